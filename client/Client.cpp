@@ -5,8 +5,9 @@
 
 Client::Client(int argc, char* argv[]):
         skt(argv[1], argv[2]),
-        thread_sender(skt),
-        thread_receiver(skt),
+        udp(),
+        thread_sender(skt, udp),
+        thread_receiver(skt, thread_sender.get_sender_queue(), udp),
         queue_sender(thread_sender.get_sender_queue()),
         queue_receiver(thread_receiver.get_queue()),
         sound_manager(),
@@ -27,6 +28,12 @@ void Client::receive_id() {
     } else {
         throw ExceptionClient("Error: socket desfazado, no se recibio el id");
     }
+
+    // Le decimos al server que version hablamos, se queda con la mas nueva que entiendan los dos
+    ServerEventSender version;
+    version.type = ServerEventSenderType::PROTOCOL_VERSION;
+    version.protocol_version = PROTOCOL_VERSION;
+    queue_sender.push(version);
 }
 
 
@@ -46,7 +53,8 @@ void Client::execute() {
             break;  // salimos del bucle principal
         }
 
-        GameloopRace gameloop_race(queue_sender, queue_receiver, user_id, sound_manager);
+        GameloopRace gameloop_race(queue_sender, queue_receiver, thread_receiver.get_snapshots(),
+                                   user_id, sound_manager);
         gameloop_race.run();
 
         sound_manager.global_quit();
@@ -10,12 +10,16 @@
 #include "ServerEvent.h"
 #include "ThreadReceiver.h"
 #include "ThreadSenderClient.h"
+#include "UdpClientChannel.h"
 
 
 class Client {
 private:
     Socket skt;
 
+    // Lo comparten los dos hilos; va antes que ellos
+    UdpClientChannel udp;
+
     ThreadSender thread_sender;
 
     ThreadReceiver thread_receiver;
@@ -2,10 +2,12 @@
 
 
 GameloopRace::GameloopRace(Queue<ServerEventSender>& queue_sender,
-                           Queue<ServerEventReceiver>& queue_receiver, uint32_t user_id,
+                           Queue<ServerEventReceiver>& queue_receiver,
+                           SnapshotMailbox& snapshots, uint32_t user_id,
                            GameSoundManager& music_manager):
         queue_sender(queue_sender),
         queue_receiver(queue_receiver),
+        snapshots(snapshots),
         _keep_running(true),
         gui_sdl(),
         user_id(user_id),
@@ -13,7 +15,8 @@ GameloopRace::GameloopRace(Queue<ServerEventSender>& queue_sender,
         music_manager(music_manager),
         playerSound(),
         input_handlers(),
-        race_manager() {}
+        race_manager(),
+        race_was_started(false) {}
 
 
 void GameloopRace::handle_change_phase() {
@@ -37,14 +40,15 @@ void GameloopRace::handle_change_phase() {
 
 
 void GameloopRace::handle_snapshot(const Snapshot& snapshot) {
+    // Confirmamos la snapshot para que el server mande la proxima como delta contra esta
+    if (snapshot.sequence != 0) {
+        send_snapshot_ack(snapshot.sequence);
+    }
 
     auto it = std::find_if(snapshot.players.begin(), snapshot.players.end(),
                            [&](const Player& p) { return p.user_id == this->user_id; });
 
-    Player main_player;
-    if (it != snapshot.players.end()) {
-        main_player = *it;
-    }
+    const Player& main_player = (it != snapshot.players.end()) ? *it : no_player;
 
     race_manager.process_snapshot(snapshot);
 
@@ -55,11 +59,16 @@ void GameloopRace::handle_snapshot(const Snapshot& snapshot) {
 }
 
 
+void GameloopRace::send_snapshot_ack(uint32_t sequence) {
+    ServerEventSender event;
+    event.type = ServerEventSenderType::SNAPSHOT_ACK;
+    event.snapshot_ack = sequence;
+    queue_sender.try_push(event);
+}
+
+
 void GameloopRace::update_game_state(const ServerEventReceiver& event) {
     switch (event.type) {
-        case ServerEventReceiverType::SNAPSHOT:
-            handle_snapshot(event.snapshot);
-            break;
         case ServerEventReceiverType::PREGAME:
             gui_sdl.set_background(event.pre_snapshot.map_selected);
             race_manager.process_pregame(event.pre_snapshot);
@@ -102,10 +111,33 @@ void GameloopRace::input_handler(const SDL_Event& input) {
 }
 
 
+void GameloopRace::send_input_state() {
+    const bool race_started = race_manager.has_race_started();
+    // Cada carrera arranca en el server con todas las teclas sueltas: si se venia apretando
+    // algo, hay que volver a mandarlo
+    if (race_started && !race_was_started) {
+        input_handlers.resend_input_state();
+    }
+    race_was_started = race_started;
+    if (!race_started) {
+        return;
+    }
+
+    // Todo lo que cambio en el frame sale junto, en un solo estado
+    ServerEventSender event = input_handlers.take_input_state();
+    if (event.type == ServerEventSenderType::SEND_INPUT_STATE) {
+        queue_sender.try_push(event);
+    }
+}
+
+
 void GameloopRace::run() {
     try {
         music_manager.playGameMusic();
 
+        // Ack 0: le avisa al server que entendemos snapshots delta (arranca con un keyframe)
+        send_snapshot_ack(0);
+
         ServerEventReceiver event;
         while (_keep_running) {
 
@@ -113,15 +145,20 @@ void GameloopRace::run() {
             while (gui_sdl.get_event(last_input)) {
                 input_handler(last_input);
             }
+            send_input_state();
 
-            event.type = ServerEventReceiverType::ERROR;
-            while (queue_receiver.try_pop(event) &&
-                   event.type == ServerEventReceiverType::SNAPSHOT) {}
+            // La snapshot se toma antes de vaciar la cola: los eventos que llegaron antes que
+            // ella ya estan en la cola y se procesan primero
+            bool new_snapshot = snapshots.take();
 
-            if (event.type != ServerEventReceiverType::ERROR) {
+            while (_keep_running && queue_receiver.try_pop(event)) {
                 update_game_state(event);
             }
 
+            if (_keep_running && new_snapshot && snapshots.latest_in_order()) {
+                handle_snapshot(snapshots.latest());
+            }
+
             if (race_manager.get_state() == GameState::SHOW_UPGRADE) {
                 gui_sdl.render_screen_upgrades(false);
             }
@@ -2,6 +2,7 @@
 #define GAMELOOPRACE_H
 
 #include "../../common/queue.h"
+#include "../SnapshotMailbox.h"
 #include "sound/PlayerSound.h"
 
 #include "GameSoundManager.h"
@@ -16,6 +17,8 @@ private:
 
     Queue<ServerEventReceiver>& queue_receiver;
 
+    SnapshotMailbox& snapshots;
+
     bool _keep_running;
 
     GuiSDL gui_sdl;
@@ -32,18 +35,27 @@ private:
 
     RacePhaseManager race_manager;
 
+    // Para mandar el estado de las teclas de nuevo cuando arranca cada carrera
+    bool race_was_started;
+
+    // Para cuando nuestro auto no viene en la snapshot, sin copiar nada por frame
+    const Player no_player{};
+
 
     void handle_snapshot(const Snapshot& snapshot);
+    void send_snapshot_ack(uint32_t sequence);
 
     void update_game_state(const ServerEventReceiver& event);
 
     void input_handler(const SDL_Event& event);
 
+    void send_input_state();
+
     void handle_change_phase();
 
 public:
     GameloopRace(Queue<ServerEventSender>& queue_sender, Queue<ServerEventReceiver>& queue_receiver,
-                 uint32_t user_id, GameSoundManager& music_manager);
+                 SnapshotMailbox& snapshots, uint32_t user_id, GameSoundManager& music_manager);
 
 
     void run();
@@ -1,27 +1,56 @@
 #include "InputHandler.h"
 
-InputHandler::InputHandler(): last_key_send(SDLK_UNKNOWN) {}
+InputHandler::InputHandler():
+        last_key_send(SDLK_UNKNOWN), held(), sent(), force_send(false) {}
 
 
-ServerEventSender InputHandler::key_unpressed(SDL_Keycode key_pressed) {
-    ServerEventSender event_send{};
-    last_key_send = SDLK_UNKNOWN;
-    event_send.type = ServerEventSenderType::SEND_KEY;
-
-    switch (key_pressed) {
+bool InputHandler::update_held(SDL_Keycode key, bool pressed) {
+    switch (key) {
         case SDLK_w:
-            event_send.send_key.key = DirectionKey::UP_UNPRESSED;
-            break;
+            held.up = pressed;
+            return true;
         case SDLK_s:
-            event_send.send_key.key = DirectionKey::DOWN_UNPRESSED;
-            break;
+            held.down = pressed;
+            return true;
         case SDLK_a:
-            event_send.send_key.key = DirectionKey::LEFT_UNPRESSED;
-            break;
+            held.left = pressed;
+            return true;
         case SDLK_d:
-            event_send.send_key.key = DirectionKey::RIGHT_UNPRESSED;
-            break;
+            held.right = pressed;
+            return true;
     }
+    return false;
+}
+
+
+ServerEventSender InputHandler::take_input_state() {
+    ServerEventSender event_send{};
+    event_send.type = ServerEventSenderType::NONE;
+
+    const bool changed = held.up != sent.up || held.down != sent.down ||
+                         held.left != sent.left || held.right != sent.right;
+    if (!changed && !force_send) {
+        return event_send;
+    }
+    force_send = false;
+
+    sent = held;
+
+    event_send.type = ServerEventSenderType::SEND_INPUT_STATE;
+    event_send.input_state = sent;
+    return event_send;
+}
+
+
+void InputHandler::resend_input_state() { force_send = true; }
+
+
+ServerEventSender InputHandler::key_unpressed(SDL_Keycode key_pressed) {
+    ServerEventSender event_send{};
+    last_key_send = SDLK_UNKNOWN;
+    event_send.type = ServerEventSenderType::NONE;
+
+    update_held(key_pressed, false);
 
     return event_send;
 }
@@ -29,7 +58,7 @@ ServerEventSender InputHandler::key_unpressed(SDL_Keycode key_pressed) {
 ServerEventSender InputHandler::key_pressed(SDL_Keycode key_pressed) {
     ServerEventSender event_send{};
 
-    if (key_pressed == last_key_send) {
+    if (update_held(key_pressed, true) || key_pressed == last_key_send) {
         event_send.type = ServerEventSenderType::NONE;
         return event_send;
     }
@@ -43,19 +72,6 @@ ServerEventSender InputHandler::key_pressed(SDL_Keycode key_pressed) {
     send_key.key = DirectionKey::None;
 
     switch (key_pressed) {
-        case SDLK_w:
-            send_key.key = DirectionKey::UP_PRESSED;
-            break;
-        case SDLK_s:
-            send_key.key = DirectionKey::DOWN_PRESSED;
-            break;
-        case SDLK_a:
-            send_key.key = DirectionKey::LEFT_PRESSED;
-            break;
-        case SDLK_d:
-            send_key.key = DirectionKey::RIGHT_PRESSED;
-            break;
-
         case SDLK_u:
             send_key.key = DirectionKey::GHOST;
             break;
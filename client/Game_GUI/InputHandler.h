@@ -11,6 +11,14 @@ class InputHandler {
 private:
     SDL_Keycode last_key_send;
 
+    // Teclas de movimiento como estan ahora y como se mandaron por ultima vez
+    SendInputState held;
+    SendInputState sent;
+    bool force_send;
+
+    // true si key es de movimiento (W/A/S/D), y en ese caso la anota en held
+    bool update_held(SDL_Keycode key, bool pressed);
+
     ServerEventSender key_unpressed(SDL_Keycode key_pressed);
 
     ServerEventSender key_pressed(SDL_Keycode key_pressed);
@@ -18,7 +26,17 @@ private:
 public:
     InputHandler();
 
+    // Las teclas de movimiento no generan eventos: se juntan en el estado de take_input_state
     ServerEventSender event_handler(const SDL_Event& event);
+
+    // Una vez por frame, despues de procesar los eventos. Si las teclas de movimiento
+    // cambiaron desde el ultimo estado mandado devuelve el nuevo (SEND_INPUT_STATE; la
+    // secuencia se la pone el ThreadSender); si no, NONE
+    ServerEventSender take_input_state();
+
+    // El proximo take_input_state devuelve el estado aunque no haya cambiado (el server lo
+    // perdio, por ejemplo al arrancar otra carrera)
+    void resend_input_state();
 };
 
 
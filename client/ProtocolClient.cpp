@@ -1,5 +1,6 @@
 #include "ProtocolClient.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
 #include <unordered_map>
@@ -8,30 +9,78 @@
 
 #include "../common/operations_bytes.h"
 
-ProtocolClient::ProtocolClient(ISocket& skt): skt(skt) {}
+ProtocolClient::ProtocolClient(ISocket& skt): skt(skt), snapshot_history(SNAPSHOT_HISTORY) {}
 
-std::vector<uint8_t> ProtocolClient::send_key(SendKey send_key) {
-
-    std::unordered_map<DirectionKey, uint8_t> key_map = {
-            {DirectionKey::UP_PRESSED, UP_PRESSED},
-            {DirectionKey::LEFT_PRESSED, LEFT_PRESSED},
-            {DirectionKey::DOWN_PRESSED, DOWN_PRESSED},
-            {DirectionKey::RIGHT_PRESSED, RIGHT_PRESSED},
-            {DirectionKey::UP_UNPRESSED, UP_UNPRESSED},
-            {DirectionKey::LEFT_UNPRESSED, LEFT_UNPRESSED},
-            {DirectionKey::DOWN_UNPRESSED, DOWN_UNPRESSED},
-            {DirectionKey::RIGHT_UNPRESSED, RIGHT_UNPRESSED},
+uint8_t ProtocolClient::key_code(DirectionKey key) {
+    static const std::unordered_map<DirectionKey, uint8_t> key_map = {
             {DirectionKey::WIN, COMMAND_WIN},
             {DirectionKey::LOSE, COMMAND_LOSE},
             {DirectionKey::INFINITE_LIFE, COMMAND_INFINITE_LIFE},
             {DirectionKey::GHOST, COMMAND_GHOST},
     };
 
-    auto it = key_map.find(send_key.key);
-    if (it == key_map.end())
+    auto it = key_map.find(key);
+    return it == key_map.end() ? NO_KEY : it->second;
+}
+
+
+std::vector<uint8_t> ProtocolClient::send_key(SendKey send_key) {
+    const uint8_t code = key_code(send_key.key);
+    if (code == NO_KEY)
         return {};
 
-    return {INPUT_KEY, it->second};
+    return {INPUT_KEY, code};
+}
+
+
+uint8_t ProtocolClient::input_state_keys(const SendInputState& input_state) {
+    uint8_t keys = 0;
+    if (input_state.up)
+        keys |= INPUT_STATE_UP;
+    if (input_state.left)
+        keys |= INPUT_STATE_LEFT;
+    if (input_state.down)
+        keys |= INPUT_STATE_DOWN;
+    if (input_state.right)
+        keys |= INPUT_STATE_RIGHT;
+    return keys;
+}
+
+void ProtocolClient::number_input_state(SendInputState& input_state) {
+    input_state.sequence = next_input_sequence++;
+}
+
+
+std::vector<uint8_t> ProtocolClient::send_input_state(const SendInputState& input_state) {
+    std::vector<uint8_t> message;
+    message.reserve(1 + 4 + 1);
+    message.push_back(SEND_INPUT_STATE);
+    operation.add_four_bytes(input_state.sequence, message);
+    message.push_back(input_state_keys(input_state));
+    return message;
+}
+
+
+std::vector<uint8_t> ProtocolClient::encode_udp_hello(uint32_t client_id, uint32_t token) {
+    std::vector<uint8_t> message;
+    message.reserve(1 + 4 + 4);
+    OperationsBytes::add_one_byte(UDP_HELLO, message);
+    OperationsBytes::add_four_bytes(client_id, message);
+    OperationsBytes::add_four_bytes(token, message);
+    return message;
+}
+
+
+std::vector<uint8_t> ProtocolClient::encode_udp_input_state(uint32_t client_id, uint32_t token,
+                                                            const SendInputState& input_state) {
+    std::vector<uint8_t> message;
+    message.reserve(1 + 4 + 4 + 4 + 1);
+    OperationsBytes::add_one_byte(UDP_INPUT_STATE, message);
+    OperationsBytes::add_four_bytes(client_id, message);
+    OperationsBytes::add_four_bytes(token, message);
+    OperationsBytes::add_four_bytes(input_state.sequence, message);
+    OperationsBytes::add_one_byte(input_state_keys(input_state), message);
+    return message;
 }
 
 
@@ -41,6 +90,9 @@ void ProtocolClient::send_event(const ServerEventSender& event) {
     if (event.type == ServerEventSenderType::SEND_KEY) {
         message = send_key(event.send_key);
 
+    } else if (event.type == ServerEventSenderType::SEND_INPUT_STATE) {
+        message = send_input_state(event.input_state);
+
     } else if (event.type == ServerEventSenderType::CREATE_LOBBY) {
         message = send_create_lobby(event.create_lobby);
 
@@ -56,13 +108,40 @@ void ProtocolClient::send_event(const ServerEventSender& event) {
     } else if (event.type == ServerEventSenderType::LEAVE_LOBBY) {
         message.push_back(SEND_LEAVE);
 
+    } else if (event.type == ServerEventSenderType::SNAPSHOT_ACK) {
+        message.push_back(SEND_SNAPSHOT_ACK);
+        operation.add_four_bytes(event.snapshot_ack, message);
+
+    } else if (event.type == ServerEventSenderType::PROTOCOL_VERSION) {
+        message.push_back(SEND_PROTOCOL_VERSION);
+        message.push_back(event.protocol_version);
+
+    } else if (event.type == ServerEventSenderType::UDP_READY) {
+        message.push_back(SEND_UDP_READY);
+
     } else {
         return;
     }
 
-    if (!skt.is_stream_send_closed()) {
+    if (skt.is_stream_send_closed()) {
+        return;
+    }
+
+    if (framed_commands) {
+        std::vector<uint8_t> frame;
+        frame.reserve(2 + message.size());
+        operation.add_two_bytes(static_cast<uint16_t>(message.size()), frame);
+        frame.insert(frame.end(), message.begin(), message.end());
+        skt.sendall(frame.data(), frame.size());
+    } else {
         skt.sendall(message.data(), message.size());
     }
+
+    // La version misma va sin frame; lo que sigue ya va con frame
+    if (event.type == ServerEventSenderType::PROTOCOL_VERSION &&
+        event.protocol_version >= PROTOCOL_VERSION_FRAMED) {
+        framed_commands = true;
+    }
 }
 
 
@@ -129,39 +208,67 @@ std::vector<uint8_t> ProtocolClient::send_join_lobby(JoinToLobby join_lobby) {
 
 ServerEventReceiver ProtocolClient::receive_event(bool& is_socket_closed) {
     ServerEventReceiver return_event;
+    receive_event(is_socket_closed, return_event, return_event.snapshot);
+    return return_event;
+}
 
+
+void ProtocolClient::receive_event(bool& is_socket_closed, ServerEventReceiver& return_event,
+                                   Snapshot& snapshot) {
     uint8_t protocol = 0x00;
     is_socket_closed = false;
+    return_event.type = ServerEventReceiverType::ERROR;
 
     int leidos = skt.recvall(reinterpret_cast<char*>(&protocol), 1);
 
     if (leidos <= 0) {
         is_socket_closed = true;
-        return return_event;
+        return;
     }
     switch (protocol) {
         case RECEIVE_SNAPSHOT:
-            return receive_snapshot();
+            if (receive_snapshot(snapshot))
+                return_event.type = ServerEventReceiverType::SNAPSHOT;
+            break;
+
+        case RECEIVE_SNAPSHOT_DELTA:
+            if (receive_snapshot_delta(snapshot))
+                return_event.type = ServerEventReceiverType::SNAPSHOT;
+            break;
+
+        case RECEIVE_SNAPSHOT_COMPACT:
+            if (receive_snapshot_compact(snapshot))
+                return_event.type = ServerEventReceiverType::SNAPSHOT;
+            break;
 
         case RECEIVE_ID:
-            return receive_id();
+            return_event = receive_id();
+            break;
 
         case RECEIVE_JOIN_ERROR:
             return_event.type = ServerEventReceiverType::ERROR;
             break;
 
         case RECEIVE_SNAPSHOT_LOBBY:
-            return receive_snapshot_lobby();
+            return_event = receive_snapshot_lobby();
+            break;
 
         case RECEIVE_START_GAME:
             return_event.type = ServerEventReceiverType::START_GAME;
             break;
 
         case RECEIVE_PREGAME_SNAPSHOT:
-            return receive_pre_game_snapshot();
+            return_event = receive_pre_game_snapshot();
+            break;
+
+        case RECEIVE_PREGAME_CHECKPOINTS:
+            return_event = receive_pre_game_snapshot();
+            receive_checkpoint_table();
+            break;
 
         case RECEIVE_RACE_RESULTS:
-            return receive_race_results();
+            return_event = receive_race_results();
+            break;
 
         case RECEIVE_SUCESS:
             return_event.type = ServerEventReceiverType::SUCESS;
@@ -169,8 +276,21 @@ ServerEventReceiver ProtocolClient::receive_event(bool& is_socket_closed) {
 
         case RECEIVE_CHANGE_FASE:
             return_event.type = ServerEventReceiverType::CHANGE_FASE;
+            break;
+
+        case RECEIVE_UDP_OFFER:
+            return_event = receive_udp_offer();
+            break;
     }
-    return return_event;
+}
+
+
+ServerEventReceiver ProtocolClient::receive_udp_offer() {
+    ServerEventReceiver event;
+    event.type = ServerEventReceiverType::UDP_OFFER;
+    event.udp_port = operation.receive_two_bytes(skt);
+    event.udp_token = operation.receive_four_bytes(skt);
+    return event;
 }
 
 
@@ -327,17 +447,48 @@ ServerEventReceiver ProtocolClient::receive_snapshot_lobby() {
 }
 
 
-ServerEventReceiver ProtocolClient::receive_snapshot() {
-    ServerEventReceiver event;
-    event.type = ServerEventReceiverType::SNAPSHOT;
+// Deja al jugador como recien creado sin soltar la memoria de sus checkpoints
+static void reset_player(Player& player) {
+    player.next_checkpoint.clear();
+    player.secondary_checkpoint.clear();
+    player.user_id = 0;
+    player.is_car_ghost = false;
+    player.player_position = {0, 0};
+    player.car_coord_z = 0;
+    player.is_secondary_check = false;
+    player.car_life = 0;
+    player.car_model = 0;
+    player.car_animation = 0;
+    player.type_sound = TypeSound::NONE;
+    player.rotation = 0;
+    player.is_checkpoint_finishline = false;
+    player.is_secondary_finishline = false;
+}
+
+
+// Arranca al jugador desde el del baseline (si estaba) para pisarle lo que venga
+static void copy_from_baseline(Player& player, uint32_t user_id, const Snapshot* baseline) {
+    if (baseline) {
+        auto it = std::find_if(baseline->players.begin(), baseline->players.end(),
+                               [&](const Player& p) { return p.user_id == user_id; });
+        if (it != baseline->players.end()) {
+            player = *it;
+            return;
+        }
+    }
+    reset_player(player);
+    player.user_id = user_id;
+}
 
-    uint32_t actual_time = operation.receive_four_bytes(skt);
-    event.snapshot.actual_time = actual_time;
+
+bool ProtocolClient::receive_snapshot(Snapshot& snapshot) {
+    snapshot.sequence = 0;
+    snapshot.actual_time = operation.receive_four_bytes(skt);
 
     uint16_t amount_players = operation.receive_two_bytes(skt);
+    snapshot.players.resize(amount_players);
 
-    for (int i = 0; i < amount_players; i++) {
-        Player player;
+    for (Player& player: snapshot.players) {
         player.user_id = operation.receive_four_bytes(skt);
 
         uint8_t is_ghost = operation.receive_one_byte(skt);
@@ -348,66 +499,343 @@ ServerEventReceiver ProtocolClient::receive_snapshot() {
 
         player.car_animation = operation.receive_one_byte(skt);
 
-        uint8_t type_sound = operation.receive_one_byte(skt);
-        if (type_sound == 0x01) {
-            player.type_sound = TypeSound::STOP;
-
-        } else if (type_sound == 0x02) {
-            player.type_sound = TypeSound::FINISH;
-
-        } else {
-            player.type_sound = TypeSound::NONE;
-        }
+        player.type_sound = receive_sound();
 
         player.player_position.coord_x = operation.receive_four_bytes(skt);
         player.player_position.coord_y = operation.receive_four_bytes(skt);
         player.car_coord_z = operation.receive_one_byte(skt);
         player.rotation = operation.receive_four_bytes(skt);
 
-        uint16_t amount_checkpoints = operation.receive_two_bytes(skt);
+        receive_player_checkpoints(player);
+    }
+
+    uint16_t amount_npc = operation.receive_two_bytes(skt);
+    snapshot.npcs.resize(amount_npc);
+    for (NPC& npc: snapshot.npcs) {
+        npc.model = operation.receive_two_bytes(skt);
+        npc.car_animation = operation.receive_one_byte(skt);
+        npc.pos = {operation.receive_four_bytes(skt), operation.receive_four_bytes(skt)};
+        npc.pos_z = operation.receive_one_byte(skt);
+        npc.rotation = operation.receive_four_bytes(skt);
+    }
+
+    return true;
+}
+
+
+static TypeSound to_type_sound(uint8_t type_sound) {
+    if (type_sound == 0x01) {
+        return TypeSound::STOP;
+    }
+    if (type_sound == 0x02) {
+        return TypeSound::FINISH;
+    }
+    return TypeSound::NONE;
+}
+
+
+TypeSound ProtocolClient::receive_sound() { return to_type_sound(operation.receive_one_byte(skt)); }
+
+
+// Inversas de la cuantizacion del server: 16 bits relativos al mapa y 256 pasos por vuelta
+static uint32_t dequantize_coord(uint16_t q, uint32_t extent) {
+    if (extent == 0) {
+        return q;
+    }
+    return static_cast<uint32_t>((static_cast<uint64_t>(q) * extent + UINT16_MAX / 2) / UINT16_MAX);
+}
+
+
+static uint32_t dequantize_angle(uint8_t q) { return (static_cast<uint32_t>(q) * 360 + 128) / 256; }
+
+
+void ProtocolClient::receive_checkpoint_table() {
+    race_checkpoints.clear();
+    max_checkpoint_order = 0;
+
+    uint16_t amount = operation.receive_two_bytes(skt);
+    for (uint16_t i = 0; i < amount; i++) {
+        uint16_t order = operation.receive_two_bytes(skt);
+        RaceCheckpoint checkpoint;
+        checkpoint.goal = operation.receive_one_byte(skt) != 0;
+
+        uint16_t amount_cells = operation.receive_two_bytes(skt);
+        checkpoint.cells.reserve(amount_cells);
+        for (uint16_t j = 0; j < amount_cells; j++) {
+            uint32_t x = operation.receive_four_bytes(skt);
+            uint32_t y = operation.receive_four_bytes(skt);
+            checkpoint.cells.push_back({x, y});
+        }
+        max_checkpoint_order = std::max(max_checkpoint_order, order);
+        race_checkpoints[order] = std::move(checkpoint);
+    }
+}
+
+
+// Misma regla que el server: el segundo es el de orden siguiente, si no era el ultimo
+void ProtocolClient::apply_next_order(Player& player, uint16_t next_order) const {
+    player.next_checkpoint.clear();
+    player.is_checkpoint_finishline = false;
+    player.secondary_checkpoint.clear();
+    player.is_secondary_check = false;
+    player.is_secondary_finishline = false;
+
+    auto next = race_checkpoints.find(next_order);
+    if (next == race_checkpoints.end()) {
+        return;
+    }
+    player.next_checkpoint = next->second.cells;
+    player.is_checkpoint_finishline = next->second.goal;
+
+    if (next_order >= max_checkpoint_order) {
+        return;
+    }
+    auto second = race_checkpoints.find(static_cast<uint16_t>(next_order + 1));
+    if (second != race_checkpoints.end()) {
+        player.is_secondary_check = true;
+        player.secondary_checkpoint = second->second.cells;
+        player.is_secondary_finishline = second->second.goal;
+    }
+}
+
+
+bool ProtocolClient::receive_snapshot_compact(Snapshot& snapshot) {
+    uint32_t sequence = operation.receive_varint(skt);
+    uint32_t baseline_sequence = operation.receive_varint(skt);
+
+    const Snapshot* baseline = nullptr;
+    bool has_baseline = true;
+    if (baseline_sequence != 0) {
+        baseline = find_snapshot(baseline_sequence);
+        has_baseline = (baseline != nullptr);
+    }
+
+    snapshot.sequence = sequence;
+    snapshot.actual_time = operation.receive_varint(skt);
+
+    uint32_t width = operation.receive_varint(skt);
+    uint32_t height = operation.receive_varint(skt);
+
+    // Roster: ids en orden, el indice de cada jugador es su posicion. Si no viene es el mismo
+    // del baseline
+    roster.clear();
+    uint8_t header = operation.receive_one_byte(skt);
+    if (header & COMPACT_HAS_ROSTER) {
+        uint32_t amount_players = operation.receive_varint(skt);
+        for (uint32_t i = 0; i < amount_players; i++) {
+            roster.push_back(operation.receive_varint(skt));
+        }
+    } else if (baseline) {
+        for (const Player& p: baseline->players) {
+            roster.push_back(p.user_id);
+        }
+    }
+
+    // Arrancamos de los jugadores del baseline y pisamos lo que vino
+    snapshot.players.resize(roster.size());
+    for (std::size_t i = 0; i < roster.size(); i++) {
+        copy_from_baseline(snapshot.players[i], roster[i], baseline);
+    }
+
+    Player discarded{};
+    uint32_t changed_players = operation.receive_varint(skt);
+    for (uint32_t i = 0; i < changed_players; i++) {
+        uint32_t index = operation.receive_varint(skt);
+        uint8_t mask = operation.receive_one_byte(skt);
+
+        // Un indice fuera del roster igual se lee entero para no desincronizar el socket
+        Player& player = (index < snapshot.players.size()) ? snapshot.players[index] : discarded;
+
+        if (mask & PLAYER_COMPACT_FLAGS) {
+            uint8_t flags = operation.receive_one_byte(skt);
+            player.is_car_ghost = (flags & 0x01) != 0;
+            player.type_sound = to_type_sound((flags >> 1) & 0x03);
+            player.car_coord_z = static_cast<uint8_t>(flags >> 3);
+        }
+        if (mask & PLAYER_COMPACT_LIFE)
+            player.car_life = static_cast<uint16_t>(operation.receive_varint(skt));
+        if (mask & PLAYER_COMPACT_MODEL)
+            player.car_model = static_cast<uint16_t>(operation.receive_varint(skt));
+        if (mask & PLAYER_COMPACT_ANIMATION)
+            player.car_animation = operation.receive_one_byte(skt);
+        if (mask & PLAYER_COMPACT_POS) {
+            player.player_position.coord_x =
+                    dequantize_coord(operation.receive_two_bytes(skt), width);
+            player.player_position.coord_y =
+                    dequantize_coord(operation.receive_two_bytes(skt), height);
+        }
+        if (mask & PLAYER_COMPACT_ANGLE)
+            player.rotation = dequantize_angle(operation.receive_one_byte(skt));
+        if (mask & PLAYER_COMPACT_NEXT_ORDER)
+            apply_next_order(player, static_cast<uint16_t>(operation.receive_varint(skt)));
+    }
+
+    uint32_t amount_npc = operation.receive_varint(skt);
+    snapshot.npcs.resize(amount_npc);
+    for (uint32_t i = 0; i < amount_npc; i++) {
+        snapshot.npcs[i] = (baseline && i < baseline->npcs.size()) ? baseline->npcs[i] : NPC{};
+    }
+
+    NPC discarded_npc{};
+    uint32_t changed_npcs = operation.receive_varint(skt);
+    for (uint32_t i = 0; i < changed_npcs; i++) {
+        uint32_t index = operation.receive_varint(skt);
+        uint8_t mask = operation.receive_one_byte(skt);
+
+        NPC& npc = (index < snapshot.npcs.size()) ? snapshot.npcs[index] : discarded_npc;
+
+        if (mask & NPC_COMPACT_Z)
+            npc.pos_z = operation.receive_one_byte(skt);
+        if (mask & NPC_COMPACT_MODEL)
+            npc.model = static_cast<uint16_t>(operation.receive_varint(skt));
+        if (mask & NPC_COMPACT_ANIMATION)
+            npc.car_animation = operation.receive_one_byte(skt);
+        if (mask & NPC_COMPACT_POS) {
+            npc.pos.coord_x = dequantize_coord(operation.receive_two_bytes(skt), width);
+            npc.pos.coord_y = dequantize_coord(operation.receive_two_bytes(skt), height);
+        }
+        if (mask & NPC_COMPACT_ANGLE)
+            npc.rotation = dequantize_angle(operation.receive_one_byte(skt));
+    }
+
+    if (!has_baseline) {
+        return false;
+    }
+
+    store_snapshot(snapshot);
+    return true;
+}
+
+
+void ProtocolClient::receive_player_checkpoints(Player& player) {
+    player.next_checkpoint.clear();
+    player.secondary_checkpoint.clear();
+
+    uint16_t amount_checkpoints = operation.receive_two_bytes(skt);
+
+    for (int j = 0; j < amount_checkpoints; j++) {
+        player.next_checkpoint.push_back(
+                {operation.receive_four_bytes(skt), operation.receive_four_bytes(skt)});
+    }
+
+    uint8_t is_finishline = operation.receive_one_byte(skt);
+    player.is_checkpoint_finishline = (is_finishline != 0x00);
+
+
+    uint8_t is_secondaty_check = operation.receive_one_byte(skt);
+    player.is_secondary_check = (is_secondaty_check == 0x01);
+
+    player.is_secondary_finishline = false;
+    if (player.is_secondary_check) {
+        amount_checkpoints = operation.receive_two_bytes(skt);
 
         for (int j = 0; j < amount_checkpoints; j++) {
-            player.next_checkpoint.push_back(
+            player.secondary_checkpoint.push_back(
                     {operation.receive_four_bytes(skt), operation.receive_four_bytes(skt)});
         }
 
-        uint8_t is_finishline = operation.receive_one_byte(skt);
-        player.is_checkpoint_finishline = (is_finishline != 0x00);
+        is_finishline = operation.receive_one_byte(skt);
+        player.is_secondary_finishline = (is_finishline != 0x00);
+    }
+}
 
 
-        uint8_t is_secondaty_check = operation.receive_one_byte(skt);
-        player.is_secondary_check = (is_secondaty_check == 0x01);
+const Snapshot* ProtocolClient::find_snapshot(uint32_t sequence) const {
+    // De la mas nueva a la mas vieja; los slots sin usar tienen secuencia 0
+    for (std::size_t i = 1; i <= snapshot_history.size(); i++) {
+        const Snapshot& candidate =
+                snapshot_history[(history_next + snapshot_history.size() - i) %
+                                 snapshot_history.size()];
+        if (candidate.sequence == sequence) {
+            return &candidate;
+        }
+    }
+    return nullptr;
+}
 
-        player.is_secondary_finishline = false;
-        if (player.is_secondary_check) {
-            amount_checkpoints = operation.receive_two_bytes(skt);
 
-            for (int j = 0; j < amount_checkpoints; j++) {
-                player.secondary_checkpoint.push_back(
-                        {operation.receive_four_bytes(skt), operation.receive_four_bytes(skt)});
-            }
+void ProtocolClient::store_snapshot(const Snapshot& snapshot) {
+    snapshot_history[history_next] = snapshot;
+    history_next = (history_next + 1) % snapshot_history.size();
+}
 
-            is_finishline = operation.receive_one_byte(skt);
-            player.is_secondary_finishline = (is_finishline != 0x00);
-        }
 
+bool ProtocolClient::receive_snapshot_delta(Snapshot& snapshot) {
+    uint32_t sequence = operation.receive_four_bytes(skt);
+    uint32_t baseline_sequence = operation.receive_four_bytes(skt);
 
-        event.snapshot.players.push_back(player);
+    // baseline 0 = keyframe. Si no tenemos el baseline igual hay que leer todo el mensaje
+    // para no desincronizar el socket, pero la snapshot no sirve y no se confirma
+    const Snapshot* baseline = nullptr;
+    bool has_baseline = true;
+    if (baseline_sequence != 0) {
+        baseline = find_snapshot(baseline_sequence);
+        has_baseline = (baseline != nullptr);
+    }
+
+    snapshot.sequence = sequence;
+    snapshot.actual_time = operation.receive_four_bytes(skt);
+
+    uint16_t amount_players = operation.receive_two_bytes(skt);
+    snapshot.players.resize(amount_players);
+
+    for (Player& player: snapshot.players) {
+        uint32_t user_id = operation.receive_four_bytes(skt);
+        uint16_t mask = operation.receive_two_bytes(skt);
+
+        copy_from_baseline(player, user_id, baseline);
+
+        if (mask & PLAYER_DELTA_GHOST)
+            player.is_car_ghost = (operation.receive_one_byte(skt) == 0x01);
+        if (mask & PLAYER_DELTA_LIFE)
+            player.car_life = operation.receive_two_bytes(skt);
+        if (mask & PLAYER_DELTA_MODEL)
+            player.car_model = operation.receive_two_bytes(skt);
+        if (mask & PLAYER_DELTA_ANIMATION)
+            player.car_animation = operation.receive_one_byte(skt);
+        if (mask & PLAYER_DELTA_SOUND)
+            player.type_sound = receive_sound();
+        if (mask & PLAYER_DELTA_X)
+            player.player_position.coord_x = operation.receive_four_bytes(skt);
+        if (mask & PLAYER_DELTA_Y)
+            player.player_position.coord_y = operation.receive_four_bytes(skt);
+        if (mask & PLAYER_DELTA_Z)
+            player.car_coord_z = operation.receive_one_byte(skt);
+        if (mask & PLAYER_DELTA_ANGLE)
+            player.rotation = operation.receive_four_bytes(skt);
+        if (mask & PLAYER_DELTA_CHECKPOINTS)
+            receive_player_checkpoints(player);
     }
 
     uint16_t amount_npc = operation.receive_two_bytes(skt);
-    for (int i = 0; i < amount_npc; i++) {
-        NPC npc;
-        npc.model = operation.receive_two_bytes(skt);
-        npc.car_animation = operation.receive_one_byte(skt);
-        npc.pos = {operation.receive_four_bytes(skt), operation.receive_four_bytes(skt)};
-        npc.pos_z = operation.receive_one_byte(skt);
-        npc.rotation = operation.receive_four_bytes(skt);
+    snapshot.npcs.resize(amount_npc);
+
+    for (std::size_t i = 0; i < amount_npc; i++) {
+        uint8_t mask = operation.receive_one_byte(skt);
+
+        NPC& npc = snapshot.npcs[i];
+        npc = (baseline && i < baseline->npcs.size()) ? baseline->npcs[i] : NPC{};
+
+        if (mask & NPC_DELTA_MODEL)
+            npc.model = operation.receive_two_bytes(skt);
+        if (mask & NPC_DELTA_ANIMATION)
+            npc.car_animation = operation.receive_one_byte(skt);
+        if (mask & NPC_DELTA_X)
+            npc.pos.coord_x = operation.receive_four_bytes(skt);
+        if (mask & NPC_DELTA_Y)
+            npc.pos.coord_y = operation.receive_four_bytes(skt);
+        if (mask & NPC_DELTA_Z)
+            npc.pos_z = operation.receive_one_byte(skt);
+        if (mask & NPC_DELTA_ANGLE)
+            npc.rotation = operation.receive_four_bytes(skt);
+    }
 
-        event.snapshot.npcs.push_back(npc);
+    if (!has_baseline) {
+        return false;
     }
 
-    return event;
+    store_snapshot(snapshot);
+    return true;
 }
 
 
@@ -1,6 +1,8 @@
 #ifndef PROTOCOL_CLIENT_H
 #define PROTOCOL_CLIENT_H
 
+#include <cstddef>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -14,17 +16,33 @@ const int8_t SEND_JOIN_LOBBY = 0X17;
 const int8_t SEND_START_GAME = 0X22;
 const uint8_t SEND_CAR_UPGRADE = 0X33;
 const uint8_t SEND_LEAVE = 0X34;
+const uint8_t SEND_SNAPSHOT_ACK = 0x35;
+const uint8_t SEND_PROTOCOL_VERSION = 0x36;
+const uint8_t SEND_UDP_READY = 0x37;
+
+// Version de protocolo que anunciamos al conectar (2 = snapshots compactas, 3 = ademas los
+// comandos van en frames [u16 largo][comando], 4 = sabemos usar el canal UDP si lo ofrecen,
+// 5 = el movimiento va como estado de las teclas y no tecla por tecla)
+const uint8_t PROTOCOL_VERSION_FRAMED = 3;
+const uint8_t PROTOCOL_VERSION_UDP = 4;
+const uint8_t PROTOCOL_VERSION_INPUT_STATE = 5;
+const uint8_t PROTOCOL_VERSION = PROTOCOL_VERSION_INPUT_STATE;
+
+// Datagramas del canal UDP. Del server llegan el ack del saludo o snapshots con el mismo
+// formato que por TCP
+const uint8_t UDP_HELLO = 0x40;
+const uint8_t UDP_HELLO_ACK = 0x41;
+const uint8_t UDP_INPUT_STATE = 0x43;
+
+// Estado de las teclas de movimiento: [u32 secuencia][u8 teclas]
+const uint8_t SEND_INPUT_STATE = 0x13;
+const uint8_t INPUT_STATE_UP = 1 << 0;
+const uint8_t INPUT_STATE_LEFT = 1 << 1;
+const uint8_t INPUT_STATE_DOWN = 1 << 2;
+const uint8_t INPUT_STATE_RIGHT = 1 << 3;
 
 const uint8_t INPUT_KEY = 0x12;
-// Keys luego de input_key
-const uint8_t UP_PRESSED = 0x00;
-const uint8_t LEFT_PRESSED = 0x01;
-const uint8_t DOWN_PRESSED = 0x02;
-const uint8_t RIGHT_PRESSED = 0x03;
-const uint8_t UP_UNPRESSED = 0x04;
-const uint8_t LEFT_UNPRESSED = 0x05;
-const uint8_t DOWN_UNPRESSED = 0x06;
-const uint8_t RIGHT_UNPRESSED = 0x07;
+// Trucos luego de input_key
 const uint8_t COMMAND_WIN = 0x08;
 const uint8_t COMMAND_LOSE = 0x09;
 const uint8_t COMMAND_INFINITE_LIFE = 0x10;
@@ -32,6 +50,8 @@ const uint8_t COMMAND_GHOST = 0x11;
 
 
 const uint8_t RECEIVE_SNAPSHOT = 0x01;
+const uint8_t RECEIVE_SNAPSHOT_DELTA = 0x02;
+const uint8_t RECEIVE_SNAPSHOT_COMPACT = 0x03;
 const uint8_t RECEIVE_ID = 0x15;
 const uint8_t RECEIVE_JOIN_ERROR = 0x20;
 const uint8_t RECEIVE_SNAPSHOT_LOBBY = 0x21;
@@ -44,9 +64,61 @@ const uint8_t UP = 0X03;
 const uint8_t DOWN = 0X04;
 
 const uint8_t RECEIVE_RACE_RESULTS = 0x24;
+const uint8_t RECEIVE_PREGAME_CHECKPOINTS = 0x25;
+const uint8_t RECEIVE_UDP_OFFER = 0x26;
 const uint8_t RECEIVE_SUCESS = 0x30;
 const uint8_t RECEIVE_CHANGE_FASE = 0x32;
 
+// Campos presentes de cada jugador en una snapshot delta
+const uint16_t PLAYER_DELTA_GHOST = 1 << 0;
+const uint16_t PLAYER_DELTA_LIFE = 1 << 1;
+const uint16_t PLAYER_DELTA_MODEL = 1 << 2;
+const uint16_t PLAYER_DELTA_ANIMATION = 1 << 3;
+const uint16_t PLAYER_DELTA_SOUND = 1 << 4;
+const uint16_t PLAYER_DELTA_X = 1 << 5;
+const uint16_t PLAYER_DELTA_Y = 1 << 6;
+const uint16_t PLAYER_DELTA_Z = 1 << 7;
+const uint16_t PLAYER_DELTA_ANGLE = 1 << 8;
+const uint16_t PLAYER_DELTA_CHECKPOINTS = 1 << 9;
+const uint16_t PLAYER_DELTA_ALL = (1 << 10) - 1;
+
+// Campos presentes de cada NPC en una snapshot delta
+const uint8_t NPC_DELTA_MODEL = 1 << 0;
+const uint8_t NPC_DELTA_ANIMATION = 1 << 1;
+const uint8_t NPC_DELTA_X = 1 << 2;
+const uint8_t NPC_DELTA_Y = 1 << 3;
+const uint8_t NPC_DELTA_Z = 1 << 4;
+const uint8_t NPC_DELTA_ANGLE = 1 << 5;
+const uint8_t NPC_DELTA_ALL = (1 << 6) - 1;
+
+// Snapshot compacta: header y campos de jugador y NPC
+const uint8_t COMPACT_HAS_ROSTER = 1 << 0;
+
+const uint8_t PLAYER_COMPACT_FLAGS = 1 << 0;
+const uint8_t PLAYER_COMPACT_LIFE = 1 << 1;
+const uint8_t PLAYER_COMPACT_MODEL = 1 << 2;
+const uint8_t PLAYER_COMPACT_ANIMATION = 1 << 3;
+const uint8_t PLAYER_COMPACT_POS = 1 << 4;
+const uint8_t PLAYER_COMPACT_ANGLE = 1 << 5;
+const uint8_t PLAYER_COMPACT_NEXT_ORDER = 1 << 6;
+const uint8_t PLAYER_COMPACT_ALL = (1 << 7) - 1;
+
+const uint8_t NPC_COMPACT_Z = 1 << 0;
+const uint8_t NPC_COMPACT_MODEL = 1 << 1;
+const uint8_t NPC_COMPACT_ANIMATION = 1 << 2;
+const uint8_t NPC_COMPACT_POS = 1 << 3;
+const uint8_t NPC_COMPACT_ANGLE = 1 << 4;
+const uint8_t NPC_COMPACT_ALL = (1 << 5) - 1;
+
+// Checkpoint de la carrera, la tabla llega una vez en la pre-game
+struct RaceCheckpoint {
+    bool goal = false;
+    std::vector<Coords> cells;
+};
+
+// Cuantas snapshots decodificadas guardamos para usar de baseline de las deltas
+const std::size_t SNAPSHOT_HISTORY = 128;
+
 class ProtocolClient {
 
 private:
@@ -54,8 +126,29 @@ private:
 
     OperationsBytes operation;
 
+    // Despues de anunciar PROTOCOL_VERSION_FRAMED todo comando sale con su largo adelante
+    bool framed_commands = false;
+
+    // Ultimas snapshots armadas (con numero de secuencia), baselines de las deltas. Es un
+    // anillo de slots que se pisan por asignacion, asi reusan la memoria de sus vectores
+    std::vector<Snapshot> snapshot_history;
+    std::size_t history_next = 0;
+
+    // Ids del roster de la snapshot compacta que se esta leyendo
+    std::vector<uint32_t> roster;
+
+    // Checkpoints de la carrera actual por orden; las snapshots compactas solo mandan el orden
+    std::map<uint16_t, RaceCheckpoint> race_checkpoints;
+    uint16_t max_checkpoint_order = 0;
+
+    // Secuencia de los estados de las teclas. Es de la conexion y no de la carrera: el server
+    // (la sesion UDP vive lo que la conexion) descarta los que no superan al ultimo que vio
+    uint32_t next_input_sequence = 1;
+
     std::vector<uint8_t> send_key(SendKey send_key);
 
+    std::vector<uint8_t> send_input_state(const SendInputState& input_state);
+
     std::vector<uint8_t> send_create_lobby(CreateToLobby snapshot);
 
     std::vector<uint8_t> send_join_lobby(JoinToLobby snapshot);
@@ -67,20 +160,59 @@ private:
 
     ServerEventReceiver receive_snapshot_lobby();
 
-    ServerEventReceiver receive_snapshot();
+    // Decodifican sobre snapshot, reusando lo que ya tenga. false si la delta no sirve (no
+    // tenemos su baseline)
+    bool receive_snapshot(Snapshot& snapshot);
+
+    bool receive_snapshot_delta(Snapshot& snapshot);
+
+    bool receive_snapshot_compact(Snapshot& snapshot);
+
+    void store_snapshot(const Snapshot& snapshot);
+
+    void apply_next_order(Player& player, uint16_t next_order) const;
+
+    TypeSound receive_sound();
+
+    void receive_player_checkpoints(Player& player);
+
+    const Snapshot* find_snapshot(uint32_t sequence) const;
 
     ServerEventReceiver receive_id();
 
     ServerEventReceiver receive_pre_game_snapshot();
 
+    void receive_checkpoint_table();
+
     ServerEventReceiver receive_race_results();
 
+    ServerEventReceiver receive_udp_offer();
+
 public:
     explicit ProtocolClient(ISocket& skt);
 
     void send_event(const ServerEventSender& key_ingresada);
 
     ServerEventReceiver receive_event(bool& server_event);
+
+    // Igual, pero las snapshots de juego se decodifican en snapshot en vez de event.snapshot
+    // (event.type queda en SNAPSHOT)
+    void receive_event(bool& is_socket_closed, ServerEventReceiver& event, Snapshot& snapshot);
+
+    // Byte del truco (lo que va despues de INPUT_KEY), o NO_KEY si no es uno
+    static constexpr uint8_t NO_KEY = 0xFF;
+    static uint8_t key_code(DirectionKey key);
+
+    // Byte de las teclas de un SendInputState
+    static uint8_t input_state_keys(const SendInputState& input_state);
+
+    // Le pone al estado de las teclas el proximo numero de la conexion, salga por TCP o UDP
+    void number_input_state(SendInputState& input_state);
+
+    // Datagramas del cliente: se identifican con el id y el token de la oferta
+    static std::vector<uint8_t> encode_udp_hello(uint32_t client_id, uint32_t token);
+    static std::vector<uint8_t> encode_udp_input_state(uint32_t client_id, uint32_t token,
+                                                       const SendInputState& input_state);
 };
 
 #endif
@@ -17,6 +17,7 @@ enum class ServerEventReceiverType {
     PREGAME,
     RACE_RESULTS,
     CHANGE_FASE,
+    UDP_OFFER,
     ERROR
 };
 
@@ -98,6 +99,8 @@ struct Snapshot {
     std::vector<Player> players;
     std::vector<NPC> npcs;
     uint32_t actual_time;
+    // 0 si vino en el formato viejo (sin numero de secuencia, no se confirma)
+    uint32_t sequence = 0;
 };
 
 
@@ -132,6 +135,9 @@ struct ServerEventReceiver {
     Snapshot_lobby snapshot_lobby{};
     PreGame pre_snapshot{};
     RaceResults race_result{};
+    // UDP_OFFER: puerto del canal UDP y token para saludar
+    uint16_t udp_port = 0;
+    uint32_t udp_token = 0;
 };
 
 
@@ -139,32 +145,23 @@ struct ServerEventReceiver {
 
 enum class ServerEventSenderType {
     SEND_KEY,
+    SEND_INPUT_STATE,
     CREATE_LOBBY,
     JOIN_LOBBY,
     START_GAME,
     UPGRADES,
     LEAVE_LOBBY,
     MUSIC_CONFIG,
+    SNAPSHOT_ACK,
+    PROTOCOL_VERSION,
+    UDP_READY,
     ERROR,
     NONE
 };
 
 
-enum class DirectionKey {
-    None,
-    UP_PRESSED,
-    DOWN_PRESSED,
-    LEFT_PRESSED,
-    RIGHT_PRESSED,
-    UP_UNPRESSED,
-    DOWN_UNPRESSED,
-    LEFT_UNPRESSED,
-    RIGHT_UNPRESSED,
-    WIN,
-    LOSE,
-    INFINITE_LIFE,
-    GHOST
-};
+// Los trucos, que van de a una tecla. El movimiento va como SendInputState
+enum class DirectionKey { None, WIN, LOSE, INFINITE_LIFE, GHOST };
 
 
 struct StartGame {
@@ -175,6 +172,16 @@ struct SendKey {
     DirectionKey key;
 };
 
+// Teclas de movimiento apretadas en un frame. La secuencia crece con cada estado que se manda,
+// asi el server descarta los que lleguen tarde
+struct SendInputState {
+    uint32_t sequence = 0;
+    bool up = false;
+    bool down = false;
+    bool left = false;
+    bool right = false;
+};
+
 struct CreateToLobby {
     uint8_t modeloAuto;
     std::string player_name;
@@ -209,11 +216,14 @@ enum class MusicConfigType { None, MUTE, INCREASE, DECREASE };
 struct ServerEventSender {
     ServerEventSenderType type;
     SendKey send_key;
+    SendInputState input_state;
     CreateToLobby create_lobby;
     JoinToLobby join_lobby;
     StartGame start_game;
     CarUpgrades car_upgrade;
     MusicConfigType music_config;
+    uint32_t snapshot_ack = 0;
+    uint8_t protocol_version = 0;
 };
 
 
@@ -0,0 +1,27 @@
+#include "SnapshotMailbox.h"
+
+
+void SnapshotMailbox::publish() {
+    // El stamp viaja con el slot: el exchange lo publica junto con la snapshot
+    stamps[back] = control_events.load(std::memory_order_relaxed);
+    back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+}
+
+
+void SnapshotMailbox::note_control_event() {
+    control_events.fetch_add(1, std::memory_order_acq_rel);
+}
+
+
+bool SnapshotMailbox::take() {
+    if ((middle.load(std::memory_order_acquire) & FRESH) == 0) {
+        return false;
+    }
+    front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+    return true;
+}
+
+
+bool SnapshotMailbox::latest_in_order() const {
+    return control_events.load(std::memory_order_acquire) == stamps[front];
+}
@@ -0,0 +1,61 @@
+#ifndef SNAPSHOT_MAILBOX_H
+#define SNAPSHOT_MAILBOX_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "ServerEvent.h"
+
+// Triple buffer de snapshots entre el ThreadReceiver (escribe) y el gameloop (lee). El
+// receiver decodifica directo en su slot y lo publica; el gameloop se queda siempre con la
+// ultima publicada y las que no llego a ver se pisan. Los slots se reusan, asi que una vez que
+// los vectores tomaron tamaño no se vuelve a pedir memoria, y no hay cola que crezca si el
+// render se atrasa.
+//
+// Los demas eventos siguen por la cola. Para no mostrar una snapshot antes que un evento que
+// llego antes que ella (o despues de uno que llego despues), cada snapshot se marca con la
+// cantidad de eventos de cola que habia al publicarla
+class SnapshotMailbox {
+private:
+    static constexpr uint8_t INDEX_MASK = 0x03;
+    static constexpr uint8_t FRESH = 0x04;
+
+    std::array<Snapshot, 3> slots;
+    std::array<uint64_t, 3> stamps{};
+
+    // Slot del medio (el ultimo publicado) y si el gameloop todavia no lo tomo
+    std::atomic<uint8_t> middle{1};
+    uint8_t back = 0;   // solo el receiver
+    uint8_t front = 2;  // solo el gameloop
+
+    std::atomic<uint64_t> control_events{0};
+
+public:
+    SnapshotMailbox() = default;
+
+    // Receiver: slot donde decodificar la proxima snapshot
+    Snapshot& write_slot() { return slots[back]; }
+
+    // Receiver: publica el slot de escritura y pasa a escribir en el que solto el gameloop
+    void publish();
+
+    // Receiver: antes de pushear cualquier otro evento a la cola
+    void note_control_event();
+
+    // Gameloop: se queda con la ultima publicada si hay una nueva. Hay que llamarlo antes de
+    // vaciar la cola, asi los eventos anteriores a la snapshot ya estan en ella
+    bool take();
+
+    // Gameloop: la que tomo con take()
+    const Snapshot& latest() const { return slots[front]; }
+
+    // Gameloop, despues de vaciar la cola: false si llego algun evento despues de la snapshot,
+    // en ese caso se descarta y se espera la siguiente
+    bool latest_in_order() const;
+
+    SnapshotMailbox(const SnapshotMailbox&) = delete;
+    SnapshotMailbox& operator=(const SnapshotMailbox&) = delete;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include "SocketReadBuffer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "../common/liberror.h"
+
+SocketReadBuffer::SocketReadBuffer(ISocket& skt, std::size_t capacity):
+        skt(skt), buffer(std::max<std::size_t>(1, capacity)) {}
+
+
+int SocketReadBuffer::refill() {
+    int received = skt.recvsome(buffer.data(), static_cast<unsigned int>(buffer.size()));
+    start = 0;
+    end = (received > 0) ? static_cast<std::size_t>(received) : 0;
+    return received;
+}
+
+
+void SocketReadBuffer::begin_datagram(const uint8_t* data, std::size_t size) {
+    datagram = data;
+    datagram_pos = 0;
+    datagram_size = size;
+}
+
+
+int SocketReadBuffer::read_datagram(void* data, unsigned int size, bool all) {
+    const std::size_t left = datagram_size - datagram_pos;
+    if (all && size > left) {
+        throw LibError(EMSGSIZE, "datagram has only %zu of %u bytes", left, size);
+    }
+    const std::size_t n = std::min<std::size_t>(size, left);
+    std::memcpy(data, datagram + datagram_pos, n);
+    datagram_pos += n;
+    return static_cast<int>(n);
+}
+
+
+int SocketReadBuffer::recvall(void* data, unsigned int size) {
+    if (datagram) {
+        return read_datagram(data, size, true);
+    }
+    auto* out = static_cast<uint8_t*>(data);
+    std::size_t copied = 0;
+
+    while (copied < size) {
+        if (start == end && refill() <= 0) {
+            if (copied > 0) {
+                throw LibError(EPIPE, "socket received only %zu of %u bytes", copied, size);
+            }
+            return 0;
+        }
+        const std::size_t n = std::min<std::size_t>(size - copied, end - start);
+        std::memcpy(out + copied, buffer.data() + start, n);
+        start += n;
+        copied += n;
+    }
+    return static_cast<int>(size);
+}
+
+
+int SocketReadBuffer::recvsome(void* data, unsigned int size) {
+    if (datagram) {
+        return read_datagram(data, size, false);
+    }
+    if (start == end && refill() <= 0) {
+        return 0;
+    }
+    const std::size_t n = std::min<std::size_t>(size, end - start);
+    std::memcpy(data, buffer.data() + start, n);
+    start += n;
+    return static_cast<int>(n);
+}
+
+
+int SocketReadBuffer::sendall(const void* data, unsigned int size) {
+    return skt.sendall(data, size);
+}
+
+int SocketReadBuffer::sendallv(struct iovec* iov, int iovcnt) { return skt.sendallv(iov, iovcnt); }
+
+
+int SocketReadBuffer::close() { return skt.close(); }
+
+
+bool SocketReadBuffer::is_stream_send_closed() const { return skt.is_stream_send_closed(); }
+
+
+bool SocketReadBuffer::is_stream_recv_closed() const { return skt.is_stream_recv_closed(); }
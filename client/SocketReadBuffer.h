@@ -0,0 +1,59 @@
+#ifndef SOCKET_READ_BUFFER_H
+#define SOCKET_READ_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../common/ISocket.h"
+
+// Envuelve el socket del receiver: cada recv pide todo lo que haya (hasta la capacidad) y
+// los recvall de campo a campo del protocolo se sirven de memoria. Una snapshot entera,
+// o varias seguidas, cuestan un solo recv
+class SocketReadBuffer: public ISocket {
+private:
+    ISocket& skt;
+
+    std::vector<uint8_t> buffer;
+    std::size_t start = 0;  // primer byte sin leer
+    std::size_t end = 0;    // fin de lo recibido
+
+    // Mientras se lee un datagrama, los recv salen de aca y no del socket
+    const uint8_t* datagram = nullptr;
+    std::size_t datagram_pos = 0;
+    std::size_t datagram_size = 0;
+
+    // Vuelve a llenar el buffer (solo cuando esta vacio). Devuelve 0 si se cerro el socket
+    int refill();
+
+    int read_datagram(void* data, unsigned int size, bool all);
+
+public:
+    static constexpr std::size_t DEFAULT_CAPACITY = 64 * 1024;
+
+    explicit SocketReadBuffer(ISocket& skt, std::size_t capacity = DEFAULT_CAPACITY);
+
+    // Misma semantica que Socket::recvall: 0 si se cerro sin leer nada, excepcion si se
+    // cerro a mitad
+    int recvall(void* data, unsigned int size) override;
+    int recvsome(void* data, unsigned int size) override;
+
+    // Quedan bytes recibidos sin leer (el proximo recv no toca el socket)
+    bool has_buffered() const { return start != end; }
+
+    // Hasta end_datagram, el protocolo lee de data en vez del socket, sin tocar lo que haya
+    // en el buffer. Pedir mas de lo que trae lanza LibError: el datagrama venia cortado
+    void begin_datagram(const uint8_t* data, std::size_t size);
+    void end_datagram() { datagram = nullptr; }
+
+    int sendall(const void* data, unsigned int size) override;
+    int sendallv(struct iovec* iov, int iovcnt) override;
+    int close() override;
+    bool is_stream_send_closed() const override;
+    bool is_stream_recv_closed() const override;
+
+    SocketReadBuffer(const SocketReadBuffer&) = delete;
+    SocketReadBuffer& operator=(const SocketReadBuffer&) = delete;
+};
+
+#endif
@@ -1,28 +1,66 @@
 #include "ThreadReceiver.h"
 
+#include <cerrno>
+#include <exception>
 #include <iostream>
 
+#include <poll.h>
+
 #include "../common/liberror.h"
 
 #include "ExceptionClient.h"
 
+// Entra cualquier datagrama que mande el server (que no pasan de 1200 bytes)
+static constexpr std::size_t MAX_DATAGRAM = 2048;
+
 
-ThreadReceiver::ThreadReceiver(Socket& skt):
-        socket(skt), queue_receiver(), protocolo(this->socket) {}
+ThreadReceiver::ThreadReceiver(Socket& skt, Queue<ServerEventSender>& queue_sender,
+                               UdpClientChannel& udp):
+        socket(skt),
+        read_buffer(this->socket),
+        snapshots(),
+        queue_receiver(),
+        protocolo(this->read_buffer),
+        queue_sender(queue_sender),
+        udp(udp),
+        datagram(MAX_DATAGRAM) {}
 
 
 void ThreadReceiver::run() {
     try {
         bool is_socket_closed;
+        ServerEventReceiver evento;
 
         while (should_keep_running()) {
 
-            ServerEventReceiver evento = protocolo.receive_event(is_socket_closed);
+            // Si quedo algo en el buffer se lee sin esperar: el poll no lo ve
+            if (udp.get_fd() != -1 && !read_buffer.has_buffered() && !wait_for_tcp()) {
+                continue;
+            }
+
+            protocolo.receive_event(is_socket_closed, evento, snapshots.write_slot());
 
             if (is_socket_closed) {
                 this->stop();
             }
 
+            if (evento.type == ServerEventReceiverType::SNAPSHOT) {
+                publish_snapshot();
+                continue;
+            }
+
+            if (evento.type == ServerEventReceiverType::UDP_OFFER) {
+                udp.open(socket, client_id, evento.udp_port, evento.udp_token);
+                continue;
+            }
+
+            if (evento.type == ServerEventReceiverType::RECEIVE_ID) {
+                client_id = evento.id_jugador;
+            }
+
+            // Primero se cuenta y despues se pushea, asi el gameloop nunca procesa un evento
+            // sin saber que las snapshots anteriores a el quedaron viejas
+            snapshots.note_control_event();
             queue_receiver.push(evento);
         }
     } catch (const ClosedQueue&) {
@@ -32,6 +70,71 @@ void ThreadReceiver::run() {
     }
 }
 
+bool ThreadReceiver::wait_for_tcp() {
+    struct pollfd fds[2] = {{socket.get_fd(), POLLIN, 0}, {udp.get_fd(), POLLIN, 0}};
+    int n = poll(fds, 2, udp.on_timer());
+    if (n < 0) {
+        if (errno == EINTR) {
+            return false;
+        }
+        throw LibError(errno, "poll failed");
+    }
+    if (fds[1].revents) {
+        receive_datagrams();
+    }
+    // Un cierre o un error tambien se atienden leyendo
+    return fds[0].revents != 0;
+}
+
+void ThreadReceiver::receive_datagrams() {
+    int n;
+    while ((n = udp.receive(datagram.data(), datagram.size())) >= 0) {
+        if (n == 1 && datagram[0] == UDP_HELLO_ACK) {
+            // El server ya nos llega por UDP: le avisamos por TCP que puede mudar las snapshots
+            if (udp.mark_ready()) {
+                ServerEventSender ready;
+                ready.type = ServerEventSenderType::UDP_READY;
+                queue_sender.push(ready);
+            }
+            continue;
+        }
+        if (n > 0) {
+            receive_snapshot_datagram(static_cast<std::size_t>(n));
+        }
+    }
+}
+
+void ThreadReceiver::receive_snapshot_datagram(std::size_t size) {
+    // Mismo protocolo (y mismos baselines) que por TCP, leyendo del datagrama
+    bool is_socket_closed = false;
+    read_buffer.begin_datagram(datagram.data(), size);
+    try {
+        protocolo.receive_event(is_socket_closed, datagram_event, snapshots.write_slot());
+    } catch (const std::exception&) {
+        // Datagrama cortado: se descarta, ya llega la proxima
+        datagram_event.type = ServerEventReceiverType::ERROR;
+    }
+    read_buffer.end_datagram();
+
+    // Por UDP solo se aceptan snapshots
+    if (datagram_event.type == ServerEventReceiverType::SNAPSHOT) {
+        publish_snapshot();
+    }
+}
+
+void ThreadReceiver::publish_snapshot() {
+    const uint32_t sequence = snapshots.write_slot().sequence;
+    // Una vieja (desordenada por UDP, o una de TCP que quedo atras al cambiar de canal) se
+    // descarta: el slot se vuelve a usar para la proxima
+    if (sequence != 0) {
+        if (sequence <= last_snapshot) {
+            return;
+        }
+        last_snapshot = sequence;
+    }
+    snapshots.publish();
+}
+
 void ThreadReceiver::stop() {
     Thread::stop();
 
@@ -41,3 +144,5 @@ void ThreadReceiver::stop() {
 }
 
 Queue<ServerEventReceiver>& ThreadReceiver::get_queue() { return queue_receiver; }
+
+SnapshotMailbox& ThreadReceiver::get_snapshots() { return snapshots; }
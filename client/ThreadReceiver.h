@@ -1,30 +1,65 @@
 #ifndef THREAD_RECEIVER_H
 #define THREAD_RECEIVER_H
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 #include "../common/queue.h"
 #include "../common/socket.h"
 #include "../common/thread.h"
 
 #include "ProtocolClient.h"
 #include "ServerEvent.h"
+#include "SnapshotMailbox.h"
+#include "SocketReadBuffer.h"
+#include "UdpClientChannel.h"
 
 
 class ThreadReceiver: public Thread {
 private:
     Socket& socket;
 
+    // El protocolo lee de aca, no directo del socket
+    SocketReadBuffer read_buffer;
+
+    // Snapshots de juego: siempre la ultima, sin cola
+    SnapshotMailbox snapshots;
+
+    // Todo lo demas, en orden
     Queue<ServerEventReceiver> queue_receiver;
 
     ProtocolClient protocolo;
 
+    // Para contestar por TCP cuando el canal UDP queda listo
+    Queue<ServerEventSender>& queue_sender;
+    UdpClientChannel& udp;
+
+    uint32_t client_id = 0;
+    // Secuencia de la ultima snapshot publicada: por UDP llegan desordenadas o repetidas
+    uint32_t last_snapshot = 0;
+
+    std::vector<uint8_t> datagram;
+    ServerEventReceiver datagram_event;
+
+    // Con el canal UDP abierto: espera en los dos sockets, atiende los datagramas y devuelve
+    // true si el TCP tiene algo para leer
+    bool wait_for_tcp();
+    void receive_datagrams();
+    void receive_snapshot_datagram(std::size_t size);
+
+    void publish_snapshot();
+
 public:
-    explicit ThreadReceiver(Socket& skt);
+    ThreadReceiver(Socket& skt, Queue<ServerEventSender>& queue_sender, UdpClientChannel& udp);
 
     void run() override;
 
     void stop() override;
 
     Queue<ServerEventReceiver>& get_queue();
+
+    SnapshotMailbox& get_snapshots();
 };
 
 #endif
@@ -1,7 +1,8 @@
 #include "ThreadSenderClient.h"
 
 
-ThreadSender::ThreadSender(Socket& skt): socket(skt), queue_sender(), protocolo(skt) {}
+ThreadSender::ThreadSender(Socket& skt, UdpClientChannel& udp):
+        socket(skt), queue_sender(), protocolo(skt), udp(udp) {}
 
 
 void ThreadSender::run() {
@@ -10,6 +11,15 @@ void ThreadSender::run() {
             ServerEventSender key_ingresada;  // Habria que cambiar lo de key a event
             key_ingresada = queue_sender.pop();
 
+            // Cada carrera tiene su InputHandler: la secuencia se la ponemos aca, que vivimos
+            // lo que la conexion
+            if (key_ingresada.type == ServerEventSenderType::SEND_INPUT_STATE) {
+                protocolo.number_input_state(key_ingresada.input_state);
+            }
+
+            if (send_by_udp(key_ingresada)) {
+                continue;
+            }
             protocolo.send_event(key_ingresada);
         }
     } catch (const ClosedQueue&) {
@@ -20,6 +30,15 @@ void ThreadSender::run() {
 }
 
 
+bool ThreadSender::send_by_udp(const ServerEventSender& event) {
+    // Los trucos no se pueden perder: siguen por TCP
+    if (event.type != ServerEventSenderType::SEND_INPUT_STATE) {
+        return false;
+    }
+    return udp.send_input_state(event.input_state);
+}
+
+
 Queue<ServerEventSender>& ThreadSender::get_sender_queue() { return queue_sender; }
 
 
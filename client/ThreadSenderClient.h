@@ -7,6 +7,7 @@
 #include "../common/thread.h"
 
 #include "ProtocolClient.h"
+#include "UdpClientChannel.h"
 
 
 class ThreadSender: public Thread {
@@ -17,8 +18,14 @@ private:
 
     ProtocolClient protocolo;
 
+    // El estado de las teclas de movimiento va por aca en cuanto este listo
+    UdpClientChannel& udp;
+
+    // true si era un estado de las teclas y salio por UDP
+    bool send_by_udp(const ServerEventSender& event);
+
 public:
-    explicit ThreadSender(Socket& skt);
+    ThreadSender(Socket& skt, UdpClientChannel& udp);
 
     void run() override;
 
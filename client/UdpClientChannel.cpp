@@ -0,0 +1,98 @@
+#include "UdpClientChannel.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "../common/liberror.h"
+
+void UdpClientChannel::open(const Socket& tcp, uint32_t client_id, uint16_t port,
+                            uint32_t token) {
+    std::lock_guard<std::mutex> lock(m);
+    if (socket) {
+        return;
+    }
+    try {
+        socket = std::make_unique<DatagramSocket>(tcp, port);
+    } catch (const LibError& e) {
+        std::cerr << "UdpClientChannel: no se pudo abrir el canal UDP: " << e.what() << "\n";
+        return;
+    }
+    this->client_id = client_id;
+    this->token = token;
+    hellos_sent = 0;
+    next_hello = Clock::now();
+    fd = socket->get_fd();
+}
+
+int UdpClientChannel::on_timer() {
+    std::lock_guard<std::mutex> lock(m);
+    if (!socket) {
+        return -1;
+    }
+    const auto now = Clock::now();
+    Clock::time_point wake = Clock::time_point::max();
+
+    if (!ready && hellos_sent < MAX_HELLOS) {
+        if (now >= next_hello) {
+            const std::vector<uint8_t> hello = ProtocolClient::encode_udp_hello(client_id, token);
+            socket->send(hello.data(), hello.size());
+            ++hellos_sent;
+            next_hello = now + HELLO_INTERVAL;
+        }
+        wake = next_hello;
+    }
+
+    if (has_state) {
+        if (now >= next_resend) {
+            send_last_state();
+            if (resends_left > 0) {
+                --resends_left;
+            }
+            next_resend = now + (resends_left > 0 ? RESEND_INTERVAL : STEADY_RESEND_INTERVAL);
+        }
+        wake = std::min(wake, next_resend);
+    }
+
+    // El sender puede mandar un estado en cualquier momento sin despertar al receiver: mientras
+    // el canal ande, se pasa seguido a ver si hay reenvios
+    if (ready) {
+        wake = std::min(wake, now + RESEND_INTERVAL);
+    }
+
+    if (wake == Clock::time_point::max()) {
+        return -1;
+    }
+    const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count();
+    return static_cast<int>(std::max<decltype(wait)>(wait, 1));
+}
+
+int UdpClientChannel::receive(void* data, std::size_t size) {
+    // El socket no se cierra hasta destruir el canal, y lo lee un solo hilo
+    if (!socket) {
+        return -1;
+    }
+    return socket->recv(data, size, nullptr, false);
+}
+
+bool UdpClientChannel::mark_ready() { return !ready.exchange(true); }
+
+bool UdpClientChannel::send_input_state(const SendInputState& input_state) {
+    if (!ready) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m);
+    last_state = input_state;
+    send_last_state();
+
+    // Si se pierde este datagrama y las teclas no vuelven a cambiar, lo rescatan los reenvios
+    has_state = true;
+    resends_left = RESENDS;
+    next_resend = Clock::now() + RESEND_INTERVAL;
+    return true;
+}
+
+void UdpClientChannel::send_last_state() {
+    const std::vector<uint8_t> message =
+            ProtocolClient::encode_udp_input_state(client_id, token, last_state);
+    socket->send(message.data(), message.size());
+}
@@ -0,0 +1,85 @@
+#ifndef UDP_CLIENT_CHANNEL_H
+#define UDP_CLIENT_CHANNEL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../common/datagram_socket.h"
+#include "../common/socket.h"
+
+#include "ProtocolClient.h"
+
+// Canal UDP con el server, si nos lo ofrece. Lo abre el ThreadReceiver con la oferta, que
+// tambien recibe por el las snapshots; el ThreadSender manda por el el estado de las teclas de
+// movimiento una vez que el server contesto el saludo.
+//
+// Nada de lo que va por aca tiene garantia: el saludo se reintenta hasta el ack y el ultimo
+// estado de las teclas se reenvia un par de veces seguidas cuando cambia y despues cada
+// STEADY_RESEND_INTERVAL mientras el canal este abierto, asi una rafaga perdida no deja una
+// tecla trabada (el server ignora los repetidos).
+class UdpClientChannel {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr auto HELLO_INTERVAL = std::chrono::milliseconds(100);
+    // Si en este tiempo no llega el ack, todo sigue por TCP
+    static constexpr int MAX_HELLOS = 20;
+    static constexpr auto RESEND_INTERVAL = std::chrono::milliseconds(30);
+    static constexpr int RESENDS = 3;
+    static constexpr auto STEADY_RESEND_INTERVAL = std::chrono::milliseconds(100);
+
+    // Lo protege m, salvo el fd (fijo desde open) y ready
+    std::mutex m;
+    std::unique_ptr<DatagramSocket> socket;
+    std::atomic<int> fd{-1};
+    std::atomic<bool> ready{false};
+
+    uint32_t client_id = 0;
+    uint32_t token = 0;
+
+    int hellos_sent = 0;
+    Clock::time_point next_hello;
+
+    SendInputState last_state;
+    bool has_state = false;
+    // Reenvios seguidos que quedan; despues se sigue a STEADY_RESEND_INTERVAL
+    int resends_left = 0;
+    Clock::time_point next_resend;
+
+    void send_last_state();
+
+public:
+    UdpClientChannel() = default;
+
+    // ThreadReceiver: abre el socket hacia el mismo host que tcp y saluda. Si no se puede
+    // abrir, el canal queda cerrado y todo sigue por TCP
+    void open(const Socket& tcp, uint32_t client_id, uint16_t port, uint32_t token);
+
+    // -1 si no esta abierto
+    int get_fd() const { return fd; }
+
+    // ThreadReceiver: reintenta el saludo y reenvia los inputs si toca. Devuelve cuantos ms
+    // esperar como mucho hasta volver a llamarlo (-1 = no hace falta)
+    int on_timer();
+
+    // ThreadReceiver: un datagrama sin bloquear, -1 si no hay
+    int receive(void* data, std::size_t size);
+
+    // ThreadReceiver: llego el ack del saludo. true si es el primero (hay que avisar por TCP)
+    bool mark_ready();
+    bool is_ready() const { return ready; }
+
+    // ThreadSender: manda el estado de las teclas. false si el canal no esta listo y hay que
+    // mandarlo por TCP
+    bool send_input_state(const SendInputState& input_state);
+
+    UdpClientChannel(const UdpClientChannel&) = delete;
+    UdpClientChannel& operator=(const UdpClientChannel&) = delete;
+};
+
+#endif
@@ -3,10 +3,17 @@
 
 #include <cstddef>
 
+#include <sys/uio.h>
+
 class ISocket {
 public:
     virtual int sendall(const void* data, unsigned int size) = 0;
     virtual int recvall(void* data, unsigned int size) = 0;
+    // Recibe lo que haya disponible, hasta size bytes (0 si se cerro)
+    virtual int recvsome(void* data, unsigned int size) = 0;
+    // Manda todos los buffers en orden, juntos en la menor cantidad de syscalls. Retorna el
+    // total enviado (0 si se cerro). Puede modificar iov al avanzar sobre envios parciales
+    virtual int sendallv(struct iovec* iov, int iovcnt) = 0;
 
     virtual int close() = 0;
 
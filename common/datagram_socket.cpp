@@ -0,0 +1,143 @@
+#include "datagram_socket.h"
+
+#include <stdexcept>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "liberror.h"
+#include "resolver.h"
+
+DatagramSocket::DatagramSocket(const char* servname): skt(-1) {
+    // El resolver pide direcciones de TCP, pero la direccion local (ip y puerto) es la misma
+    Resolver resolver(nullptr, servname, true);
+
+    int saved_errno = 0;
+    while (resolver.has_next()) {
+        struct addrinfo* addr = resolver.next();
+
+        int s = socket(addr->ai_family, SOCK_DGRAM, 0);
+        if (s == -1) {
+            saved_errno = errno;
+            continue;
+        }
+        int optval = 1;
+        if (setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval)) == -1 ||
+            bind(s, addr->ai_addr, addr->ai_addrlen) == -1) {
+            saved_errno = errno;
+            ::close(s);
+            continue;
+        }
+        this->skt = s;
+        return;
+    }
+    throw LibError(saved_errno, "udp socket for %s failed", servname);
+}
+
+DatagramSocket::DatagramSocket(const Socket& peer_of, uint16_t port): skt(-1) {
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if (getpeername(peer_of.get_fd(), reinterpret_cast<sockaddr*>(&addr), &len) == -1) {
+        throw LibError(errno, "getpeername failed");
+    }
+    addr.sin_port = htons(port);
+
+    int s = socket(AF_INET, SOCK_DGRAM, 0);
+    if (s == -1) {
+        throw LibError(errno, "udp socket failed");
+    }
+    if (connect(s, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == -1) {
+        int saved_errno = errno;
+        ::close(s);
+        throw LibError(saved_errno, "udp connect failed");
+    }
+    this->skt = s;
+}
+
+DatagramSocket::DatagramSocket(DatagramSocket&& other): skt(other.skt) { other.skt = -1; }
+
+DatagramSocket& DatagramSocket::operator=(DatagramSocket&& other) {
+    if (this == &other)
+        return *this;
+    if (this->skt != -1)
+        ::close(this->skt);
+    this->skt = other.skt;
+    other.skt = -1;
+    return *this;
+}
+
+bool DatagramSocket::sendv(const struct iovec* iov, int iovcnt, const sockaddr_in* to) {
+    chk_skt_or_fail();
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    // cppcheck-suppress cstyleCast
+    msg.msg_name = (void*)to;
+    msg.msg_namelen = to ? sizeof(*to) : 0;
+    // cppcheck-suppress cstyleCast
+    msg.msg_iov = (struct iovec*)iov;
+    msg.msg_iovlen = iovcnt;
+    return sendmsg(this->skt, &msg, MSG_NOSIGNAL | MSG_DONTWAIT) != -1;
+}
+
+bool DatagramSocket::send(const void* data, std::size_t sz, const sockaddr_in* to) {
+    // cppcheck-suppress cstyleCast
+    struct iovec iov = {(void*)data, sz};
+    return sendv(&iov, 1, to);
+}
+
+int DatagramSocket::recv(void* data, std::size_t sz, sockaddr_in* from, bool wait) {
+    chk_skt_or_fail();
+    socklen_t len = sizeof(sockaddr_in);
+    while (true) {
+        ssize_t s = recvfrom(this->skt, data, sz, wait ? 0 : MSG_DONTWAIT,
+                             reinterpret_cast<sockaddr*>(from), from ? &len : nullptr);
+        if (s >= 0)
+            return static_cast<int>(s);
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN)
+            return -1;
+        /*
+         * Un ICMP "port unreachable" de un datagrama anterior (el otro lado
+         * todavia no abrio o ya cerro su socket) no es un error de este
+         * socket: se sigue con el proximo
+         * */
+        if (errno == ECONNREFUSED)
+            continue;
+        throw LibError(errno, "udp recv failed");
+    }
+}
+
+uint16_t DatagramSocket::local_port() const {
+    chk_skt_or_fail();
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if (getsockname(this->skt, reinterpret_cast<sockaddr*>(&addr), &len) == -1) {
+        throw LibError(errno, "getsockname failed");
+    }
+    return ntohs(addr.sin_port);
+}
+
+void DatagramSocket::shutdown() {
+    chk_skt_or_fail();
+    /*
+     * Sobre un socket UDP sin conectar da ENOTCONN, pero igual despierta
+     * a quien este en recvfrom (que retorna 0)
+     * */
+    ::shutdown(this->skt, SHUT_RDWR);
+}
+
+DatagramSocket::~DatagramSocket() {
+    if (this->skt != -1)
+        ::close(this->skt);
+}
+
+void DatagramSocket::chk_skt_or_fail() const {
+    if (skt == -1) {
+        throw std::runtime_error("udp socket with invalid file descriptor (-1), "
+                                 "perhaps you are using a *previously moved* "
+                                 "socket (and therefore invalid).");
+    }
+}
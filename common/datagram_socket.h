@@ -0,0 +1,89 @@
+#ifndef DATAGRAM_SOCKET_H
+#define DATAGRAM_SOCKET_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <netinet/in.h>
+#include <sys/uio.h>
+
+#include "socket.h"
+
+/*
+ * Socket UDP (IPv4), para lo que puede perderse en el camino: snapshots
+ * y el estado del input. Todo lo que tiene que llegar sigue por el
+ * `Socket` TCP de la conexion.
+ *
+ * Cada datagrama llega entero o no llega: no hay `recvall` ni streams.
+ * */
+class DatagramSocket {
+private:
+    int skt;
+
+    void chk_skt_or_fail() const;
+
+public:
+    /*
+     * Lado del servidor: escucha en el <servname> dado, en todas las
+     * interfaces, y manda a quien se le indique en cada `send_to`.
+     *
+     * En caso de error se lanza una excepción.
+     * */
+    explicit DatagramSocket(const char* servname);
+
+    /*
+     * Lado del cliente: queda "conectado" al mismo host que la conexion
+     * TCP `peer_of`, en el puerto dado. El kernel descarta lo que llegue
+     * de cualquier otra dirección.
+     *
+     * En caso de error se lanza una excepción.
+     * */
+    DatagramSocket(const Socket& peer_of, uint16_t port);
+
+    DatagramSocket(const DatagramSocket&) = delete;
+    DatagramSocket& operator=(const DatagramSocket&) = delete;
+
+    DatagramSocket(DatagramSocket&&);
+    DatagramSocket& operator=(DatagramSocket&&);
+
+    /*
+     * Manda un datagrama armado con los buffers de `iov`, a `to` o (si es
+     * `nullptr`) a la dirección conectada. Nunca bloquea: si el kernel no
+     * tiene lugar el datagrama se pierde, como cualquier otro.
+     *
+     * Retorna true si salio. Un error de red no lanza excepción, solo
+     * retorna false (UDP no promete nada).
+     * */
+    bool sendv(const struct iovec* iov, int iovcnt, const sockaddr_in* to = nullptr);
+    bool send(const void* data, std::size_t sz, const sockaddr_in* to = nullptr);
+
+    /*
+     * Recibe un datagrama (truncado a `sz`) y, si `from` no es `nullptr`,
+     * quien lo mando.
+     *
+     * Si `wait` es false y no hay nada, retorna -1. Con `wait` se bloquea
+     * hasta que llegue algo o hasta un `shutdown`, en cuyo caso retorna 0.
+     *
+     * En caso de error se lanza una excepción.
+     * */
+    int recv(void* data, std::size_t sz, sockaddr_in* from, bool wait);
+
+    /*
+     * Puerto local (el que hay que anunciarle al cliente).
+     * */
+    uint16_t local_port() const;
+
+    /*
+     * File descriptor, solo para hacer poll. El socket sigue siendo el dueño.
+     * */
+    int get_fd() const { return skt; }
+
+    /*
+     * Despierta a quien este bloqueado en `recv`.
+     * */
+    void shutdown();
+
+    ~DatagramSocket();
+};
+
+#endif
@@ -0,0 +1,427 @@
+#include "map_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "operations_bytes.h"
+
+namespace {
+
+constexpr char MAGIC[4] = {'N', '4', 'S', 'M'};
+
+bool is_pole_code(int v) {
+    return v == CELL_POLE || v == CELL_BRIDGE_UP_AND_POLE || v == CELL_BRIDGE_DOWN_AND_POLE;
+}
+
+bool is_goal_code(int v) {
+    return v == CELL_GOAL || v == CELL_BRIDGE_UP_AND_GOAL || v == CELL_BRIDGE_DOWN_AND_GOAL;
+}
+
+uint8_t npc_dir_from_string(const std::string& s) {
+    if (s == "Right") {
+        return 0;
+    }
+    if (s == "Left") {
+        return 1;
+    }
+    if (s == "Up") {
+        return 2;
+    }
+    if (s == "Down") {
+        return 3;
+    }
+    throw std::runtime_error("MapFile: direccion de NPC invalida: " + s);
+}
+
+std::vector<MapFileNpcSpawn> npc_spawns_from_json(const nlohmann::json& j, const char* key) {
+    std::vector<MapFileNpcSpawn> spawns;
+    if (j.is_object() && j.contains(key) && j[key].is_array()) {
+        for (const auto& s: j[key]) {
+            spawns.push_back(MapFileNpcSpawn{static_cast<uint16_t>(s.value("col", 0)),
+                                             static_cast<uint16_t>(s.value("row", 0)),
+                                             npc_dir_from_string(s.value("dir", "Right"))});
+        }
+    }
+    return spawns;
+}
+
+void add_cells(const std::vector<MapFileCell>& cells, std::vector<uint8_t>& buf) {
+    OperationsBytes::add_two_bytes(static_cast<uint16_t>(cells.size()), buf);
+    for (const auto& c: cells) {
+        OperationsBytes::add_two_bytes(c.col, buf);
+        OperationsBytes::add_two_bytes(c.row, buf);
+    }
+}
+
+void add_npc_spawns(const std::vector<MapFileNpcSpawn>& spawns, std::vector<uint8_t>& buf) {
+    OperationsBytes::add_two_bytes(static_cast<uint16_t>(spawns.size()), buf);
+    for (const auto& s: spawns) {
+        OperationsBytes::add_two_bytes(s.col, buf);
+        OperationsBytes::add_two_bytes(s.row, buf);
+        OperationsBytes::add_one_byte(s.dir, buf);
+    }
+}
+
+// Lee del archivo mapeado controlando que nunca nos pasemos del final
+class BodyReader {
+private:
+    const uint8_t* ptr;
+    const uint8_t* end;
+
+    void need(std::size_t n) const {
+        if (static_cast<std::size_t>(end - ptr) < n) {
+            throw std::runtime_error("MapFile: archivo truncado");
+        }
+    }
+
+public:
+    BodyReader(const uint8_t* begin, const uint8_t* end): ptr(begin), end(end) {}
+
+    uint8_t u8() {
+        need(1);
+        return *ptr++;
+    }
+
+    uint16_t u16() {
+        need(2);
+        uint16_t v = static_cast<uint16_t>((ptr[0] << 8) | ptr[1]);
+        ptr += 2;
+        return v;
+    }
+
+    uint32_t u32() {
+        need(4);
+        uint32_t v = (uint32_t(ptr[0]) << 24) | (uint32_t(ptr[1]) << 16) | (uint32_t(ptr[2]) << 8) |
+                     uint32_t(ptr[3]);
+        ptr += 4;
+        return v;
+    }
+
+    void skip(std::size_t n) {
+        need(n);
+        ptr += n;
+    }
+
+    std::string string(std::size_t n) {
+        need(n);
+        std::string s(reinterpret_cast<const char*>(ptr), n);
+        ptr += n;
+        return s;
+    }
+
+    std::vector<MapFileCell> cells() {
+        std::vector<MapFileCell> out(u16());
+        for (auto& c: out) {
+            c.col = u16();
+            c.row = u16();
+        }
+        return out;
+    }
+
+    std::vector<MapFileNpcSpawn> npc_spawns() {
+        std::vector<MapFileNpcSpawn> out(u16());
+        for (auto& s: out) {
+            s.col = u16();
+            s.row = u16();
+            s.dir = u8();
+        }
+        return out;
+    }
+
+    bool at_end() const { return ptr == end; }
+};
+
+}  // namespace
+
+MapFileData MapFile::from_json(const nlohmann::json& j) {
+    MapFileData data;
+
+    nlohmann::json grid_json;
+    if (j.is_object()) {
+        if (!j.contains("grid"))
+            throw std::runtime_error("MapFile: falta la clave 'grid' en el objeto JSON");
+        grid_json = j["grid"];
+
+        if (j.contains("base_map"))
+            data.base_map = j["base_map"].get<std::string>();
+    } else if (j.is_array()) {
+        grid_json = j;
+    } else {
+        throw std::runtime_error("MapFile: se esperaba objeto con 'grid' o matriz [[...], ...]");
+    }
+
+    const auto matrix = grid_json.get<std::vector<std::vector<int>>>();
+    if (matrix.empty() || matrix[0].empty()) {
+        throw std::runtime_error("MapFile: matriz vacía");
+    }
+    if (matrix.size() > UINT16_MAX || matrix[0].size() > UINT16_MAX) {
+        throw std::runtime_error("MapFile: matriz demasiado grande");
+    }
+
+    data.height = static_cast<uint16_t>(matrix.size());
+    data.width = static_cast<uint16_t>(matrix[0].size());
+    data.grid.reserve(static_cast<std::size_t>(data.width) * data.height);
+
+    std::vector<MapFileCell> goal_cells;
+    for (uint16_t row = 0; row < data.height; ++row) {
+        if (matrix[row].size() != data.width) {
+            throw std::runtime_error("MapFile: Matriz no rectangular");
+        }
+        for (uint16_t col = 0; col < data.width; ++col) {
+            const int v = matrix[row][col];
+            if (v < 0 || v > UINT8_MAX) {
+                throw std::runtime_error("MapFile: codigo de celda invalido " + std::to_string(v));
+            }
+            data.grid.push_back(static_cast<uint8_t>(v));
+
+            if (is_pole_code(v)) {
+                data.pole_cells.push_back(MapFileCell{col, row});
+            } else if (is_goal_code(v)) {
+                goal_cells.push_back(MapFileCell{col, row});
+            }
+        }
+    }
+
+    if (j.is_object() && j.contains("checkpoints_order") && j["checkpoints_order"].is_array()) {
+        for (const auto& cp: j["checkpoints_order"]) {
+            MapFileCheckpoint def{cp.value("order", 0), false, {}};
+            for (const auto& c: cp["cells"]) {
+                def.cells.push_back(MapFileCell{static_cast<uint16_t>(c.value("col", 0)),
+                                                static_cast<uint16_t>(c.value("row", 0))});
+            }
+            data.checkpoints.push_back(std::move(def));
+        }
+        std::sort(data.checkpoints.begin(), data.checkpoints.end(),
+                  [](const auto& a, const auto& b) { return a.order < b.order; });
+    }
+
+    // La meta es un checkpoint mas, el ultimo
+    if (!goal_cells.empty()) {
+        const int32_t max_order = data.checkpoints.empty() ? 0 : data.checkpoints.back().order;
+        data.checkpoints.push_back(MapFileCheckpoint{max_order + 1, true, std::move(goal_cells)});
+    }
+
+    if (!j.is_object() || !j.contains("direccion_salida")) {
+        throw std::runtime_error("MapFile: La pole de salida no tiene direccion");
+    }
+    const std::string direccion_salida = j["direccion_salida"].get<std::string>();
+    if (direccion_salida == "derecha") {
+        data.pole_direction = 0x01;
+    } else if (direccion_salida == "izquierda") {
+        data.pole_direction = 0x02;
+    } else if (direccion_salida == "arriba") {
+        data.pole_direction = 0x03;
+    } else if (direccion_salida == "abajo") {
+        data.pole_direction = 0x04;
+    } else {
+        throw std::runtime_error("MapFile: La direccion de pole de salida es incorrecta");
+    }
+
+    data.npc_spawns = npc_spawns_from_json(j, "npc_spawns");
+    data.npc_spawns_park = npc_spawns_from_json(j, "npc_spawns_park");
+
+    return data;
+}
+
+std::vector<uint8_t> MapFile::encode(const MapFileData& data) {
+    if (data.grid.size() != static_cast<std::size_t>(data.width) * data.height) {
+        throw std::runtime_error("MapFile: la grilla no coincide con las dimensiones");
+    }
+
+    std::vector<uint8_t> body;
+    body.reserve(data.grid.size() + 1024);
+    body.insert(body.end(), data.grid.begin(), data.grid.end());
+
+    OperationsBytes::add_one_byte(data.pole_direction, body);
+    add_cells(data.pole_cells, body);
+
+    OperationsBytes::add_two_bytes(static_cast<uint16_t>(data.base_map.size()), body);
+    OperationsBytes::add_string(data.base_map, body);
+
+    OperationsBytes::add_two_bytes(static_cast<uint16_t>(data.checkpoints.size()), body);
+    for (const auto& cp: data.checkpoints) {
+        OperationsBytes::add_four_bytes(static_cast<uint32_t>(cp.order), body);
+        OperationsBytes::add_one_byte(cp.goal ? 1 : 0, body);
+        add_cells(cp.cells, body);
+    }
+
+    add_npc_spawns(data.npc_spawns, body);
+    add_npc_spawns(data.npc_spawns_park, body);
+
+    std::vector<uint8_t> out;
+    out.reserve(HEADER_SIZE + body.size());
+    out.insert(out.end(), MAGIC, MAGIC + sizeof(MAGIC));
+    OperationsBytes::add_two_bytes(VERSION, out);
+    OperationsBytes::add_two_bytes(static_cast<uint16_t>(HEADER_SIZE), out);
+    OperationsBytes::add_two_bytes(data.width, out);
+    OperationsBytes::add_two_bytes(data.height, out);
+    OperationsBytes::add_four_bytes(static_cast<uint32_t>(body.size()), out);
+    OperationsBytes::add_four_bytes(checksum(body.data(), body.size()), out);
+    OperationsBytes::add_four_bytes(0, out);
+    out.insert(out.end(), body.begin(), body.end());
+    return out;
+}
+
+void MapFile::write(const std::string& path, const MapFileData& data) {
+    const std::vector<uint8_t> bytes = encode(data);
+
+    // Escribimos a un temporal y renombramos, asi nadie mapea un archivo a medio escribir.
+    // El temporal tiene nombre unico: si dos procesos (o dos lobbies) escriben el mismo mapa
+    // a la vez, cada uno escribe el suyo y gana el ultimo rename, pero nunca uno mezclado
+    std::string tmp = path + ".XXXXXX";
+    int fd = ::mkstemp(tmp.data());
+    if (fd == -1) {
+        throw std::runtime_error("MapFile: No se puede escribir el archivo " + path);
+    }
+    // mkstemp lo crea 0600; el mapa lo tienen que poder leer todos, como antes
+    ::fchmod(fd, 0644);
+
+    std::size_t written = 0;
+    while (written < bytes.size()) {
+        ssize_t n = ::write(fd, bytes.data() + written, bytes.size() - written);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            ::close(fd);
+            std::remove(tmp.c_str());
+            throw std::runtime_error("MapFile: Error escribiendo el archivo " + tmp);
+        }
+        written += static_cast<std::size_t>(n);
+    }
+    if (::close(fd) != 0) {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("MapFile: Error escribiendo el archivo " + tmp);
+    }
+
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("MapFile: No se puede escribir el archivo " + path);
+    }
+}
+
+std::string MapFile::binary_path_for(const std::string& json_path) {
+    const std::string json_ext = ".json";
+    if (json_path.size() >= json_ext.size() &&
+        json_path.compare(json_path.size() - json_ext.size(), json_ext.size(), json_ext) == 0) {
+        return json_path.substr(0, json_path.size() - json_ext.size()) + EXTENSION;
+    }
+    return json_path + EXTENSION;
+}
+
+uint32_t MapFile::checksum(const uint8_t* data, std::size_t size) {
+    // FNV-1a de 32 bits
+    uint32_t hash = 2166136261u;
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+MappedMapFile::MappedMapFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw std::runtime_error("MapFile: No se puede abrir el archivo " + path);
+    }
+
+    struct stat st {};
+    if (::fstat(fd, &st) == -1 || st.st_size < static_cast<off_t>(MapFile::HEADER_SIZE)) {
+        ::close(fd);
+        throw std::runtime_error("MapFile: archivo invalido " + path);
+    }
+
+    mapping_size = static_cast<std::size_t>(st.st_size);
+    void* addr = ::mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // El mapeo sigue valido aunque cerremos el fd
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        throw std::runtime_error("MapFile: No se puede mapear el archivo " + path);
+    }
+    mapping = static_cast<const uint8_t*>(addr);
+
+    try {
+        decode_body();
+    } catch (const std::runtime_error& e) {
+        ::munmap(const_cast<uint8_t*>(mapping), mapping_size);
+        throw std::runtime_error(std::string(e.what()) + " (" + path + ")");
+    }
+}
+
+void MappedMapFile::decode_body() {
+    BodyReader header(mapping, mapping + MapFile::HEADER_SIZE);
+    if (!std::equal(MAGIC, MAGIC + sizeof(MAGIC), mapping)) {
+        throw std::runtime_error("MapFile: no es un archivo .n4smap");
+    }
+    header.skip(sizeof(MAGIC));
+    if (header.u16() != MapFile::VERSION) {
+        throw std::runtime_error("MapFile: version de .n4smap no soportada");
+    }
+    if (header.u16() != MapFile::HEADER_SIZE) {
+        throw std::runtime_error("MapFile: header invalido");
+    }
+    tables.width = header.u16();
+    tables.height = header.u16();
+    const uint32_t body_size = header.u32();
+    const uint32_t expected_checksum = header.u32();
+
+    if (body_size != mapping_size - MapFile::HEADER_SIZE) {
+        throw std::runtime_error("MapFile: archivo truncado");
+    }
+    const uint8_t* body = mapping + MapFile::HEADER_SIZE;
+    if (MapFile::checksum(body, body_size) != expected_checksum) {
+        throw std::runtime_error("MapFile: checksum invalido");
+    }
+    if (tables.width == 0 || tables.height == 0) {
+        throw std::runtime_error("MapFile: matriz vacía");
+    }
+
+    BodyReader r(body, body + body_size);
+    r.skip(static_cast<std::size_t>(tables.width) * tables.height);
+
+    tables.pole_direction = r.u8();
+    tables.pole_cells = r.cells();
+
+    tables.base_map = r.string(r.u16());
+
+    tables.checkpoints.resize(r.u16());
+    for (auto& cp: tables.checkpoints) {
+        cp.order = static_cast<int32_t>(r.u32());
+        cp.goal = r.u8() != 0;
+        cp.cells = r.cells();
+    }
+
+    tables.npc_spawns = r.npc_spawns();
+    tables.npc_spawns_park = r.npc_spawns();
+
+    if (!r.at_end()) {
+        throw std::runtime_error("MapFile: datos de mas al final del archivo");
+    }
+
+    // Todas las celdas de las tablas tienen que estar dentro del mapa
+    auto in_map = [this](const MapFileCell& c) {
+        return c.col < tables.width && c.row < tables.height;
+    };
+    bool cells_ok = std::all_of(tables.pole_cells.begin(), tables.pole_cells.end(), in_map);
+    for (const auto& cp: tables.checkpoints) {
+        cells_ok = cells_ok && std::all_of(cp.cells.begin(), cp.cells.end(), in_map);
+    }
+    if (!cells_ok) {
+        throw std::runtime_error("MapFile: celda fuera del mapa");
+    }
+}
+
+MappedMapFile::~MappedMapFile() {
+    if (mapping) {
+        ::munmap(const_cast<uint8_t*>(mapping), mapping_size);
+    }
+}
@@ -0,0 +1,125 @@
+#ifndef MAP_FILE_H
+#define MAP_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+// Codigos de celda en la grilla del mapa (los que escribe el editor)
+enum CellCode : uint8_t {
+    CELL_WALL = 0,
+    CELL_ROAD = 1,
+    CELL_POLE = 2,
+    CELL_GOAL = 3,
+    CELL_CHECKPOINT = 4,
+    CELL_SLOW = 5,
+    CELL_WALL_L1_ONLY = 6,
+    CELL_BRIDGE_UP = 7,  // te levanta
+    CELL_WALL_L0_ONLY = 8,
+    CELL_BRIDGE_DOWN = 9,  // te baja
+    CELL_BRIDGE_DOWN_AND_POLE = 10,
+    CELL_BRIDGE_UP_AND_POLE = 11,
+    CELL_BRIDGE_DOWN_AND_GOAL = 12,
+    CELL_BRIDGE_UP_AND_GOAL = 13,
+    CELL_BRIDGE_DOWN_AND_CHECKPOINT = 14,
+    CELL_BRIDGE_UP_AND_CHECKPOINT = 15
+};
+
+struct MapFileCell {
+    uint16_t col;
+    uint16_t row;
+};
+
+struct MapFileCheckpoint {
+    int32_t order;
+    bool goal;
+    std::vector<MapFileCell> cells;
+};
+
+// dir: 0 = Right, 1 = Left, 2 = Up, 3 = Down
+struct MapFileNpcSpawn {
+    uint16_t col;
+    uint16_t row;
+    uint8_t dir;
+};
+
+// Todo lo que necesita el server de un mapa, ya interpretado.
+// Los checkpoints vienen ordenados y con la meta al final (order = max + 1)
+struct MapFileData {
+    std::string base_map;
+    uint16_t width = 0;
+    uint16_t height = 0;
+    // Un byte por celda, fila por fila (grid[row * width + col])
+    std::vector<uint8_t> grid;
+    // 0x01 derecha, 0x02 izquierda, 0x03 arriba, 0x04 abajo
+    uint8_t pole_direction = 0;
+    std::vector<MapFileCell> pole_cells;
+    std::vector<MapFileCheckpoint> checkpoints;
+    std::vector<MapFileNpcSpawn> npc_spawns;
+    std::vector<MapFileNpcSpawn> npc_spawns_park;
+};
+
+/*
+ * Formato binario .n4smap (todos los enteros en big endian, como en el protocolo):
+ *
+ *  Header (24 bytes)
+ *    "N4SM" | u16 version | u16 largo del header | u16 width | u16 height |
+ *    u32 largo del cuerpo | u32 checksum (FNV-1a del cuerpo) | u32 reservado
+ *  Cuerpo
+ *    grilla: width * height bytes (va primero, asi se puede leer directo del mmap)
+ *    pole: u8 direccion | u16 cantidad | (u16 col, u16 row)*
+ *    u16 largo + base_map
+ *    checkpoints: u16 cantidad | (i32 order, u8 goal, u16 cantidad, (u16 col, u16 row)*)*
+ *    npc_spawns: u16 cantidad | (u16 col, u16 row, u8 dir)*
+ *    npc_spawns_park: igual que npc_spawns
+ */
+class MapFile {
+public:
+    static constexpr uint16_t VERSION = 1;
+    static constexpr std::size_t HEADER_SIZE = 24;
+    static constexpr const char* EXTENSION = ".n4smap";
+
+    // Interpreta el json del editor (el mismo que leia antes MapLoader)
+    static MapFileData from_json(const nlohmann::json& j);
+
+    // Serializa el mapa al formato binario
+    static std::vector<uint8_t> encode(const MapFileData& data);
+
+    // Escribe el .n4smap (primero a un temporal y despues lo renombra)
+    static void write(const std::string& path, const MapFileData& data);
+
+    // "mapas/Mi Mapa.json" -> "mapas/Mi Mapa.n4smap"
+    static std::string binary_path_for(const std::string& json_path);
+
+    static uint32_t checksum(const uint8_t* data, std::size_t size);
+};
+
+// Un .n4smap abierto con mmap. La grilla no se copia: grid() apunta adentro del archivo
+// mapeado. Las tablas (pole, checkpoints, spawns) son chicas y se decodifican al abrir
+class MappedMapFile {
+private:
+    const uint8_t* mapping = nullptr;
+    std::size_t mapping_size = 0;
+
+    MapFileData tables;  // Todo menos la grilla
+
+    void decode_body();
+
+public:
+    // Tira std::runtime_error si el archivo no existe, esta corrupto o es de otra version
+    explicit MappedMapFile(const std::string& path);
+
+    const uint8_t* grid() const { return mapping + MapFile::HEADER_SIZE; }
+
+    // Datos del mapa. Ojo: data().grid esta vacio, la grilla se lee con grid()
+    const MapFileData& data() const { return tables; }
+
+    ~MappedMapFile();
+    MappedMapFile(const MappedMapFile&) = delete;
+    MappedMapFile& operator=(const MappedMapFile&) = delete;
+};
+
+#endif  // MAP_FILE_H
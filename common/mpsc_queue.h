@@ -0,0 +1,138 @@
+#ifndef MPSC_QUEUE_H_
+#define MPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "queue.h"
+
+/*
+ * Multiproducer/Singleconsumer Bounded Queue (MPSC), lock-free
+ *
+ * Ring de capacidad fija (potencia de 2) donde cada slot tiene un numero
+ * de secuencia que dice de quien es el turno:
+ *  - seq == pos:            libre, lo puede tomar el productor de la posicion pos
+ *  - seq == pos + 1:        tiene un valor listo para el consumidor
+ *  - seq == pos + capacity: el consumidor ya lo libero para la vuelta siguiente
+ *
+ * Los productores se reparten las posiciones con un CAS sobre tail; el
+ * consumidor es uno solo y avanza head sin atomics. Los valores se mueven
+ * adentro y afuera, nunca se copian.
+ *
+ * push() no bloquea con mutex: si el ring esta lleno cede el procesador y
+ * reintenta, asi que solo sirve si el consumidor sigue sacando. Los hilos
+ * que atienden conexiones usan try_push(), que devuelve false.
+ *
+ * Igual que Queue, sobre una cola cerrada push() lanza ClosedQueue, y
+ * drain() tambien si ya no queda nada por sacar.
+ * */
+template <typename T>
+class MpscQueue {
+private:
+    struct Slot {
+        std::atomic<std::size_t> seq;
+        T value;
+    };
+
+    const std::size_t capacity;
+    const std::size_t mask;
+    std::unique_ptr<Slot[]> slots;
+
+    // En lineas de cache separadas: tail lo pisan los productores, head solo el consumidor
+    alignas(64) std::atomic<std::size_t> tail{0};
+    alignas(64) std::size_t head = 0;
+
+    std::atomic<bool> closed{false};
+
+    static std::size_t round_up_pow2(std::size_t n) {
+        std::size_t p = 2;
+        while (p < n) {
+            p <<= 1;
+        }
+        return p;
+    }
+
+public:
+    explicit MpscQueue(std::size_t min_capacity = 4096):
+            capacity(round_up_pow2(min_capacity)),
+            mask(capacity - 1),
+            slots(new Slot[capacity]) {
+        for (std::size_t i = 0; i < capacity; ++i) {
+            slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool try_push(T&& val) {
+        if (closed.load(std::memory_order_relaxed)) {
+            throw ClosedQueue();
+        }
+
+        std::size_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[pos & mask];
+            const std::size_t seq = slot.seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = std::move(val);
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+                // Otro productor gano la posicion, pos ya quedo actualizado por el CAS
+            } else if (diff < 0) {
+                // El consumidor todavia no libero este slot: lleno
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void push(T&& val) {
+        while (!try_push(std::move(val))) {
+            std::this_thread::yield();
+        }
+    }
+
+    /*
+     * Saca todo lo que este listo (hasta max) y se lo pasa a fn de a uno,
+     * en el orden en que se encolo. Retorna cuantos saco.
+     *
+     * Solo lo puede llamar un hilo a la vez (el consumidor).
+     * */
+    template <typename F>
+    std::size_t drain(F&& fn, std::size_t max = static_cast<std::size_t>(-1)) {
+        std::size_t count = 0;
+        while (count < max) {
+            Slot& slot = slots[head & mask];
+            if (slot.seq.load(std::memory_order_acquire) != head + 1) {
+                break;
+            }
+            T val = std::move(slot.value);
+            slot.seq.store(head + capacity, std::memory_order_release);
+            ++head;
+            ++count;
+            fn(val);
+        }
+
+        if (count == 0 && closed.load(std::memory_order_relaxed)) {
+            throw ClosedQueue();
+        }
+        return count;
+    }
+
+    void close() {
+        if (closed.exchange(true)) {
+            throw std::runtime_error("The queue is already closed.");
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include "operations_bytes.h"
 
+#include <stdexcept>
+
 void OperationsBytes::add_one_byte(uint8_t code, std::vector<uint8_t>& buf) { buf.push_back(code); }
 
 void OperationsBytes::add_two_bytes(uint16_t value, std::vector<uint8_t>& buf) {
@@ -16,6 +18,14 @@ void OperationsBytes::add_four_bytes(uint32_t value, std::vector<uint8_t>& buf)
     std::memcpy(buf.data() + pos, &value, sizeof(value));
 }
 
+void OperationsBytes::add_varint(uint32_t value, std::vector<uint8_t>& buf) {
+    while (value >= 0x80) {
+        buf.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    buf.push_back(static_cast<uint8_t>(value));
+}
+
 void OperationsBytes::add_string(const std::string& str, std::vector<uint8_t>& buf) {
     buf.insert(std::end(buf), str.begin(), str.end());
 }
@@ -46,6 +56,18 @@ uint32_t OperationsBytes::receive_four_bytes(ISocket& skt) {
     return ntohl(value);
 }
 
+uint32_t OperationsBytes::receive_varint(ISocket& skt) {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        const uint8_t byte = receive_one_byte(skt);
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::runtime_error("OperationsBytes: varint de mas de 5 bytes");
+}
+
 std::string OperationsBytes::receive_string(size_t length, ISocket& skt) {
     std::string str(length, '\0');
     if (length > 0) {
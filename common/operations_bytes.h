@@ -25,6 +25,10 @@ public:
     // Agrega al buffer un uint32_t
     static void add_four_bytes(uint32_t value, std::vector<uint8_t>& buf);
 
+    // Agrega al buffer un uint32_t como varint (7 bits por byte, el bit alto indica que sigue).
+    // Los valores chicos (< 128) ocupan un solo byte
+    static void add_varint(uint32_t value, std::vector<uint8_t>& buf);
+
     // Agrega al buffer un string
     static void add_string(const std::string& str, std::vector<uint8_t>& buf);
 
@@ -37,6 +41,9 @@ public:
     // Recibe un uint32_t de un socket
     static uint32_t receive_four_bytes(class ISocket& skt);
 
+    // Recibe un varint de un socket (a lo sumo 5 bytes)
+    static uint32_t receive_varint(class ISocket& skt);
+
     // Recibe un string de un socket
     static std::string receive_string(size_t length, class ISocket& skt);
 
@@ -5,11 +5,16 @@
 #include <arpa/inet.h>
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "liberror.h"
@@ -202,6 +207,8 @@ Socket::Socket(Socket&& other) {
     this->skt = other.skt;
     this->closed = other.closed;
     this->stream_status = other.stream_status;
+    this->send_syscalls = other.send_syscalls;
+    this->bytes_sent = other.bytes_sent;
 
     /* ...pero luego le sacamos al otro socket
      * el ownership del recurso.
@@ -241,6 +248,8 @@ Socket& Socket::operator=(Socket&& other) {
     this->skt = other.skt;
     this->closed = other.closed;
     this->stream_status = other.stream_status;
+    this->send_syscalls = other.send_syscalls;
+    this->bytes_sent = other.bytes_sent;
     other.skt = -1;
     other.closed = true;
     other.stream_status = STREAM_BOTH_CLOSED;
@@ -292,6 +301,7 @@ int Socket::sendsome(const void* data, unsigned int sz) {
      * */
     // cppcheck-suppress cstyleCast
     int s = send(this->skt, (char*)data, sz, MSG_NOSIGNAL);
+    ++send_syscalls;
     if (s == -1) {
         /*
          * Este es un caso especial: cuando enviamos algo pero en el medio
@@ -319,6 +329,7 @@ int Socket::sendsome(const void* data, unsigned int sz) {
         stream_status |= STREAM_SEND_CLOSED;
         return 0;
     } else {
+        bytes_sent += s;
         return s;
     }
 }
@@ -381,6 +392,119 @@ int Socket::sendall(const void* data, unsigned int sz) {
     return sz;
 }
 
+int Socket::sendallv(struct iovec* iov, int iovcnt) {
+    chk_skt_or_fail();
+    int sent = 0;
+
+    // Salteamos los buffers vacios para no hacer un sendmsg de 0 bytes
+    while (iovcnt > 0 and iov->iov_len == 0) {
+        ++iov;
+        --iovcnt;
+    }
+
+    while (iovcnt > 0) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (iovcnt > IOV_MAX) ? IOV_MAX : iovcnt;
+
+        /* Mismo manejo que `Socket::sendsome`: MSG_NOSIGNAL y EPIPE como cierre */
+        ssize_t s = sendmsg(this->skt, &msg, MSG_NOSIGNAL);
+        ++send_syscalls;
+        if (s == -1) {
+            if (errno != EPIPE)
+                throw LibError(errno, "socket sendmsg failed");
+            stream_status |= STREAM_SEND_CLOSED;
+            if (sent)
+                throw LibError(EPIPE, "socket sent only %d bytes of the vector", sent);
+            return 0;
+        }
+        bytes_sent += s;
+        sent += static_cast<int>(s);
+
+        /*
+         * Avanzamos sobre lo que el kernel acepto: los buffers completos
+         * se descartan y el primero a medias se recorta.
+         * */
+        size_t left = static_cast<size_t>(s);
+        while (iovcnt > 0 and left >= iov->iov_len) {
+            left -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0) {
+            // cppcheck-suppress cstyleCast
+            iov->iov_base = (char*)iov->iov_base + left;
+            iov->iov_len -= left;
+        }
+    }
+
+    return sent;
+}
+
+void Socket::set_nodelay(bool enabled) {
+    chk_skt_or_fail();
+    int optval = enabled ? 1 : 0;
+    if (setsockopt(this->skt, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval)) == -1)
+        throw LibError(errno, "socket setsockopt TCP_NODELAY failed");
+}
+
+void Socket::set_notsent_lowat(int bytes) {
+    chk_skt_or_fail();
+#ifdef TCP_NOTSENT_LOWAT
+    if (setsockopt(this->skt, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &bytes, sizeof(bytes)) == -1)
+        throw LibError(errno, "socket setsockopt TCP_NOTSENT_LOWAT failed");
+#else
+    (void)bytes;
+#endif
+}
+
+void Socket::set_nonblocking() {
+    chk_skt_or_fail();
+    int flags = fcntl(this->skt, F_GETFL, 0);
+    if (flags == -1 or fcntl(this->skt, F_SETFL, flags | O_NONBLOCK) == -1)
+        throw LibError(errno, "socket fcntl O_NONBLOCK failed");
+}
+
+int Socket::try_recvsome(void* data, unsigned int sz) {
+    chk_skt_or_fail();
+    // cppcheck-suppress cstyleCast
+    int s = recv(this->skt, (char*)data, sz, 0);
+    if (s == 0) {
+        stream_status |= STREAM_RECV_CLOSED;
+        return 0;
+    } else if (s == -1) {
+        if (errno == EAGAIN or errno == EINTR)
+            return -1;
+        /* Un reset del peer es un cierre como cualquier otro */
+        if (errno == ECONNRESET) {
+            stream_status |= STREAM_RECV_CLOSED;
+            return 0;
+        }
+        throw LibError(errno, "socket recv failed");
+    }
+    return s;
+}
+
+int Socket::try_sendsome(const void* data, unsigned int sz) {
+    chk_skt_or_fail();
+    // cppcheck-suppress cstyleCast
+    int s = send(this->skt, (char*)data, sz, MSG_NOSIGNAL);
+    ++send_syscalls;
+    if (s == -1) {
+        if (errno == EAGAIN or errno == EINTR)
+            return -1;
+        /* Véase `Socket::sendsome` */
+        if (errno == EPIPE or errno == ECONNRESET) {
+            stream_status |= STREAM_SEND_CLOSED;
+            return 0;
+        }
+        throw LibError(errno, "socket send failed");
+    }
+    bytes_sent += s;
+    return s;
+}
+
 Socket::Socket(int skt) {
     this->skt = skt;
     this->closed = false;
@@ -1,6 +1,9 @@
 #ifndef SOCKET_H
 #define SOCKET_H
 
+#include <cstddef>
+#include <cstdint>
+
 #include "ISocket.h"
 
 /*
@@ -14,6 +17,10 @@ private:
     bool closed;
     int stream_status;
 
+    // Para las estadisticas de envio (las lee el mismo hilo que manda)
+    uint64_t send_syscalls = 0;
+    uint64_t bytes_sent = 0;
+
     /*
      * Construye el socket pasándole directamente el file descriptor.
      * */
@@ -120,7 +127,7 @@ public:
      * Lease manpage de `send` y `recv`
      * */
     int sendsome(const void* data, unsigned int sz);
-    int recvsome(void* data, unsigned int sz);
+    int recvsome(void* data, unsigned int sz) override;
 
     /*
      * `Socket::sendall` envía exactamente `sz` bytes leídos del buffer, ni más,
@@ -145,6 +152,68 @@ public:
     int sendall(const void* data, unsigned int sz) override;
     int recvall(void* data, unsigned int sz) override;
 
+    /*
+     * `Socket::sendallv` es como `Socket::sendall` pero junta varios buffers
+     * en un mismo `sendmsg` (lease manpage de `writev`). Si el kernel acepta
+     * solo una parte, se avanza sobre `iov` y se sigue desde ahi, por eso
+     * el arreglo puede quedar modificado.
+     *
+     * Retorna el total enviado, 0 si el socket se cerro sin enviar nada
+     * y lanza una excepción si se cerro a mitad de camino.
+     * */
+    int sendallv(struct iovec* iov, int iovcnt) override;
+
+    /*
+     * Opciones de TCP por conexión.
+     *
+     * `set_nodelay` desactiva el algoritmo de Nagle: lo que se manda sale
+     * ya, sin esperar a juntar más datos (nosotros ya juntamos por nuestra
+     * cuenta).
+     *
+     * `set_notsent_lowat` limita cuantos bytes aún no enviados puede tener
+     * el kernel encolados en el socket; así los datos viejos no se apilan
+     * en el kernel cuando el cliente es lento. Si el sistema no tiene
+     * `TCP_NOTSENT_LOWAT` no hace nada.
+     *
+     * En caso de error se lanza una excepción.
+     * */
+    void set_nodelay(bool enabled);
+    void set_notsent_lowat(int bytes);
+
+    /*
+     * Pasa el socket a modo no bloqueante (para usarlo con epoll).
+     *
+     * En ese modo se usan `Socket::try_recvsome` y `Socket::try_sendsome`,
+     * que son como `recvsome`/`sendsome` pero retornan -1 en vez de
+     * bloquear si no hay nada para recibir o no hay lugar para enviar
+     * (EAGAIN). `recvall`/`sendall` no tienen sentido en este modo.
+     * */
+    void set_nonblocking();
+    int try_recvsome(void* data, unsigned int sz);
+    int try_sendsome(const void* data, unsigned int sz);
+
+    /*
+     * File descriptor, solo para registrarlo en epoll. El socket sigue
+     * siendo el dueño: no hay que cerrarlo por fuera.
+     * */
+    int get_fd() const { return skt; }
+
+    /*
+     * Cantidad de syscalls de envio hechas y bytes enviados desde que
+     * se creo el socket.
+     * */
+    uint64_t get_send_syscalls() const { return send_syscalls; }
+    uint64_t get_bytes_sent() const { return bytes_sent; }
+
+    /*
+     * Anota un envio que no paso por este socket (lo hizo io_uring
+     * sobre el mismo fd), para que las estadisticas sigan cuadrando.
+     * */
+    void record_external_send(std::size_t bytes) {
+        ++send_syscalls;
+        bytes_sent += bytes;
+    }
+
     /*
      * Acepta una conexión entrante y retorna un nuevo socket
      * construido a partir de ella.
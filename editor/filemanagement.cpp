@@ -6,8 +6,11 @@
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <exception>
 #include <utility>
 
+#include "../common/map_file.h"
+
 bool FileManagement::loadMatrixFromJson(const QString& filePath, QVector<QVector<int>>& outGrid,
                                         QList<QPair<int, QVector<QPoint>>>& outCheckpoints,
                                         QString& outBaseMapName, QJsonObject& outExtraFields,
@@ -141,6 +144,25 @@ bool FileManagement::saveMatrixToJson(const QString& filePath, const QVector<QVe
     if (!f.open(QIODevice::WriteOnly))
         return false;
 
-    f.write(doc.toJson(QJsonDocument::Compact));
+    const QByteArray json = doc.toJson(QJsonDocument::Compact);
+    f.write(json);
+    f.close();
+
+    // Si falla el binario no es grave: el server lo regenera desde el json
+    exportBinaryMap(filePath, json);
+    return true;
+}
+
+bool FileManagement::exportBinaryMap(const QString& jsonFilePath, const QByteArray& json) {
+    // El server lee el .n4smap (mmap, sin parsear json). Lo generamos con el mismo
+    // codigo que usa el conversor, a partir del json que acabamos de guardar
+    try {
+        const char* begin = json.constData();
+        const nlohmann::json j = nlohmann::json::parse(begin, begin + json.size());
+        MapFile::write(MapFile::binary_path_for(jsonFilePath.toStdString()), MapFile::from_json(j));
+    } catch (const std::exception& e) {
+        qWarning() << "No se pudo exportar el .n4smap:" << e.what();
+        return false;
+    }
     return true;
 }
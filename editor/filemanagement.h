@@ -1,6 +1,7 @@
 #ifndef FILEMANAGEMENT_H
 #define FILEMANAGEMENT_H
 
+#include <QByteArray>
 #include <QJsonObject>
 #include <QList>
 #include <QPair>
@@ -19,6 +20,9 @@ public:
                                  const QList<QPair<int, QVector<QPoint>>>& checkpoints,
                                  const QString& baseMapFile, const QString& direccionSalida,
                                  const QJsonObject& extraFields);
+
+    // Exporta el mapa en formato binario (.n4smap) al lado del json
+    static bool exportBinaryMap(const QString& jsonFilePath, const QByteArray& json);
 };
 
 #endif
@@ -14,15 +14,21 @@ enum class CommandReceiverType : uint8_t {
     Disconect,
     BeginRace,
     Upgrade,
-    DefiniteDisconect
+    DefiniteDisconect,
+    SnapshotAck,
+    ProtocolVersion,
+    UdpReady,
+    InputState
 };
 
 // El CommandReceiver es el comando que va a recibir el gameloop desde el receiver
 struct CommandReceiver {
     int client_id;
     CommandReceiverType type;
-    uint8_t param;       // Direccion de movimiento, modelo del auto, upgrade
+    uint8_t param;       // Direccion de movimiento, modelo del auto, upgrade, teclas
     std::string name{};  // Solo para new car
+    // Solo para InputState: secuencia del estado de teclas que viene en param
+    uint32_t sequence = 0;
 };
 
 // Estos structs son comandos especificos que van a llegar al receiver pero seran
@@ -48,5 +54,18 @@ struct CommandReceiverStartLobby {
     uint32_t lobby_id;
 };
 
+// Datagrama UDP de un cliente (UDP_HELLO, UDP_INPUT o UDP_INPUT_STATE). Llega sin conexion, por
+// eso trae el id y el token que se le dio por TCP
+struct UdpInput {
+    uint32_t sequence;
+    uint8_t key;
+};
+struct CommandReceiverUdp {
+    uint8_t op;
+    int client_id;
+    uint32_t token;
+    std::vector<UdpInput> inputs;  // solo UDP_INPUT, de la mas vieja a la mas nueva
+    UdpInput state{};              // solo UDP_INPUT_STATE (key son las teclas apretadas)
+};
 
 #endif  // COMMAND_H
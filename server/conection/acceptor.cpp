@@ -1,15 +1,56 @@
 #include "acceptor.h"
 
+#include <algorithm>
+#include <string>
+#include <thread>
+
+#include "../config.h"
+
 Acceptor::Acceptor(const char* servname, GameManager& game_manager):
-        server_socket(servname), game_manager(game_manager) {}
+        server_socket(servname), game_manager(game_manager) {
+    const Config& cfg = Config::instance();
+    if (cfg.udp_enabled()) {
+        const std::string udp_servname =
+                cfg.udp_port() > 0 ? std::to_string(cfg.udp_port()) : std::string(servname);
+        try {
+            udp = std::make_unique<UdpChannel>(udp_servname.c_str());
+        } catch (const std::exception& e) {
+            // Sin UDP los clientes siguen andando igual, todo por TCP
+            std::cerr << "Acceptor: no se pudo abrir el canal UDP: " << e.what() << "\n";
+        }
+    }
+    if (!cfg.use_reactor()) {
+        return;
+    }
+    unsigned int n = cfg.reactor_threads();
+    if (n == 0) {
+        n = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned int i = 0; i < n; ++i) reactors.push_back(Reactor::create(cfg.io_model()));
+}
+
+Reactor* Acceptor::pick_reactor() {
+    if (reactors.empty()) {
+        return nullptr;
+    }
+    Reactor* r = reactors[next_reactor].get();
+    next_reactor = (next_reactor + 1) % reactors.size();
+    return r;
+}
 
 void Acceptor::run() {
+    for (auto& r: reactors) r->start();
+    if (udp) {
+        udp->start();
+    }
+
     while (should_keep_running()) {
         try {
             reap();
             Socket peer = server_socket.accept();
             // Creamos el manejador de cliente y lo iniciamos
-            auto& h = clients.emplace_back(std::move(peer), next_id++, game_manager);
+            auto& h = clients.emplace_back(std::move(peer), next_id++, game_manager,
+                                           pick_reactor(), udp.get());
             h.start();
         } catch (const LibError& e) {
             // Si el socket fue cerrado aproposito, no es un error
@@ -57,6 +98,16 @@ void Acceptor::reap() {
 }
 
 void Acceptor::clear() {
+    // Primero se paran los reactores, asi nadie mas toca los handlers mientras se joinean
+    for (auto& r: reactors) {
+        r->stop();
+        r->join();
+    }
+    // Y el canal UDP, que es el otro que pushea inputs a las partidas
+    if (udp) {
+        udp->stop();
+        udp->join();
+    }
     for (auto& handler: clients) handler.join();
     clients.clear();
 }
@@ -3,7 +3,9 @@
 
 #include <iostream>
 #include <list>
+#include <memory>
 #include <utility>
+#include <vector>
 
 #include <sys/socket.h>
 
@@ -14,6 +16,8 @@
 
 #include "client_handler.h"
 #include "game_manager.h"
+#include "reactor.h"
+#include "udp_channel.h"
 
 
 class Acceptor: public Thread {
@@ -24,12 +28,24 @@ private:
 
     GameManager& game_manager;
 
+    // Con io_model epoll o io_uring, los hilos que atienden las conexiones (se reparten en
+    // ronda). Van antes que los clientes: los handlers se destruyen primero
+    std::vector<std::unique_ptr<Reactor>> reactors;
+    std::size_t next_reactor = 0;
+
+    // Canal UDP compartido por todos los clientes (nullptr si esta deshabilitado o no se pudo
+    // abrir). Tambien va antes que los clientes: sus sesiones se cierran al destruirse
+    std::unique_ptr<UdpChannel> udp;
+
     // Lista para almacenar los manejadores de clientes activos
     std::list<ClientHandler> clients;
 
     // ID para el proximo cliente
     int next_id = 1;
 
+    // nullptr si cada cliente tiene sus propios hilos
+    Reactor* pick_reactor();
+
     // Elimina clientes que ya terminaron
     void reap();
 
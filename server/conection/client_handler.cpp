@@ -1,17 +1,169 @@
 #include "client_handler.h"
 
-ClientHandler::ClientHandler(Socket&& peer, const int id, GameManager& gm):
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+
+#include "../config.h"
+
+static std::chrono::steady_clock::duration max_client_lag() {
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<float>(Config::instance().max_client_lag_seconds()));
+}
+
+// Con reactor: cuanto se lee de un socket por vuelta, cuanto puede juntar un cliente sin
+// completar un comando, y hasta cuanto se serializa adelantado al socket
+static constexpr std::size_t READ_CHUNK = 16 * 1024;
+static constexpr int MAX_READS_PER_WAKEUP = 4;
+static constexpr std::size_t MAX_INPUT_BYTES = 1 << 20;
+static constexpr std::size_t OUTPUT_HIGH_WATER = 256 * 1024;
+
+ClientHandler::ClientHandler(Socket&& peer, const int id, GameManager& gm, Reactor* reactor,
+                             UdpChannel* udp):
         peer(std::move(peer)),
         id_(id),
         game_manager(gm),
-        receiver(this->peer, this->id_, *this),
-        sender(this->peer, this->id_, queue_out) {}
+        queue_out(std::make_shared<OutboundQueue>(Config::instance().max_queued_bytes_per_client(),
+                                                  max_client_lag())),
+        reactor(reactor),
+        receiver(reactor ? static_cast<ISocket&>(input) : static_cast<ISocket&>(this->peer),
+                 this->id_, *this),
+        sender(this->peer, this->id_, *queue_out),
+        udp(udp) {
+    if (!udp) {
+        return;
+    }
+    // La sesion se abre ya (es solo un token) pero se ofrece recien si el cliente la entiende
+    udp_session = udp->open_session(id_);
+    sender.set_datagram_sink([udp, s = udp_session.get()](const WireBuffer& wire) {
+        return udp->send_snapshot(*s, *wire);
+    });
+}
 
 void ClientHandler::start() {
-    if (!is_started) {
-        is_started = true;
-        sender.start();
-        receiver.start();
+    if (is_started)
+        return;
+    is_started = true;
+    if (reactor) {
+        reactor->add(*this);
+        return;
+    }
+    sender.start();
+    receiver.start();
+}
+
+bool ClientHandler::on_registered() {
+    try {
+        peer.set_nonblocking();
+        // Cada vez que la cola pasa de vacia a tener algo, el reactor viene a mandarlo
+        queue_out->set_listener([r = reactor, id = id_]() { r->notify_writable(id); });
+        sender.greet(output);
+    } catch (const std::exception& e) {
+        std::cerr << "ClientHandler " << id_ << ": " << e.what() << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool ClientHandler::on_readable() {
+    try {
+        for (int i = 0; i < MAX_READS_PER_WAKEUP; ++i) {
+            uint8_t* dst = input.write_area(READ_CHUNK);
+            const auto space = static_cast<unsigned int>(std::min<std::size_t>(
+                    input.write_space(), UINT_MAX));
+            int n = peer.try_recvsome(dst, space);
+            if (n < 0) {
+                break;  // no hay mas por ahora
+            }
+            if (n == 0) {
+                input.set_eof();
+                break;
+            }
+            input.commit_write(static_cast<std::size_t>(n));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "ClientHandler " << id_ << ": " << e.what() << "\n";
+        return false;
+    }
+    return process_input();
+}
+
+bool ClientHandler::on_received(const uint8_t* data, std::size_t n) {
+    if (n == 0) {
+        input.set_eof();
+    } else {
+        std::memcpy(input.write_area(n), data, n);
+        input.commit_write(n);
+    }
+    return process_input();
+}
+
+bool ClientHandler::process_input() {
+    try {
+        while (true) {
+            input.begin_command();
+            bool keep_going;
+            try {
+                keep_going = receiver.handle_next_command();
+            } catch (const NeedMoreInput&) {
+                input.rollback();
+                break;
+            }
+            // El comando que se acaba de atender puede haber negociado los frames
+            input.set_framed(receiver.framed_commands());
+            if (!keep_going) {
+                return false;
+            }
+        }
+        input.compact();
+
+        if (input.pending() > MAX_INPUT_BYTES) {
+            std::cerr << "ClientHandler " << id_ << ": comando demasiado largo, se desconecta\n";
+            return false;
+        }
+    } catch (const ClosedQueue&) {
+        // Igual que en el receiver: la partida cerro su cola
+        return false;
+    } catch (const std::exception& e) {
+        std::cerr << "ClientHandler " << id_ << ": " << e.what() << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool ClientHandler::fill_output() {
+    try {
+        return sender.pump(output, OUTPUT_HIGH_WATER);
+    } catch (const std::exception& e) {
+        std::cerr << "ClientHandler " << id_ << ": " << e.what() << "\n";
+        return false;
+    }
+}
+
+bool ClientHandler::on_writable() {
+    try {
+        while (true) {
+            if (!fill_output()) {
+                return false;
+            }
+            if (output.pending() == 0) {
+                return true;
+            }
+            const auto size =
+                    static_cast<unsigned int>(std::min<std::size_t>(output.pending(), UINT_MAX));
+            int n = peer.try_sendsome(output.pending_data(), size);
+            if (n < 0) {
+                return true;  // socket lleno: el reactor espera EPOLLOUT
+            }
+            if (n == 0) {
+                return false;
+            }
+            output.consume(static_cast<std::size_t>(n));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "ClientHandler " << id_ << ": " << e.what() << "\n";
+        return false;
     }
 }
 
@@ -19,6 +171,10 @@ void ClientHandler::join() {
     if (!is_started)
         return;
 
+    set_udp_game(nullptr);
+    if (udp) {
+        udp->close_session(id_);
+    }
     if (current_game) {
         current_game->remove_lobby_player(id_);
         current_game->get_registry().remove(id_);
@@ -37,21 +193,33 @@ void ClientHandler::join() {
         current_lobby_id = 0;
     }
 
+    if (reactor) {
+        // El reactor ya no la atiende (o ya no corre): que la cola no lo despierte mas
+        queue_out->set_listener(nullptr);
+    }
     sender.close_queue();
 
     try {
         peer.shutdown(SHUT_RDWR);
     } catch (...) {}
-    receiver.join();
-    sender.join();
+    if (!reactor) {
+        receiver.join();
+        sender.join();
+    }
     is_started = false;
 }
 
 // Si alguno dejo de estar vivo, el handler ya termino y debe hacer join de ambos
-bool ClientHandler::is_finished() const { return !receiver.is_alive() && !sender.is_alive(); }
+bool ClientHandler::is_finished() const {
+    if (reactor) {
+        return finished;
+    }
+    return !receiver.is_alive() && !sender.is_alive();
+}
 
-Queue<CommandReceiver>* ClientHandler::get_queue_gameloop() noexcept {
+MpscQueue<CommandReceiver>* ClientHandler::get_queue_gameloop() noexcept {
     if (current_game && current_game->has_finished()) {
+        set_udp_game(nullptr);
         current_game = nullptr;
         game_cmd_q = nullptr;
         current_lobby_id = 0;
@@ -66,6 +234,7 @@ Queue<CommandReceiver>* ClientHandler::get_queue_gameloop() noexcept {
 void ClientHandler::attach_to_game(Game& g, uint32_t lobby_id) {
     current_game = &g;
     current_lobby_id = lobby_id;
+    set_udp_game(&g);
     // Hasta que no inicie el juego realmente (salir de la lobby), no le asignamos la cola
 }
 
@@ -79,7 +248,7 @@ void ClientHandler::create_lobby(CommandReceiverCreateLobby& cmd) {
 
     if (!ok) {
         auto error = std::make_shared<JoinErrorEvent>();
-        queue_out.push(error);
+        queue_out->push(error);
         return;
     }
     attach_to_game(*g, snapshot.lobby_id);
@@ -93,7 +262,7 @@ void ClientHandler::join_lobby(const CommandReceiverJoinLobby& cmd) {
                                       snapshot, cmd.name);
     if (!ok) {
         auto error = std::make_shared<JoinErrorEvent>();
-        queue_out.push(error);
+        queue_out->push(error);
         return;
     }
     attach_to_game(*g, snapshot.lobby_id);
@@ -108,6 +277,7 @@ void ClientHandler::start_lobby(uint32_t lobby_id) {
 }
 
 void ClientHandler::disconnect() {
+    set_udp_game(nullptr);
     game_manager.disconnect(id_);
 
     current_game = nullptr;
@@ -115,4 +285,25 @@ void ClientHandler::disconnect() {
     current_lobby_id = 0;
 }
 
+void ClientHandler::ack_snapshot(uint32_t sequence) { sender.ack_snapshot(sequence); }
+
+void ClientHandler::set_protocol_version(uint8_t version) {
+    sender.set_protocol_version(version);
+    if (udp_session && version >= PROTOCOL_VERSION_UDP) {
+        queue_out->push(std::make_shared<UdpOfferEvent>(udp->get_port(), udp_session->get_token()));
+    }
+}
+
+void ClientHandler::activate_udp() {
+    if (udp_session) {
+        udp_session->set_ready();
+    }
+}
+
+void ClientHandler::set_udp_game(Game* g) {
+    if (udp_session) {
+        udp_session->set_game(g);
+    }
+}
+
 ClientHandler::~ClientHandler() { join(); }
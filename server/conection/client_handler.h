@@ -1,6 +1,8 @@
 #ifndef CLIENT_HANDLER_H
 #define CLIENT_HANDLER_H
 
+#include <atomic>
+#include <cstddef>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -9,18 +11,25 @@
 
 #include <sys/socket.h>
 
+#include "../../common/mpsc_queue.h"
 #include "../../common/queue.h"
 #include "../../common/socket.h"
 #include "../../common/thread.h"
 #include "../command.h"
 
 #include "client_registry.h"
+#include "connection_buffers.h"
 #include "game_manager.h"
+#include "reactor.h"
 #include "receiver.h"
 #include "sender.h"
+#include "udp_channel.h"
 
 // Hay un client handler por cliente conectado. Dueño de su propio socket,
 // receiver y sender. Administra la cola de salida del sender.
+//
+// Con reactor, ni el receiver ni el sender arrancan su hilo: el reactor le pasa lo que llega y
+// se lleva lo que hay que mandar, con la misma logica sobre los buffers de la conexion.
 
 class ClientHandler {
 private:
@@ -31,40 +40,84 @@ private:
     // Todos los client handlers comparten el game manager (monitorea todas las partidas)
     GameManager& game_manager;
 
-    // La cola del sender la administra el handler
-    Queue<std::shared_ptr<IEvent>> queue_out;
+    // La cola del sender la administra el handler. Es compartida con los registros de las
+    // partidas, que pueden tener todavia una lista vieja de destinatarios al irnos
+    std::shared_ptr<OutboundQueue> queue_out;
+
+    // nullptr = un hilo receiver y uno sender para este cliente
+    Reactor* reactor;
+    // Solo con reactor. Van antes del receiver, que lee de input
+    InputBuffer input;
+    OutputBuffer output;
+    std::atomic<bool> finished{false};
 
     Receiver receiver;
     Sender sender;
 
+    // nullptr = sin canal UDP; todo va por el socket
+    UdpChannel* udp;
+    std::shared_ptr<UdpSession> udp_session;
+
     // Arranca sin estar en ninguna partida. Durante el transcurso de la conexion,
     // puede crear o unirse a todas las partidas que quiera.
     Game* current_game = nullptr;
-    Queue<CommandReceiver>* game_cmd_q = nullptr;
+    MpscQueue<CommandReceiver>* game_cmd_q = nullptr;
     uint32_t current_lobby_id = 0;
 
     bool is_started{false};
     void attach_to_game(Game& g, uint32_t lobby_id);
+    // Los inputs por UDP van a la partida en la que estamos. Hay que sacarla ANTES de salir
+    // de ella, que despues se puede borrar
+    void set_udp_game(Game* g);
+
+    // Atiende los comandos completos que haya en el buffer de entrada
+    bool process_input();
 
 public:
-    ClientHandler(Socket&& peer, const int id, GameManager& gm);
+    ClientHandler(Socket&& peer, const int id, GameManager& gm, Reactor* reactor = nullptr,
+                  UdpChannel* udp = nullptr);
 
-    // Arranca Receiver y Sender
+    // Arranca Receiver y Sender, o le pasa la conexion al reactor
     void start();
 
     // Cierra la queue, shutdown al socket, join receiver y sender
     void join();
 
-    // Devuelve true si ambos hilos estan terminados
+    // Devuelve true si ambos hilos estan terminados (o si el reactor ya solto la conexion)
     bool is_finished() const;
 
+    // Desde el hilo del reactor. Los que devuelven bool dan false si hay que cerrar la conexion
+    int get_id() const { return id_; }
+    int get_fd() const { return peer.get_fd(); }
+    // Deja la bienvenida en el buffer de salida
+    bool on_registered();
+    // Epoll: el reactor avisa que el socket esta listo y el handler hace la syscall
+    bool on_readable();
+    bool on_writable();
+    // Queda algo en el buffer de salida que el socket no acepto
+    bool wants_write() const { return output.pending() > 0; }
+    // io_uring: el reactor hace la operacion y le pasa el resultado (n = 0 es que el cliente
+    // cerro). Mientras haya un envio en vuelo, el buffer de salida no se puede tocar
+    bool on_received(const uint8_t* data, std::size_t n);
+    bool fill_output();
+    const uint8_t* output_data() const { return output.pending_data(); }
+    std::size_t output_pending() const { return output.pending(); }
+    void on_sent(std::size_t n) { output.consume(n); }
+    // Cada send que completa el anillo, para las estadisticas del sender
+    void record_ring_send(std::size_t n) { peer.record_external_send(n); }
+    void mark_finished() { finished = true; }
+
     // Devuelve nullptr si aun no estamos en partida, eoc el puntero a la queue del gameloop
-    Queue<CommandReceiver>* get_queue_gameloop() noexcept;
+    MpscQueue<CommandReceiver>* get_queue_gameloop() noexcept;
 
     void join_lobby(const CommandReceiverJoinLobby& cmd);
     void create_lobby(CommandReceiverCreateLobby& cmd);
     void start_lobby(uint32_t lobby_id);
     void disconnect();
+    void ack_snapshot(uint32_t sequence);
+    void set_protocol_version(uint8_t version);
+    // El cliente ya recibe por UDP: las snapshots pasan a ir por ahi
+    void activate_udp();
 
     ClientHandler(const ClientHandler&) = delete;
     ClientHandler& operator=(const ClientHandler&) = delete;
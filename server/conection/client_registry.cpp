@@ -1,29 +1,68 @@
 #include "client_registry.h"
 
-void ClientRegistryMonitor::add(const int id, Queue<std::shared_ptr<IEvent>>& q) {
-    std::lock_guard<std::mutex> lk(m);
-    out_queue_sender[id] = &q;
+#include <algorithm>
+
+static bool id_less(const std::pair<int, std::shared_ptr<OutboundQueue>>& entry, int id) {
+    return entry.first < id;
+}
+
+void ClientRegistryMonitor::add(const int id, const std::shared_ptr<OutboundQueue>& q) {
+    std::lock_guard<std::mutex> lk(writers);
+    auto next = std::make_shared<Recipients>(*recipients.load());
+    auto it = std::lower_bound(next->begin(), next->end(), id, id_less);
+    if (it != next->end() && it->first == id) {
+        it->second = q;
+    } else {
+        next->emplace(it, id, q);
+    }
+    recipients.store(std::move(next));
 }
 
 void ClientRegistryMonitor::remove(const int id) {
-    std::lock_guard<std::mutex> lk(m);
-    out_queue_sender.erase(id);
+    std::lock_guard<std::mutex> lk(writers);
+    auto current = recipients.load();
+    auto it = std::lower_bound(current->begin(), current->end(), id, id_less);
+    if (it == current->end() || it->first != id) {
+        return;
+    }
+    auto next = std::make_shared<Recipients>(*current);
+    next->erase(next->begin() + (it - current->begin()));
+    recipients.store(std::move(next));
+}
+
+void ClientRegistryMonitor::push_to(OutboundQueue& q, const std::shared_ptr<IEvent>& event) {
+    try {
+        q.push(event);
+    } catch (const ClosedQueue&) {
+        // Si la cola del cliente esta cerrada, seguimos
+    }
 }
 
 // Envía un evento a todos los clientes registrados en el monitor.
 void ClientRegistryMonitor::broadcast(const std::shared_ptr<IEvent>& event) {
-    std::lock_guard<std::mutex> lk(m);
-    for (const auto& [id, q]: out_queue_sender) {
-        try {
-            q->push(event);
-        } catch (const ClosedQueue&) {
-            // Si la cola del cliente esta cerrada, seguimos
-            continue;
-        }
+    const auto current = recipients.load();
+    for (const auto& [id, q]: *current) {
+        push_to(*q, event);
+    }
+}
+
+void ClientRegistryMonitor::send_to(const int id, const std::shared_ptr<IEvent>& event) {
+    const auto current = recipients.load();
+    auto it = std::lower_bound(current->begin(), current->end(), id, id_less);
+    if (it == current->end() || it->first != id) {
+        return;
     }
+    push_to(*it->second, event);
 }
 
-int ClientRegistryMonitor::size() {
-    std::lock_guard<std::mutex> lk(m);
-    return static_cast<int>(out_queue_sender.size());
+std::vector<int> ClientRegistryMonitor::get_ids() {
+    const auto current = recipients.load();
+    std::vector<int> ids;
+    ids.reserve(current->size());
+    for (const auto& [id, q]: *current) {
+        ids.push_back(id);
+    }
+    return ids;
 }
+
+int ClientRegistryMonitor::size() { return static_cast<int>(recipients.load()->size()); }
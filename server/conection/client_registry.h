@@ -1,33 +1,46 @@
 #ifndef CLIENT_REGISTRY_H
 #define CLIENT_REGISTRY_H
 
-#include <map>
+#include <atomic>
 #include <memory>
 #include <mutex>
+#include <utility>
 #include <vector>
 
 #include "../../common/queue.h"
 #include "../event.h"
 
+#include "outbound_queue.h"
+
 
 // Al registro de clientes se le agrega un cliente cuando este se conecta. El gameloop debe
 // poder enviar eventos a los clientes y para eso necesita la cola de eventos de salida
 // de cada cliente. Cuando un cliente se desconecta, se lo elimina del registro.
-// El registro de clientes es un recurso compartido, se necesita un monitor.
 // Cada gameloop tiene su propio registro de clientes.
+//
+// El gameloop lo lee 60 veces por segundo y solo cambia cuando alguien entra o sale, asi que
+// la lista de destinatarios es inmutable: add/remove arman una copia nueva y la publican de
+// forma atomica, y broadcast lee la que este publicada sin tomar ningun mutex.
 
 class ClientRegistryMonitor {
 private:
-    // Recurso compartido, necesita mutex.
-    std::mutex m;
-    // Mapa de id de cliente a su cola de eventos de salida
-    std::map<int, Queue<std::shared_ptr<IEvent>>*> out_queue_sender;
+    // Ordenada por id. Las colas son compartidas: si un broadcast todavia tiene una lista vieja
+    // cuando el cliente se va, su cola sigue viva (y cerrada) hasta que termine
+    using Recipients = std::vector<std::pair<int, std::shared_ptr<OutboundQueue>>>;
+
+    std::atomic<std::shared_ptr<const Recipients>> recipients{
+            std::make_shared<const Recipients>()};
+
+    // Serializa solo a los que escriben (add/remove), los lectores no lo toman
+    std::mutex writers;
+
+    static void push_to(OutboundQueue& q, const std::shared_ptr<IEvent>& event);
 
 public:
     ClientRegistryMonitor() = default;
 
     // Agrega un cliente al registro
-    void add(const int id, Queue<std::shared_ptr<IEvent>>& q);
+    void add(const int id, const std::shared_ptr<OutboundQueue>& q);
 
     // Elimina un cliente del registro
     void remove(const int id);
@@ -36,6 +49,12 @@ public:
     // Seran snapshots del estado del juego en cierto momento
     void broadcast(const std::shared_ptr<IEvent>& event);
 
+    // Envía un evento a un solo cliente (si sigue registrado)
+    void send_to(const int id, const std::shared_ptr<IEvent>& event);
+
+    // Ids de los clientes registrados en este momento
+    std::vector<int> get_ids();
+
     int size();
 
     ~ClientRegistryMonitor() = default;
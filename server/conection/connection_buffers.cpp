@@ -0,0 +1,122 @@
+#include "connection_buffers.h"
+
+#include <algorithm>
+#include <cstring>
+
+uint8_t* InputBuffer::write_area(std::size_t min_space) {
+    if (data.size() - end < min_space) {
+        // Lo anterior al comando actual ya se parseo: se corre todo al principio
+        if (mark > 0) {
+            std::memmove(data.data(), data.data() + mark, end - mark);
+            pos -= mark;
+            end -= mark;
+            ready = ready > mark ? ready - mark : 0;
+            mark = 0;
+        }
+        if (data.size() - end < min_space) {
+            data.resize(std::max(end + min_space, data.size() * 2));
+        }
+    }
+    return data.data() + end;
+}
+
+void InputBuffer::commit_write(std::size_t n) { end += n; }
+
+void InputBuffer::set_framed(bool framed) {
+    if (framed && !frames) {
+        ready = pos;
+    }
+    frames = framed;
+}
+
+std::size_t InputBuffer::available() {
+    while (end - ready >= HEADER_SIZE) {
+        const std::size_t length = (static_cast<std::size_t>(data[ready]) << 8) | data[ready + 1];
+        // Un frame vacio se entrega igual, el FrameReader lo rechaza
+        if (end - ready < HEADER_SIZE + length) {
+            break;
+        }
+        ready += HEADER_SIZE + length;
+    }
+    return ready - pos;
+}
+
+void InputBuffer::rollback() {
+    // Con frames lo que se entrego ya esta en el FrameReader
+    if (!frames) {
+        pos = mark;
+    }
+}
+
+void InputBuffer::compact() {
+    if (pos == end) {
+        pos = end = mark = ready = 0;
+    }
+}
+
+int InputBuffer::recvall(void* buf, unsigned int size) {
+    if (end - pos < size) {
+        if (eof) {
+            return 0;
+        }
+        throw NeedMoreInput();
+    }
+    std::memcpy(buf, data.data() + pos, size);
+    pos += size;
+    return static_cast<int>(size);
+}
+
+int InputBuffer::recvsome(void* buf, unsigned int size) {
+    const std::size_t n = std::min<std::size_t>(size, frames ? available() : end - pos);
+    if (n == 0) {
+        if (eof) {
+            return 0;
+        }
+        throw NeedMoreInput();
+    }
+    std::memcpy(buf, data.data() + pos, n);
+    pos += n;
+    return static_cast<int>(n);
+}
+
+int InputBuffer::sendall(const void*, unsigned int) {
+    throw std::logic_error("InputBuffer: no se puede enviar");
+}
+
+int InputBuffer::sendallv(struct iovec*, int) {
+    throw std::logic_error("InputBuffer: no se puede enviar");
+}
+
+void OutputBuffer::consume(std::size_t n) {
+    sent += n;
+    if (sent == data.size()) {
+        data.clear();
+        sent = 0;
+    } else if (sent > data.size() / 2) {
+        // Lo ya enviado ocupa mas que lo pendiente: no vale la pena seguir arrastrandolo
+        data.erase(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(sent));
+        sent = 0;
+    }
+}
+
+int OutputBuffer::sendall(const void* buf, unsigned int size) {
+    const auto* bytes = static_cast<const uint8_t*>(buf);
+    data.insert(data.end(), bytes, bytes + size);
+    return static_cast<int>(size);
+}
+
+int OutputBuffer::sendallv(struct iovec* iov, int iovcnt) {
+    int total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        total += sendall(iov[i].iov_base, static_cast<unsigned int>(iov[i].iov_len));
+    }
+    return total;
+}
+
+int OutputBuffer::recvall(void*, unsigned int) {
+    throw std::logic_error("OutputBuffer: no se puede recibir");
+}
+
+int OutputBuffer::recvsome(void*, unsigned int) {
+    throw std::logic_error("OutputBuffer: no se puede recibir");
+}
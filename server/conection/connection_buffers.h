@@ -0,0 +1,102 @@
+#ifndef CONNECTION_BUFFERS_H
+#define CONNECTION_BUFFERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../../common/ISocket.h"
+
+// Los buffers con los que el reactor maneja una conexion sin bloquear. Ambos son ISocket, asi
+// el ServerProtocol de siempre parsea y serializa sobre memoria en vez de sobre el socket.
+
+// El comando que se esta parseando todavia no llego entero. No es un error: se vuelve a
+// intentar cuando lleguen mas bytes
+class NeedMoreInput: public std::runtime_error {
+public:
+    NeedMoreInput(): std::runtime_error("NeedMoreInput: el comando todavia no llego entero") {}
+};
+
+// Bytes recibidos de un cliente y todavia no parseados.
+//
+// Sin frames (protocolo viejo) el largo de un comando se conoce recien parseandolo, asi que se
+// marca el principio de cada comando y si se corta a la mitad se vuelve a la marca.
+// Con frames solo se entregan frames completos: el FrameReader del protocolo nunca se queda con
+// uno a medias y no hace falta volver atras.
+class InputBuffer: public ISocket {
+private:
+    std::vector<uint8_t> data;
+    std::size_t pos = 0;    // proximo byte a parsear
+    std::size_t end = 0;    // fin de lo recibido
+    std::size_t mark = 0;   // principio del comando actual
+    std::size_t ready = 0;  // con frames: fin del ultimo frame completo
+    bool frames = false;
+    bool eof = false;
+
+    static constexpr std::size_t HEADER_SIZE = 2;
+
+    // Con frames, cuantos bytes se pueden entregar desde pos
+    std::size_t available();
+
+public:
+    InputBuffer() = default;
+
+    // Lugar para recibir al menos min_space bytes mas; despues se confirma con commit_write
+    uint8_t* write_area(std::size_t min_space);
+    std::size_t write_space() const { return data.size() - end; }
+    void commit_write(std::size_t n);
+
+    // El cliente cerro: lo que falte ya no va a llegar
+    void set_eof() { eof = true; }
+
+    // A partir de aca los comandos llegan en frames (se negocio PROTOCOL_VERSION_FRAMED)
+    void set_framed(bool framed);
+
+    void begin_command() { mark = pos; }
+    void rollback();
+    // Descarta lo ya parseado
+    void compact();
+
+    std::size_t pending() const { return end - pos; }
+
+    int recvall(void* buf, unsigned int size) override;
+    int recvsome(void* buf, unsigned int size) override;
+
+    // No se manda nada por aca
+    int sendall(const void* buf, unsigned int size) override;
+    int sendallv(struct iovec* iov, int iovcnt) override;
+
+    int close() override { return 0; }
+    bool is_stream_send_closed() const override { return false; }
+    bool is_stream_recv_closed() const override { return eof; }
+};
+
+// Bytes serializados para un cliente que el socket todavia no acepto
+class OutputBuffer: public ISocket {
+private:
+    std::vector<uint8_t> data;
+    std::size_t sent = 0;
+
+public:
+    OutputBuffer() = default;
+
+    const uint8_t* pending_data() const { return data.data() + sent; }
+    std::size_t pending() const { return data.size() - sent; }
+    // El socket acepto n bytes
+    void consume(std::size_t n);
+
+    int sendall(const void* buf, unsigned int size) override;
+    int sendallv(struct iovec* iov, int iovcnt) override;
+
+    // No se recibe nada por aca
+    int recvall(void* buf, unsigned int size) override;
+    int recvsome(void* buf, unsigned int size) override;
+
+    int close() override { return 0; }
+    bool is_stream_send_closed() const override { return false; }
+    bool is_stream_recv_closed() const override { return false; }
+};
+
+#endif  // CONNECTION_BUFFERS_H
@@ -0,0 +1,161 @@
+#include "epoll_reactor.h"
+
+#include <cerrno>
+#include <iostream>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "../../common/liberror.h"
+
+#include "client_handler.h"
+
+EpollReactor::EpollReactor() {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+        throw LibError(errno, "epoll_create1 failed");
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = WAKE_ID;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev) == -1) {
+        int err = errno;
+        ::close(epoll_fd);
+        throw LibError(err, "epoll_ctl failed");
+    }
+}
+
+void EpollReactor::run() {
+    epoll_event events[MAX_EVENTS];
+    while (should_keep_running()) {
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Reactor: epoll_wait failed (errno " << errno << ")\n";
+            break;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.u64 == WAKE_ID) {
+                uint64_t count;
+                while (::read(wake_fd, &count, sizeof(count)) > 0) {}
+                continue;
+            }
+
+            const int id = static_cast<int>(events[i].data.u64);
+            const uint32_t e = events[i].events;
+            if (e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                handle_readable(id);
+            }
+            // Si la lectura la cerro, handle_writable ya no la encuentra
+            if (e & EPOLLOUT) {
+                handle_writable(id);
+            }
+        }
+
+        drain_requests();
+    }
+    // Las conexiones que quedan las cierra el acceptor con el join de cada handler
+}
+
+void EpollReactor::drain_requests() {
+    std::vector<ClientHandler*> added;
+    std::vector<int> writable;
+    take_requests(added, writable);
+
+    for (ClientHandler* h: added) register_connection(*h);
+    for (int id: writable) handle_writable(id);
+}
+
+void EpollReactor::register_connection(ClientHandler& h) {
+    const int id = h.get_id();
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.u64 = static_cast<uint64_t>(id);
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, h.get_fd(), &ev) == -1) {
+        std::cerr << "Reactor: no se pudo registrar al cliente " << id << " (errno " << errno
+                  << ")\n";
+        h.mark_finished();
+        return;
+    }
+    connections[id] = &h;
+    interest[id] = ev.events;
+
+    // La bienvenida puede no salir entera: en ese caso queda pidiendo EPOLLOUT
+    if (!h.on_registered() || !h.on_writable()) {
+        drop(id);
+        return;
+    }
+    update_interest(h);
+}
+
+void EpollReactor::drop(int id) {
+    auto it = connections.find(id);
+    if (it == connections.end()) {
+        return;
+    }
+    ClientHandler* h = it->second;
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, h->get_fd(), nullptr);
+    connections.erase(it);
+    interest.erase(id);
+
+    // Desde aca el handler es del acceptor, que lo va a joinear en el proximo reap
+    h->mark_finished();
+}
+
+void EpollReactor::update_interest(ClientHandler& h) {
+    const int id = h.get_id();
+    const uint32_t wanted = EPOLLIN | EPOLLRDHUP | (h.wants_write() ? EPOLLOUT : 0u);
+    uint32_t& current = interest[id];
+    if (current == wanted) {
+        return;
+    }
+
+    epoll_event ev{};
+    ev.events = wanted;
+    ev.data.u64 = static_cast<uint64_t>(id);
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, h.get_fd(), &ev) == -1) {
+        std::cerr << "Reactor: epoll_ctl MOD failed para el cliente " << id << " (errno "
+                  << errno << ")\n";
+        drop(id);
+        return;
+    }
+    current = wanted;
+}
+
+void EpollReactor::handle_readable(int id) {
+    auto it = connections.find(id);
+    if (it == connections.end()) {
+        return;
+    }
+    ClientHandler& h = *it->second;
+    if (!h.on_readable()) {
+        drop(id);
+        return;
+    }
+    update_interest(h);
+}
+
+void EpollReactor::handle_writable(int id) {
+    auto it = connections.find(id);
+    if (it == connections.end()) {
+        return;
+    }
+    ClientHandler& h = *it->second;
+    if (!h.on_writable()) {
+        drop(id);
+        return;
+    }
+    update_interest(h);
+}
+
+EpollReactor::~EpollReactor() {
+    if (epoll_fd != -1) {
+        ::close(epoll_fd);
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef EPOLL_REACTOR_H
+#define EPOLL_REACTOR_H
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "reactor.h"
+
+// Reactor sobre un epoll (level-triggered) con los sockets no bloqueantes
+class EpollReactor: public Reactor {
+private:
+    int epoll_fd = -1;
+
+    // Solo las toca el hilo del reactor
+    std::unordered_map<int, ClientHandler*> connections;
+    std::unordered_map<int, uint32_t> interest;  // eventos de epoll registrados por id
+
+    // El data de epoll es el id del cliente; el eventfd usa uno que ningun cliente tiene
+    static constexpr uint64_t WAKE_ID = 0;
+    static constexpr int MAX_EVENTS = 256;
+
+    void drain_requests();
+    void register_connection(ClientHandler& h);
+    void drop(int id);
+
+    // Pide EPOLLOUT solo mientras quede algo sin mandar
+    void update_interest(ClientHandler& h);
+
+    void handle_readable(int id);
+    void handle_writable(int id);
+
+public:
+    EpollReactor();
+
+    void run() override;
+
+    ~EpollReactor() override;
+};
+
+#endif  // EPOLL_REACTOR_H
@@ -0,0 +1,79 @@
+#include "frame_reader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "../../common/peer_close_error.h"
+
+const uint8_t* FrameCursor::take(std::size_t n) {
+    if (n > size - pos) {
+        throw FrameError("FrameCursor: campo que se pasa del final del frame");
+    }
+    const uint8_t* field = data + pos;
+    pos += n;
+    return field;
+}
+
+uint8_t FrameCursor::read_one_byte() { return *take(1); }
+
+uint16_t FrameCursor::read_two_bytes() {
+    const uint8_t* b = take(2);
+    return static_cast<uint16_t>((b[0] << 8) | b[1]);
+}
+
+uint32_t FrameCursor::read_four_bytes() {
+    const uint8_t* b = take(4);
+    return (static_cast<uint32_t>(b[0]) << 24) | (static_cast<uint32_t>(b[1]) << 16) |
+           (static_cast<uint32_t>(b[2]) << 8) | static_cast<uint32_t>(b[3]);
+}
+
+std::string FrameCursor::read_string(std::size_t length) {
+    const uint8_t* b = take(length);
+    return std::string(reinterpret_cast<const char*>(b), length);
+}
+
+void FrameReader::fill(ISocket& skt, std::size_t n) {
+    if (end - start >= n) {
+        return;
+    }
+    // Se pide recien al primer frame: el protocolo del sender nunca lee
+    if (buffer.empty()) {
+        buffer.resize(std::max(INITIAL_CAPACITY, n));
+    }
+
+    // Lo pendiente va al principio antes de que se acabe el lugar al final
+    if (buffer.size() - start < n) {
+        std::memmove(buffer.data(), buffer.data() + start, end - start);
+        end -= start;
+        start = 0;
+        if (buffer.size() < n) {
+            buffer.resize(std::max(n, buffer.size() * 2));
+        }
+    }
+
+    while (end - start < n) {
+        int received = skt.recvsome(buffer.data() + end,
+                                    static_cast<unsigned int>(buffer.size() - end));
+        if (received <= 0) {
+            throw PeerCloseError(
+                    "FrameReader: El peer ha sido cerrado al intentar recibir un frame");
+        }
+        end += static_cast<std::size_t>(received);
+    }
+}
+
+FrameCursor FrameReader::next_frame(ISocket& skt) {
+    fill(skt, HEADER_SIZE);
+    const std::size_t length = (static_cast<std::size_t>(buffer[start]) << 8) | buffer[start + 1];
+    if (length == 0) {
+        throw FrameError("FrameReader: frame vacio");
+    }
+
+    fill(skt, HEADER_SIZE + length);
+    FrameCursor frame(buffer.data() + start + HEADER_SIZE, length);
+    start += HEADER_SIZE + length;
+    if (start == end) {
+        start = end = 0;
+    }
+    return frame;
+}
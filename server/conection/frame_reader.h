@@ -0,0 +1,66 @@
+#ifndef FRAME_READER_H
+#define FRAME_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../../common/ISocket.h"
+
+// Un frame mal armado (largo 0 o un campo que se pasa del final). El cliente se desconecta
+class FrameError: public std::runtime_error {
+public:
+    explicit FrameError(const std::string& message): std::runtime_error(message) {}
+};
+
+// Vista sobre el payload de un frame ya recibido. Cada lectura chequea que no se pase del
+// final; lo que quede sin leer se descarta al pedir el siguiente frame
+class FrameCursor {
+private:
+    const uint8_t* data = nullptr;
+    std::size_t size = 0;
+    std::size_t pos = 0;
+
+    const uint8_t* take(std::size_t n);
+
+public:
+    FrameCursor() = default;
+    FrameCursor(const uint8_t* data, std::size_t size): data(data), size(size) {}
+
+    uint8_t read_one_byte();
+    uint16_t read_two_bytes();
+    uint32_t read_four_bytes();
+    std::string read_string(std::size_t length);
+
+    std::size_t remaining() const { return size - pos; }
+};
+
+// Lee frames [u16 largo][payload] de un socket. Pide al socket todo lo que tenga disponible
+// de una (recvsome) y despues corta los frames del buffer, asi una rafaga de comandos cuesta
+// un solo recv en vez de uno por campo
+class FrameReader {
+private:
+    static constexpr std::size_t HEADER_SIZE = 2;
+    static constexpr std::size_t INITIAL_CAPACITY = 4096;
+
+    std::vector<uint8_t> buffer;
+    std::size_t start = 0;  // primer byte sin consumir
+    std::size_t end = 0;    // fin de lo recibido
+
+    // Se queda recibiendo hasta tener al menos n bytes sin consumir
+    void fill(ISocket& skt, std::size_t n);
+
+public:
+    FrameReader() = default;
+
+    // Bloquea hasta tener un frame entero. El cursor apunta al buffer interno: vale hasta la
+    // proxima llamada
+    FrameCursor next_frame(ISocket& skt);
+
+    FrameReader(const FrameReader&) = delete;
+    FrameReader& operator=(const FrameReader&) = delete;
+};
+
+#endif  // FRAME_READER_H
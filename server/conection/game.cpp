@@ -1,13 +1,18 @@
 #include "game.h"
 
 #include <string>
+#include <utility>
 #include <vector>
 
 
-Game::Game(std::vector<std::string>& maps, int lobby_id):
-        command_queue(), registry(), gameloop(command_queue, registry, maps), lobby_id(lobby_id) {}
+Game::Game(std::vector<std::string>& maps, int lobby_id, TickScheduler& scheduler):
+        command_queue(),
+        registry(),
+        scheduler(scheduler),
+        gameloop(command_queue, registry, maps, lobby_id),
+        lobby_id(lobby_id) {}
 
-void Game::start() { gameloop.start(); }
+void Game::start() { scheduler.schedule(gameloop); }
 
 void Game::stop() {
     try {
@@ -18,10 +23,10 @@ void Game::stop() {
 
 void Game::join() { gameloop.join(); }
 
-Queue<CommandReceiver>& Game::get_cmd_q() { return command_queue; }
+MpscQueue<CommandReceiver>& Game::get_cmd_q() { return command_queue; }
 ClientRegistryMonitor& Game::get_registry() { return registry; }
 
-const Queue<CommandReceiver>& Game::get_cmd_q() const { return command_queue; }
+const MpscQueue<CommandReceiver>& Game::get_cmd_q() const { return command_queue; }
 
 const ClientRegistryMonitor& Game::get_registry() const { return registry; }
 
@@ -38,14 +43,14 @@ bool Game::start_lobby() {
         cmd.type = CommandReceiverType::NewCar;
         cmd.param = model;
         cmd.name = names.at(player_id);
-        command_queue.push(cmd);
+        command_queue.push(std::move(cmd));
     }
 
     CommandReceiver begin;
     begin.client_id = -1;  // interno
     begin.type = CommandReceiverType::BeginRace;
     begin.param = 0;
-    command_queue.push(begin);
+    command_queue.push(std::move(begin));
 
     return true;
 }
@@ -94,7 +99,9 @@ void Game::on_disconnect(int id) {
     cmd.param = 0;
 
     try {
-        command_queue.push(cmd);
+        // Sin esperar: lo llama el hilo de la conexion. Si la cola esta llena el gameloop no la
+        // esta vaciando, y un auto de mas en una partida trabada no cambia nada
+        command_queue.try_push(std::move(cmd));
     } catch (const ClosedQueue&) {
         // La partida ya esta cerrandose, ignoramos total no cambia nada
     }
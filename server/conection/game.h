@@ -7,14 +7,16 @@
 #include <utility>
 #include <vector>
 
-#include "../../common/queue.h"
+#include "../../common/mpsc_queue.h"
 #include "../command.h"
 #include "../event.h"
 #include "../game/gameloop.h"
+#include "../game/tick_scheduler.h"
 
 #include "client_registry.h"
 
-// Cada partida tiene su propio gameloop, cola de comandos y registry.
+// Cada partida tiene su propio gameloop, cola de comandos y registry. Los ticks del gameloop
+// los corre el TickScheduler compartido por todas las partidas.
 // El game manager tiene varias partidas (lobbies) activas, creandolas y destruyendolas segun
 // sea necesario. Permite ademas, a los clientes unirse a ellas antes de que empiecen.
 
@@ -22,12 +24,14 @@ class Game {
 private:
     // Recursos compartidos por los hilos
     // Cola de comandos para el gameloop
-    Queue<CommandReceiver> command_queue;
+    MpscQueue<CommandReceiver> command_queue;
 
     // Mapea id de cliente a su cola de eventos de salida
     ClientRegistryMonitor registry;
 
-    // Unico hilo del juego
+    // Pool de workers que corre el gameloop
+    TickScheduler& scheduler;
+
     Gameloop gameloop;
 
     // id -> modelo
@@ -40,16 +44,16 @@ private:
     static const int size_max_players = 8;
 
 public:
-    Game(std::vector<std::string>& maps, int lobby_id);
+    Game(std::vector<std::string>& maps, int lobby_id, TickScheduler& scheduler);
 
     // ciclo de vida de una partida
     void start();
     void stop();
     void join();
 
-    Queue<CommandReceiver>& get_cmd_q();
+    MpscQueue<CommandReceiver>& get_cmd_q();
     ClientRegistryMonitor& get_registry();
-    const Queue<CommandReceiver>& get_cmd_q() const;
+    const MpscQueue<CommandReceiver>& get_cmd_q() const;
     const ClientRegistryMonitor& get_registry() const;
 
     bool can_join() const { return !lobby_started && (int)lobby_players.size() < size_max_players; }
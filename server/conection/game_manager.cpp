@@ -3,6 +3,8 @@
 #include <string>
 #include <utility>
 
+#include "../config.h"
+
 static void broadcast_lobby_snapshot(Game& game, uint32_t lobby_id) {
     LobbySnapshotData data;
     game.build_lobby_snapshot(lobby_id, data);
@@ -19,6 +21,9 @@ static int next_lobby_id(const std::map<int, std::unique_ptr<Game>>& games, int
     return id;
 }
 
+GameManager::GameManager():
+        scheduler(static_cast<std::size_t>(Config::instance().tick_workers())) {}
+
 bool GameManager::start_lobby(uint32_t lobby_id) {
     std::lock_guard<std::mutex> lk(m);
 
@@ -63,13 +68,13 @@ void GameManager::join_all() {
 }
 
 bool GameManager::create_lobby_and_join(int client_id, uint8_t model,
-                                        Queue<std::shared_ptr<IEvent>>& out_q, Game*& game,
+                                        const std::shared_ptr<OutboundQueue>& out_q, Game*& game,
                                         LobbySnapshotData& snapshot, std::vector<std::string>& maps,
                                         const std::string& name) {
     std::lock_guard<std::mutex> lk(m);
     const int lobby_id = next_lobby_id(games, default_id);
 
-    std::unique_ptr<Game> g(new Game(maps, lobby_id));
+    std::unique_ptr<Game> g(new Game(maps, lobby_id, scheduler));
     g->start();
     Game* ptr = g.get();
     games.emplace(lobby_id, std::move(g));
@@ -78,7 +83,7 @@ bool GameManager::create_lobby_and_join(int client_id, uint8_t model,
     ptr->add_lobby_player(client_id, model, name);
 
     auto ev = std::make_shared<ExitJoinEvent>();
-    out_q.push(ev);
+    out_q->push(ev);
 
     ptr->build_lobby_snapshot((uint32_t)lobby_id, snapshot);
 
@@ -89,7 +94,7 @@ bool GameManager::create_lobby_and_join(int client_id, uint8_t model,
 }
 
 bool GameManager::join_lobby(int client_id, uint32_t lobby_id, uint8_t model,
-                             Queue<std::shared_ptr<IEvent>>& out_q, Game*& game,
+                             const std::shared_ptr<OutboundQueue>& out_q, Game*& game,
                              LobbySnapshotData& snapshot, const std::string& name) {
     std::lock_guard<std::mutex> lk(m);
     auto it = games.find((int)lobby_id);
@@ -107,7 +112,7 @@ bool GameManager::join_lobby(int client_id, uint32_t lobby_id, uint8_t model,
     ptr->add_lobby_player(client_id, model, name);
 
     auto ev = std::make_shared<ExitJoinEvent>();
-    out_q.push(ev);
+    out_q->push(ev);
 
     ptr->build_lobby_snapshot(lobby_id, snapshot);
     broadcast_lobby_snapshot(*ptr, lobby_id);
@@ -7,29 +7,35 @@
 #include <string>
 #include <vector>
 
+#include "../game/tick_scheduler.h"
+
 #include "game.h"
 
 // Unico manegador de partidas de todo el server.
 class GameManager {
 private:
+    // Corre los gameloops de todas las partidas. Va antes que games para destruirse despues
+    TickScheduler scheduler;
+
     // Recurso compartido, necesita mutex.
     std::mutex m;
     std::map<int, std::unique_ptr<Game>> games;
     const int default_id = 1001;
 
 public:
-    GameManager() = default;
+    GameManager();
 
     // Crea una nueva lobby y mete al jugador.
     // Devuelve true si fue exitosa.
-    bool create_lobby_and_join(int client_id, uint8_t model, Queue<std::shared_ptr<IEvent>>& out_q,
-                               Game*& game, LobbySnapshotData& snapshot,
-                               std::vector<std::string>& maps, const std::string& name);
+    bool create_lobby_and_join(int client_id, uint8_t model,
+                               const std::shared_ptr<OutboundQueue>& out_q, Game*& game,
+                               LobbySnapshotData& snapshot, std::vector<std::string>& maps,
+                               const std::string& name);
 
     // Une al jugador a una lobby existente.
     bool join_lobby(int client_id, uint32_t lobby_id, uint8_t model,
-                    Queue<std::shared_ptr<IEvent>>& out_q, Game*& game, LobbySnapshotData& snapshot,
-                    const std::string& name);
+                    const std::shared_ptr<OutboundQueue>& out_q, Game*& game,
+                    LobbySnapshotData& snapshot, const std::string& name);
 
     void reap_finished_games();
 
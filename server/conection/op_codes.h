@@ -1,23 +1,113 @@
 #ifndef OP_CODES_H
 #define OP_CODES_H
 
+#include <cstddef>
 #include <cstdint>
 
 static constexpr uint8_t INPUT_KEY = 0x12;
+static constexpr uint8_t CMD_INPUT_STATE = 0x13;
 static constexpr uint8_t CREATE_LOBBY = 0x16;
 static constexpr uint8_t JOIN_LOBBY = 0x17;
 static constexpr uint8_t START_LOBBY = 0x22;
 static constexpr uint8_t CMD_UPGRADE = 0x33;
 static constexpr uint8_t CMD_DISCONNECT = 0x34;
+static constexpr uint8_t CMD_SNAPSHOT_ACK = 0x35;
+static constexpr uint8_t CMD_PROTOCOL_VERSION = 0x36;
+static constexpr uint8_t CMD_UDP_READY = 0x37;
 static constexpr uint8_t EVENT_SEND_SNAPSHOT = 0x01;
+static constexpr uint8_t EVENT_SEND_SNAPSHOT_DELTA = 0x02;
+static constexpr uint8_t EVENT_SEND_SNAPSHOT_COMPACT = 0x03;
 static constexpr uint8_t EVENT_SEND_ID = 0x15;
 static constexpr uint8_t EVENT_LOBBY_JOIN_ERROR = 0x20;
 static constexpr uint8_t EVENT_LOBBY_SNAPSHOT = 0x21;
 static constexpr uint8_t EVENT_START_LOBBY = 0x22;
 static constexpr uint8_t EVENT_PRE_GAME_SNAPSHOT = 0x23;
 static constexpr uint8_t EVENT_RACE_RESULTS = 0x24;
+static constexpr uint8_t EVENT_PRE_GAME_CHECKPOINTS = 0x25;
+static constexpr uint8_t EVENT_UDP_OFFER = 0x26;
 static constexpr uint8_t EVENT_EXIT_JOIN = 0x30;
 static constexpr uint8_t EVENT_PHASE_CHANGE = 0x32;
 
+// Campos presentes de cada jugador en una EVENT_SEND_SNAPSHOT_DELTA (mascara de 2 bytes)
+static constexpr uint16_t PLAYER_DELTA_GHOST = 1 << 0;
+static constexpr uint16_t PLAYER_DELTA_LIFE = 1 << 1;
+static constexpr uint16_t PLAYER_DELTA_MODEL = 1 << 2;
+static constexpr uint16_t PLAYER_DELTA_ANIMATION = 1 << 3;
+static constexpr uint16_t PLAYER_DELTA_SOUND = 1 << 4;
+static constexpr uint16_t PLAYER_DELTA_X = 1 << 5;
+static constexpr uint16_t PLAYER_DELTA_Y = 1 << 6;
+static constexpr uint16_t PLAYER_DELTA_Z = 1 << 7;
+static constexpr uint16_t PLAYER_DELTA_ANGLE = 1 << 8;
+static constexpr uint16_t PLAYER_DELTA_CHECKPOINTS = 1 << 9;
+static constexpr uint16_t PLAYER_DELTA_ALL = (1 << 10) - 1;
+
+// Campos presentes de cada NPC en una EVENT_SEND_SNAPSHOT_DELTA (mascara de 1 byte)
+static constexpr uint8_t NPC_DELTA_MODEL = 1 << 0;
+static constexpr uint8_t NPC_DELTA_ANIMATION = 1 << 1;
+static constexpr uint8_t NPC_DELTA_X = 1 << 2;
+static constexpr uint8_t NPC_DELTA_Y = 1 << 3;
+static constexpr uint8_t NPC_DELTA_Z = 1 << 4;
+static constexpr uint8_t NPC_DELTA_ANGLE = 1 << 5;
+static constexpr uint8_t NPC_DELTA_ALL = (1 << 6) - 1;
+
+// Version del protocolo. Un cliente que no manda CMD_PROTOCOL_VERSION es version 1
+static constexpr uint8_t PROTOCOL_VERSION_LEGACY = 1;
+// Snapshots EVENT_SEND_SNAPSHOT_COMPACT y pre-game con la tabla de checkpoints
+static constexpr uint8_t PROTOCOL_VERSION_COMPACT = 2;
+// Los comandos del cliente llegan en frames [u16 largo][comando] despues de CMD_PROTOCOL_VERSION
+static constexpr uint8_t PROTOCOL_VERSION_FRAMED = 3;
+// El cliente sabe abrir el canal UDP si se lo ofrecemos (EVENT_UDP_OFFER)
+static constexpr uint8_t PROTOCOL_VERSION_UDP = 4;
+// El movimiento llega como estado (CMD_INPUT_STATE / UDP_INPUT_STATE) en vez de INPUT_KEY
+static constexpr uint8_t PROTOCOL_VERSION_INPUT_STATE = 5;
+static constexpr uint8_t PROTOCOL_VERSION = PROTOCOL_VERSION_INPUT_STATE;
+
+// CMD_INPUT_STATE [u32 secuencia][u8 teclas]: las teclas de movimiento apretadas en ese frame
+// del cliente. La secuencia crece con cada estado nuevo; uno mas viejo que el ultimo se ignora
+static constexpr uint8_t INPUT_STATE_W = 1 << 0;
+static constexpr uint8_t INPUT_STATE_A = 1 << 1;
+static constexpr uint8_t INPUT_STATE_S = 1 << 2;
+static constexpr uint8_t INPUT_STATE_D = 1 << 3;
+static constexpr uint8_t INPUT_STATE_ALL = (1 << 4) - 1;
+
+// Canal UDP. Se negocia por TCP despues de EVENT_SEND_ID:
+//   server -> EVENT_UDP_OFFER [u16 puerto][u32 token]
+//   cliente -> UDP_HELLO [u32 id][u32 token] por UDP, reintentando hasta el UDP_HELLO_ACK
+//   cliente -> CMD_UDP_READY por TCP: desde ahi las snapshots van por UDP
+// Los datagramas del server son un UDP_HELLO_ACK o una snapshot tal cual iria por TCP.
+// UDP_INPUT [u32 id][u32 token][u8 n] n * [u32 secuencia][u8 tecla] lleva las ultimas teclas
+// de movimiento (redundantes: se aplican solo las de secuencia nueva). Desde
+// PROTOCOL_VERSION_INPUT_STATE va UDP_INPUT_STATE [u32 id][u32 token][u32 secuencia][u8 teclas]
+static constexpr uint8_t UDP_HELLO = 0x40;
+static constexpr uint8_t UDP_HELLO_ACK = 0x41;
+static constexpr uint8_t UDP_INPUT = 0x42;
+static constexpr uint8_t UDP_INPUT_STATE = 0x43;
+// Por UDP solo van las teclas de movimiento (hasta soltar D); los trucos siguen por TCP
+static constexpr uint8_t UDP_MAX_INPUT_KEY = 0x07;
+static constexpr std::size_t UDP_MAX_INPUTS = 8;
+// Lo que pase de esto va por TCP, asi ningun datagrama se fragmenta
+static constexpr std::size_t UDP_MAX_DATAGRAM = 1200;
+
+// EVENT_SEND_SNAPSHOT_COMPACT: bits del header
+static constexpr uint8_t COMPACT_HAS_ROSTER = 1 << 0;
+
+// EVENT_SEND_SNAPSHOT_COMPACT: campos presentes de cada jugador (mascara de 1 byte)
+static constexpr uint8_t PLAYER_COMPACT_FLAGS = 1 << 0;  // ghost | sonido << 1 | z << 3
+static constexpr uint8_t PLAYER_COMPACT_LIFE = 1 << 1;
+static constexpr uint8_t PLAYER_COMPACT_MODEL = 1 << 2;
+static constexpr uint8_t PLAYER_COMPACT_ANIMATION = 1 << 3;
+static constexpr uint8_t PLAYER_COMPACT_POS = 1 << 4;
+static constexpr uint8_t PLAYER_COMPACT_ANGLE = 1 << 5;
+static constexpr uint8_t PLAYER_COMPACT_NEXT_ORDER = 1 << 6;
+static constexpr uint8_t PLAYER_COMPACT_ALL = (1 << 7) - 1;
+
+// EVENT_SEND_SNAPSHOT_COMPACT: campos presentes de cada NPC (mascara de 1 byte)
+static constexpr uint8_t NPC_COMPACT_Z = 1 << 0;
+static constexpr uint8_t NPC_COMPACT_MODEL = 1 << 1;
+static constexpr uint8_t NPC_COMPACT_ANIMATION = 1 << 2;
+static constexpr uint8_t NPC_COMPACT_POS = 1 << 3;
+static constexpr uint8_t NPC_COMPACT_ANGLE = 1 << 4;
+static constexpr uint8_t NPC_COMPACT_ALL = (1 << 5) - 1;
+
 
 #endif  // OP_CODES_H
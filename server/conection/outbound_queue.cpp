@@ -0,0 +1,113 @@
+#include "outbound_queue.h"
+
+#include <utility>
+
+OutboundQueue::OutboundQueue(std::size_t max_bytes, std::chrono::steady_clock::duration max_lag):
+        max_bytes(max_bytes), max_lag(max_lag) {}
+
+void OutboundQueue::push(const std::shared_ptr<IEvent>& ev) {
+    std::unique_lock<std::mutex> lck(m);
+    if (closed) {
+        throw ClosedQueue();
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    const bool was_empty = is_empty();
+    if (was_empty) {
+        pending_since = now;
+    } else if (max_lag.count() > 0 && now - pending_since > max_lag) {
+        // El sender no vacio la cola en todo este tiempo: el cliente no esta leyendo
+        overflow();
+        return;
+    }
+
+    if (ev->is_latest_wins()) {
+        std::shared_ptr<IEvent> merged = state ? ev->absorb_dropped(*state) : nullptr;
+        state = merged ? std::move(merged) : ev;
+    } else {
+        // La snapshot pendiente sale antes que el evento nuevo, asi el cliente no ve estado
+        // de la fase anterior despues de un cambio de fase
+        if (state) {
+            control.push_back(std::move(state));
+            state = nullptr;
+        }
+        control.push_back(ev);
+        control_bytes += ev->queued_bytes();
+        if (max_bytes > 0 && control_bytes > max_bytes) {
+            overflow();
+            return;
+        }
+    }
+
+    is_not_empty.notify_all();
+    if (was_empty && listener) {
+        listener();
+    }
+}
+
+std::shared_ptr<IEvent> OutboundQueue::take() {
+    std::shared_ptr<IEvent> ev;
+    if (!control.empty()) {
+        ev = std::move(control.front());
+        control.pop_front();
+        control_bytes -= ev->queued_bytes();
+    } else {
+        ev = std::move(state);
+        state = nullptr;
+    }
+    return ev;
+}
+
+std::shared_ptr<IEvent> OutboundQueue::pop() {
+    std::unique_lock<std::mutex> lck(m);
+    while (is_empty()) {
+        if (closed) {
+            throw ClosedQueue();
+        }
+        is_not_empty.wait(lck);
+    }
+    return take();
+}
+
+bool OutboundQueue::try_pop(std::shared_ptr<IEvent>& ev) {
+    std::unique_lock<std::mutex> lck(m);
+    if (is_empty()) {
+        if (closed) {
+            throw ClosedQueue();
+        }
+        return false;
+    }
+    ev = take();
+    return true;
+}
+
+void OutboundQueue::overflow() {
+    overflowed = true;
+    closed = true;
+    control.clear();
+    state = nullptr;
+    control_bytes = 0;
+    is_not_empty.notify_all();
+    if (listener) {
+        listener();
+    }
+}
+
+void OutboundQueue::close() {
+    std::unique_lock<std::mutex> lck(m);
+    if (closed) {
+        throw std::runtime_error("The queue is already closed.");
+    }
+    closed = true;
+    is_not_empty.notify_all();
+}
+
+bool OutboundQueue::is_overflowed() {
+    std::unique_lock<std::mutex> lck(m);
+    return overflowed;
+}
+
+void OutboundQueue::set_listener(std::function<void()> fn) {
+    std::unique_lock<std::mutex> lck(m);
+    listener = std::move(fn);
+}
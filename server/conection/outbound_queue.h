@@ -0,0 +1,82 @@
+#ifndef OUTBOUND_QUEUE_H
+#define OUTBOUND_QUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "../../common/queue.h"
+#include "../event.h"
+
+// Cola de salida de un cliente. Tiene dos carriles:
+//  - control: lobby, resultados, cambios de fase... Se mandan todos y en orden.
+//  - estado: las snapshots de juego. Solo importa la ultima, asi que una nueva reemplaza a la
+//    que todavia no salio en vez de hacer fila detras.
+// Un cliente lento entonces tiene como mucho una snapshot pendiente y sus eventos de control no
+// quedan atras de segundos de snapshots viejas.
+//
+// Si aun asi se atrasa (pasa el tope de bytes encolados o no saca nada por mas de max_lag) la
+// cola se cierra sola y queda marcada como desbordada para que el sender corte la conexion.
+// Nunca bloquea al que pushea (el gameloop).
+class OutboundQueue {
+private:
+    std::mutex m;
+    std::condition_variable is_not_empty;
+
+    std::deque<std::shared_ptr<IEvent>> control;
+    std::shared_ptr<IEvent> state;
+
+    // Bytes encolados en el carril de control
+    std::size_t control_bytes = 0;
+    // Desde cuando hay algo sin sacar (se reinicia cada vez que el sender la vacia)
+    std::chrono::steady_clock::time_point pending_since;
+
+    const std::size_t max_bytes;
+    const std::chrono::steady_clock::duration max_lag;
+
+    bool closed = false;
+    bool overflowed = false;
+
+    // Con el reactor nadie bloquea en pop: se le avisa cuando hay algo para mandar
+    std::function<void()> listener;
+
+    bool is_empty() const { return control.empty() && !state; }
+
+    // Saca el proximo evento: primero el carril de control y despues la snapshot
+    std::shared_ptr<IEvent> take();
+
+    // Cierra y descarta todo lo pendiente (llamar con el mutex tomado)
+    void overflow();
+
+public:
+    // 0 en cualquiera de los dos = sin tope
+    explicit OutboundQueue(std::size_t max_bytes = 0,
+                           std::chrono::steady_clock::duration max_lag = {});
+
+    // No bloquea nunca. Lanza ClosedQueue si la cola esta cerrada
+    void push(const std::shared_ptr<IEvent>& ev);
+
+    // Igual que Queue: pop bloquea, try_pop no, y ambos lanzan ClosedQueue si la cola se
+    // cerro y ya no queda nada
+    std::shared_ptr<IEvent> pop();
+    bool try_pop(std::shared_ptr<IEvent>& ev);
+
+    void close();
+
+    // True si se cerro porque el cliente no daba abasto
+    bool is_overflowed();
+
+    // fn se llama (con el mutex de la cola tomado, tiene que ser corta) cada vez que la cola
+    // pasa de vacia a tener algo y cuando se desborda. nullptr la saca: despues de eso no se
+    // vuelve a llamar
+    void set_listener(std::function<void()> fn);
+
+    OutboundQueue(const OutboundQueue&) = delete;
+    OutboundQueue& operator=(const OutboundQueue&) = delete;
+};
+
+#endif  // OUTBOUND_QUEUE_H
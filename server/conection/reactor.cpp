@@ -0,0 +1,72 @@
+#include "reactor.h"
+
+#include <cerrno>
+#include <iostream>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "../../common/liberror.h"
+
+#include "epoll_reactor.h"
+#include "uring_reactor.h"
+
+Reactor::Reactor() {
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd == -1) {
+        throw LibError(errno, "eventfd failed");
+    }
+}
+
+std::unique_ptr<Reactor> Reactor::create(const std::string& io_model) {
+    if (io_model == "io_uring") {
+        try {
+            return std::make_unique<UringReactor>();
+        } catch (const LibError& e) {
+            std::cerr << "Reactor: io_uring no disponible (" << e.what() << "), se usa epoll\n";
+        }
+    }
+    return std::make_unique<EpollReactor>();
+}
+
+void Reactor::wake() {
+    if (wake_pending) {
+        return;
+    }
+    wake_pending = true;
+    uint64_t one = 1;
+    if (::write(wake_fd, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+        std::cerr << "Reactor: no se pudo despertar al reactor (errno " << errno << ")\n";
+    }
+}
+
+void Reactor::add(ClientHandler& h) {
+    std::lock_guard<std::mutex> lock(m);
+    to_add.push_back(&h);
+    wake();
+}
+
+void Reactor::notify_writable(int id) {
+    std::lock_guard<std::mutex> lock(m);
+    to_write.push_back(id);
+    wake();
+}
+
+void Reactor::stop() {
+    Thread::stop();
+    std::lock_guard<std::mutex> lock(m);
+    wake();
+}
+
+void Reactor::take_requests(std::vector<ClientHandler*>& added, std::vector<int>& writable) {
+    std::lock_guard<std::mutex> lock(m);
+    added.swap(to_add);
+    writable.swap(to_write);
+    wake_pending = false;
+}
+
+Reactor::~Reactor() {
+    if (wake_fd != -1) {
+        ::close(wake_fd);
+    }
+}
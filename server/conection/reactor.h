@@ -0,0 +1,55 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../../common/thread.h"
+
+class ClientHandler;
+
+// Un hilo que atiende muchas conexiones a la vez, en vez de un receiver y un sender bloqueantes
+// por cliente. Cada ClientHandler tiene sus buffers de entrada y salida y el reactor solo le
+// pasa lo que llega y se lleva lo que hay que mandar. Hay dos implementaciones: EpollReactor
+// (sockets no bloqueantes) y UringReactor (io_uring).
+//
+// Los otros hilos (acceptor, gameloops) no tocan las conexiones: dejan el pedido en una lista
+// y despiertan al reactor con un eventfd.
+class Reactor: public Thread {
+private:
+    std::mutex m;
+    std::vector<ClientHandler*> to_add;
+    std::vector<int> to_write;  // ids con eventos nuevos en su cola de salida
+    bool wake_pending = false;
+
+    // Se llama con m tomado. Un solo write alcanza hasta que el reactor levante los pedidos
+    void wake();
+
+protected:
+    int wake_fd = -1;
+
+    // Hilo del reactor: se lleva los pedidos que dejaron los otros hilos
+    void take_requests(std::vector<ClientHandler*>& added, std::vector<int>& writable);
+
+public:
+    Reactor();
+
+    // Crea el reactor de io_model ("io_uring" o "epoll"). Si io_uring no esta disponible en
+    // este kernel, avisa y usa epoll
+    static std::unique_ptr<Reactor> create(const std::string& io_model);
+
+    // Desde cualquier hilo
+    void add(ClientHandler& h);
+    void notify_writable(int id);
+
+    void stop() override;
+
+    ~Reactor() override;
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+};
+
+#endif  // REACTOR_H
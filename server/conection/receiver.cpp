@@ -1,53 +1,15 @@
 #include "receiver.h"
 
+#include <utility>
+
 #include "client_handler.h"
 
-Receiver::Receiver(Socket& peer_socket, const int id, ClientHandler& ch):
+Receiver::Receiver(ISocket& peer_socket, const int id, ClientHandler& ch):
         peer(peer_socket), id(id), client_handler(ch) {}
 
 void Receiver::run() {
     try {
-        while (true) {
-
-            switch (protocol.get_type_of_command(peer)) {
-                case CommandReceiverType::Move: {
-                    handle_move_command();
-                    break;
-                }
-                case CommandReceiverType::JoinLobby: {
-                    handle_join_lobby();
-                    break;
-                }
-                case CommandReceiverType::CreateLobby: {
-                    handle_create_lobby();
-                    break;
-                }
-                case CommandReceiverType::StartLobby: {
-                    handle_start_lobby();
-                    break;
-                }
-                case CommandReceiverType::Disconect: {
-                    client_handler.disconnect();
-                    break;
-                }
-                case CommandReceiverType::NewCar: {
-                    break;
-                }
-                case CommandReceiverType::Upgrade: {
-                    handle_upgrade_command();
-                    break;
-                }
-                case CommandReceiverType::DefiniteDisconect: {
-                    client_handler.disconnect();
-                    return;
-                }
-                default: {
-                    std::cerr << "Receiver: Comando desconocido recibido por el cliente"
-                              << std::endl;
-                    return;
-                }
-            }
-        }
+        while (handle_next_command()) {}
     } catch (const ClosedQueue&) {
         // Esto no es un error, es la forma que tiene de cerrar la cola.
     } catch (const std::exception& e) {
@@ -57,30 +19,90 @@ void Receiver::run() {
     }
 }
 
-void Receiver::handle_move_command() {
-    CommandReceiver cmd = protocol.get_command_move(peer, id);
-    // De todavia no tener queue del gameloop, lo mantendra en null hasta que exista
-    queue_gameloop = client_handler.get_queue_gameloop();
-    if (queue_gameloop) {
-        try {
-            queue_gameloop->push(cmd);
-        } catch (const ClosedQueue&) {
-            // Justo la partida termino mientras pusheabamos, ignoramos el input.
+bool Receiver::handle_next_command() {
+    switch (protocol.get_type_of_command(peer)) {
+        case CommandReceiverType::Move: {
+            return handle_move_command();
+        }
+        case CommandReceiverType::InputState: {
+            return handle_input_state();
+        }
+        case CommandReceiverType::JoinLobby: {
+            handle_join_lobby();
+            break;
+        }
+        case CommandReceiverType::CreateLobby: {
+            handle_create_lobby();
+            break;
+        }
+        case CommandReceiverType::StartLobby: {
+            handle_start_lobby();
+            break;
+        }
+        case CommandReceiverType::Disconect: {
+            client_handler.disconnect();
+            break;
+        }
+        case CommandReceiverType::NewCar: {
+            break;
+        }
+        case CommandReceiverType::Upgrade: {
+            return handle_upgrade_command();
+        }
+        case CommandReceiverType::SnapshotAck: {
+            handle_snapshot_ack();
+            break;
+        }
+        case CommandReceiverType::ProtocolVersion: {
+            handle_protocol_version();
+            break;
+        }
+        case CommandReceiverType::UdpReady: {
+            // Al cliente ya le llegan los datagramas: las snapshots se mudan a UDP
+            client_handler.activate_udp();
+            break;
+        }
+        case CommandReceiverType::DefiniteDisconect: {
+            client_handler.disconnect();
+            return false;
+        }
+        default: {
+            std::cerr << "Receiver: Comando desconocido recibido por el cliente" << std::endl;
+            return false;
         }
     }
+    return true;
 }
 
-void Receiver::handle_upgrade_command() {
-    CommandReceiver cmd = protocol.get_command_upgrade(peer, id);
+bool Receiver::push_to_gameloop(CommandReceiver&& cmd) {
+    // De todavia no tener queue del gameloop, lo mantendra en null hasta que exista
     queue_gameloop = client_handler.get_queue_gameloop();
-
-    if (queue_gameloop) {
-        try {
-            queue_gameloop->push(cmd);
-        } catch (const ClosedQueue&) {
-            // Justo la partida termino mientras pusheabamos, ignoramos el input.
+    if (!queue_gameloop) {
+        return true;
+    }
+    try {
+        if (!queue_gameloop->try_push(std::move(cmd))) {
+            // Por TCP no hay reenvio: tirar el comando deja al auto en un estado que el
+            // cliente no pidio, y con miles encolados el gameloop no esta andando
+            std::cerr << "Receiver " << id << ": la cola del gameloop esta llena, se corta\n";
+            return false;
         }
+    } catch (const ClosedQueue&) {
+        // Justo la partida termino mientras pusheabamos, ignoramos el input.
     }
+    return true;
+}
+
+bool Receiver::handle_move_command() {
+    return push_to_gameloop(protocol.get_command_move(peer, id));
+}
+
+bool Receiver::handle_input_state() {
+    return push_to_gameloop(protocol.get_command_input_state(peer, id));
+}
+
+bool Receiver::handle_upgrade_command() {
+    return push_to_gameloop(protocol.get_command_upgrade(peer, id));
 }
 
 void Receiver::handle_join_lobby() {
@@ -93,6 +115,18 @@ void Receiver::handle_create_lobby() {
     client_handler.create_lobby(cmd);
 }
 
+void Receiver::handle_snapshot_ack() {
+    // No pasa por el gameloop: solo le importa al sender de este cliente
+    client_handler.ack_snapshot(protocol.get_snapshot_ack(peer));
+}
+
+void Receiver::handle_protocol_version() {
+    uint8_t version = protocol.get_protocol_version(peer);
+    // El nuestro decide si lo que sigue llega en frames, el del sender que snapshots mandar
+    protocol.set_protocol_version(version);
+    client_handler.set_protocol_version(version);
+}
+
 void Receiver::handle_start_lobby() {
     client_handler.start_lobby(protocol.get_command_start_lobby(peer, id).lobby_id);
     queue_gameloop = client_handler.get_queue_gameloop();
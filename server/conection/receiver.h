@@ -3,7 +3,7 @@
 
 #include <iostream>
 
-#include "../../common/queue.h"
+#include "../../common/mpsc_queue.h"
 #include "../../common/socket.h"
 #include "../../common/thread.h"
 #include "../command.h"
@@ -14,29 +14,44 @@ class ClientHandler;
 
 class Receiver: public Thread {
 private:
-    // El socket es referenciado, lo tiene el handler
-    Socket& peer;
+    // El socket es referenciado, lo tiene el handler. Con el reactor es el buffer de entrada
+    // de la conexion
+    ISocket& peer;
 
     int id;
 
     ClientHandler& client_handler;
 
     // El receiver pushea comandos a esta cola (gameloop)
-    Queue<CommandReceiver>* queue_gameloop = {nullptr};
+    MpscQueue<CommandReceiver>* queue_gameloop = {nullptr};
 
     ServerProtocol protocol;
 
-    void handle_move_command();
-    void handle_upgrade_command();
+    // Si ya hay partida le pasa el comando al gameloop; si no, se pierde. False si la cola del
+    // gameloop esta llena: la partida no la esta vaciando y se corta al cliente en vez de
+    // bloquear el hilo (que con el reactor atiende a otras conexiones)
+    bool push_to_gameloop(CommandReceiver&& cmd);
+
+    bool handle_move_command();
+    bool handle_input_state();
+    bool handle_upgrade_command();
     void handle_join_lobby();
     void handle_create_lobby();
     void handle_start_lobby();
+    void handle_snapshot_ack();
+    void handle_protocol_version();
 
 public:
-    Receiver(Socket& peer_socket, const int id, ClientHandler& ch);
+    Receiver(ISocket& peer_socket, const int id, ClientHandler& ch);
 
     void run() override;
 
+    // Recibe y atiende un comando. False si la conexion termino (el cliente se fue o mando
+    // algo invalido). Con el reactor lanza NeedMoreInput si el comando no llego entero
+    bool handle_next_command();
+
+    bool framed_commands() const { return protocol.framed_commands(); }
+
     ~Receiver() override = default;
     Receiver(const Receiver&) = delete;
     Receiver& operator=(const Receiver&) = delete;
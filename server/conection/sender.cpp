@@ -1,19 +1,26 @@
 #include "sender.h"
 
-Sender::Sender(Socket& peer_socket, const int id, Queue<std::shared_ptr<IEvent>>& queue_out):
+#include <sys/socket.h>
+
+#include "../config.h"
+
+Sender::Sender(Socket& peer_socket, const int id, OutboundQueue& queue_out):
         peer(peer_socket), id_(id), queue_out(queue_out) {}
 
 void Sender::run() {
     try {
-        // Ni bien se establece, una conexion, le notificamos al cliente su id
-        // Asi a futuro en snapshots, puede identificarse.
-        protocol.send_id_to_client(peer, id_);
+        greet(peer);
         bool continue_running = true;
         while (continue_running) {
             continue_running = protocol.send_event_to_client(peer, queue_out);
+            report_send_stats();
         }
     } catch (const ClosedQueue&) {
         // Esto no es un error, es la forma que tiene de cerrar la cola.
+        // Salvo que se haya cerrado sola porque el cliente se quedo atras
+        if (queue_out.is_overflowed()) {
+            drop_lagging_client();
+        }
     } catch (const std::exception& e) {
         std::cerr << "Sender exception: " << e.what() << "\n";
     } catch (...) {
@@ -21,6 +28,85 @@ void Sender::run() {
     }
 }
 
+void Sender::greet(ISocket& out) {
+    // Ni bien se establece, una conexion, le notificamos al cliente su id
+    // Asi a futuro en snapshots, puede identificarse.
+    configure_socket();
+    protocol.send_id_to_client(out, id_);
+
+    stats_since = std::chrono::steady_clock::now();
+    stats_syscalls = peer.get_send_syscalls();
+    stats_bytes = peer.get_bytes_sent();
+}
+
+bool Sender::pump(OutputBuffer& out, std::size_t high_water) {
+    try {
+        std::shared_ptr<IEvent> ev;
+        while (out.pending() < high_water && queue_out.try_pop(ev)) {
+            ev->send(out, protocol);
+        }
+    } catch (const ClosedQueue&) {
+        if (queue_out.is_overflowed()) {
+            std::cerr << "Sender " << id_
+                      << ": el cliente no lee lo que se le manda, se lo desconecta\n";
+        }
+        return false;
+    }
+    report_send_stats();
+    return true;
+}
+
+void Sender::configure_socket() {
+    const Config& cfg = Config::instance();
+    try {
+        peer.set_nodelay(cfg.tcp_nodelay());
+        if (cfg.tcp_notsent_lowat_bytes() > 0) {
+            peer.set_notsent_lowat(cfg.tcp_notsent_lowat_bytes());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Sender: no se pudieron configurar las opciones de TCP: " << e.what()
+                  << "\n";
+    }
+}
+
+void Sender::report_send_stats() {
+    const float every = Config::instance().send_stats_seconds();
+    if (every <= 0.0f) {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    const std::chrono::duration<double> elapsed = now - stats_since;
+    if (elapsed.count() < every) {
+        return;
+    }
+
+    const uint64_t syscalls = peer.get_send_syscalls() - stats_syscalls;
+    const uint64_t bytes = peer.get_bytes_sent() - stats_bytes;
+    const uint64_t events = protocol.get_events_sent() - stats_events;
+    if (syscalls > 0) {
+        std::cerr << "Sender " << id_ << ": " << (syscalls / elapsed.count())
+                  << " syscalls/s, " << (bytes / syscalls) << " bytes/syscall, "
+                  << (static_cast<double>(events) / syscalls) << " eventos/syscall\n";
+    }
+
+    stats_since = now;
+    stats_syscalls += syscalls;
+    stats_bytes += bytes;
+    stats_events += events;
+}
+
+void Sender::drop_lagging_client() {
+    std::cerr << "Sender " << id_ << ": el cliente no lee lo que se le manda, se lo desconecta\n";
+    // El receiver sale del recv y el handler queda terminado para que lo limpien
+    try {
+        peer.shutdown(SHUT_RDWR);
+    } catch (...) {}
+}
+
+void Sender::ack_snapshot(uint32_t sequence) { protocol.ack_snapshot(sequence); }
+
+void Sender::set_protocol_version(uint8_t version) { protocol.set_protocol_version(version); }
+
 void Sender::close_queue() {
     try {
         queue_out.close();
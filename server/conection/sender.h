@@ -1,15 +1,21 @@
 #ifndef SENDER_H
 #define SENDER_H
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <utility>
 
 #include "../../common/queue.h"
 #include "../../common/socket.h"
 #include "../../common/thread.h"
 #include "../event.h"
 
+#include "connection_buffers.h"
+#include "outbound_queue.h"
 #include "server_protocol.h"
 
 // El sender solamente saca eventos de la cola y los manda por el socket
@@ -26,17 +32,51 @@ private:
 
     // La cola es prioridad del client_handler. Es el mismo quien la agrega/saca del
     // registry y tambien le pushea logica de la lobby.
-    Queue<std::shared_ptr<IEvent>>& queue_out;
+    OutboundQueue& queue_out;
 
     ServerProtocol protocol;
 
+    // Estadisticas de envio: contadores del socket al empezar la ventana actual
+    std::chrono::steady_clock::time_point stats_since;
+    uint64_t stats_syscalls = 0;
+    uint64_t stats_bytes = 0;
+    uint64_t stats_events = 0;
+
+    // Opciones de TCP de la conexion segun la config (un error no corta la conexion)
+    void configure_socket();
+
+    // Si paso la ventana configurada, imprime syscalls/s y bytes por syscall
+    void report_send_stats();
+
+    // La cola se desbordo: corta la conexion
+    void drop_lagging_client();
+
 public:
-    Sender(Socket& peer_socket, const int id, Queue<std::shared_ptr<IEvent>>& queue_out);
+    Sender(Socket& peer_socket, const int id, OutboundQueue& queue_out);
 
     void run() override;
 
+    // Manda la bienvenida (el id) y configura el socket. run() arranca con esto; con el
+    // reactor lo llama el reactor, con out = buffer de salida de la conexion
+    void greet(ISocket& out);
+
+    // Modo reactor (el hilo no se arranca): serializa en out lo que haya en la cola, sin
+    // bloquear, mientras out no pase high_water bytes pendientes. False si la cola se cerro
+    bool pump(OutputBuffer& out, std::size_t high_water);
+
     void close_queue();
 
+    // Lo llama el receiver cuando el cliente confirma una snapshot
+    void ack_snapshot(uint32_t sequence);
+
+    // Lo llama el receiver cuando el cliente anuncia su version de protocolo
+    void set_protocol_version(uint8_t version);
+
+    // Canal por el que intentar primero las snapshots (antes de arrancar)
+    void set_datagram_sink(std::function<bool(const WireBuffer&)> sink) {
+        protocol.set_datagram_sink(std::move(sink));
+    }
+
     ~Sender() override = default;
     Sender(const Sender&) = delete;
     Sender& operator=(const Sender&) = delete;
@@ -1,11 +1,41 @@
 #include "server_protocol.h"
 
+#include <algorithm>
+#include <utility>
+
+uint8_t ServerProtocol::receive_command_code(ISocket& skt) {
+    if (!framed_commands()) {
+        return op_bytes.receive_one_byte(skt);
+    }
+    // Lo que haya quedado sin leer del frame anterior se saltea
+    frame = frames.next_frame(skt);
+    return frame.read_one_byte();
+}
+
+uint8_t ServerProtocol::receive_one_byte(ISocket& skt) {
+    return framed_commands() ? frame.read_one_byte() : op_bytes.receive_one_byte(skt);
+}
+
+uint16_t ServerProtocol::receive_two_bytes(ISocket& skt) {
+    return framed_commands() ? frame.read_two_bytes() : op_bytes.receive_two_bytes(skt);
+}
+
+uint32_t ServerProtocol::receive_four_bytes(ISocket& skt) {
+    return framed_commands() ? frame.read_four_bytes() : op_bytes.receive_four_bytes(skt);
+}
+
+std::string ServerProtocol::receive_string(std::size_t length, ISocket& skt) {
+    return framed_commands() ? frame.read_string(length) : op_bytes.receive_string(length, skt);
+}
+
 CommandReceiverType ServerProtocol::get_type_of_command(ISocket& skt) {
     try {
-        switch (op_bytes.receive_one_byte(skt)) {
+        switch (receive_command_code(skt)) {
             case INPUT_KEY:
                 return CommandReceiverType::Move;
                 break;
+            case CMD_INPUT_STATE:
+                return CommandReceiverType::InputState;
             case CREATE_LOBBY:
                 return CommandReceiverType::CreateLobby;
                 break;
@@ -20,49 +50,65 @@ CommandReceiverType ServerProtocol::get_type_of_command(ISocket& skt) {
                 break;
             case CMD_DISCONNECT:
                 return CommandReceiverType::Disconect;
+            case CMD_SNAPSHOT_ACK:
+                return CommandReceiverType::SnapshotAck;
+            case CMD_PROTOCOL_VERSION:
+                return CommandReceiverType::ProtocolVersion;
+            case CMD_UDP_READY:
+                return CommandReceiverType::UdpReady;
             default:
                 break;
         }
     } catch (const PeerCloseError& e) {
         // El cliente cerro la conexion
         return CommandReceiverType::DefiniteDisconect;
+    } catch (const FrameError& e) {
+        std::cerr << "ServerProtocol: " << e.what() << ", desconectar" << std::endl;
+        return CommandReceiverType::DefiniteDisconect;
     }
     std::cerr << "ServerProtocol: Comando recibido desconocido, desconectar" << std::endl;
     return CommandReceiverType::DefiniteDisconect;
 }
 
 CommandReceiver ServerProtocol::get_command_move(ISocket& skt, int id) {
-    uint8_t direccion = op_bytes.receive_one_byte(skt);
+    uint8_t direccion = receive_one_byte(skt);
     return (CommandReceiver{id, CommandReceiverType::Move, direccion});
 }
 
+CommandReceiver ServerProtocol::get_command_input_state(ISocket& skt, int id) {
+    uint32_t sequence = receive_four_bytes(skt);
+    // Los bits que no son teclas de movimiento no significan nada: se descartan
+    uint8_t keys = receive_one_byte(skt) & INPUT_STATE_ALL;
+    return (CommandReceiver{id, CommandReceiverType::InputState, keys, {}, sequence});
+}
+
 CommandReceiverJoinLobby ServerProtocol::get_command_join_lobby(ISocket& skt, int id) {
-    uint32_t id_lobby = (op_bytes.receive_four_bytes(skt));
-    uint8_t model_car = op_bytes.receive_one_byte(skt);
-    uint16_t size_string = (op_bytes.receive_two_bytes(skt));
-    std::string name = op_bytes.receive_string(size_string, skt);
+    uint32_t id_lobby = (receive_four_bytes(skt));
+    uint8_t model_car = receive_one_byte(skt);
+    uint16_t size_string = (receive_two_bytes(skt));
+    std::string name = receive_string(size_string, skt);
     return (CommandReceiverJoinLobby{id, CommandReceiverType::JoinLobby, id_lobby, model_car,
                                      name});
 }
 
 CommandReceiver ServerProtocol::get_command_upgrade(ISocket& skt, int id) {
-    uint8_t upgrade = op_bytes.receive_one_byte(skt);
+    uint8_t upgrade = receive_one_byte(skt);
     return (CommandReceiver{id, CommandReceiverType::Upgrade, upgrade});
 }
 
 CommandReceiverCreateLobby ServerProtocol::get_command_create_lobby(ISocket& skt, int id) {
-    uint8_t model_car = op_bytes.receive_one_byte(skt);
+    uint8_t model_car = receive_one_byte(skt);
 
-    uint16_t size_string = (op_bytes.receive_two_bytes(skt));
-    std::string name = op_bytes.receive_string(size_string, skt);
+    uint16_t size_string = (receive_two_bytes(skt));
+    std::string name = receive_string(size_string, skt);
 
-    uint16_t maps_size = (op_bytes.receive_two_bytes(skt));
+    uint16_t maps_size = (receive_two_bytes(skt));
 
     std::vector<std::string> maps;
 
     for (int i = 0; i < static_cast<int>(maps_size); i++) {
-        uint16_t map_size_string = (op_bytes.receive_two_bytes(skt));
-        std::string map = op_bytes.receive_string(map_size_string, skt);
+        uint16_t map_size_string = (receive_two_bytes(skt));
+        std::string map = receive_string(map_size_string, skt);
         maps.emplace_back(map);
     }
 
@@ -71,10 +117,68 @@ CommandReceiverCreateLobby ServerProtocol::get_command_create_lobby(ISocket& skt
 }
 
 CommandReceiverStartLobby ServerProtocol::get_command_start_lobby(ISocket& skt, int id) {
-    uint32_t id_lobby = (op_bytes.receive_four_bytes(skt));
+    uint32_t id_lobby = (receive_four_bytes(skt));
     return (CommandReceiverStartLobby{id, CommandReceiverType::StartLobby, id_lobby});
 }
 
+uint32_t ServerProtocol::get_snapshot_ack(ISocket& skt) { return receive_four_bytes(skt); }
+
+void ServerProtocol::ack_snapshot(uint32_t sequence) {
+    acked_snapshot = sequence;
+    snapshot_deltas = true;
+}
+
+uint8_t ServerProtocol::get_protocol_version(ISocket& skt) {
+    return receive_one_byte(skt);
+}
+
+void ServerProtocol::set_protocol_version(uint8_t client_version) {
+    // Hablamos la mas nueva que entiendan los dos
+    protocol_version = std::clamp(client_version, PROTOCOL_VERSION_LEGACY, PROTOCOL_VERSION);
+}
+
+const GameSnapshotEvent* ServerProtocol::find_sent_snapshot(uint32_t sequence) const {
+    if (sequence == 0) {
+        return nullptr;
+    }
+    for (auto it = sent_snapshots.rbegin(); it != sent_snapshots.rend(); ++it) {
+        if ((*it)->sequence == sequence) {
+            return it->get();
+        }
+    }
+    return nullptr;
+}
+
+bool ServerProtocol::send_snapshot_event(ISocket& skt,
+                                         const std::shared_ptr<const GameSnapshotEvent>& ev) {
+    const bool compact = (protocol_version >= PROTOCOL_VERSION_COMPACT);
+
+    // Cliente viejo que nunca mando un ack: formato original, siempre completa
+    if (!compact && !snapshot_deltas) {
+        return send_wire(skt, ev->get_wire());
+    }
+
+    // Sin acks no hay baseline y sale todo como keyframe
+    const GameSnapshotEvent* baseline = find_sent_snapshot(acked_snapshot);
+    const bool keyframe = !baseline || snapshots_since_keyframe >= KEYFRAME_INTERVAL;
+
+    WireBuffer wire =
+            keyframe ? ev->get_keyframe_wire(compact) : ev->get_delta_wire(*baseline, compact);
+    snapshots_since_keyframe = keyframe ? 0 : snapshots_since_keyframe + 1;
+
+    sent_snapshots.push_back(ev);
+    if (sent_snapshots.size() > SNAPSHOT_HISTORY) {
+        sent_snapshots.pop_front();
+    }
+
+    // Por UDP una snapshot perdida no frena a las siguientes. El baseline sigue siendo la
+    // ultima confirmada, asi que perder una delta no rompe las que vienen
+    if (datagram_sink && datagram_sink(wire)) {
+        return true;
+    }
+    return send_wire(skt, wire);
+}
+
 void ServerProtocol::send_id_to_client(ISocket& skt, const int id) {
     std::vector<uint8_t> buff;
     buff.reserve(5);
@@ -88,9 +192,62 @@ void ServerProtocol::send_id_to_client(ISocket& skt, const int id) {
     }
 }
 
-bool ServerProtocol::send_event_to_client(ISocket& skt, Queue<std::shared_ptr<IEvent>>& queue_out) {
+bool ServerProtocol::send_event_to_client(ISocket& skt, OutboundQueue& queue_out) {
     auto ev = queue_out.pop();
-    return ev->send(skt, *this);
+
+    batching = true;
+    std::size_t count = 0;
+    bool ok = true;
+    try {
+        do {
+            ok = ev->send(skt, *this);
+            ++count;
+        } while (ok && count < MAX_BATCH_EVENTS && queue_out.try_pop(ev));
+    } catch (const ClosedQueue&) {
+        // Lo que ya se junto sale igual; el proximo pop avisa el cierre
+    }
+    batching = false;
+
+    events_sent += count;
+    return flush_batch(skt) && ok;
+}
+
+bool ServerProtocol::flush_batch(ISocket& skt) {
+    if (batch.empty()) {
+        return true;
+    }
+    if (batch.size() == 1) {
+        WireBuffer wire = std::move(batch.front());
+        batch.clear();
+        return send_wire(skt, *wire);
+    }
+
+    batch_iov.clear();
+    for (const auto& wire: batch) {
+        // cppcheck-suppress cstyleCast
+        batch_iov.push_back({(void*)wire->data(), wire->size()});
+    }
+    int sent = skt.sendallv(batch_iov.data(), static_cast<int>(batch_iov.size()));
+    batch.clear();
+    return sent != 0;
+}
+
+bool ServerProtocol::send_wire(ISocket& skt, const std::vector<uint8_t>& wire) {
+    // Un evento puede no tener nada para mandar (p. ej. resultados vacios)
+    if (wire.empty()) {
+        return true;
+    }
+    return (skt.sendall(wire.data(), wire.size()) != 0);
+}
+
+bool ServerProtocol::send_wire(ISocket& skt, const WireBuffer& wire) {
+    if (!batching) {
+        return send_wire(skt, *wire);
+    }
+    if (!wire->empty()) {
+        batch.push_back(wire);
+    }
+    return true;
 }
 
 bool ServerProtocol::send_phase_change_to_client(ISocket& skt) {
@@ -99,54 +256,142 @@ bool ServerProtocol::send_phase_change_to_client(ISocket& skt) {
     return (skt.sendall(buff.data(), buff.size()) != 0);
 }
 
-bool ServerProtocol::send_race_results_to_client(ISocket& skt,
-                                                 const RaceResultsData& race_results) {
+std::vector<uint8_t> ServerProtocol::encode_race_results(const RaceResultsData& race_results) {
     uint16_t count = static_cast<uint16_t>(race_results.race_results.size());
 
     std::vector<uint8_t> buff;
     buff.reserve(1 + 1 + 2 + count * (2 + 4 + 4 + 4 + 1));
 
-    op_bytes.add_one_byte(EVENT_RACE_RESULTS, buff);
-    op_bytes.add_one_byte(race_results.last_race, buff);
-    op_bytes.add_two_bytes((count), buff);
+    OperationsBytes::add_one_byte(EVENT_RACE_RESULTS, buff);
+    OperationsBytes::add_one_byte(race_results.last_race, buff);
+    OperationsBytes::add_two_bytes((count), buff);
 
     for (const auto& r: race_results.race_results) {
-        op_bytes.add_two_bytes((static_cast<uint16_t>(r.name.size())), buff);
-        op_bytes.add_string(r.name, buff);
-        op_bytes.add_four_bytes((r.race_time_seconds), buff);
-        op_bytes.add_four_bytes((r.total_time_seconds), buff);
-        op_bytes.add_one_byte(r.status, buff);
+        OperationsBytes::add_two_bytes((static_cast<uint16_t>(r.name.size())), buff);
+        OperationsBytes::add_string(r.name, buff);
+        OperationsBytes::add_four_bytes((r.race_time_seconds), buff);
+        OperationsBytes::add_four_bytes((r.total_time_seconds), buff);
+        OperationsBytes::add_one_byte(r.status, buff);
     }
 
-    return (skt.sendall(buff.data(), buff.size()) != 0);
+    return buff;
 }
 
-bool ServerProtocol::send_pre_game_snapshot_to_client(ISocket& skt,
-                                                      const PreGameSnapshotData& pre_game) {
+bool ServerProtocol::send_race_results_to_client(ISocket& skt,
+                                                 const RaceResultsData& race_results) {
+    return send_wire(skt, encode_race_results(race_results));
+}
+
+std::vector<uint8_t> ServerProtocol::encode_pre_game_snapshot(const PreGameSnapshotData& pre_game) {
     std::vector<uint8_t> buff;
     buff.reserve(1 + 4 + 4 + 4 + 4 + 1 + 2 + 1 + 4 + 4);
 
-    op_bytes.add_one_byte(EVENT_PRE_GAME_SNAPSHOT, buff);
+    OperationsBytes::add_one_byte(EVENT_PRE_GAME_SNAPSHOT, buff);
 
-    op_bytes.add_four_bytes((pre_game.pole.coord_up_left.x_px), buff);
-    op_bytes.add_four_bytes((pre_game.pole.coord_up_left.y_px), buff);
-    op_bytes.add_four_bytes((pre_game.pole.coord_down_right.x_px), buff);
-    op_bytes.add_four_bytes((pre_game.pole.coord_down_right.y_px), buff);
-    op_bytes.add_one_byte(pre_game.pole.direc, buff);
+    OperationsBytes::add_four_bytes((pre_game.pole.coord_up_left.x_px), buff);
+    OperationsBytes::add_four_bytes((pre_game.pole.coord_up_left.y_px), buff);
+    OperationsBytes::add_four_bytes((pre_game.pole.coord_down_right.x_px), buff);
+    OperationsBytes::add_four_bytes((pre_game.pole.coord_down_right.y_px), buff);
+    OperationsBytes::add_one_byte(pre_game.pole.direc, buff);
 
-    op_bytes.add_two_bytes((pre_game.remaining_races), buff);
-    op_bytes.add_one_byte(static_cast<uint8_t>(pre_game.map_id), buff);
+    OperationsBytes::add_two_bytes((pre_game.remaining_races), buff);
+    OperationsBytes::add_one_byte(static_cast<uint8_t>(pre_game.map_id), buff);
 
 
-    op_bytes.add_four_bytes((pre_game.race_total_time_seconds), buff);
-    op_bytes.add_four_bytes((pre_game.race_move_enabled_time_seconds), buff);
+    OperationsBytes::add_four_bytes((pre_game.race_total_time_seconds), buff);
+    OperationsBytes::add_four_bytes((pre_game.race_move_enabled_time_seconds), buff);
 
-    return (skt.sendall(buff.data(), buff.size()) != 0);
+    return buff;
+}
+
+std::vector<uint8_t> ServerProtocol::encode_pre_game_checkpoints(
+        const PreGameSnapshotData& pre_game) {
+    // Mismo contenido que EVENT_PRE_GAME_SNAPSHOT y al final la tabla de checkpoints
+    std::vector<uint8_t> buff = encode_pre_game_snapshot(pre_game);
+    buff[0] = EVENT_PRE_GAME_CHECKPOINTS;
+
+    const CheckpointTable* table = pre_game.checkpoints.get();
+    const std::size_t count = table ? table->checkpoints.size() : 0;
+    OperationsBytes::add_two_bytes(static_cast<uint16_t>(count), buff);
+    for (std::size_t i = 0; i < count; ++i) {
+        const CheckpointInfo& cp = table->checkpoints[i];
+        OperationsBytes::add_two_bytes(static_cast<uint16_t>(cp.order), buff);
+        OperationsBytes::add_one_byte(cp.goal, buff);
+        OperationsBytes::add_two_bytes(static_cast<uint16_t>(cp.cells.size()), buff);
+        for (const auto& c: cp.cells) {
+            OperationsBytes::add_four_bytes(c.x_px, buff);
+            OperationsBytes::add_four_bytes(c.y_px, buff);
+        }
+    }
+    return buff;
+}
+
+bool ServerProtocol::send_pre_game_event(ISocket& skt, const PreGameSnapshotEvent& ev) {
+    // Solo los que reciben snapshots compactas saben armar los checkpoints con la tabla
+    if (protocol_version >= PROTOCOL_VERSION_COMPACT) {
+        return send_wire(skt, ev.get_checkpoints_wire());
+    }
+    return send_wire(skt, ev.get_wire());
+}
+
+bool ServerProtocol::send_pre_game_snapshot_to_client(ISocket& skt,
+                                                      const PreGameSnapshotData& pre_game) {
+    return send_wire(skt, encode_pre_game_snapshot(pre_game));
+}
+
+std::vector<uint8_t> ServerProtocol::encode_udp_offer(uint16_t port, uint32_t token) {
+    std::vector<uint8_t> buff;
+    buff.reserve(1 + 2 + 4);
+    OperationsBytes::add_one_byte(EVENT_UDP_OFFER, buff);
+    OperationsBytes::add_two_bytes(port, buff);
+    OperationsBytes::add_four_bytes(token, buff);
+    return buff;
+}
+
+bool ServerProtocol::decode_udp_datagram(const uint8_t* data, std::size_t size,
+                                         CommandReceiverUdp& out) {
+    // Mismo layout que en TCP: todo en big endian
+    auto read_u32 = [data](std::size_t at) {
+        uint32_t v;
+        std::memcpy(&v, data + at, sizeof(v));
+        return ntohl(v);
+    };
+
+    if (size < 1 + 4 + 4) {
+        return false;
+    }
+    out.op = data[0];
+    out.client_id = static_cast<int>(read_u32(1));
+    out.token = read_u32(5);
+    out.inputs.clear();
+
+    if (out.op == UDP_HELLO) {
+        return true;
+    }
+    if (out.op == UDP_INPUT_STATE) {
+        if (size < 1 + 4 + 4 + 4 + 1) {
+            return false;
+        }
+        out.state = UdpInput{read_u32(9), static_cast<uint8_t>(data[13] & INPUT_STATE_ALL)};
+        return true;
+    }
+    if (out.op != UDP_INPUT || size < 1 + 4 + 4 + 1) {
+        return false;
+    }
+    const std::size_t count = data[9];
+    if (count > UDP_MAX_INPUTS || size < 10 + count * (4 + 1)) {
+        return false;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t at = 10 + i * (4 + 1);
+        out.inputs.push_back(UdpInput{read_u32(at), data[at + 4]});
+    }
+    return true;
 }
 
 bool ServerProtocol::send_exit_join(ISocket& skt) {
     std::vector<uint8_t> buff;
-    op_bytes.add_one_byte(0x30, buff);
+    op_bytes.add_one_byte(EVENT_EXIT_JOIN, buff);
     return (skt.sendall(buff.data(), buff.size()) != 0);
 }
 
@@ -162,98 +407,445 @@ bool ServerProtocol::send_join_error_to_client(ISocket& skt) {
     return (skt.sendall(buff.data(), buff.size()) != 0);
 }
 
-bool ServerProtocol::send_snapshot_lobby_to_client(ISocket& skt, const LobbySnapshotData& lobby) {
+std::vector<uint8_t> ServerProtocol::encode_snapshot_lobby(const LobbySnapshotData& lobby) {
 
     const uint16_t count = static_cast<uint16_t>(lobby.lobby_players.size());
 
     std::vector<uint8_t> buff;
     buff.reserve(7 + count * (2 + 4 + 1));
 
-    op_bytes.add_one_byte(EVENT_LOBBY_SNAPSHOT, buff);
-    op_bytes.add_four_bytes((lobby.lobby_id), buff);
-    op_bytes.add_two_bytes((count), buff);
+    OperationsBytes::add_one_byte(EVENT_LOBBY_SNAPSHOT, buff);
+    OperationsBytes::add_four_bytes((lobby.lobby_id), buff);
+    OperationsBytes::add_two_bytes((count), buff);
 
     // Para cada jugador
     for (const auto& p: lobby.lobby_players) {
-        op_bytes.add_two_bytes((static_cast<uint16_t>(p.name.size())), buff);
-        op_bytes.add_string(p.name, buff);
-        op_bytes.add_one_byte(p.model, buff);
+        OperationsBytes::add_two_bytes((static_cast<uint16_t>(p.name.size())), buff);
+        OperationsBytes::add_string(p.name, buff);
+        OperationsBytes::add_one_byte(p.model, buff);
     }
 
-    return (skt.sendall(buff.data(), buff.size()) != 0);
+    return buff;
 }
 
-bool ServerProtocol::send_snapshot_game_to_client(ISocket& skt, const GameSnapshotData& game) {
+bool ServerProtocol::send_snapshot_lobby_to_client(ISocket& skt, const LobbySnapshotData& lobby) {
+    return send_wire(skt, encode_snapshot_lobby(lobby));
+}
+
+// Proximo checkpoint (y el siguiente, si hay) de un jugador. Igual en snapshots completas y delta
+static void add_checkpoint_cells(const CheckpointInfo* cp, std::vector<uint8_t>& buff) {
+    const std::size_t count = cp ? cp->cells.size() : 0;
+    OperationsBytes::add_two_bytes((static_cast<uint16_t>(count)), buff);
+
+    // Por cada coord del checkpoint:
+    // x_px, y_px (cada uno 4 bytes)
+    for (std::size_t i = 0; i < count; ++i) {
+        OperationsBytes::add_four_bytes((cp->cells[i].x_px), buff);
+        OperationsBytes::add_four_bytes((cp->cells[i].y_px), buff);
+    }
+    OperationsBytes::add_one_byte(cp ? cp->goal : 0x00, buff);
+}
+
+// Los formatos viejos mandan las celdas del proximo checkpoint y del siguiente en cada
+// snapshot. Salen de la tabla de la carrera a partir del next_order del jugador
+static void add_player_checkpoints(const PlayerSnapshot& p, const CheckpointTable* table,
+                                   std::vector<uint8_t>& buff) {
+    const CheckpointInfo* next = table ? table->find(p.next_order) : nullptr;
+    const CheckpointInfo* second =
+            (table && p.next_order < table->max_order) ? table->find(p.next_order + 1) : nullptr;
+
+    add_checkpoint_cells(next, buff);
+
+    // Enviamos el segundo checkpoint
+    // Si HAY second checkpoint (Sino, ya con el flag avisamos que no hay nada mas por parte de
+    // los checkpoints)
+    OperationsBytes::add_one_byte(second ? 1 : 0, buff);
+    if (second) {
+        add_checkpoint_cells(second, buff);
+    }
+}
+
+static uint16_t player_delta_mask(const PlayerSnapshot& p, const PlayerSnapshot* base) {
+    if (!base) {
+        return PLAYER_DELTA_ALL;
+    }
+    uint16_t mask = 0;
+    if (p.ghost != base->ghost)
+        mask |= PLAYER_DELTA_GHOST;
+    if (p.car_life != base->car_life)
+        mask |= PLAYER_DELTA_LIFE;
+    if (p.model != base->model)
+        mask |= PLAYER_DELTA_MODEL;
+    if (p.animation != base->animation)
+        mask |= PLAYER_DELTA_ANIMATION;
+    if (p.sound_code != base->sound_code)
+        mask |= PLAYER_DELTA_SOUND;
+    if (p.x_px != base->x_px)
+        mask |= PLAYER_DELTA_X;
+    if (p.y_px != base->y_px)
+        mask |= PLAYER_DELTA_Y;
+    if (p.z != base->z)
+        mask |= PLAYER_DELTA_Z;
+    if (p.angle != base->angle)
+        mask |= PLAYER_DELTA_ANGLE;
+    if (p.next_order != base->next_order)
+        mask |= PLAYER_DELTA_CHECKPOINTS;
+    return mask;
+}
+
+static uint8_t npc_delta_mask(const NpcSnapshot& n, const NpcSnapshot* base) {
+    if (!base) {
+        return NPC_DELTA_ALL;
+    }
+    uint8_t mask = 0;
+    if (n.model != base->model)
+        mask |= NPC_DELTA_MODEL;
+    if (n.animation != base->animation)
+        mask |= NPC_DELTA_ANIMATION;
+    if (n.x_px != base->x_px)
+        mask |= NPC_DELTA_X;
+    if (n.y_px != base->y_px)
+        mask |= NPC_DELTA_Y;
+    if (n.z != base->z)
+        mask |= NPC_DELTA_Z;
+    if (n.angle != base->angle)
+        mask |= NPC_DELTA_ANGLE;
+    return mask;
+}
+
+std::vector<uint8_t> ServerProtocol::encode_snapshot_game(const GameSnapshotData& game) {
 
     const uint16_t count = static_cast<uint16_t>(game.players.size());
 
     std::vector<uint8_t> buff;
     buff.reserve(7 + count * (22 + 5 * 8 + 1) + 2 + game.npcs.size() * (13));
 
-    op_bytes.add_one_byte(EVENT_SEND_SNAPSHOT, buff);
-    op_bytes.add_four_bytes((game.time_seconds_remained), buff);
-    op_bytes.add_two_bytes((count), buff);
+    OperationsBytes::add_one_byte(EVENT_SEND_SNAPSHOT, buff);
+    OperationsBytes::add_four_bytes((game.time_seconds_remained), buff);
+    OperationsBytes::add_two_bytes((count), buff);
 
     // Para cada jugador
     for (const auto& p: game.players) {
-        op_bytes.add_four_bytes((p.id), buff);
-        op_bytes.add_one_byte(p.ghost, buff);
-        op_bytes.add_two_bytes((p.car_life), buff);
-        op_bytes.add_two_bytes((p.model), buff);
-        op_bytes.add_one_byte(p.animation, buff);
-        op_bytes.add_one_byte(p.sound_code, buff);
-        op_bytes.add_four_bytes((p.x_px), buff);
-        op_bytes.add_four_bytes((p.y_px), buff);
-        op_bytes.add_one_byte(p.z, buff);
-        op_bytes.add_four_bytes((p.angle), buff);
-        op_bytes.add_two_bytes((static_cast<uint16_t>(p.next_checkpoint.size())), buff);
-
-        // Por cada coord del checkpoint:
-        // x_px, y_px (cada uno 4 bytes)
-        for (const auto& coord: p.next_checkpoint) {
-            op_bytes.add_four_bytes((coord.x_px), buff);
-            op_bytes.add_four_bytes((coord.y_px), buff);
+        OperationsBytes::add_four_bytes((p.id), buff);
+        OperationsBytes::add_one_byte(p.ghost, buff);
+        OperationsBytes::add_two_bytes((p.car_life), buff);
+        OperationsBytes::add_two_bytes((p.model), buff);
+        OperationsBytes::add_one_byte(p.animation, buff);
+        OperationsBytes::add_one_byte(p.sound_code, buff);
+        OperationsBytes::add_four_bytes((p.x_px), buff);
+        OperationsBytes::add_four_bytes((p.y_px), buff);
+        OperationsBytes::add_one_byte(p.z, buff);
+        OperationsBytes::add_four_bytes((p.angle), buff);
+        add_player_checkpoints(p, game.checkpoints.get(), buff);
+    }
+
+    const uint16_t cant_npcs = static_cast<uint16_t>(game.npcs.size());
+    OperationsBytes::add_two_bytes((cant_npcs), buff);
+
+    for (const auto& p: game.npcs) {
+        OperationsBytes::add_two_bytes((p.model), buff);
+        OperationsBytes::add_one_byte(p.animation, buff);
+        OperationsBytes::add_four_bytes((p.x_px), buff);
+        OperationsBytes::add_four_bytes((p.y_px), buff);
+        OperationsBytes::add_one_byte(p.z, buff);
+        OperationsBytes::add_four_bytes((p.angle), buff);
+    }
+
+    return buff;
+}
+
+std::vector<uint8_t> ServerProtocol::encode_snapshot_delta(const GameSnapshotData& game,
+                                                           uint32_t sequence,
+                                                           const GameSnapshotData* baseline,
+                                                           uint32_t baseline_sequence) {
+    // Un baseline de otra carrera tiene otros checkpoints: va como keyframe
+    if (baseline && baseline->checkpoints != game.checkpoints) {
+        baseline = nullptr;
+    }
+
+    const uint16_t count = static_cast<uint16_t>(game.players.size());
+    const uint16_t cant_npcs = static_cast<uint16_t>(game.npcs.size());
+
+    std::vector<uint8_t> buff;
+    buff.reserve(15 + count * (6 + 22 + 5 * 8 + 1) + 2 + cant_npcs * (1 + 12));
+
+    OperationsBytes::add_one_byte(EVENT_SEND_SNAPSHOT_DELTA, buff);
+    OperationsBytes::add_four_bytes(sequence, buff);
+    OperationsBytes::add_four_bytes(baseline ? baseline_sequence : 0, buff);
+    OperationsBytes::add_four_bytes(game.time_seconds_remained, buff);
+    OperationsBytes::add_two_bytes(count, buff);
+
+    // Todos los jugadores van siempre (id + mascara), asi el cliente sabe cuales siguen.
+    // Solo se escriben los campos que cambiaron contra el baseline
+    for (const auto& p: game.players) {
+        const PlayerSnapshot* base = nullptr;
+        if (baseline) {
+            for (const auto& b: baseline->players) {
+                if (b.id == p.id) {
+                    base = &b;
+                    break;
+                }
+            }
         }
-        op_bytes.add_one_byte(p.goal, buff);
-
-        // Enviamos el segundo checkpoint
-
-        op_bytes.add_one_byte(p.there_is_second_checkpoint, buff);
-        // Si HAY second checkpoint (Sino, ya con el flag avisamos que no hay nada mas por parte de
-        // los checkpoints)
-        if (p.there_is_second_checkpoint == 1) {
-            op_bytes.add_two_bytes((static_cast<uint16_t>(p.next_next_checkpoint.size())), buff);
-            for (const auto& coord: p.next_next_checkpoint) {
-                op_bytes.add_four_bytes((coord.x_px), buff);
-                op_bytes.add_four_bytes((coord.y_px), buff);
+        const uint16_t mask = player_delta_mask(p, base);
+
+        OperationsBytes::add_four_bytes(p.id, buff);
+        OperationsBytes::add_two_bytes(mask, buff);
+        if (mask & PLAYER_DELTA_GHOST)
+            OperationsBytes::add_one_byte(p.ghost, buff);
+        if (mask & PLAYER_DELTA_LIFE)
+            OperationsBytes::add_two_bytes(p.car_life, buff);
+        if (mask & PLAYER_DELTA_MODEL)
+            OperationsBytes::add_two_bytes(p.model, buff);
+        if (mask & PLAYER_DELTA_ANIMATION)
+            OperationsBytes::add_one_byte(p.animation, buff);
+        if (mask & PLAYER_DELTA_SOUND)
+            OperationsBytes::add_one_byte(p.sound_code, buff);
+        if (mask & PLAYER_DELTA_X)
+            OperationsBytes::add_four_bytes(p.x_px, buff);
+        if (mask & PLAYER_DELTA_Y)
+            OperationsBytes::add_four_bytes(p.y_px, buff);
+        if (mask & PLAYER_DELTA_Z)
+            OperationsBytes::add_one_byte(p.z, buff);
+        if (mask & PLAYER_DELTA_ANGLE)
+            OperationsBytes::add_four_bytes(p.angle, buff);
+        if (mask & PLAYER_DELTA_CHECKPOINTS)
+            add_player_checkpoints(p, game.checkpoints.get(), buff);
+    }
+
+    // Los NPCs se comparan por posicion en la lista (es estable durante la carrera).
+    // Un NPC estacionado que no cambio ocupa un solo byte
+    OperationsBytes::add_two_bytes(cant_npcs, buff);
+    for (std::size_t i = 0; i < game.npcs.size(); ++i) {
+        const NpcSnapshot& n = game.npcs[i];
+        const NpcSnapshot* base =
+                (baseline && i < baseline->npcs.size()) ? &baseline->npcs[i] : nullptr;
+        const uint8_t mask = npc_delta_mask(n, base);
+
+        OperationsBytes::add_one_byte(mask, buff);
+        if (mask & NPC_DELTA_MODEL)
+            OperationsBytes::add_two_bytes(n.model, buff);
+        if (mask & NPC_DELTA_ANIMATION)
+            OperationsBytes::add_one_byte(n.animation, buff);
+        if (mask & NPC_DELTA_X)
+            OperationsBytes::add_four_bytes(n.x_px, buff);
+        if (mask & NPC_DELTA_Y)
+            OperationsBytes::add_four_bytes(n.y_px, buff);
+        if (mask & NPC_DELTA_Z)
+            OperationsBytes::add_one_byte(n.z, buff);
+        if (mask & NPC_DELTA_ANGLE)
+            OperationsBytes::add_four_bytes(n.angle, buff);
+    }
+
+    return buff;
+}
+
+// Posicion en pixeles -> 16 bits relativos al tamaño del mapa. Con mapas de menos de 65536 px
+// de lado la ida y vuelta (redondeando) es exacta
+static uint16_t quantize_coord(uint32_t px, uint32_t extent) {
+    if (extent == 0) {
+        return static_cast<uint16_t>(std::min<uint32_t>(px, UINT16_MAX));
+    }
+    const uint64_t clamped = std::min(px, extent);
+    return static_cast<uint16_t>((clamped * UINT16_MAX + extent / 2) / extent);
+}
+
+// Grados enteros (0..359) -> 256 pasos por vuelta (~1.4 grados)
+static uint8_t quantize_angle(uint32_t degrees) {
+    return static_cast<uint8_t>(((degrees % 360) * 256 + 180) / 360);
+}
+
+// Lo que viaja de cada jugador en el formato compacto, ya cuantizado
+struct CompactPlayer {
+    uint8_t flags;
+    uint16_t x;
+    uint16_t y;
+    uint8_t angle;
+};
+
+static CompactPlayer compact_player(const PlayerSnapshot& p, const GameSnapshotData& game) {
+    return CompactPlayer{
+            static_cast<uint8_t>((p.ghost & 0x01) | ((p.sound_code & 0x03) << 1) | (p.z << 3)),
+            quantize_coord(p.x_px, game.map_width_px), quantize_coord(p.y_px, game.map_height_px),
+            quantize_angle(p.angle)};
+}
+
+static uint8_t player_compact_mask(const PlayerSnapshot& p, const GameSnapshotData& game,
+                                   const PlayerSnapshot* base, const GameSnapshotData* baseline) {
+    if (!base) {
+        return PLAYER_COMPACT_ALL;
+    }
+    // Se compara lo cuantizado: un movimiento que no cambia los 16 bits no se manda
+    const CompactPlayer now = compact_player(p, game);
+    const CompactPlayer before = compact_player(*base, *baseline);
+    const uint16_t delta = player_delta_mask(p, base);
+
+    uint8_t mask = 0;
+    if (now.flags != before.flags)
+        mask |= PLAYER_COMPACT_FLAGS;
+    if (delta & PLAYER_DELTA_LIFE)
+        mask |= PLAYER_COMPACT_LIFE;
+    if (delta & PLAYER_DELTA_MODEL)
+        mask |= PLAYER_COMPACT_MODEL;
+    if (delta & PLAYER_DELTA_ANIMATION)
+        mask |= PLAYER_COMPACT_ANIMATION;
+    if (now.x != before.x || now.y != before.y)
+        mask |= PLAYER_COMPACT_POS;
+    if (now.angle != before.angle)
+        mask |= PLAYER_COMPACT_ANGLE;
+    if (p.next_order != base->next_order)
+        mask |= PLAYER_COMPACT_NEXT_ORDER;
+    return mask;
+}
+
+static uint8_t npc_compact_mask(const NpcSnapshot& n, const GameSnapshotData& game,
+                                const NpcSnapshot* base, const GameSnapshotData* baseline) {
+    if (!base) {
+        return NPC_COMPACT_ALL;
+    }
+    uint8_t mask = 0;
+    if (n.z != base->z)
+        mask |= NPC_COMPACT_Z;
+    if (n.model != base->model)
+        mask |= NPC_COMPACT_MODEL;
+    if (n.animation != base->animation)
+        mask |= NPC_COMPACT_ANIMATION;
+    if (quantize_coord(n.x_px, game.map_width_px) !=
+                quantize_coord(base->x_px, baseline->map_width_px) ||
+        quantize_coord(n.y_px, game.map_height_px) !=
+                quantize_coord(base->y_px, baseline->map_height_px))
+        mask |= NPC_COMPACT_POS;
+    if (quantize_angle(n.angle) != quantize_angle(base->angle))
+        mask |= NPC_COMPACT_ANGLE;
+    return mask;
+}
+
+std::vector<uint8_t> ServerProtocol::encode_snapshot_compact(const GameSnapshotData& game,
+                                                             uint32_t sequence,
+                                                             const GameSnapshotData* baseline,
+                                                             uint32_t baseline_sequence) {
+    // Si cambio el mapa las posiciones del baseline estan en otra escala y los checkpoints son
+    // otros: va como keyframe
+    if (baseline && (baseline->map_width_px != game.map_width_px ||
+                     baseline->map_height_px != game.map_height_px ||
+                     baseline->checkpoints != game.checkpoints)) {
+        baseline = nullptr;
+    }
+
+    std::vector<uint8_t> buff;
+    buff.reserve(24 + game.players.size() * 32 + game.npcs.size() * 8);
+
+    OperationsBytes::add_one_byte(EVENT_SEND_SNAPSHOT_COMPACT, buff);
+    OperationsBytes::add_varint(sequence, buff);
+    OperationsBytes::add_varint(baseline ? baseline_sequence : 0, buff);
+    OperationsBytes::add_varint(game.time_seconds_remained, buff);
+    OperationsBytes::add_varint(game.map_width_px, buff);
+    OperationsBytes::add_varint(game.map_height_px, buff);
+
+    // El roster es la lista de ids en orden: la posicion de cada id es el indice local del
+    // jugador en la partida. Solo viaja si cambio respecto del baseline
+    bool roster = !baseline || baseline->players.size() != game.players.size();
+    for (std::size_t i = 0; !roster && i < game.players.size(); ++i) {
+        roster = (game.players[i].id != baseline->players[i].id);
+    }
+    OperationsBytes::add_one_byte(roster ? COMPACT_HAS_ROSTER : 0, buff);
+    if (roster) {
+        OperationsBytes::add_varint(static_cast<uint32_t>(game.players.size()), buff);
+        for (const auto& p: game.players) {
+            OperationsBytes::add_varint(p.id, buff);
+        }
+    }
+
+    // Solo van los jugadores que cambiaron, identificados por su indice
+    std::vector<std::pair<uint32_t, uint8_t>> changed;
+    for (std::size_t i = 0; i < game.players.size(); ++i) {
+        const PlayerSnapshot& p = game.players[i];
+        const PlayerSnapshot* base = nullptr;
+        if (baseline) {
+            for (const auto& b: baseline->players) {
+                if (b.id == p.id) {
+                    base = &b;
+                    break;
+                }
             }
-            op_bytes.add_one_byte(p.next_next_goal, buff);
+        }
+        const uint8_t mask = player_compact_mask(p, game, base, baseline);
+        if (mask != 0) {
+            changed.emplace_back(static_cast<uint32_t>(i), mask);
         }
     }
 
-    const uint16_t cant_npcs = static_cast<uint16_t>(game.npcs.size());
-    op_bytes.add_two_bytes((cant_npcs), buff);
+    OperationsBytes::add_varint(static_cast<uint32_t>(changed.size()), buff);
+    for (const auto& [index, mask]: changed) {
+        const PlayerSnapshot& p = game.players[index];
+        const CompactPlayer q = compact_player(p, game);
+
+        OperationsBytes::add_varint(index, buff);
+        OperationsBytes::add_one_byte(mask, buff);
+        if (mask & PLAYER_COMPACT_FLAGS)
+            OperationsBytes::add_one_byte(q.flags, buff);
+        if (mask & PLAYER_COMPACT_LIFE)
+            OperationsBytes::add_varint(p.car_life, buff);
+        if (mask & PLAYER_COMPACT_MODEL)
+            OperationsBytes::add_varint(p.model, buff);
+        if (mask & PLAYER_COMPACT_ANIMATION)
+            OperationsBytes::add_one_byte(p.animation, buff);
+        if (mask & PLAYER_COMPACT_POS) {
+            OperationsBytes::add_two_bytes(q.x, buff);
+            OperationsBytes::add_two_bytes(q.y, buff);
+        }
+        if (mask & PLAYER_COMPACT_ANGLE)
+            OperationsBytes::add_one_byte(q.angle, buff);
+        if (mask & PLAYER_COMPACT_NEXT_ORDER)
+            OperationsBytes::add_varint(p.next_order, buff);
+    }
 
-    for (const auto& p: game.npcs) {
-        op_bytes.add_two_bytes((p.model), buff);
-        op_bytes.add_one_byte(p.animation, buff);
-        op_bytes.add_four_bytes((p.x_px), buff);
-        op_bytes.add_four_bytes((p.y_px), buff);
-        op_bytes.add_one_byte(p.z, buff);
-        op_bytes.add_four_bytes((p.angle), buff);
+    // NPCs: cantidad total y despues solo los que cambiaron, por indice
+    std::vector<std::pair<uint32_t, uint8_t>> changed_npcs;
+    for (std::size_t i = 0; i < game.npcs.size(); ++i) {
+        const NpcSnapshot* base =
+                (baseline && i < baseline->npcs.size()) ? &baseline->npcs[i] : nullptr;
+        const uint8_t mask = npc_compact_mask(game.npcs[i], game, base, baseline);
+        if (mask != 0) {
+            changed_npcs.emplace_back(static_cast<uint32_t>(i), mask);
+        }
     }
 
-    return (skt.sendall(buff.data(), buff.size()) != 0);
+    OperationsBytes::add_varint(static_cast<uint32_t>(game.npcs.size()), buff);
+    OperationsBytes::add_varint(static_cast<uint32_t>(changed_npcs.size()), buff);
+    for (const auto& [index, mask]: changed_npcs) {
+        const NpcSnapshot& n = game.npcs[index];
+
+        OperationsBytes::add_varint(index, buff);
+        OperationsBytes::add_one_byte(mask, buff);
+        if (mask & NPC_COMPACT_Z)
+            OperationsBytes::add_one_byte(n.z, buff);
+        if (mask & NPC_COMPACT_MODEL)
+            OperationsBytes::add_varint(n.model, buff);
+        if (mask & NPC_COMPACT_ANIMATION)
+            OperationsBytes::add_one_byte(n.animation, buff);
+        if (mask & NPC_COMPACT_POS) {
+            OperationsBytes::add_two_bytes(quantize_coord(n.x_px, game.map_width_px), buff);
+            OperationsBytes::add_two_bytes(quantize_coord(n.y_px, game.map_height_px), buff);
+        }
+        if (mask & NPC_COMPACT_ANGLE)
+            OperationsBytes::add_one_byte(quantize_angle(n.angle), buff);
+    }
+
+    return buff;
 }
 
-bool ServerProtocol::send_race_results_last_to_client(ISocket& skt,
-                                                      const RaceResultsData& race_results) {
+bool ServerProtocol::send_snapshot_game_to_client(ISocket& skt, const GameSnapshotData& game) {
+    return send_wire(skt, encode_snapshot_game(game));
+}
+
+std::vector<uint8_t> ServerProtocol::encode_race_results_last(const RaceResultsData& race_results) {
 
     const auto& results = race_results.race_results;
     const int n = static_cast<int>(results.size());
 
     if (n == 0) {
-        return true;
+        return {};
     }
 
     int non_podium_count = 0;
@@ -270,18 +862,18 @@ bool ServerProtocol::send_race_results_last_to_client(ISocket& skt,
     buff.reserve(1 + 1 + 2 + non_podium_count * (2 + 32 + 4 + 4 + 1) + 1 +
                  podium_flag * (1 + 1 + 32 + 4 + 4 + 1));
 
-    op_bytes.add_one_byte(EVENT_RACE_RESULTS, buff);
-    op_bytes.add_one_byte(0x01, buff);
+    OperationsBytes::add_one_byte(EVENT_RACE_RESULTS, buff);
+    OperationsBytes::add_one_byte(0x01, buff);
 
     // Los no podio
-    op_bytes.add_two_bytes(static_cast<uint16_t>(non_podium_count), buff);
+    OperationsBytes::add_two_bytes(static_cast<uint16_t>(non_podium_count), buff);
     for (int i = 3; i < n; ++i) {
         const auto& r = results[i];
-        op_bytes.add_two_bytes((static_cast<uint16_t>(r.name.size())), buff);
-        op_bytes.add_string(r.name, buff);
-        op_bytes.add_four_bytes(r.race_time_seconds, buff);
-        op_bytes.add_four_bytes(r.total_time_seconds, buff);
-        op_bytes.add_one_byte(r.status, buff);
+        OperationsBytes::add_two_bytes((static_cast<uint16_t>(r.name.size())), buff);
+        OperationsBytes::add_string(r.name, buff);
+        OperationsBytes::add_four_bytes(r.race_time_seconds, buff);
+        OperationsBytes::add_four_bytes(r.total_time_seconds, buff);
+        OperationsBytes::add_one_byte(r.status, buff);
     }
 
     // Los no podio los metemos en orden (3 || 2-3 || 1-2-3)
@@ -290,7 +882,7 @@ bool ServerProtocol::send_race_results_last_to_client(ISocket& skt,
     // 2 -> 2 y 3
     // 3 -> 1, 2 y 3
 
-    op_bytes.add_one_byte(podium_flag, buff);
+    OperationsBytes::add_one_byte(podium_flag, buff);
 
     for (int place = 1; place <= 3; ++place) {
         int idx = place - 1;
@@ -298,19 +890,24 @@ bool ServerProtocol::send_race_results_last_to_client(ISocket& skt,
         if (idx >= n) {
             // No existe ese lugar de podio (por ejemplo partida de 2 personas, el 3er puesto no
             // existe)
-            op_bytes.add_one_byte(0x00, buff);  // EXISTE_JUGADOR = 0
+            OperationsBytes::add_one_byte(0x00, buff);  // EXISTE_JUGADOR = 0
             continue;
         }
 
         const auto& r = results[idx];
 
-        op_bytes.add_one_byte(0x01, buff);  // EXISTE_JUGADOR = 1
-        op_bytes.add_two_bytes(static_cast<uint16_t>(r.name.size()), buff);
-        op_bytes.add_string(r.name, buff);
-        op_bytes.add_four_bytes(r.race_time_seconds, buff);
-        op_bytes.add_four_bytes(r.total_time_seconds, buff);
-        op_bytes.add_one_byte(r.status, buff);
+        OperationsBytes::add_one_byte(0x01, buff);  // EXISTE_JUGADOR = 1
+        OperationsBytes::add_two_bytes(static_cast<uint16_t>(r.name.size()), buff);
+        OperationsBytes::add_string(r.name, buff);
+        OperationsBytes::add_four_bytes(r.race_time_seconds, buff);
+        OperationsBytes::add_four_bytes(r.total_time_seconds, buff);
+        OperationsBytes::add_one_byte(r.status, buff);
     }
 
-    return (skt.sendall(buff.data(), buff.size()) != 0);
+    return buff;
+}
+
+bool ServerProtocol::send_race_results_last_to_client(ISocket& skt,
+                                                      const RaceResultsData& race_results) {
+    return send_wire(skt, encode_race_results_last(race_results));
 }
@@ -3,9 +3,12 @@
 
 #include <atomic>
 #include <cstring>
+#include <deque>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "../../common/ISocket.h"
@@ -14,6 +17,8 @@
 #include "../command.h"
 #include "../event.h"
 
+#include "frame_reader.h"
+#include "outbound_queue.h"
 #include "op_codes.h"
 
 class ServerProtocol {
@@ -22,6 +27,51 @@ private:
     // Usamos esta clase para las operaciones con bytes repetidas
     OperationsBytes op_bytes;
 
+    // Estado de las snapshots delta de ESTE cliente (cada Sender tiene su protocolo).
+    // El ack lo escribe el hilo receiver, por eso es atomico
+    std::atomic<bool> snapshot_deltas{false};
+    std::atomic<uint32_t> acked_snapshot{0};
+
+    // Version acordada con el cliente (la escribe el hilo receiver)
+    std::atomic<uint8_t> protocol_version{PROTOCOL_VERSION_LEGACY};
+
+    // Ultimas snapshots mandadas, para encontrar el baseline que confirmo el cliente
+    std::deque<std::shared_ptr<const GameSnapshotEvent>> sent_snapshots;
+    uint32_t snapshots_since_keyframe = 0;
+
+    static constexpr std::size_t SNAPSHOT_HISTORY = 64;
+    // Cada cuantas snapshots mandamos una completa aunque el cliente venga confirmando
+    static constexpr uint32_t KEYFRAME_INTERVAL = 120;
+
+    const GameSnapshotEvent* find_sent_snapshot(uint32_t sequence) const;
+
+    // Desde PROTOCOL_VERSION_FRAMED los comandos llegan en frames: se reciben en bloque y los
+    // campos se leen del frame actual. Antes de eso se lee campo por campo del socket
+    FrameReader frames;
+    FrameCursor frame;
+
+    uint8_t receive_command_code(ISocket& skt);
+    uint8_t receive_one_byte(ISocket& skt);
+    uint16_t receive_two_bytes(ISocket& skt);
+    uint32_t receive_four_bytes(ISocket& skt);
+    std::string receive_string(std::size_t length, ISocket& skt);
+
+    // Mientras el sender arma un lote, los eventos no escriben: send_wire se guarda el buffer
+    // (compartido, asi sigue vivo) y al final sale todo junto en un solo sendmsg
+    bool batching = false;
+    std::vector<WireBuffer> batch;
+    std::vector<struct iovec> batch_iov;
+    uint64_t events_sent = 0;
+
+    // Eventos que se sacan de la cola como mucho para un mismo envio
+    static constexpr std::size_t MAX_BATCH_EVENTS = 64;
+
+    bool flush_batch(ISocket& skt);
+
+    // Si esta, las snapshots se le ofrecen primero (canal UDP). Devuelve false si no la tomo
+    // (el canal no esta listo o no entra en un datagrama) y entonces sale por el socket
+    std::function<bool(const WireBuffer&)> datagram_sink;
+
 public:
     ServerProtocol() = default;
 
@@ -29,6 +79,9 @@ public:
 
     CommandReceiver get_command_move(ISocket& skt, int id);
 
+    // CMD_INPUT_STATE: las teclas van en param y la secuencia en sequence
+    CommandReceiver get_command_input_state(ISocket& skt, int id);
+
     CommandReceiverJoinLobby get_command_join_lobby(ISocket& skt, int id);
 
     CommandReceiver get_command_upgrade(ISocket& skt, int id);
@@ -37,7 +90,65 @@ public:
 
     CommandReceiverStartLobby get_command_start_lobby(ISocket& skt, int id);
 
-    bool send_event_to_client(ISocket& skt, Queue<std::shared_ptr<IEvent>>& queue_out);
+    uint32_t get_snapshot_ack(ISocket& skt);
+
+    // El cliente confirmo la snapshot sequence. Cualquier ack (incluso 0) habilita las deltas
+    void ack_snapshot(uint32_t sequence);
+
+    uint8_t get_protocol_version(ISocket& skt);
+
+    // True si los comandos ya llegan en frames (se acordo PROTOCOL_VERSION_FRAMED o mas)
+    bool framed_commands() const { return protocol_version >= PROTOCOL_VERSION_FRAMED; }
+
+    // El cliente anuncio la version que habla; se queda con la mas nueva que entiendan ambos
+    void set_protocol_version(uint8_t client_version);
+
+    // Se setea antes de arrancar el hilo que manda
+    void set_datagram_sink(std::function<bool(const WireBuffer&)> sink) {
+        datagram_sink = std::move(sink);
+    }
+
+    // Manda la snapshot completa o como delta contra la ultima confirmada por el cliente
+    bool send_snapshot_event(ISocket& skt, const std::shared_ptr<const GameSnapshotEvent>& ev);
+
+    // Manda la pre-game con o sin la tabla de checkpoints segun la version del cliente
+    bool send_pre_game_event(ISocket& skt, const PreGameSnapshotEvent& ev);
+
+    // Espera el proximo evento y se lleva tambien los que ya esten encolados, mandando todo
+    // junto en una sola escritura
+    bool send_event_to_client(ISocket& skt, OutboundQueue& queue_out);
+
+    // Escribe bytes ya serializados (los de un EncodedEvent)
+    bool send_wire(ISocket& skt, const std::vector<uint8_t>& wire);
+    // Igual, pero si hay un lote armandose el buffer se suma al lote en vez de escribirse
+    bool send_wire(ISocket& skt, const WireBuffer& wire);
+
+    // Cantidad de eventos mandados por send_event_to_client (para las estadisticas del sender)
+    uint64_t get_events_sent() const { return events_sent; }
+
+    // Serializan sin tocar el socket, para codificar una sola vez lo que va a varios clientes
+    static std::vector<uint8_t> encode_snapshot_game(const GameSnapshotData& game);
+    // baseline nullptr = keyframe (van todos los campos)
+    static std::vector<uint8_t> encode_snapshot_delta(const GameSnapshotData& game,
+                                                      uint32_t sequence,
+                                                      const GameSnapshotData* baseline,
+                                                      uint32_t baseline_sequence);
+    // Igual que la delta pero cuantizada y empaquetada (protocolo version 2)
+    static std::vector<uint8_t> encode_snapshot_compact(const GameSnapshotData& game,
+                                                        uint32_t sequence,
+                                                        const GameSnapshotData* baseline,
+                                                        uint32_t baseline_sequence);
+    static std::vector<uint8_t> encode_snapshot_lobby(const LobbySnapshotData& lobby);
+    static std::vector<uint8_t> encode_pre_game_snapshot(const PreGameSnapshotData& pre_game);
+    // EVENT_PRE_GAME_CHECKPOINTS: la pre-game mas la tabla de checkpoints de la carrera
+    static std::vector<uint8_t> encode_pre_game_checkpoints(const PreGameSnapshotData& pre_game);
+    static std::vector<uint8_t> encode_race_results(const RaceResultsData& race_results);
+    static std::vector<uint8_t> encode_race_results_last(const RaceResultsData& race_results);
+    static std::vector<uint8_t> encode_udp_offer(uint16_t port, uint32_t token);
+
+    // Parsea un datagrama de un cliente. false si no es uno de los nuestros o esta cortado
+    static bool decode_udp_datagram(const uint8_t* data, std::size_t size,
+                                    CommandReceiverUdp& out);
 
     void send_id_to_client(ISocket& skt, const int id);
 
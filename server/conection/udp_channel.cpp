@@ -0,0 +1,150 @@
+#include "udp_channel.h"
+
+#include <array>
+#include <iostream>
+#include <utility>
+
+#include "game.h"
+#include "op_codes.h"
+#include "server_protocol.h"
+
+void UdpSession::set_game(Game* g) {
+    std::lock_guard<std::mutex> lock(m);
+    game = g;
+}
+
+UdpChannel::UdpChannel(const char* servname):
+        socket(servname), port(socket.local_port()), rng(std::random_device{}()) {}
+
+std::shared_ptr<UdpSession> UdpChannel::open_session(int client_id) {
+    std::lock_guard<std::mutex> lock(m);
+    auto session = std::make_shared<UdpSession>(client_id, static_cast<uint32_t>(rng()));
+    sessions[client_id] = session;
+    return session;
+}
+
+void UdpChannel::close_session(int client_id) {
+    std::lock_guard<std::mutex> lock(m);
+    sessions.erase(client_id);
+}
+
+std::shared_ptr<UdpSession> UdpChannel::find_session(int client_id) {
+    std::lock_guard<std::mutex> lock(m);
+    auto it = sessions.find(client_id);
+    return it == sessions.end() ? nullptr : it->second;
+}
+
+bool UdpChannel::send_snapshot(UdpSession& session, const std::vector<uint8_t>& wire) {
+    if (!session.is_ready() || wire.size() > UDP_MAX_DATAGRAM) {
+        return false;
+    }
+    sockaddr_in to;
+    {
+        std::lock_guard<std::mutex> lock(session.m);
+        if (!session.has_addr) {
+            return false;
+        }
+        to = session.addr;
+    }
+    // Si no sale (buffer del kernel lleno) se pierde como cualquier datagrama: la proxima
+    // snapshot trae el estado entero igual
+    socket.send(wire.data(), wire.size(), &to);
+    return true;
+}
+
+void UdpChannel::run() {
+    std::array<uint8_t, 2048> buffer;
+    CommandReceiverUdp cmd;
+    while (should_keep_running()) {
+        try {
+            sockaddr_in from;
+            int n = socket.recv(buffer.data(), buffer.size(), &from, true);
+            if (!should_keep_running()) {
+                break;
+            }
+            // Cualquiera puede mandar cualquier cosa a este puerto: lo que no se entiende o
+            // no trae el token de su sesion se ignora
+            if (n <= 0 || !ServerProtocol::decode_udp_datagram(
+                                  buffer.data(), static_cast<std::size_t>(n), cmd)) {
+                continue;
+            }
+            auto session = find_session(cmd.client_id);
+            if (!session || session->token != cmd.token) {
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(session->m);
+                session->addr = from;
+                session->has_addr = true;
+            }
+            if (cmd.op == UDP_HELLO) {
+                handle_hello(from);
+            } else {
+                handle_input(*session, cmd);
+            }
+        } catch (const std::exception& e) {
+            if (!should_keep_running()) {
+                break;
+            }
+            std::cerr << "UdpChannel: " << e.what() << "\n";
+        }
+    }
+}
+
+void UdpChannel::handle_hello(const sockaddr_in& from) {
+    // Se contesta cada saludo: si se perdio el ack, el cliente vuelve a saludar
+    const uint8_t ack = UDP_HELLO_ACK;
+    socket.send(&ack, sizeof(ack), &from);
+}
+
+void UdpChannel::handle_input(UdpSession& session, const CommandReceiverUdp& cmd) {
+    std::lock_guard<std::mutex> lock(session.m);
+    Game* g = session.game;
+    // Igual que por TCP: hasta que no arranca la partida los inputs no van a ningun lado
+    if (!g || !g->is_started() || g->has_finished()) {
+        return;
+    }
+
+    if (cmd.op == UDP_INPUT_STATE) {
+        // El cliente lo reenvia un par de veces por si se pierde: se pasa una sola vez
+        if (cmd.state.sequence <= session.last_input) {
+            return;
+        }
+        CommandReceiver input{session.client_id, CommandReceiverType::InputState, cmd.state.key,
+                              {}, cmd.state.sequence};
+        try {
+            if (!g->get_cmd_q().try_push(std::move(input))) {
+                // Cola llena: lo trae el proximo reenvio o el proximo estado
+                return;
+            }
+        } catch (const ClosedQueue&) {
+            return;
+        }
+        session.last_input = cmd.state.sequence;
+        return;
+    }
+
+    // Cada datagrama repite las ultimas teclas; se aplican solo las que no llegaron antes
+    for (const UdpInput& in: cmd.inputs) {
+        if (in.sequence <= session.last_input || in.key > UDP_MAX_INPUT_KEY) {
+            continue;
+        }
+        try {
+            if (!g->get_cmd_q().try_push(
+                        CommandReceiver{session.client_id, CommandReceiverType::Move, in.key})) {
+                // Cola llena: el proximo datagrama la vuelve a traer
+                return;
+            }
+        } catch (const ClosedQueue&) {
+            // La partida termino mientras pusheabamos
+            return;
+        }
+        session.last_input = in.sequence;
+    }
+}
+
+void UdpChannel::stop() {
+    Thread::stop();
+    socket.shutdown();
+}
@@ -0,0 +1,93 @@
+#ifndef UDP_CHANNEL_H
+#define UDP_CHANNEL_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <netinet/in.h>
+
+#include "../../common/datagram_socket.h"
+#include "../../common/thread.h"
+#include "../command.h"
+
+class Game;
+
+// Lo que el canal UDP sabe de un cliente. La abre el ClientHandler, que le va diciendo en que
+// partida esta; el hilo del UdpChannel la usa con cada datagrama y el sender para mandarle
+// las snapshots
+class UdpSession {
+private:
+    friend class UdpChannel;
+
+    const int client_id;
+    const uint32_t token;
+
+    std::mutex m;
+    // De donde llego el ultimo datagrama valido (puede cambiar si hay un NAT en el medio)
+    sockaddr_in addr{};
+    bool has_addr = false;
+    // Partida a la que van los inputs. El handler la limpia antes de salir de la partida, y
+    // como lo hace con el mutex tomado, la partida no se borra mientras se pushea
+    Game* game = nullptr;
+    uint32_t last_input = 0;
+
+    // El cliente confirmo por TCP que le llegan los datagramas
+    std::atomic<bool> ready{false};
+
+public:
+    UdpSession(int client_id, uint32_t token): client_id(client_id), token(token) {}
+
+    uint32_t get_token() const { return token; }
+
+    void set_game(Game* g);
+    void set_ready() { ready = true; }
+    bool is_ready() const { return ready; }
+
+    UdpSession(const UdpSession&) = delete;
+    UdpSession& operator=(const UdpSession&) = delete;
+};
+
+// Un unico socket UDP para todo el server, al lado del de TCP. Un hilo recibe los datagramas
+// de todos los clientes (saludos e inputs); las snapshots las manda cada sender por su cuenta
+class UdpChannel: public Thread {
+private:
+    DatagramSocket socket;
+    uint16_t port;
+
+    std::mutex m;
+    std::unordered_map<int, std::shared_ptr<UdpSession>> sessions;
+    std::mt19937 rng;
+
+    std::shared_ptr<UdpSession> find_session(int client_id);
+
+    void handle_hello(const sockaddr_in& from);
+    void handle_input(UdpSession& session, const CommandReceiverUdp& cmd);
+
+public:
+    // Escucha en servname (el mismo puerto que el TCP, que es otro espacio de puertos)
+    explicit UdpChannel(const char* servname);
+
+    uint16_t get_port() const { return port; }
+
+    // Sesion nueva con un token al azar. Hasta que el cliente salude no se le manda nada
+    std::shared_ptr<UdpSession> open_session(int client_id);
+    void close_session(int client_id);
+
+    // Desde el sender del cliente. false si la sesion no esta lista o wire no entra en un
+    // datagrama: en ese caso va por TCP
+    bool send_snapshot(UdpSession& session, const std::vector<uint8_t>& wire);
+
+    void run() override;
+
+    // Despierta al hilo, que esta bloqueado en recv
+    void stop() override;
+
+    ~UdpChannel() override = default;
+};
+
+#endif  // UDP_CHANNEL_H
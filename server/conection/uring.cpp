@@ -0,0 +1,158 @@
+#include "uring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "../../common/liberror.h"
+
+Uring::Uring(unsigned entries) {
+    io_uring_params p;
+    std::memset(&p, 0, sizeof(p));
+    // SINGLE_ISSUER es de 6.0, igual que los recv multishot: si el kernel no lo entiende
+    // tampoco va a entender lo demas. El anillo arranca deshabilitado porque el que lo usa es
+    // el hilo del reactor, no el que lo crea
+    p.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_R_DISABLED;
+
+    ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+    if (ring_fd < 0) {
+        throw LibError(errno, "io_uring_setup failed");
+    }
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        ::close(ring_fd);
+        throw LibError(ENOSYS, "io_uring without IORING_FEAT_SINGLE_MMAP");
+    }
+
+    ring_mem_size = std::max(p.sq_off.array + p.sq_entries * sizeof(unsigned),
+                             p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe));
+    ring_mem = mmap(nullptr, ring_mem_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring_fd, IORING_OFF_SQ_RING);
+    if (ring_mem == MAP_FAILED) {
+        int err = errno;
+        ring_mem = nullptr;
+        ::close(ring_fd);
+        throw LibError(err, "io_uring mmap failed");
+    }
+
+    sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+    void* s = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ring_fd, IORING_OFF_SQES);
+    if (s == MAP_FAILED) {
+        int err = errno;
+        unmap();
+        ::close(ring_fd);
+        throw LibError(err, "io_uring mmap failed");
+    }
+    sqes = static_cast<io_uring_sqe*>(s);
+
+    auto* base = static_cast<uint8_t*>(ring_mem);
+    sq_head = reinterpret_cast<unsigned*>(base + p.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(base + p.sq_off.tail);
+    sq_mask = *reinterpret_cast<unsigned*>(base + p.sq_off.ring_mask);
+    sq_entries = p.sq_entries;
+    cq_head = reinterpret_cast<unsigned*>(base + p.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(base + p.cq_off.tail);
+    cq_mask = *reinterpret_cast<unsigned*>(base + p.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(base + p.cq_off.cqes);
+
+    // El indice i de la cola siempre apunta al SQE i
+    auto* sq_array = reinterpret_cast<unsigned*>(base + p.sq_off.array);
+    for (unsigned i = 0; i < sq_entries; ++i) sq_array[i] = i;
+    sqe_tail = sqe_submitted = *sq_tail;
+}
+
+void Uring::enable() {
+    if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_ENABLE_RINGS, nullptr, 0) < 0) {
+        throw LibError(errno, "io_uring enable failed");
+    }
+}
+
+void Uring::setup_buffers(uint16_t group, uint16_t count, uint32_t size) {
+    buf_ring_size = count * sizeof(io_uring_buf);
+    void* mem = mmap(nullptr, buf_ring_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        throw LibError(errno, "io_uring buffer ring mmap failed");
+    }
+    buf_ring = static_cast<io_uring_buf*>(mem);
+    buf_data.resize(static_cast<std::size_t>(count) * size);
+    buf_count = count;
+    buf_size = size;
+    buf_group = group;
+    buf_tail = 0;
+
+    io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring);
+    reg.ring_entries = count;
+    reg.bgid = group;
+    if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        int err = errno;
+        munmap(buf_ring, buf_ring_size);
+        buf_ring = nullptr;
+        throw LibError(err, "io_uring buffer ring register failed");
+    }
+
+    for (uint16_t bid = 0; bid < count; ++bid) recycle_buffer(bid);
+}
+
+void Uring::recycle_buffer(uint16_t bid) {
+    io_uring_buf& b = buf_ring[buf_tail & (buf_count - 1)];
+    b.addr = reinterpret_cast<uint64_t>(buffer(bid));
+    b.len = buf_size;
+    b.bid = bid;
+    ++buf_tail;
+    std::atomic_ref<uint16_t>(buf_ring[0].resv).store(buf_tail, std::memory_order_release);
+}
+
+io_uring_sqe* Uring::get_sqe() {
+    if (sqe_tail - std::atomic_ref<unsigned>(*sq_head).load(std::memory_order_acquire) >=
+        sq_entries) {
+        // Sin SQPOLL el kernel consume todo lo publicado dentro de la misma io_uring_enter
+        submit_and_wait(0);
+    }
+    io_uring_sqe* sqe = &sqes[sqe_tail & sq_mask];
+    std::memset(sqe, 0, sizeof(*sqe));
+    ++sqe_tail;
+    return sqe;
+}
+
+void Uring::submit_and_wait(unsigned wait_nr) {
+    std::atomic_ref<unsigned>(*sq_tail).store(sqe_tail, std::memory_order_release);
+    const unsigned to_submit = sqe_tail - sqe_submitted;
+    const unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+
+    long ret = syscall(__NR_io_uring_enter, ring_fd, to_submit, wait_nr, flags, nullptr, 0);
+    if (ret < 0) {
+        // Una senal o la cola de completions llena: se reintenta en la proxima vuelta
+        if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+            return;
+        }
+        throw LibError(errno, "io_uring_enter failed");
+    }
+    sqe_submitted += static_cast<unsigned>(ret);
+}
+
+void Uring::unmap() {
+    if (sqes) {
+        munmap(sqes, sqes_size);
+        sqes = nullptr;
+    }
+    if (ring_mem) {
+        munmap(ring_mem, ring_mem_size);
+        ring_mem = nullptr;
+    }
+}
+
+Uring::~Uring() {
+    // Cerrar el fd cancela lo que quede en vuelo
+    ::close(ring_fd);
+    unmap();
+    if (buf_ring) {
+        munmap(buf_ring, buf_ring_size);
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef URING_H
+#define URING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <linux/io_uring.h>
+
+// Un io_uring armado a mano sobre las syscalls (sin liburing). Solo tiene lo que usa el
+// UringReactor: pedir SQEs, mandar todo lo preparado junto con la espera en una sola
+// io_uring_enter, recorrer las completions y un anillo de buffers provistos para los recv.
+//
+// No es thread-safe: lo usa solo el hilo del reactor (salvo el constructor).
+class Uring {
+private:
+    int ring_fd = -1;
+
+    void* ring_mem = nullptr;
+    std::size_t ring_mem_size = 0;
+    io_uring_sqe* sqes = nullptr;
+    std::size_t sqes_size = 0;
+
+    // Submission queue
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned sq_entries = 0;
+    unsigned sqe_tail = 0;       // SQEs preparados (todavia sin publicar)
+    unsigned sqe_submitted = 0;  // hasta donde ya los tomo el kernel
+
+    // Completion queue
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    // Buffers provistos: el kernel elige uno recien cuando llegan datos, asi una conexion
+    // callada no tiene memoria reservada. Es un arreglo de io_uring_buf con el tail encimado
+    // en bufs[0].resv; no se usa io_uring_buf_ring porque en C++ su arreglo flexible queda
+    // corrido 8 bytes
+    io_uring_buf* buf_ring = nullptr;
+    std::size_t buf_ring_size = 0;
+    std::vector<uint8_t> buf_data;
+    uint16_t buf_count = 0;
+    uint16_t buf_tail = 0;
+    uint32_t buf_size = 0;
+    uint16_t buf_group = 0;
+
+    void unmap();
+
+public:
+    // Lanza LibError si el kernel no tiene io_uring (o es anterior a 6.0: se piden flags que
+    // recien existen ahi, asi el fallback se decide aca y no con la primera conexion)
+    explicit Uring(unsigned entries);
+
+    // Los SQEs solo los puede mandar el hilo que habilito el anillo
+    void enable();
+
+    // Registra count buffers de size bytes en el grupo group (count potencia de 2)
+    void setup_buffers(uint16_t group, uint16_t count, uint32_t size);
+    uint16_t buffer_group() const { return buf_group; }
+    const uint8_t* buffer(uint16_t bid) const {
+        return buf_data.data() + static_cast<std::size_t>(bid) * buf_size;
+    }
+    // El buffer ya se copio: vuelve al anillo
+    void recycle_buffer(uint16_t bid);
+
+    // Un SQE en cero. Si la cola esta llena manda lo que haya para hacer lugar
+    io_uring_sqe* get_sqe();
+
+    // Manda todo lo preparado y espera al menos wait_nr completions, en una sola syscall
+    void submit_and_wait(unsigned wait_nr);
+
+    // Llama a fn con cada completion disponible. Retorna cuantas hubo
+    template <typename F>
+    unsigned for_each_completion(F&& fn) {
+        unsigned head = *cq_head;
+        unsigned n = 0;
+        while (head != std::atomic_ref<unsigned>(*cq_tail).load(std::memory_order_acquire)) {
+            const io_uring_cqe cqe = cqes[head & cq_mask];
+            ++head;
+            ++n;
+            // Se libera el lugar antes de atenderla: fn puede preparar SQEs nuevos
+            std::atomic_ref<unsigned>(*cq_head).store(head, std::memory_order_release);
+            fn(cqe);
+        }
+        return n;
+    }
+
+    ~Uring();
+
+    Uring(const Uring&) = delete;
+    Uring& operator=(const Uring&) = delete;
+};
+
+#endif  // URING_H
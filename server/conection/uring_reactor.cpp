@@ -0,0 +1,243 @@
+#include "uring_reactor.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <iostream>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "client_handler.h"
+
+UringReactor::UringReactor(): ring(RING_ENTRIES) {
+    ring.setup_buffers(BUFFER_GROUP, BUFFER_COUNT, BUFFER_SIZE);
+}
+
+void UringReactor::run() {
+    try {
+        ring.enable();
+        arm_wake();
+        while (should_keep_running()) {
+            ring.submit_and_wait(1);
+            ring.for_each_completion([this](const io_uring_cqe& cqe) { handle_completion(cqe); });
+            drain_requests();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Reactor: " << e.what() << "\n";
+    }
+    shutdown_connections();
+}
+
+void UringReactor::arm_wake() {
+    // Un poll y no un read: el eventfd es no bloqueante y io_uring devolveria EAGAIN en vez de
+    // esperar
+    io_uring_sqe* sqe = ring.get_sqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = wake_fd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = tag(0, OP_WAKE);
+    wake_armed = true;
+}
+
+void UringReactor::arm_recv(int id, Connection& c) {
+    io_uring_sqe* sqe = ring.get_sqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = c.h->get_fd();
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = ring.buffer_group();
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->user_data = tag(id, OP_RECV);
+    c.recv_armed = true;
+}
+
+void UringReactor::flush(int id, Connection& c) {
+    // Mientras el kernel lee del buffer de salida no se le agrega nada
+    if (c.send_in_flight || c.closing) {
+        return;
+    }
+    if (!c.h->fill_output()) {
+        close_connection(c);
+        return;
+    }
+    const std::size_t pending = c.h->output_pending();
+    if (pending == 0) {
+        return;
+    }
+
+    io_uring_sqe* sqe = ring.get_sqe();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = c.h->get_fd();
+    sqe->addr = reinterpret_cast<uint64_t>(c.h->output_data());
+    sqe->len = static_cast<uint32_t>(std::min<std::size_t>(pending, UINT_MAX));
+    // MSG_WAITALL: el kernel reintenta los envios parciales sin volver a este hilo
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    sqe->user_data = tag(id, OP_SEND);
+    c.send_in_flight = true;
+}
+
+void UringReactor::drain_requests() {
+    std::vector<ClientHandler*> added;
+    std::vector<int> writable;
+    take_requests(added, writable);
+
+    for (ClientHandler* h: added) register_connection(*h);
+    for (int id: writable) {
+        auto it = connections.find(id);
+        if (it != connections.end()) {
+            flush(id, it->second);
+            maybe_release(id);
+        }
+    }
+}
+
+void UringReactor::register_connection(ClientHandler& h) {
+    const int id = h.get_id();
+    if (!h.on_registered()) {
+        h.mark_finished();
+        return;
+    }
+    Connection& c = connections.insert_or_assign(id, Connection{&h}).first->second;
+    arm_recv(id, c);
+    flush(id, c);
+    maybe_release(id);
+}
+
+void UringReactor::close_connection(Connection& c) {
+    if (c.closing) {
+        return;
+    }
+    c.closing = true;
+    // Termina el recv multishot (llega un 0) y el send que este en vuelo
+    ::shutdown(c.h->get_fd(), SHUT_RDWR);
+}
+
+void UringReactor::maybe_release(int id) {
+    auto it = connections.find(id);
+    if (it == connections.end()) {
+        return;
+    }
+    const Connection& c = it->second;
+    if (!c.closing || c.recv_armed || c.send_in_flight) {
+        return;
+    }
+    ClientHandler* h = c.h;
+    connections.erase(it);
+
+    // Desde aca el handler es del acceptor, que lo va a joinear en el proximo reap
+    h->mark_finished();
+}
+
+void UringReactor::handle_completion(const io_uring_cqe& cqe) {
+    const auto op = static_cast<Op>(cqe.user_data & 0xFF);
+    const auto id = static_cast<int>(cqe.user_data >> 8);
+
+    if (op == OP_WAKE) {
+        wake_armed = false;
+        uint64_t count;
+        while (::read(wake_fd, &count, sizeof(count)) > 0) {}
+        if (should_keep_running()) {
+            arm_wake();
+        }
+        return;
+    }
+    if (op == OP_RECV) {
+        handle_recv(id, cqe);
+    } else {
+        handle_send(id, cqe);
+    }
+    maybe_release(id);
+}
+
+void UringReactor::handle_recv(int id, const io_uring_cqe& cqe) {
+    const bool has_buffer = cqe.flags & IORING_CQE_F_BUFFER;
+    const auto bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+
+    auto it = connections.find(id);
+    if (it == connections.end()) {
+        if (has_buffer) {
+            ring.recycle_buffer(bid);
+        }
+        return;
+    }
+    Connection& c = it->second;
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+        c.recv_armed = false;
+    }
+
+    if (cqe.res > 0) {
+        // Se copia al buffer de entrada de la conexion y el buffer vuelve al anillo enseguida
+        const bool ok =
+                c.closing || c.h->on_received(ring.buffer(bid), static_cast<std::size_t>(cqe.res));
+        ring.recycle_buffer(bid);
+        if (!ok) {
+            close_connection(c);
+        } else if (!c.recv_armed && !c.closing) {
+            arm_recv(id, c);
+        }
+        return;
+    }
+
+    if (cqe.res == -ENOBUFS) {
+        // Se acabaron los buffers libres por un momento: se vuelve a armar
+        if (!c.recv_armed && !c.closing) {
+            arm_recv(id, c);
+        }
+        return;
+    }
+
+    // 0: el cliente cerro. Un error (reset) es lo mismo
+    if (!c.closing) {
+        c.h->on_received(nullptr, 0);
+        close_connection(c);
+    }
+}
+
+void UringReactor::handle_send(int id, const io_uring_cqe& cqe) {
+    auto it = connections.find(id);
+    if (it == connections.end()) {
+        return;
+    }
+    Connection& c = it->second;
+    c.send_in_flight = false;
+    // Como try_sendsome con epoll: cada send cuenta, aunque falle
+    c.h->record_ring_send(cqe.res > 0 ? static_cast<std::size_t>(cqe.res) : 0);
+    if (c.closing) {
+        return;
+    }
+    if (cqe.res < 0) {
+        close_connection(c);
+        return;
+    }
+    c.h->on_sent(static_cast<std::size_t>(cqe.res));
+    flush(id, c);
+}
+
+void UringReactor::shutdown_connections() {
+    // Se completa el poll del eventfd para no dejarlo en vuelo
+    if (wake_armed) {
+        uint64_t one = 1;
+        if (::write(wake_fd, &one, sizeof(one)) == -1) {
+            std::cerr << "Reactor: no se pudo despertar al reactor (errno " << errno << ")\n";
+        }
+    }
+
+    std::vector<int> ids;
+    ids.reserve(connections.size());
+    for (auto& [id, c]: connections) {
+        close_connection(c);
+        ids.push_back(id);
+    }
+    for (int id: ids) maybe_release(id);
+
+    try {
+        while (wake_armed || !connections.empty()) {
+            ring.submit_and_wait(1);
+            ring.for_each_completion([this](const io_uring_cqe& cqe) { handle_completion(cqe); });
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Reactor: " << e.what() << "\n";
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef URING_REACTOR_H
+#define URING_REACTOR_H
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "reactor.h"
+#include "uring.h"
+
+// Reactor sobre io_uring. Cada vuelta manda todo lo preparado (recvs, sends, el poll del
+// eventfd) y espera completions en una sola io_uring_enter, para todas las conexiones.
+//
+// Cada conexion tiene un recv multishot armado todo el tiempo, que toma buffers del anillo
+// provisto del Uring, y como mucho un send en vuelo con lo que haya en su buffer de salida.
+class UringReactor: public Reactor {
+private:
+    struct Connection {
+        ClientHandler* h;
+        bool recv_armed = false;
+        bool send_in_flight = false;
+        // Se hizo shutdown: se espera que terminen las operaciones en vuelo para soltarla
+        bool closing = false;
+    };
+
+    enum Op : uint64_t { OP_WAKE = 0, OP_RECV = 1, OP_SEND = 2 };
+
+    // El user_data de cada operacion: el id del cliente y la operacion
+    static uint64_t tag(int id, Op op) { return (static_cast<uint64_t>(id) << 8) | op; }
+
+    static constexpr unsigned RING_ENTRIES = 1024;
+    static constexpr uint16_t BUFFER_GROUP = 0;
+    static constexpr uint16_t BUFFER_COUNT = 512;
+    static constexpr uint32_t BUFFER_SIZE = 4096;
+
+    Uring ring;
+
+    // Solo las toca el hilo del reactor
+    std::unordered_map<int, Connection> connections;
+    bool wake_armed = false;
+
+    void arm_wake();
+    void arm_recv(int id, Connection& c);
+    // Si no hay un send en vuelo, serializa lo que haya en la cola y lo manda
+    void flush(int id, Connection& c);
+
+    void drain_requests();
+    void register_connection(ClientHandler& h);
+    void close_connection(Connection& c);
+    // Si la conexion se esta cerrando y ya no tiene nada en vuelo, se la devuelve al acceptor
+    void maybe_release(int id);
+
+    void handle_completion(const io_uring_cqe& cqe);
+    void handle_recv(int id, const io_uring_cqe& cqe);
+    void handle_send(int id, const io_uring_cqe& cqe);
+
+    // Al parar: cierra todas las conexiones y espera que el kernel suelte sus buffers
+    void shutdown_connections();
+
+public:
+    // Lanza LibError si io_uring no esta disponible
+    UringReactor();
+
+    void run() override;
+
+    ~UringReactor() override = default;
+};
+
+#endif  // URING_REACTOR_H
@@ -58,6 +58,24 @@ Config::Config(const std::string& path) {
         min_shield_ = 0.0;
         max_shield_ = 0.8;
 
+        tick_workers_ = 0;
+        max_catch_up_steps_ = 5;
+        profiler_dump_seconds_ = 60.0f;
+
+        aoi_near_radius_px_ = 1200;
+        aoi_far_radius_px_ = 4800;
+        aoi_far_update_interval_ = 4;
+
+        tcp_nodelay_ = true;
+        tcp_notsent_lowat_bytes_ = 0;
+        send_stats_seconds_ = 60.0f;
+        max_queued_bytes_per_client_ = 1 << 20;
+        max_client_lag_seconds_ = 5.0f;
+        io_model_ = "epoll";
+        reactor_threads_ = 0;
+        udp_enabled_ = true;
+        udp_port_ = 0;
+
         root = YAML::LoadFile(path);
 
         load_game_config();
@@ -65,6 +83,9 @@ Config::Config(const std::string& path) {
         load_penalties_config();
         load_npcs_config();
         load_car_tuning();
+        load_server_config();
+        load_snapshots_config();
+        load_network_config();
     } catch (const std::exception& e) {
         std::cerr << "Config: error cargando config.yaml: " << e.what()
                   << " (usando valores por defecto)" << std::endl;
@@ -215,3 +236,77 @@ void Config::load_car_tuning() {
         max_shield_ = mapping["max_shield"].as<float>(max_shield_);
     }
 }
+
+void Config::load_server_config() {
+    auto server = root["server"];
+    if (!server) {
+        return;
+    }
+
+    int workers = server["tick_workers"].as<int>(tick_workers_);
+    int catch_up = server["max_catch_up_steps"].as<int>(max_catch_up_steps_);
+    float dump = server["profiler_dump_seconds"].as<float>(profiler_dump_seconds_);
+
+    if (workers >= 0)
+        tick_workers_ = workers;
+    if (catch_up >= 1)
+        max_catch_up_steps_ = catch_up;
+    if (dump >= 0.0f)
+        profiler_dump_seconds_ = dump;
+}
+
+void Config::load_snapshots_config() {
+    auto snapshots = root["snapshots"];
+    if (!snapshots) {
+        return;
+    }
+
+    int near = snapshots["aoi_near_radius_px"].as<int>(aoi_near_radius_px_);
+    int far = snapshots["aoi_far_radius_px"].as<int>(aoi_far_radius_px_);
+    int interval = snapshots["aoi_far_update_interval"].as<int>(aoi_far_update_interval_);
+
+    if (near >= 0)
+        aoi_near_radius_px_ = near;
+    if (far >= 0)
+        aoi_far_radius_px_ = far;
+    if (interval >= 1)
+        aoi_far_update_interval_ = interval;
+}
+
+void Config::load_network_config() {
+    auto network = root["network"];
+    if (!network) {
+        return;
+    }
+
+    tcp_nodelay_ = network["tcp_nodelay"].as<bool>(tcp_nodelay_);
+    int lowat = network["tcp_notsent_lowat_bytes"].as<int>(tcp_notsent_lowat_bytes_);
+    float stats = network["send_stats_seconds"].as<float>(send_stats_seconds_);
+    int queued = network["max_queued_bytes_per_client"].as<int>(max_queued_bytes_per_client_);
+    float lag = network["max_client_lag_seconds"].as<float>(max_client_lag_seconds_);
+
+    if (lowat >= 0)
+        tcp_notsent_lowat_bytes_ = lowat;
+    if (stats >= 0.0f)
+        send_stats_seconds_ = stats;
+    if (queued >= 0)
+        max_queued_bytes_per_client_ = queued;
+    if (lag >= 0.0f)
+        max_client_lag_seconds_ = lag;
+
+    std::string model = network["io_model"].as<std::string>(io_model_);
+    int reactors = network["reactor_threads"].as<int>(reactor_threads_);
+    if (model == "epoll" || model == "io_uring" || model == "threads") {
+        io_model_ = model;
+    } else {
+        std::cerr << "Config: io_model desconocido '" << model << "', se usa " << io_model_
+                  << std::endl;
+    }
+    if (reactors >= 0)
+        reactor_threads_ = reactors;
+
+    udp_enabled_ = network["udp_enabled"].as<bool>(udp_enabled_);
+    int udp_port = network["udp_port"].as<int>(udp_port_);
+    if (udp_port >= 0 && udp_port <= 65535)
+        udp_port_ = udp_port;
+}
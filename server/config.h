@@ -1,6 +1,7 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <cstddef>
 #include <cstdint>
 #include <map>
 #include <string>
@@ -27,6 +28,9 @@ private:
     void load_penalties_config();
     void load_npcs_config();
     void load_car_tuning();
+    void load_server_config();
+    void load_snapshots_config();
+    void load_network_config();
 
     std::map<uint8_t, double> upgrade_penalties_;
 
@@ -60,6 +64,24 @@ private:
     float min_shield_;
     float max_shield_;
 
+    int tick_workers_;
+    int max_catch_up_steps_;
+    float profiler_dump_seconds_;
+
+    int aoi_near_radius_px_;
+    int aoi_far_radius_px_;
+    int aoi_far_update_interval_;
+
+    bool tcp_nodelay_;
+    int tcp_notsent_lowat_bytes_;
+    float send_stats_seconds_;
+    int max_queued_bytes_per_client_;
+    float max_client_lag_seconds_;
+    std::string io_model_;
+    int reactor_threads_;
+    bool udp_enabled_;
+    int udp_port_;
+
 public:
     static Config& instance() {
         static Config cfg{ResourcePaths::config() + "/config.yaml"};
@@ -103,6 +125,46 @@ public:
     float max_friction() const { return max_friction_; }
     float min_shield() const { return min_shield_; }
     float max_shield() const { return max_shield_; }
+
+    // Cantidad de workers del scheduler de ticks (0 = uno por core)
+    int tick_workers() const { return tick_workers_; }
+    // Maximo de pasos de fisica que un gameloop atrasado corre en un mismo frame
+    int max_catch_up_steps() const { return max_catch_up_steps_; }
+    // Cada cuanto cada partida imprime su profiler de ticks (0 = solo cuando se pasa de tiempo)
+    float profiler_dump_seconds() const { return profiler_dump_seconds_; }
+
+    // Filtrado por cercania de las snapshots (radio 0 = todos reciben todo)
+    uint32_t aoi_near_radius_px() const { return static_cast<uint32_t>(aoi_near_radius_px_); }
+    // NPCs mas lejos que esto no se mandan (0 = sin limite)
+    uint32_t aoi_far_radius_px() const { return static_cast<uint32_t>(aoi_far_radius_px_); }
+    // Lo que esta lejos se actualiza cada tantas snapshots
+    uint32_t aoi_far_update_interval() const {
+        return static_cast<uint32_t>(aoi_far_update_interval_);
+    }
+
+    // TCP_NODELAY en cada conexion (el sender ya junta los eventos por su cuenta)
+    bool tcp_nodelay() const { return tcp_nodelay_; }
+    // TCP_NOTSENT_LOWAT en cada conexion (0 = lo que diga el sistema)
+    int tcp_notsent_lowat_bytes() const { return tcp_notsent_lowat_bytes_; }
+    // Cada cuanto cada sender imprime syscalls/s y bytes por syscall (0 = nunca)
+    float send_stats_seconds() const { return send_stats_seconds_; }
+    // Tope de bytes de eventos sin mandar por cliente (0 = sin tope)
+    std::size_t max_queued_bytes_per_client() const {
+        return static_cast<std::size_t>(max_queued_bytes_per_client_);
+    }
+    // Si la cola de salida de un cliente no se vacia en este tiempo, se lo desconecta
+    // (0 = nunca)
+    float max_client_lag_seconds() const { return max_client_lag_seconds_; }
+    // "epoll" o "io_uring": unos pocos reactores atienden todas las conexiones. "threads": un
+    // receiver y un sender bloqueantes por cliente
+    const std::string& io_model() const { return io_model_; }
+    bool use_reactor() const { return io_model_ != "threads"; }
+    // Cuantos reactores (0 = uno por nucleo)
+    unsigned int reactor_threads() const { return static_cast<unsigned int>(reactor_threads_); }
+    // Ofrecerle a los clientes el canal UDP para snapshots e inputs
+    bool udp_enabled() const { return udp_enabled_; }
+    // Puerto del canal UDP (0 = el mismo numero que el de TCP)
+    uint16_t udp_port() const { return static_cast<uint16_t>(udp_port_); }
 };
 
 #endif  // CONFIG_H
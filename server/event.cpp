@@ -1,40 +1,193 @@
 #include "event.h"
 
+#include <algorithm>
+#include <atomic>
+#include <optional>
+
 #include "../common/ISocket.h"
 #include "conection/server_protocol.h"
 
-bool LobbySnapshotEvent::send(ISocket& skt, ServerProtocol& proto) const {
-    return proto.send_snapshot_lobby_to_client(skt, data);
+static WireBuffer make_wire(std::vector<uint8_t>&& bytes) {
+    return std::make_shared<const std::vector<uint8_t>>(std::move(bytes));
 }
 
-bool GameSnapshotEvent::send(ISocket& skt, ServerProtocol& proto) const {
-    return proto.send_snapshot_game_to_client(skt, data);
+// Buffer de un evento que es solo su opcode. Se arma una vez por opcode y se comparte
+template <uint8_t OPCODE>
+static const WireBuffer& opcode_only_wire() {
+    static const WireBuffer wire = make_wire(std::vector<uint8_t>{OPCODE});
+    return wire;
 }
 
-bool JoinErrorEvent::send(ISocket& skt, ServerProtocol& proto) const {
-    return proto.send_join_error_to_client(skt);
+const CheckpointInfo* CheckpointTable::find(int order) const {
+    if (order < 0 || static_cast<std::size_t>(order) >= index_by_order.size() ||
+        index_by_order[order] < 0) {
+        return nullptr;
+    }
+    return &checkpoints[static_cast<std::size_t>(index_by_order[order])];
 }
 
-bool StartLobbyEvent::send(ISocket& skt, ServerProtocol& proto) const {
-    return proto.send_start_lobby_to_client(skt);
+bool EncodedEvent::send(ISocket& skt, ServerProtocol& proto) const {
+    return proto.send_wire(skt, wire);
 }
 
-bool ExitJoinEvent::send(ISocket& skt, ServerProtocol& proto) const {
-    return proto.send_exit_join(skt);
+LobbySnapshotEvent::LobbySnapshotEvent(LobbySnapshotData d):
+        EncodedEvent(make_wire(ServerProtocol::encode_snapshot_lobby(d))), data(std::move(d)) {}
+
+static uint32_t next_snapshot_sequence() {
+    // Arranca en 1: el 0 en un ack significa "todavia no recibi ninguna"
+    static std::atomic<uint32_t> next{1};
+    uint32_t seq = next++;
+    if (seq == 0) {
+        seq = next++;
+    }
+    return seq;
 }
 
-bool PreGameSnapshotEvent::send(ISocket& skt, ServerProtocol& proto) const {
-    return proto.send_pre_game_snapshot_to_client(skt, data);
+GameSnapshotEvent::GameSnapshotEvent(GameSnapshotData d):
+        EncodedEvent(nullptr), sequence(next_snapshot_sequence()), data(std::move(d)) {}
+
+const WireBuffer& GameSnapshotEvent::get_wire() const {
+    std::lock_guard<std::mutex> lock(m);
+    if (!full) {
+        // Solo la piden los clientes que no manejan deltas
+        full = make_wire(ServerProtocol::encode_snapshot_game(data));
+    }
+    return full;
+}
+
+WireBuffer GameSnapshotEvent::get_keyframe_wire(bool compact) const {
+    std::lock_guard<std::mutex> lock(m);
+    if (compact) {
+        if (!compact_keyframe) {
+            compact_keyframe = make_wire(
+                    ServerProtocol::encode_snapshot_compact(data, sequence, nullptr, 0));
+        }
+        return compact_keyframe;
+    }
+    if (!keyframe) {
+        keyframe = make_wire(ServerProtocol::encode_snapshot_delta(data, sequence, nullptr, 0));
+    }
+    return keyframe;
 }
 
-bool RaceResultsEvent::send(ISocket& skt, ServerProtocol& proto) const {
-    return proto.send_race_results_to_client(skt, data);
+WireBuffer GameSnapshotEvent::get_delta_wire(const GameSnapshotEvent& baseline,
+                                             bool compact) const {
+    std::lock_guard<std::mutex> lock(m);
+    for (const auto& delta: deltas) {
+        if (delta.baseline == baseline.sequence && delta.compact == compact) {
+            return delta.bytes;
+        }
+    }
+    WireBuffer bytes = make_wire(
+            compact ? ServerProtocol::encode_snapshot_compact(data, sequence, &baseline.data,
+                                                              baseline.sequence) :
+                      ServerProtocol::encode_snapshot_delta(data, sequence, &baseline.data,
+                                                            baseline.sequence));
+    deltas.push_back(DeltaWire{baseline.sequence, compact, bytes});
+    return bytes;
+}
+
+// Los NPCs no tienen id: el de la snapshot pisada es el del mismo modelo en la misma posicion
+// de la lista o, si la lista cambio (filtrado por cercania), el mas cercano. Entre dos
+// snapshots un auto no se mueve mas que esto
+static constexpr int64_t NPC_MATCH_RADIUS_PX = 96;
+
+// Posicion en npcs del que corresponde a old, o npcs.size() si no esta
+static std::size_t find_same_npc(const std::vector<NpcSnapshot>& npcs, std::size_t index,
+                                 const NpcSnapshot& old) {
+    if (index < npcs.size() && npcs[index].model == old.model) {
+        return index;
+    }
+    std::size_t best = npcs.size();
+    int64_t best_dist = NPC_MATCH_RADIUS_PX * NPC_MATCH_RADIUS_PX;
+    for (std::size_t i = 0; i < npcs.size(); ++i) {
+        const int64_t dx = static_cast<int64_t>(npcs[i].x_px) - old.x_px;
+        const int64_t dy = static_cast<int64_t>(npcs[i].y_px) - old.y_px;
+        if (npcs[i].model == old.model && dx * dx + dy * dy <= best_dist) {
+            best = i;
+            best_dist = dx * dx + dy * dy;
+        }
+    }
+    return best;
+}
+
+std::shared_ptr<IEvent> GameSnapshotEvent::absorb_dropped(const IEvent& dropped) const {
+    const auto* old = dynamic_cast<const GameSnapshotEvent*>(&dropped);
+    if (!old) {
+        return nullptr;
+    }
+
+    // Copia recien si hay algo para rescatar: casi siempre la pisada no traia nada
+    std::optional<GameSnapshotData> merged;
+    auto copy = [&]() -> GameSnapshotData& {
+        if (!merged) {
+            merged = data;
+        }
+        return *merged;
+    };
+
+    for (const auto& p: old->data.players) {
+        if (p.animation == 0 && p.sound_code == 0) {
+            continue;
+        }
+        const auto it = std::find_if(data.players.begin(), data.players.end(),
+                                     [&](const PlayerSnapshot& n) { return n.id == p.id; });
+        if (it == data.players.end()) {
+            continue;
+        }
+        // La animacion que ya trae la nueva gana; el sonido de meta (2) le gana a la frenada
+        if ((it->animation == 0 && p.animation != 0) || it->sound_code < p.sound_code) {
+            PlayerSnapshot& n = copy().players[static_cast<std::size_t>(it - data.players.begin())];
+            if (n.animation == 0) {
+                n.animation = p.animation;
+            }
+            n.sound_code = std::max(n.sound_code, p.sound_code);
+        }
+    }
+
+    for (std::size_t i = 0; i < old->data.npcs.size(); ++i) {
+        const NpcSnapshot& o = old->data.npcs[i];
+        if (o.animation == 0) {
+            continue;
+        }
+        const std::size_t j = find_same_npc(data.npcs, i, o);
+        if (j < data.npcs.size() && data.npcs[j].animation == 0) {
+            copy().npcs[j].animation = o.animation;
+        }
+    }
+
+    if (!merged) {
+        return nullptr;
+    }
+    return std::make_shared<GameSnapshotEvent>(std::move(*merged));
 }
 
-bool RaceResultsLastEvent::send(ISocket& skt, ServerProtocol& proto) const {
-    return proto.send_race_results_last_to_client(skt, data);
+bool GameSnapshotEvent::send(ISocket& skt, ServerProtocol& proto) const {
+    return proto.send_snapshot_event(skt, shared_from_this());
 }
 
-bool PhaseChangeEvent::send(ISocket& skt, ServerProtocol& proto) const {
-    return proto.send_phase_change_to_client(skt);
+JoinErrorEvent::JoinErrorEvent(): EncodedEvent(opcode_only_wire<EVENT_LOBBY_JOIN_ERROR>()) {}
+
+StartLobbyEvent::StartLobbyEvent(): EncodedEvent(opcode_only_wire<EVENT_START_LOBBY>()) {}
+
+ExitJoinEvent::ExitJoinEvent(): EncodedEvent(opcode_only_wire<EVENT_EXIT_JOIN>()) {}
+
+PreGameSnapshotEvent::PreGameSnapshotEvent(PreGameSnapshotData d):
+        EncodedEvent(make_wire(ServerProtocol::encode_pre_game_snapshot(d))),
+        with_checkpoints(make_wire(ServerProtocol::encode_pre_game_checkpoints(d))),
+        data(std::move(d)) {}
+
+bool PreGameSnapshotEvent::send(ISocket& skt, ServerProtocol& proto) const {
+    return proto.send_pre_game_event(skt, *this);
 }
+
+RaceResultsEvent::RaceResultsEvent(RaceResultsData d):
+        EncodedEvent(make_wire(ServerProtocol::encode_race_results(d))), data(std::move(d)) {}
+
+RaceResultsLastEvent::RaceResultsLastEvent(RaceResultsData d):
+        EncodedEvent(make_wire(ServerProtocol::encode_race_results_last(d))), data(std::move(d)) {}
+
+PhaseChangeEvent::PhaseChangeEvent(): EncodedEvent(opcode_only_wire<EVENT_PHASE_CHANGE>()) {}
+
+UdpOfferEvent::UdpOfferEvent(uint16_t port, uint32_t token):
+        EncodedEvent(make_wire(ServerProtocol::encode_udp_offer(port, token))) {}
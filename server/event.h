@@ -1,8 +1,10 @@
 #ifndef EVENT_H
 #define EVENT_H
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -19,6 +21,24 @@ struct Coord {
     uint32_t y_px;
 };
 
+// Un checkpoint de la carrera: sus celdas en pixeles y si es la meta
+struct CheckpointInfo {
+    int order = 0;
+    uint8_t goal = 0x00;
+    std::vector<Coord> cells;
+};
+
+// Todos los checkpoints de la carrera. Se arma una sola vez por carrera y se comparte entre
+// las snapshots, que de cada jugador solo guardan el proximo orden
+struct CheckpointTable {
+    std::vector<CheckpointInfo> checkpoints;  // ordenados por order
+    std::vector<int> index_by_order;          // order -> posicion en checkpoints, -1 si no hay
+    int max_order = 0;
+
+    // nullptr si no hay checkpoint con ese orden
+    const CheckpointInfo* find(int order) const;
+};
+
 struct PlayerSnapshot {
     uint32_t id;
     uint8_t ghost = 0;
@@ -30,12 +50,8 @@ struct PlayerSnapshot {
     uint32_t y_px;
     uint8_t z;
     uint32_t angle;
-    std::vector<Coord> next_checkpoint;
-    // Por defecto NO hay segundo checkpoint
-    uint8_t there_is_second_checkpoint = 0;
-    std::vector<Coord> next_next_checkpoint;
-    uint8_t goal = 0x00;
-    uint8_t next_next_goal = 0x00;
+    // Orden del proximo checkpoint. Las celdas salen de la CheckpointTable de la carrera
+    uint16_t next_order = 0;
 };
 
 struct NpcSnapshot {
@@ -68,8 +84,12 @@ struct PoleCoordsAndDirec {
 
 struct GameSnapshotData {
     uint32_t time_seconds_remained = 0;
+    // Tamaño del mapa en pixeles, el formato compacto manda las posiciones relativas a esto
+    uint32_t map_width_px = 0;
+    uint32_t map_height_px = 0;
     std::vector<PlayerSnapshot> players;
     std::vector<NpcSnapshot> npcs;
+    std::shared_ptr<const CheckpointTable> checkpoints;
 };
 
 struct LobbySnapshotData {
@@ -83,6 +103,7 @@ struct PreGameSnapshotData {
     PoleCoordsAndDirec pole;
     uint32_t race_total_time_seconds;
     uint32_t race_move_enabled_time_seconds;
+    std::shared_ptr<const CheckpointTable> checkpoints;
 };
 
 struct RaceResultsData {
@@ -91,87 +112,156 @@ struct RaceResultsData {
     uint8_t podium_count = 0;
 };
 
+// Bytes ya serializados de un evento. Inmutables y compartidos: el mismo buffer se manda a
+// todos los clientes de la partida sin volver a codificarlo
+using WireBuffer = std::shared_ptr<const std::vector<uint8_t>>;
+
 class IEvent {
 public:
     virtual ~IEvent() = default;
 
     // Cada evento sabe como enviarse usando el protocolo
     virtual bool send(ISocket& skt, ServerProtocol& proto) const = 0;
+
+    // Los eventos de estado se pisan en la cola de salida: si hay uno sin mandar, el nuevo lo
+    // reemplaza. El resto se manda siempre y en orden
+    virtual bool is_latest_wins() const { return false; }
+
+    // Cuando este evento pisa a dropped (que nunca salio): una copia con lo de dropped que no se
+    // puede perder, o nullptr si alcanza con mandar este tal cual
+    virtual std::shared_ptr<IEvent> absorb_dropped(const IEvent& dropped) const {
+        (void)dropped;
+        return nullptr;
+    }
+
+    // Lo que pesa el evento mientras espera en la cola de salida (para el tope por cliente)
+    virtual std::size_t queued_bytes() const { return 0; }
 };
 
+// Evento que se serializa una sola vez, al crearse (en el hilo que lo broadcastea), y despues
+// cada Sender solo escribe los bytes
+class EncodedEvent: public IEvent {
+protected:
+    WireBuffer wire;
 
-class GameSnapshotEvent: public IEvent {
-public:
-    GameSnapshotData data;
+    explicit EncodedEvent(WireBuffer wire): wire(std::move(wire)) {}
 
-    explicit GameSnapshotEvent(GameSnapshotData d): data(std::move(d)) {}
+public:
+    virtual const WireBuffer& get_wire() const { return wire; }
 
     bool send(ISocket& skt, ServerProtocol& proto) const override;
+
+    std::size_t queued_bytes() const override { return wire ? wire->size() : 0; }
 };
 
-class LobbySnapshotEvent: public IEvent {
+
+// La snapshot de juego se manda completa (formato viejo) o como delta contra la ultima que
+// confirmo cada cliente. Todas las codificaciones se hacen a demanda y se cachean: los
+// clientes con el mismo baseline comparten el mismo buffer
+class GameSnapshotEvent: public EncodedEvent,
+                         public std::enable_shared_from_this<GameSnapshotEvent> {
+private:
+    mutable std::mutex m;
+    mutable WireBuffer full;
+    mutable WireBuffer keyframe;
+    mutable WireBuffer compact_keyframe;
+
+    struct DeltaWire {
+        uint32_t baseline;
+        bool compact;
+        WireBuffer bytes;
+    };
+    mutable std::vector<DeltaWire> deltas;
+
 public:
-    LobbySnapshotData data;
+    // Unico en todo el server, asi un ack viejo nunca coincide con una snapshot de otra carrera
+    const uint32_t sequence;
+    GameSnapshotData data;
+
+    explicit GameSnapshotEvent(GameSnapshotData d);
 
-    explicit LobbySnapshotEvent(LobbySnapshotData d): data(std::move(d)) {}
+    // Snapshot completa en el formato original (EVENT_SEND_SNAPSHOT)
+    const WireBuffer& get_wire() const override;
+
+    // Delta con todos los campos (sin baseline). compact elige EVENT_SEND_SNAPSHOT_COMPACT
+    // en vez de EVENT_SEND_SNAPSHOT_DELTA
+    WireBuffer get_keyframe_wire(bool compact) const;
+
+    // Delta solo con lo que cambio desde baseline
+    WireBuffer get_delta_wire(const GameSnapshotEvent& baseline, bool compact) const;
 
     bool send(ISocket& skt, ServerProtocol& proto) const override;
+
+    // Cada snapshot trae el estado entero, asi que una vieja sin mandar ya no sirve
+    bool is_latest_wins() const override { return true; }
+
+    // Salvo los choques y sonidos, que viajan en una sola snapshot: si la pisada los tenia y
+    // esta no, van en una copia de esta
+    std::shared_ptr<IEvent> absorb_dropped(const IEvent& dropped) const override;
 };
 
-class JoinErrorEvent: public IEvent {
+class LobbySnapshotEvent: public EncodedEvent {
 public:
-    JoinErrorEvent() = default;
+    LobbySnapshotData data;
 
-    bool send(ISocket& skt, ServerProtocol& proto) const override;
+    explicit LobbySnapshotEvent(LobbySnapshotData d);
 };
 
-class StartLobbyEvent: public IEvent {
+// Los eventos sin datos comparten un buffer estatico armado una unica vez
+class JoinErrorEvent: public EncodedEvent {
 public:
-    StartLobbyEvent() = default;
-
-    bool send(ISocket& skt, ServerProtocol& proto) const override;
+    JoinErrorEvent();
 };
 
-class ExitJoinEvent: public IEvent {
+class StartLobbyEvent: public EncodedEvent {
 public:
-    ExitJoinEvent() = default;
+    StartLobbyEvent();
+};
 
-    bool send(ISocket& skt, ServerProtocol& proto) const override;
+class ExitJoinEvent: public EncodedEvent {
+public:
+    ExitJoinEvent();
 };
 
-class PreGameSnapshotEvent: public IEvent {
+// Los clientes nuevos reciben ademas la tabla de checkpoints (EVENT_PRE_GAME_CHECKPOINTS)
+class PreGameSnapshotEvent: public EncodedEvent {
+private:
+    WireBuffer with_checkpoints;
+
 public:
     PreGameSnapshotData data;
 
-    explicit PreGameSnapshotEvent(PreGameSnapshotData d): data(std::move(d)) {}
+    explicit PreGameSnapshotEvent(PreGameSnapshotData d);
+
+    const WireBuffer& get_checkpoints_wire() const { return with_checkpoints; }
 
     bool send(ISocket& skt, ServerProtocol& proto) const override;
 };
 
-class RaceResultsEvent: public IEvent {
+class RaceResultsEvent: public EncodedEvent {
 public:
     RaceResultsData data;
 
-    explicit RaceResultsEvent(RaceResultsData d): data(std::move(d)) {}
-
-    bool send(ISocket& skt, ServerProtocol& proto) const override;
+    explicit RaceResultsEvent(RaceResultsData d);
 };
 
 // Usa la misma RaceResultsData
-class RaceResultsLastEvent: public IEvent {
+class RaceResultsLastEvent: public EncodedEvent {
 public:
     RaceResultsData data;
 
-    explicit RaceResultsLastEvent(RaceResultsData d): data(std::move(d)) {}
-
-    bool send(ISocket& skt, ServerProtocol& proto) const override;
+    explicit RaceResultsLastEvent(RaceResultsData d);
 };
 
-class PhaseChangeEvent: public IEvent {
+class PhaseChangeEvent: public EncodedEvent {
 public:
-    PhaseChangeEvent() = default;
+    PhaseChangeEvent();
+};
 
-    bool send(ISocket& skt, ServerProtocol& proto) const override;
+// Le ofrece al cliente el canal UDP: a que puerto mandar y el token para identificarse
+class UdpOfferEvent: public EncodedEvent {
+public:
+    UdpOfferEvent(uint16_t port, uint32_t token);
 };
 
 #endif  // EVENT_H
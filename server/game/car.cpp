@@ -3,6 +3,7 @@
 #include "../config.h"
 
 #include "map_loader.h"
+#include "terrain_grid.h"
 
 
 Car::Car(b2WorldId worldId, float x, float y, float angle_rad, uint16_t model_id): model(model_id) {
@@ -28,7 +29,7 @@ Car::Car(b2WorldId worldId, float x, float y, float angle_rad, uint16_t model_id
     shape.enableHitEvents = true;
 
     shape.filter.categoryBits = CAR_L0;
-    shape.filter.maskBits = CAR_L0 | WALL_L0 | NPC_L0 | SENSOR;
+    shape.filter.maskBits = CAR_L0 | WALL_L0 | NPC_L0 | ALL_SENSORS;
 
     carShapeId = b2CreatePolygonShape(body, &shape, &box);
 
@@ -58,18 +59,18 @@ void Car::update_filter() {
     if (level == 0) {
         if (npc.active) {
             f.categoryBits = NPC_L0;
-            f.maskBits = CAR_L0 | WALL_L0 | SENSOR;
+            f.maskBits = CAR_L0 | WALL_L0 | ALL_SENSORS;
         } else {
             f.categoryBits = CAR_L0;
-            f.maskBits = CAR_L0 | NPC_L0 | WALL_L0 | SENSOR;
+            f.maskBits = CAR_L0 | NPC_L0 | WALL_L0 | ALL_SENSORS;
         }
     } else {
         if (npc.active) {
             f.categoryBits = NPC_L1;
-            f.maskBits = CAR_L1 | WALL_L1 | SENSOR;
+            f.maskBits = CAR_L1 | WALL_L1 | ALL_SENSORS;
         } else {
             f.categoryBits = CAR_L1;
-            f.maskBits = CAR_L1 | NPC_L1 | WALL_L1 | SENSOR;
+            f.maskBits = CAR_L1 | NPC_L1 | WALL_L1 | ALL_SENSORS;
         }
     }
 
@@ -242,16 +243,10 @@ uint16_t Car::get_model() const { return model; }
 
 void Car::set_user_data() { b2Body_SetUserData(body, this); }
 
-// Dado el vector de celdas "lentas" detecta si el auto esta en alguna
-bool Car::is_on_slow_zone(const std::vector<Cell>& slow_cells, int height) const {
+// Consulta en la grilla si la celda donde esta el auto es "lenta"
+bool Car::is_on_slow_zone(const TerrainGrid& terrain) const {
     b2Vec2 pos = get_position();
-    int col = static_cast<int>(pos.x);
-    int row = height - 1 - static_cast<int>(pos.y);
-
-    auto it = std::find_if(slow_cells.begin(), slow_cells.end(),
-                           [col, row](const Cell& c) { return c.col == col && c.row == row; });
-
-    return it != slow_cells.end();
+    return terrain.has_at_world(pos.x, pos.y, TERRAIN_SLOW);
 }
 
 float Car::get_health() const { return health; }
@@ -301,7 +296,9 @@ int Car::get_one_destroy() const {
 
 void Car::set_layer(int z) {
 
-    if (ghost) {
+    // Cambiar el filtro de la shape no es gratis (Box2D rehace sus contactos), asi que
+    // solo lo tocamos si de verdad cambia el nivel
+    if (ghost || z == level) {
         return;
     }
 
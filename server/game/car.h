@@ -13,7 +13,7 @@
 #include "car_design.h"
 #include "categories.h"
 
-struct Cell;
+class TerrainGrid;
 
 enum class NpcDir { Right, Left, Up, Down };
 
@@ -89,6 +89,9 @@ private:
 
     int level = 0;  // 0..1
 
+    // client_id del jugador duenio del auto (-1 si es NPC)
+    int owner_id = -1;
+
     bool finished = false;
     bool god_mode = false;
     bool ghost = false;
@@ -119,7 +122,7 @@ public:
     Car(b2WorldId worldId, float x, float y, float angle_rad, uint16_t model_id);
     void apply_input(bool w, bool s, bool a, bool d, bool slow_zone);
 
-    bool is_on_slow_zone(const std::vector<Cell>& slow_cells, int height) const;
+    bool is_on_slow_zone(const TerrainGrid& terrain) const;
 
     b2Vec2 get_position() const;
     b2Rot get_rotation() const;
@@ -135,6 +138,9 @@ public:
 
     void set_user_data();
 
+    void set_owner_id(int client_id) { owner_id = client_id; }
+    int get_owner_id() const { return owner_id; }
+
     int get_one_destroy() const;
 
     void set_layer(int z);
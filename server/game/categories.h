@@ -8,9 +8,11 @@ enum MyCategories : uint32_t {
     WALL_L1 = 0x00000008,
     NPC_L0 = 0x00010000,
     NPC_L1 = 0x00200000,
-    SENSOR = 0x00000010,
+    SENSOR = 0x00000010,         // checkpoints
+    SENSOR_BRIDGE = 0x00000020,  // subidas y bajadas de los puentes
     BOTH_WALLS = WALL_L0 | WALL_L1,
-    BOTH_CARS = CAR_L0 | CAR_L1 | NPC_L0 | NPC_L1
+    BOTH_CARS = CAR_L0 | CAR_L1 | NPC_L0 | NPC_L1,
+    ALL_SENSORS = SENSOR | SENSOR_BRIDGE
 };
 
 #endif
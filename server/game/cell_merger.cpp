@@ -0,0 +1,51 @@
+#include "cell_merger.h"
+
+std::vector<CellRect> CellMerger::merge(const std::vector<int>& keys, int width, int height) {
+    std::vector<CellRect> rects;
+    std::vector<bool> used(keys.size(), false);
+
+    auto free_with_key = [&](int col, int row, int key) {
+        const std::size_t i = static_cast<std::size_t>(row) * width + col;
+        return !used[i] && keys[i] == key;
+    };
+
+    for (int row = 0; row < height; ++row) {
+        for (int col = 0; col < width; ++col) {
+            const int key = keys[static_cast<std::size_t>(row) * width + col];
+            if (key == NO_KEY || !free_with_key(col, row, key)) {
+                continue;
+            }
+
+            // Extendemos hacia la derecha
+            int cols = 1;
+            while (col + cols < width && free_with_key(col + cols, row, key)) {
+                ++cols;
+            }
+
+            // Extendemos hacia abajo mientras la fila entera tenga la misma clave
+            int rows = 1;
+            bool can_grow = true;
+            while (can_grow && row + rows < height) {
+                for (int c = col; c < col + cols; ++c) {
+                    if (!free_with_key(c, row + rows, key)) {
+                        can_grow = false;
+                        break;
+                    }
+                }
+                if (can_grow) {
+                    ++rows;
+                }
+            }
+
+            for (int r = row; r < row + rows; ++r) {
+                for (int c = col; c < col + cols; ++c) {
+                    used[static_cast<std::size_t>(r) * width + c] = true;
+                }
+            }
+
+            rects.push_back(CellRect{col, row, cols, rows, key});
+        }
+    }
+
+    return rects;
+}
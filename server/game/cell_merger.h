@@ -0,0 +1,29 @@
+#ifndef CELL_MERGER_H
+#define CELL_MERGER_H
+
+#include <vector>
+
+// Rectangulo de celdas de la grilla, en filas/columnas de la matriz del mapa
+struct CellRect {
+    int col;
+    int row;
+    int cols;
+    int rows;
+    // La clave que comparten todas las celdas del rectangulo
+    int key;
+};
+
+// Agrupa celdas vecinas con la misma clave en rectangulos lo mas grandes posibles.
+// Sirve para crear una sola shape de Box2D por rectangulo en vez de una por celda.
+class CellMerger {
+public:
+    // Las celdas con esta clave no se agrupan (no generan rectangulos)
+    static constexpr int NO_KEY = -1;
+
+    // keys tiene una clave por celda, fila por fila (keys[row * width + col]).
+    // Greedy: recorre la grilla y desde cada celda libre extiende primero hacia la
+    // derecha y despues hacia abajo, mientras las celdas tengan la misma clave.
+    static std::vector<CellRect> merge(const std::vector<int>& keys, int width, int height);
+};
+
+#endif  // CELL_MERGER_H
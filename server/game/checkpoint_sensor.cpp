@@ -1,13 +1,14 @@
 #include "checkpoint_sensor.h"
 
-CheckpointSensor::CheckpointSensor(b2ShapeId shapeId, int* orderPtr, int x, int y, bool goal):
-        shapeId(shapeId), orderPtr(orderPtr), x(x), y(y), goal(goal) {}
+CheckpointSensor::CheckpointSensor(int order, bool goal): order(order), goal(goal) {}
 
-b2ShapeId CheckpointSensor::get_shapeId() const { return shapeId; }
+void CheckpointSensor::add_cell(int x, int y) {
+    cells_px.push_back(CheckpointCellPx{static_cast<int>((x + 0.5) * PPM),
+                                        static_cast<int>((y + 0.5) * PPM)});
+}
 
-const int* CheckpointSensor::get_orderPtr() const { return orderPtr; }
-
-int CheckpointSensor::get_position_in_px_X() const { return static_cast<int>((x + 0.5) * PPM); }
-int CheckpointSensor::get_position_in_px_Y() const { return static_cast<int>((y + 0.5) * PPM); }
+int CheckpointSensor::get_order() const { return order; }
 
 bool CheckpointSensor::is_goal() const { return goal; }
+
+const std::vector<CheckpointCellPx>& CheckpointSensor::get_cells_px() const { return cells_px; }
@@ -1,36 +1,40 @@
 #ifndef CHECKPOINT_SENSOR_H
 #define CHECKPOINT_SENSOR_H
 
-#include <box2d/box2d.h>
+#include <vector>
 
+// Posicion en pixeles del centro de una celda del checkpoint, lista para el cliente
+struct CheckpointCellPx {
+    int x_px;
+    int y_px;
+};
+
+// Un checkpoint entero (todas sus celdas). En el mundo fisico es un solo body sensor
+// cuyo userData apunta a este objeto, asi lo reconocemos desde los eventos de sensor
 class CheckpointSensor {
 private:
-    // shape real en el mundo
-    b2ShapeId shapeId;
-    // puntero estable (lista) al orden del checkpoint
-    int* orderPtr;
-
-    // Celdas de la matriz
-    int x;
-    int y;
+    int order;
 
     bool goal;
 
+    // Centros de las celdas de la matriz, ya pasados a pixeles
+    std::vector<CheckpointCellPx> cells_px;
+
     static constexpr float PPM = 16.0f;  // pixels per meter
 
 public:
-    // Recive el id y el puntero a su orden al momento de crearse
-    CheckpointSensor(b2ShapeId shapeId, int* orderPtr, int x, int y, bool goal);
+    CheckpointSensor(int order, bool goal);
+
+    // Recibe la celda de la matriz (col, row)
+    void add_cell(int x, int y);
 
-    b2ShapeId get_shapeId() const;
-    const int* get_orderPtr() const;
+    int get_order() const;
 
     // Si el sensor es meta
     bool is_goal() const;
 
-    // Le devuelve ya la posicion en pixeles para el cliente
-    int get_position_in_px_X() const;
-    int get_position_in_px_Y() const;
+    // Le devuelve ya las posiciones en pixeles para el cliente
+    const std::vector<CheckpointCellPx>& get_cells_px() const;
 };
 
 #endif  // CHECKPOINT_SENSOR_H
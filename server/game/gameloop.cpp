@@ -7,8 +7,8 @@
 
 #include "../config.h"
 
-Gameloop::Gameloop(Queue<CommandReceiver>& command_queue, ClientRegistryMonitor& registry,
-                   std::vector<std::string> maps):
+Gameloop::Gameloop(MpscQueue<CommandReceiver>& command_queue, ClientRegistryMonitor& registry,
+                   std::vector<std::string> maps, int lobby_id):
         command_queue(command_queue),
         registry(registry),
         maps(std::move(maps)),
@@ -16,29 +16,38 @@ Gameloop::Gameloop(Queue<CommandReceiver>& command_queue, ClientRegistryMonitor&
         race_total_time(Config::instance().race_total_time()),
         race_countdown_time(Config::instance().race_countdown_time()),
         results_screen_seconds(Config::instance().results_screen_seconds()),
-        upgrades_screen_seconds(Config::instance().upgrades_screen_seconds()) {
+        upgrades_screen_seconds(Config::instance().upgrades_screen_seconds()),
+        max_catch_up_steps(Config::instance().max_catch_up_steps()),
+        profiler("lobby " + std::to_string(lobby_id),
+                 std::chrono::duration_cast<TickClock::duration>(
+                         std::chrono::duration<double>(race->get_time_step())),
+                 std::chrono::duration_cast<TickClock::duration>(std::chrono::duration<double>(
+                         Config::instance().profiler_dump_seconds()))) {
     race_with_countdown = race_total_time;
     results_time_remaining = results_screen_seconds;
     time_each_result_snapshot = results_screen_seconds / 4;
 }
 
 void Gameloop::receive_commands() {
-    CommandReceiver cmd;
-    while (command_queue.try_pop(cmd)) {
-        if (cmd.type == CommandReceiverType::Move) {
-            receive_command_move(cmd);
-        } else if (cmd.type == CommandReceiverType::NewCar) {
-            receive_new_car(cmd);
-        } else if (cmd.type == CommandReceiverType::BeginRace) {
-            begin_race();
-        } else if (cmd.type == CommandReceiverType::Upgrade) {
-            upgrade_car(cmd);
-        } else if (cmd.type == CommandReceiverType::Disconect) {
-            disconect_car(cmd);
-        } else {
-            throw ServerError(
-                    "Gameloop::receive_commands: Unknown command type received in gameloop");
-        }
+    // Todo lo que llego desde el tick anterior, de una sola pasada y sin locks
+    command_queue.drain([this](CommandReceiver& cmd) { handle_command(cmd); });
+}
+
+void Gameloop::handle_command(CommandReceiver& cmd) {
+    if (cmd.type == CommandReceiverType::InputState) {
+        receive_input_state(cmd);
+    } else if (cmd.type == CommandReceiverType::Move) {
+        receive_command_move(cmd);
+    } else if (cmd.type == CommandReceiverType::NewCar) {
+        receive_new_car(cmd);
+    } else if (cmd.type == CommandReceiverType::BeginRace) {
+        begin_race();
+    } else if (cmd.type == CommandReceiverType::Upgrade) {
+        upgrade_car(cmd);
+    } else if (cmd.type == CommandReceiverType::Disconect) {
+        disconect_car(cmd);
+    } else {
+        throw ServerError("Gameloop::receive_commands: Unknown command type received in gameloop");
     }
 }
 
@@ -48,8 +57,16 @@ void Gameloop::receive_command_move(const CommandReceiver& cmd) {
     }
 }
 
-void Gameloop::receive_new_car(const CommandReceiver& cmd) {
-    players[cmd.client_id].name = cmd.name;
+void Gameloop::receive_input_state(const CommandReceiver& cmd) {
+    // Si en un tick llegan varios estados del mismo cliente, cada uno pisa al anterior: a la
+    // fisica le llega solo el ultimo
+    if (state == RaceState::Running) {
+        race->receive_input_state(cmd);
+    }
+}
+
+void Gameloop::receive_new_car(CommandReceiver& cmd) {
+    players[cmd.client_id].name = std::move(cmd.name);
     race->spawn_car_for_player(cmd.client_id, static_cast<uint16_t>(cmd.param));
 }
 
@@ -129,11 +146,11 @@ void Gameloop::create_new_race(const std::map<int, Car>& cars) {
 
     state = RaceState::ShowingResults;
 
-    race = std::make_unique<RaceContext>(maps[current_map_index], registry);
-
-    for (const auto& [client_id, model]: player_models) {
-        race->spawn_car_for_player(client_id, model);
-    }
+    // La proxima carrera se arma en otro hilo mientras se muestran resultados y mejoras,
+    // asi no frenamos los ticks de la lobby. La actual sigue viva hasta start_new_map
+    next_race = std::make_unique<RacePreparer>(maps[current_map_index], registry,
+                                               std::move(player_models));
+    next_race->start();
 
     // Limpiamos estructura para las mejoras de los jugadores
     for (auto& [client_id, player]: players) {
@@ -147,6 +164,8 @@ void Gameloop::race_finished() {
         return;
     }
 
+    log_timing_stats();
+
     auto& cars = race->get_cars();
     auto& rp_map = race->get_race_progress();
     std::vector<PlayerRaceResult> results;
@@ -237,7 +256,31 @@ void Gameloop::update_state_waiting_upgrades(double dt) {
     }
 }
 
+void Gameloop::swap_in_next_race() {
+    if (!next_race) {
+        return;
+    }
+    std::unique_ptr<RacePreparer> preparer = std::move(next_race);
+
+    using clock = std::chrono::steady_clock;
+    const auto t0 = clock::now();
+    std::unique_ptr<RaceContext> prepared = preparer->take();
+    // Cuanto tardo en armarse y cuanto tuvo que esperarla el gameloop (si no llego a terminar
+    // antes de start_new_map). Quedan en los dumps del profiler de la partida
+    const double stall_ms = std::chrono::duration<double, std::milli>(clock::now() - t0).count();
+    const double preparation_ms = preparer->get_preparation_ms();
+    profiler.record_race_preparation(preparation_ms, stall_ms);
+
+    std::cout << "Gameloop: carrera " << preparer->get_map_path() << " preparada en "
+              << preparation_ms << " ms (espera del gameloop: " << stall_ms << " ms)\n";
+
+    race = std::move(prepared);
+}
+
 void Gameloop::start_new_map() {
+    // La carrera que se venia armando en segundo plano pasa a ser la actual
+    swap_in_next_race();
+
     // Antes de arrancar la nueva carrera (los autos ya han sido creados en el nuevo
     // mapa) los mejoramos con TODAS las mejoras que tuvieron hasta ahora!
     for (auto& [client_id, player]: players) {
@@ -256,6 +299,13 @@ void Gameloop::start_new_map() {
     }
 }
 
+Gameloop::~Gameloop() {
+    // Si la partida termina mientras se armaba la proxima carrera, la esperamos
+    if (next_race) {
+        next_race->join();
+    }
+}
+
 void Gameloop::update_state_showing_resultes_last_race(double dt) {
     results_time_remaining -= dt;
     actual_result_time += dt;
@@ -295,78 +345,131 @@ void Gameloop::update_state(double dt) {
 }
 
 void Gameloop::step_simulation(double& acumulate, double delta_time) {
-    // Si nos atrasamos nos ponemos al dia
-    while (acumulate >= delta_time) {
+    // Si nos atrasamos nos ponemos al dia, pero con tope: si un frame se trabo no queremos
+    // correr cientos de pasos seguidos (que a su vez atrasan el proximo frame)
+    int steps = 0;
+    while (acumulate >= delta_time && steps < max_catch_up_steps) {
         if (state == RaceState::Running) {
 
             if ((race_total_time - race_with_countdown) >= race_countdown_time) {
+                TickProfiler::Scope measure(profiler, TickPhase::UpdateNpcs);
                 race->update_npcs();
             }
 
             // Aplicar inputs (estado "keys" -> fuerzas/torques del auto)
-            race->apply_player_inputs();
+            {
+                TickProfiler::Scope measure(profiler, TickPhase::ApplyInputs);
+                race->apply_player_inputs();
+            }
 
             // Avanzar la física exactamente delta_time, con substeps para estabilidad
-            race->step_physics();
+            {
+                TickProfiler::Scope measure(profiler, TickPhase::StepPhysics);
+                race->step_physics();
+            }
 
+            TickProfiler::Scope measure(profiler, TickPhase::RaceAndContacts);
             double race_with_countdown_actual = race_with_countdown;
             race->handle_race_and_contacts(race_with_countdown_actual);
         }
         acumulate -= delta_time;
+        steps++;
+    }
+
+    // Lo que no llegamos a simular se descarta
+    if (acumulate >= delta_time) {
+        const auto dropped = static_cast<uint64_t>(acumulate / delta_time);
+        skipped_steps += dropped;
+        acumulate -= static_cast<double>(dropped) * delta_time;
     }
 }
 
 void Gameloop::send_snapshots(double& snapshot_acumulate, float snapshot_interval) {
-    // Si nos atrasamos nos ponemos al dia
-    while (snapshot_acumulate >= snapshot_interval) {
-        if (state == RaceState::Running) {
-            race->send_snapshot(snapshot_acumulate, snapshot_interval, race_with_countdown);
-        } else {
-            snapshot_acumulate -= snapshot_interval;
-        }
+    if (snapshot_acumulate < snapshot_interval) {
+        return;
+    }
+
+    // Si nos atrasamos solo mandamos la snapshot mas nueva: las intermedias serian todas
+    // iguales (la fisica no avanzo entre ellas) y solo llenarian las colas de los clientes
+    const auto pending = static_cast<uint64_t>(snapshot_acumulate / snapshot_interval);
+    if (pending > 1) {
+        skipped_snapshots += pending - 1;
+        snapshot_acumulate -= static_cast<double>(pending - 1) * snapshot_interval;
+    }
+
+    if (state == RaceState::Running) {
+        race->send_snapshot(snapshot_acumulate, snapshot_interval, race_with_countdown,
+                            profiler);
+    } else {
+        snapshot_acumulate -= snapshot_interval;
     }
 }
 
-void Gameloop::run() {
-    try {
+void Gameloop::run_frame() {
+    const float delta_time = race->get_time_step();
 
-        using clock = std::chrono::steady_clock;
-        const float delta_time = race->get_time_step();
+    const auto frame_start = TickClock::now();
+    if (!started) {
+        t0 = frame_start;
+        started = true;
+    }
 
-        auto t0 = clock::now();
-        double acumulate = 0.0;
-        double snapshot_acumulate = 0.0;
+    {
+        TickProfiler::Scope measure(profiler, TickPhase::ReceiveCommands);
+        receive_commands();
+    }
 
-        const auto frame_duration = std::chrono::duration<double>(delta_time);
+    const auto now = TickClock::now();
+    std::chrono::duration<double> dt = now - t0;
+    t0 = now;
+    acumulate += dt.count();
+    snapshot_acumulate += dt.count();
 
-        while (should_keep_running()) {
-            auto frame_start = clock::now();
+    update_state(dt.count());
+    step_simulation(acumulate, delta_time);
+    send_snapshots(snapshot_acumulate, delta_time);
 
-            receive_commands();
+    profiler.end_tick(TickClock::now() - frame_start);
+}
 
-            auto now = clock::now();
-            std::chrono::duration<double> dt = now - t0;
-            t0 = now;
-            acumulate += dt.count();
-            snapshot_acumulate += dt.count();
+void Gameloop::log_timing_stats() const {
+    const double max_late_ms =
+            std::chrono::duration<double, std::milli>(get_max_lateness()).count();
+    std::cout << "Gameloop: ticks tarde " << get_late_ticks() << ", atraso maximo " << max_late_ms
+              << " ms, pasos descartados " << skipped_steps << ", snapshots descartadas "
+              << skipped_snapshots << "\n";
+}
 
-            update_state(dt.count());
-            step_simulation(acumulate, delta_time);
-            send_snapshots(snapshot_acumulate, delta_time);
+TickClock::duration Gameloop::tick_period() const {
+    return std::chrono::duration_cast<TickClock::duration>(
+            std::chrono::duration<double>(race->get_time_step()));
+}
 
-            auto frame_end = clock::now();
-            auto elapsed = frame_end - frame_start;
+void Gameloop::close_command_queue() {
+    try {
+        command_queue.close();
+    } catch (...) {
+        // Ya estaba cerrada (termino la ultima carrera o Game::stop)
+    }
+}
 
-            if (elapsed < frame_duration) {
-                std::this_thread::sleep_for(frame_duration - elapsed);
-            }
-        }
+bool Gameloop::tick() {
+    if (!should_keep_running()) {
+        close_command_queue();
+        return false;
+    }
+    try {
+        run_frame();
+        return true;
 
     } catch (const ClosedQueue&) {
-        // Si la cola de comandos se cerro, salimos del gameloop
+        // Si la cola de comandos se cerro, termina la partida
     } catch (const std::exception& e) {
         std::cerr << "Gameloop exception: " << e.what() << "\n";
     } catch (...) {
         std::cerr << "Gameloop unknown exception\n";
     }
+    close_command_queue();
+    log_timing_stats();
+    return false;
 }
@@ -12,8 +12,7 @@
 
 #include <stdio.h>
 
-#include "../../common/queue.h"
-#include "../../common/thread.h"
+#include "../../common/mpsc_queue.h"
 #include "../command.h"
 #include "../conection/client_registry.h"
 #include "../server_error.h"
@@ -21,9 +20,12 @@
 #include "car.h"
 #include "physic_world.h"
 #include "race_context.h"
+#include "race_preparer.h"
 #include "race_progress.h"
 #include "race_system.h"
 #include "snapshot_builder.h"
+#include "tick_profiler.h"
+#include "tick_scheduler.h"
 #include "world_state.h"
 
 enum class RaceState {
@@ -48,9 +50,11 @@ struct PlayerSession {
     int races_finished = 0;
 };
 
-class Gameloop: public Thread {
+// Cada partida tiene un gameloop, pero ya no un hilo propio: el TickScheduler del server
+// llama a tick() una vez por frame desde su pool de workers
+class Gameloop: public TickTask {
 private:
-    Queue<CommandReceiver>& command_queue;
+    MpscQueue<CommandReceiver>& command_queue;
     ClientRegistryMonitor& registry;
     std::vector<std::string> maps;
     std::size_t current_map_index{0};
@@ -58,6 +62,10 @@ private:
     // Contexto de la carrera actual
     std::unique_ptr<RaceContext> race;
 
+    // Proxima carrera, que se arma en otro hilo mientras se muestran resultados y mejoras.
+    // Se intercambia con race en start_new_map
+    std::unique_ptr<RacePreparer> next_race;
+
     // Estado inicial del gameloop.
     RaceState state{RaceState::WaitingForLobbyStart};
 
@@ -75,9 +83,12 @@ private:
 
     // Procesa todos los comandos disponibles en la cola
     void receive_commands();
+    void handle_command(CommandReceiver& cmd);
     void receive_command_move(const CommandReceiver& cmd);
+    void receive_input_state(const CommandReceiver& cmd);
     void upgrade_car(const CommandReceiver& cmd);
-    void receive_new_car(const CommandReceiver& cmd);
+    // Se queda con el nombre del comando (lo mueve)
+    void receive_new_car(CommandReceiver& cmd);
     void disconect_car(const CommandReceiver& cmd);
     void begin_race();
 
@@ -86,6 +97,7 @@ private:
     void update_state_showing_results(double dt);
     void update_state_choosing_upgrades(double dt);
     void update_state_waiting_upgrades(double dt);
+    void swap_in_next_race();
     void start_new_map();
     void update_state_showing_resultes_last_race(double dt);
     void send_pre_game_snapshot();
@@ -104,17 +116,42 @@ private:
     // Mapea id del cliente con su informacion en la partida
     std::map<int, PlayerSession> players;
 
+    // Estado que antes vivia en las variables locales de run()
+    bool started = false;
+    TickClock::time_point t0;
+    double acumulate = 0.0;
+    double snapshot_acumulate = 0.0;
+    int max_catch_up_steps;
+
+    // Pasos de fisica y snapshots descartados por estar atrasados
+    uint64_t skipped_steps = 0;
+    uint64_t skipped_snapshots = 0;
+
+    // Tiempos por fase de cada tick
+    TickProfiler profiler;
+
     void update_state(double dt);
     void step_simulation(double& acumulate, double delta_time);
     void send_snapshots(double& snapshot_acumulate, float snapshot_interval);
+    void run_frame();
+    void log_timing_stats() const;
+
+    // Cuando el loop termina (bien o por una excepcion): nadie mas va a sacar comandos, asi que
+    // los que pushean tienen que enterarse en vez de llenar la cola
+    void close_command_queue();
 
 public:
-    Gameloop(Queue<CommandReceiver>& command_queue, ClientRegistryMonitor& registry,
-             std::vector<std::string> maps);
+    Gameloop(MpscQueue<CommandReceiver>& command_queue, ClientRegistryMonitor& registry,
+             std::vector<std::string> maps, int lobby_id);
+
+    // Corre un frame. Devuelve false cuando la partida termino (o se cerro la cola de comandos)
+    bool tick() override;
+    TickClock::duration tick_period() const override;
 
-    void run() override;
+    uint64_t get_skipped_steps() const { return skipped_steps; }
+    uint64_t get_skipped_snapshots() const { return skipped_snapshots; }
 
-    ~Gameloop() override = default;
+    ~Gameloop() override;
     Gameloop(const Gameloop&) = delete;
     Gameloop& operator=(const Gameloop&) = delete;
 };
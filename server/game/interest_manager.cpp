@@ -0,0 +1,184 @@
+#include "interest_manager.h"
+
+#include <algorithm>
+#include <numeric>
+#include <set>
+
+static bool within(uint32_t ax, uint32_t ay, uint32_t bx, uint32_t by, uint32_t radius) {
+    const int64_t dx = static_cast<int64_t>(ax) - bx;
+    const int64_t dy = static_cast<int64_t>(ay) - by;
+    return dx * dx + dy * dy <= static_cast<int64_t>(radius) * radius;
+}
+
+int InterestGrid::cell_col(uint32_t x_px) const {
+    return std::min(cols - 1, static_cast<int>(x_px / cell_px));
+}
+
+int InterestGrid::cell_row(uint32_t y_px) const {
+    return std::min(rows - 1, static_cast<int>(y_px / cell_px));
+}
+
+void InterestGrid::rebuild(const std::vector<NpcSnapshot>& npcs, uint32_t width_px,
+                           uint32_t height_px, uint32_t cell) {
+    cell_px = std::max<uint32_t>(1, cell);
+    cols = std::max(1, static_cast<int>((width_px + cell_px - 1) / cell_px));
+    rows = std::max(1, static_cast<int>((height_px + cell_px - 1) / cell_px));
+
+    const std::size_t cells = static_cast<std::size_t>(cols) * rows;
+    cell_start.assign(cells + 1, 0);
+
+    // Contamos cuantos caen en cada celda y acumulamos: cell_start[c] queda en el fin de c
+    for (const auto& npc: npcs) {
+        cell_start[static_cast<std::size_t>(cell_row(npc.y_px)) * cols + cell_col(npc.x_px)]++;
+    }
+    std::partial_sum(cell_start.begin(), cell_start.end() - 1, cell_start.begin());
+    cell_start[cells] = static_cast<uint32_t>(npcs.size());
+
+    // Llenando de atras para adelante cada cell_start[c] termina en el inicio de c, y dentro de
+    // la celda los indices quedan ordenados
+    entries.resize(npcs.size());
+    for (std::size_t i = npcs.size(); i-- > 0;) {
+        const auto c = static_cast<std::size_t>(cell_row(npcs[i].y_px)) * cols +
+                       cell_col(npcs[i].x_px);
+        entries[--cell_start[c]] = static_cast<uint32_t>(i);
+    }
+}
+
+void InterestGrid::query(const std::vector<NpcSnapshot>& npcs, uint32_t x_px, uint32_t y_px,
+                         uint32_t radius_px, std::vector<uint32_t>& out) const {
+    const std::size_t first = out.size();
+
+    const int col_min = cell_col(x_px > radius_px ? x_px - radius_px : 0);
+    const int col_max = cell_col(x_px + radius_px);
+    const int row_min = cell_row(y_px > radius_px ? y_px - radius_px : 0);
+    const int row_max = cell_row(y_px + radius_px);
+
+    for (int row = row_min; row <= row_max; ++row) {
+        for (int col = col_min; col <= col_max; ++col) {
+            const std::size_t c = static_cast<std::size_t>(row) * cols + col;
+            for (uint32_t e = cell_start[c]; e < cell_start[c + 1]; ++e) {
+                const NpcSnapshot& npc = npcs[entries[e]];
+                if (within(npc.x_px, npc.y_px, x_px, y_px, radius_px)) {
+                    out.push_back(entries[e]);
+                }
+            }
+        }
+    }
+    std::sort(out.begin() + static_cast<std::ptrdiff_t>(first), out.end());
+}
+
+InterestManager::InterestManager(uint32_t near_radius_px, uint32_t far_radius_px,
+                                 uint32_t far_update_interval):
+        near_radius_px(near_radius_px),
+        // Un radio lejano mas chico que el cercano no tiene sentido
+        far_radius_px(far_radius_px == 0 ? 0 : std::max(far_radius_px, near_radius_px)),
+        far_update_interval(std::max<uint32_t>(1, far_update_interval)) {}
+
+bool InterestManager::refresh_turn(uint32_t key) const {
+    return (snapshot_count + key) % far_update_interval == 0;
+}
+
+void InterestManager::begin_snapshot(const GameSnapshotData& full) {
+    snapshot_count++;
+    grid.rebuild(full.npcs, full.map_width_px, full.map_height_px, near_radius_px);
+}
+
+bool InterestManager::build_view(int client_id, const GameSnapshotData& full,
+                                 GameSnapshotData& view) {
+    const auto me = std::find_if(full.players.begin(), full.players.end(),
+                                 [&](const PlayerSnapshot& p) {
+                                     return p.id == static_cast<uint32_t>(client_id);
+                                 });
+    if (me == full.players.end()) {
+        return false;
+    }
+
+    const ClientView& prev = last_views[client_id];
+
+    ClientView next;
+    next.data.time_seconds_remained = full.time_seconds_remained;
+    next.data.map_width_px = full.map_width_px;
+    next.data.map_height_px = full.map_height_px;
+    next.data.checkpoints = full.checkpoints;
+
+    // Si no hubo que sacar ni repetir nada, la vista es la completa
+    bool same_as_full = true;
+
+    next.data.players.reserve(full.players.size());
+    for (const auto& p: full.players) {
+        if (&p == &*me || within(p.x_px, p.y_px, me->x_px, me->y_px, near_radius_px)) {
+            next.data.players.push_back(p);
+            continue;
+        }
+
+        const auto old = std::find_if(prev.data.players.begin(), prev.data.players.end(),
+                                      [&](const PlayerSnapshot& o) { return o.id == p.id; });
+        const bool fresh = refresh_turn(p.id) || old == prev.data.players.end();
+        PlayerSnapshot far = fresh ? p : *old;
+        // Los sonidos son de un solo frame y de lejos no se escuchan
+        far.sound_code = 0;
+        // El choque tambien es de un solo frame: si repetimos el viejo, no se vuelve a mandar
+        if (!fresh) {
+            far.animation = 0;
+        }
+        same_as_full = same_as_full && fresh && p.sound_code == 0;
+        next.data.players.push_back(std::move(far));
+    }
+
+    near_npcs.clear();
+    grid.query(full.npcs, me->x_px, me->y_px, near_radius_px, near_npcs);
+
+    far_npcs.clear();
+    if (far_radius_px > 0) {
+        grid.query(full.npcs, me->x_px, me->y_px, far_radius_px, far_npcs);
+    } else {
+        far_npcs.resize(full.npcs.size());
+        std::iota(far_npcs.begin(), far_npcs.end(), 0);
+    }
+    same_as_full = same_as_full && far_npcs.size() == full.npcs.size();
+
+    // far_npcs incluye a los cercanos; los dos estan ordenados por indice
+    next.data.npcs.reserve(far_npcs.size());
+    next.npc_indices.reserve(far_npcs.size());
+    auto near_it = near_npcs.begin();
+    for (uint32_t idx: far_npcs) {
+        while (near_it != near_npcs.end() && *near_it < idx) {
+            ++near_it;
+        }
+        const bool is_near = (near_it != near_npcs.end() && *near_it == idx);
+
+        NpcSnapshot npc = full.npcs[idx];
+        if (!is_near && !refresh_turn(idx)) {
+            const auto old =
+                    std::lower_bound(prev.npc_indices.begin(), prev.npc_indices.end(), idx);
+            if (old != prev.npc_indices.end() && *old == idx) {
+                npc = prev.data.npcs[static_cast<std::size_t>(old - prev.npc_indices.begin())];
+                // Igual que con los autos: el choque viejo ya se mando
+                npc.animation = 0;
+                same_as_full = false;
+            }
+        }
+        next.data.npcs.push_back(npc);
+        next.npc_indices.push_back(idx);
+    }
+
+    // La guardamos igual: de aca salen los lejanos repetidos de la proxima
+    ClientView& stored = last_views[client_id];
+    stored = std::move(next);
+    if (same_as_full) {
+        return false;
+    }
+    view = stored.data;
+    return true;
+}
+
+void InterestManager::retain(const std::vector<int>& client_ids) {
+    const std::set<int> alive(client_ids.begin(), client_ids.end());
+    for (auto it = last_views.begin(); it != last_views.end();) {
+        if (alive.count(it->first) == 0) {
+            it = last_views.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef INTEREST_MANAGER_H
+#define INTEREST_MANAGER_H
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "../event.h"
+
+// Grilla uniforme sobre el mapa con los NPCs de una snapshot, para encontrar rapido los que
+// estan cerca de un punto. Se rearma en cada snapshot con un counting sort por celda; una vez
+// que los vectores llegaron a su tamaño no vuelve a pedir memoria
+class InterestGrid {
+private:
+    uint32_t cell_px = 1;
+    int cols = 0;
+    int rows = 0;
+
+    // Los NPCs de la celda c son entries[cell_start[c] .. cell_start[c + 1])
+    std::vector<uint32_t> cell_start;
+    std::vector<uint32_t> entries;
+
+    int cell_col(uint32_t x_px) const;
+    int cell_row(uint32_t y_px) const;
+
+public:
+    void rebuild(const std::vector<NpcSnapshot>& npcs, uint32_t width_px, uint32_t height_px,
+                 uint32_t cell_px);
+
+    // Agrega a out los indices de los NPCs a menos de radius px de (x_px, y_px), ordenados
+    void query(const std::vector<NpcSnapshot>& npcs, uint32_t x_px, uint32_t y_px,
+               uint32_t radius_px, std::vector<uint32_t>& out) const;
+};
+
+// Decide que va en la snapshot de cada cliente segun donde esta su auto:
+//  - cerca (near_radius): NPCs y autos en todas las snapshots
+//  - lejos: solo cada far_update_interval snapshots; en el resto se repite lo ultimo que se le
+//    mando a ese cliente, que en las deltas no ocupa nada
+//  - mas alla de far_radius (si no es 0): los NPCs no van. Los autos van siempre, el cliente
+//    los necesita para el minimapa y las posiciones
+// Cada vista es un GameSnapshotEvent aparte que se codifica para un solo cliente, asi que el
+// filtrado cambia el encode-once por bytes; los que terminan viendo todo comparten la completa
+class InterestManager {
+private:
+    uint32_t near_radius_px;
+    uint32_t far_radius_px;
+    uint32_t far_update_interval;
+
+    uint64_t snapshot_count = 0;
+    InterestGrid grid;
+
+    // Lo ultimo que se armo para cada cliente, de donde salen los lejanos que no tocan
+    struct ClientView {
+        GameSnapshotData data;
+        std::vector<uint32_t> npc_indices;  // indice en la snapshot completa de cada npc
+    };
+    std::map<int, ClientView> last_views;
+
+    std::vector<uint32_t> near_npcs;
+    std::vector<uint32_t> far_npcs;
+
+    // Los lejanos se refrescan escalonados, no todos en la misma snapshot
+    bool refresh_turn(uint32_t key) const;
+
+public:
+    InterestManager(uint32_t near_radius_px, uint32_t far_radius_px,
+                    uint32_t far_update_interval);
+
+    // near_radius 0 = sin filtrado, todos reciben la snapshot completa
+    bool enabled() const { return near_radius_px > 0; }
+
+    // Arma la grilla con los NPCs de la snapshot completa. Una vez por snapshot
+    void begin_snapshot(const GameSnapshotData& full);
+
+    // Arma en view la snapshot para el cliente client_id. Devuelve false si tiene que recibir
+    // la completa (no tiene auto, o lo que le toca es igual a la completa)
+    bool build_view(int client_id, const GameSnapshotData& full, GameSnapshotData& view);
+
+    // Olvida las vistas de los clientes que ya no estan
+    void retain(const std::vector<int>& client_ids);
+};
+
+#endif  // INTEREST_MANAGER_H
@@ -0,0 +1,135 @@
+#include "map_asset.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+MapAsset::MapAsset(MapFileData&& data):
+        base_map(std::move(data.base_map)),
+        terrain(data.width, data.height, std::move(data.grid)) {
+    load_tables(data);
+}
+
+MapAsset::MapAsset(std::shared_ptr<const MappedMapFile> file):
+        base_map(file->data().base_map),
+        terrain(file->data().width, file->data().height, file->grid(), file) {
+    load_tables(file->data());
+}
+
+void MapAsset::load_tables(const MapFileData& data) {
+    for (const auto& cp: data.checkpoints) {
+        CheckpointDef def;
+        def.order = cp.order;
+        def.goal = cp.goal;
+        for (const auto& c: cp.cells) {
+            def.cells.push_back(Cell{c.col, c.row});
+        }
+        checkpoints.push_back(std::move(def));
+    }
+
+    for (const auto& c: data.pole_cells) {
+        pole_cells.push_back(PoleCell{c.col, c.row});
+    }
+
+    if (data.pole_direction < DERECHA || data.pole_direction > ABAJO) {
+        throw std::runtime_error("MapAsset: La direccion de pole de salida es incorrecta");
+    }
+    pole_direction = data.pole_direction;
+
+    auto to_npc_spawns = [](const std::vector<MapFileNpcSpawn>& in) {
+        std::vector<NpcSpawnDef> out;
+        for (const auto& s: in) {
+            if (s.dir > static_cast<uint8_t>(NpcDir::Down)) {
+                throw std::runtime_error("MapAsset: direccion de NPC invalida");
+            }
+            out.push_back(NpcSpawnDef{s.col, s.row, static_cast<NpcDir>(s.dir)});
+        }
+        return out;
+    };
+    npc_spawns = to_npc_spawns(data.npc_spawns);
+    npc_spawns_park = to_npc_spawns(data.npc_spawns_park);
+}
+
+std::shared_ptr<const MapAsset> MapAssetCache::load(const std::string& path) {
+    const std::string binary_path = MapFile::binary_path_for(path);
+
+    // Si falla cualquiera de las dos fechas no podemos saber si el binario esta al dia
+    std::error_code json_ec;
+    std::error_code binary_ec;
+    const auto json_mtime = std::filesystem::last_write_time(path, json_ec);
+    const auto binary_mtime = std::filesystem::last_write_time(binary_path, binary_ec);
+    if (!json_ec && !binary_ec && binary_mtime >= json_mtime) {
+        try {
+            return std::make_shared<const MapAsset>(std::make_shared<const MappedMapFile>(binary_path));
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << ", se usa el json" << std::endl;
+        }
+    }
+
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("MapAsset: No se puede abrir el archivo " + path);
+    }
+    nlohmann::json j;
+    file >> j;
+    MapFileData data = MapFile::from_json(j);
+
+    // Convertimos los mapas viejos la primera vez que se usan
+    try {
+        MapFile::write(binary_path, data);
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+    }
+
+    return std::make_shared<const MapAsset>(std::move(data));
+}
+
+MapAssetCache& MapAssetCache::instance() {
+    static MapAssetCache cache;
+    return cache;
+}
+
+std::shared_ptr<const MapAsset> MapAssetCache::get(const std::string& path) {
+    std::error_code ec;
+    const auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec) {
+        throw std::runtime_error("MapAsset: No se puede abrir el archivo " + path);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = assets.find(path);
+        if (it != assets.end() && it->second.mtime == mtime) {
+            return it->second.asset;
+        }
+    }
+
+    // Parseamos sin tener el lock del cache, asi otros lobbies con mapas ya cargados no
+    // esperan. Pero un mismo mapa lo carga (y lo convierte) un solo hilo a la vez: los demas
+    // esperan y se llevan el que quedo en el cache
+    std::shared_ptr<std::mutex> load_lock;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& slot = load_locks[path];
+        if (!slot) {
+            slot = std::make_shared<std::mutex>();
+        }
+        load_lock = slot;
+    }
+    std::lock_guard<std::mutex> loading(*load_lock);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = assets.find(path);
+        if (it != assets.end() && it->second.mtime == mtime) {
+            return it->second.asset;
+        }
+    }
+
+    auto asset = load(path);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    assets[path] = Entry{mtime, asset};
+    return asset;
+}
@@ -0,0 +1,110 @@
+#ifndef MAP_ASSET_H
+#define MAP_ASSET_H
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../../common/map_file.h"
+
+#include "car.h"
+#include "pole.h"
+#include "terrain_grid.h"
+
+struct Cell {
+    int col;
+    int row;
+};
+
+// Cada checkpoint va a tener varias celdas de sensores
+// Y el orden es con el que hay que ir pasando los checkpoints
+struct CheckpointDef {
+    int order;
+    std::vector<Cell> cells;
+    bool goal = false;
+};
+
+struct NpcSpawnDef {
+    int col;
+    int row;
+    NpcDir dir;
+};
+
+// Todo lo que sale de parsear el json de un mapa. Una vez construido no cambia,
+// asi que lo pueden compartir todos los lobbies que corren ese mapa a la vez
+class MapAsset {
+private:
+    std::string base_map;
+
+    // Grilla del mapa, con los atributos de cada celda (incluye las zonas lentas)
+    TerrainGrid terrain;
+
+    // Todos los checkpoints de un mapa, ordenados por "order". La meta va al final
+    std::vector<CheckpointDef> checkpoints;
+
+    // Linea de largada de los jugadores
+    std::vector<PoleCell> pole_cells;
+    uint8_t pole_direction = DERECHA;
+
+    std::vector<NpcSpawnDef> npc_spawns;
+    std::vector<NpcSpawnDef> npc_spawns_park;
+
+    // Pasa las tablas del formato de archivo a los tipos del server
+    void load_tables(const MapFileData& data);
+
+public:
+    // Mapa leido del json (la grilla se mueve adentro del asset)
+    explicit MapAsset(MapFileData&& data);
+
+    // Mapa leido de un .n4smap mapeado: la grilla se lee directo del archivo
+    explicit MapAsset(std::shared_ptr<const MappedMapFile> file);
+
+    const std::string& get_base_map() const { return base_map; }
+    const TerrainGrid& get_terrain() const { return terrain; }
+    const std::vector<CheckpointDef>& get_checkpoints() const { return checkpoints; }
+    const std::vector<PoleCell>& get_pole_cells() const { return pole_cells; }
+    uint8_t get_pole_direction() const { return pole_direction; }
+    const std::vector<NpcSpawnDef>& get_npc_spawns() const { return npc_spawns; }
+    const std::vector<NpcSpawnDef>& get_npc_spawns_park() const { return npc_spawns_park; }
+
+    MapAsset(const MapAsset&) = delete;
+    MapAsset& operator=(const MapAsset&) = delete;
+};
+
+// Cache de todo el proceso con los mapas ya parseados, por path.
+// Si el archivo cambia (otra fecha de modificacion) se vuelve a parsear.
+// La memoria crece con la cantidad de mapas distintos, no con la cantidad de lobbies
+class MapAssetCache {
+private:
+    struct Entry {
+        std::filesystem::file_time_type mtime;
+        std::shared_ptr<const MapAsset> asset;
+    };
+
+    std::mutex mutex;
+    std::map<std::string, Entry> assets;
+    // Uno por path, para no cargar el mismo mapa en dos hilos a la vez (se crean con mutex)
+    std::map<std::string, std::shared_ptr<std::mutex>> load_locks;
+
+    MapAssetCache() = default;
+
+    // Si al lado del json hay un .n4smap al dia, lo usa. Si no, parsea el json y
+    // deja escrito el .n4smap para la proxima vez
+    static std::shared_ptr<const MapAsset> load(const std::string& path);
+
+public:
+    static MapAssetCache& instance();
+
+    // Devuelve el mapa parseado, cargandolo si no estaba o si cambio el archivo
+    std::shared_ptr<const MapAsset> get(const std::string& path);
+
+    MapAssetCache(const MapAssetCache&) = delete;
+    MapAssetCache& operator=(const MapAssetCache&) = delete;
+};
+
+#endif  // MAP_ASSET_H
@@ -3,179 +3,20 @@
 #include <algorithm>
 #include <random>
 
-MapLoader::MapLoader(const std::string& path) {
-    std::ifstream file(path);
-    if (!file) {
-        throw std::runtime_error("MapLoader: No se puede abrir el archivo " + path);
-    }
-
-    nlohmann::json j;
-    file >> j;
-
-    load_grid_and_dimensions(j);
-    load_checkpoints(j);
-    load_pole_direction(j);
-    create_goal_pole_and_slow_zones();
-    load_npc_spawns_for_base_map(j);
-}
-
-void MapLoader::load_grid_and_dimensions(const nlohmann::json& j) {
-    nlohmann::json grid_json;
-
-    if (j.is_object()) {
-        if (!j.contains("grid"))
-            throw std::runtime_error("MapLoader: falta la clave 'grid' en el objeto JSON");
-        grid_json = j["grid"];
-
-        if (j.contains("base_map"))
-            base_map = j["base_map"].get<std::string>();
-    } else if (j.is_array()) {
-        grid_json = j;
-    } else {
-        throw std::runtime_error("MapLoader: se esperaba objeto con 'grid' o matriz [[...], ...]");
-    }
-
-    grid = grid_json.get<std::vector<std::vector<int>>>();
-
-    if (grid.empty() || grid[0].empty()) {
-        throw std::runtime_error("MapLoader: matriz vacía");
-    }
-
-    height = static_cast<int>(grid.size());
-    width = static_cast<int>(grid[0].size());
-
-    bool rectangular = std::all_of(grid.begin(), grid.end(), [this](const auto& row) {
-        return static_cast<int>(row.size()) == this->width;
-    });
+MapLoader::MapLoader(const std::string& path): asset(MapAssetCache::instance().get(path)) {
+    const TerrainGrid& terrain = asset->get_terrain();
+    height = terrain.get_height();
+    width = terrain.get_width();
 
-    if (!rectangular) {
-        throw std::runtime_error("MapLoader: Matriz no rectangular");
+    for (const auto& pc: asset->get_pole_cells()) {
+        pole.add_cell_to_pole(pc.col, pc.row);
     }
-}
-
-void MapLoader::load_checkpoints(const nlohmann::json& j) {
-    if (j.contains("checkpoints_order") && j["checkpoints_order"].is_array()) {
-        for (const auto& cp: j["checkpoints_order"]) {
-            CheckpointDef def;
-            def.order = cp.value("order", 0);
-            for (const auto& c: cp["cells"]) {
-                def.cells.push_back({c.value("col", 0), c.value("row", 0)});
-            }
-            checkpoints.push_back(std::move(def));
-        }
-        std::sort(checkpoints.begin(), checkpoints.end(),
-                  [](const auto& a, const auto& b) { return a.order < b.order; });
-    }
-}
-
-void MapLoader::load_pole_direction(const nlohmann::json& j) {
-    if (j.contains("direccion_salida")) {
-        std::string direccion_salida = j["direccion_salida"].get<std::string>();
-        if (direccion_salida == "derecha") {
-            pole.set_direc(DERECHA);
-        } else if (direccion_salida == "izquierda") {
-            pole.set_direc(IZQUIERDA);
-        } else if (direccion_salida == "arriba") {
-            pole.set_direc(ARRIBA);
-        } else if (direccion_salida == "abajo") {
-            pole.set_direc(ABAJO);
-        } else {
-            throw std::runtime_error("MapLoader: La direccion de pole de salida es incorrecta");
-        }
-    } else {
-        throw std::runtime_error("MapLoader: La pole de salida no tiene direccion");
-    }
-}
-
-void MapLoader::create_goal_pole_and_slow_zones() {
-    std::vector<Cell> goalCells;
-    // Como mucho, son 9
-    goalCells.reserve(9);
-
-    for (int row = 0; row < height; ++row) {
-        for (int col = 0; col < width; ++col) {
-            if (grid[row][col] == CELL_POLE || grid[row][col] == CELL_BRIDGE_UP_AND_POLE ||
-                grid[row][col] == CELL_BRIDGE_DOWN_AND_POLE) {
-                pole.add_cell_to_pole(col, row);
-            } else if (grid[row][col] == CELL_SLOW) {
-                slow_cells.emplace_back(Cell{col, row});
-            } else if (grid[row][col] == CELL_GOAL || grid[row][col] == CELL_BRIDGE_UP_AND_GOAL ||
-                       grid[row][col] == CELL_BRIDGE_DOWN_AND_GOAL) {
-                goalCells.push_back(Cell{col, row});
-            }
-        }
-    }
-
+    pole.set_direc(asset->get_pole_direction());
     pole.set_height_map(height);
 
-    if (goalCells.empty()) {
-        return;
-    }
-
-    // Calculamos el orden que le toca a la meta
-    int maxOrder = 0;
-    if (!checkpoints.empty()) {
-        maxOrder = checkpoints.back().order;
-    }
-
-    CheckpointDef goalDef;
-    goalDef.order = maxOrder + 1;
-    goalDef.cells = std::move(goalCells);
-    goalDef.goal = true;
-
-    checkpoints.push_back(std::move(goalDef));
-}
-
-NpcDir MapLoader::dir_from_string(const std::string& s) {
-    if (s == "Right") {
-        return NpcDir::Right;
-    }
-    if (s == "Left") {
-        return NpcDir::Left;
-    }
-    if (s == "Up") {
-        return NpcDir::Up;
-    }
-    if (s == "Down") {
-        return NpcDir::Down;
-    }
-    throw std::runtime_error("MapLoader: direccion de NPC invalida: " + s);
-}
-
-// Algunos spawns para los npcs. De querer mas, se pueden agregar aca!
-void MapLoader::load_npc_spawns_for_base_map(const nlohmann::json& j) {
-    npc_spawns.clear();
-    npc_spawns_park.clear();
-
-    // npc_spawns normales
-    if (j.contains("npc_spawns") && j["npc_spawns"].is_array()) {
-        for (const auto& s: j["npc_spawns"]) {
-            NpcSpawnDef def;
-            def.col = s.value("col", 0);
-            def.row = s.value("row", 0);
-
-            std::string dir_str = s.value("dir", "Right");
-            def.dir = dir_from_string(dir_str);
-
-            npc_spawns.push_back(def);
-        }
-    }
-
-    // npc_spawns_park
-    if (j.contains("npc_spawns_park") && j["npc_spawns_park"].is_array()) {
-        for (const auto& s: j["npc_spawns_park"]) {
-            NpcSpawnDef def;
-            def.col = s.value("col", 0);
-            def.row = s.value("row", 0);
-
-            std::string dir_str = s.value("dir", "Right");
-            def.dir = dir_from_string(dir_str);
-
-            npc_spawns_park.push_back(def);
-        }
-    }
-
-    // Mezclar los vectores para que el orden sea aleatorio
+    // Cada carrera mezcla su propia copia de los spawns para que el orden sea aleatorio
+    npc_spawns = asset->get_npc_spawns();
+    npc_spawns_park = asset->get_npc_spawns_park();
     std::random_device rd;
     std::mt19937 g(rd());
     std::shuffle(npc_spawns.begin(), npc_spawns.end(), g);
@@ -200,14 +41,41 @@ void MapLoader::load_npc_spawns_for_base_map(const nlohmann::json& j) {
 // el mapa y puede hacer la conversión que quiera. Pero me ayuda a ahorrarme
 // dolores de cabeza.
 
-void MapLoader::create_wall(uint32_t category_wall, uint32_t category_car, const b2WorldId& world,
-                            int x, int y) const {
-    b2BodyDef groundBodyDef = b2DefaultBodyDef();
-    groundBodyDef.position = b2Vec2{static_cast<float>(x) + CELL_HALF,
-                                    static_cast<float>(height - 1 - y) + CELL_HALF};
-    b2BodyId groundId = b2CreateBody(world, &groundBodyDef);
+int MapLoader::wall_key_of(int col, int row) const {
+    // Por las dudas, todos los bordes son pared en ambas alturas
+    if (row == 0 || row == height - 1 || col == 0 || col == width - 1) {
+        return WALL_KEY_BOTH;
+    }
 
-    b2Polygon box = b2MakeBox(CELL_HALF, CELL_HALF);
+    const bool wall_l0 = asset->get_terrain().has(col, row, TERRAIN_WALL_L0);
+    const bool wall_l1 = asset->get_terrain().has(col, row, TERRAIN_WALL_L1);
+    if (wall_l0 && wall_l1) {
+        return WALL_KEY_BOTH;
+    }
+    if (wall_l1) {
+        // Se pueden transitar en altura 0, pero en 1 bloquean
+        return WALL_KEY_L1_ONLY;
+    }
+    if (wall_l0) {
+        // dejan el paso en altura 1 pero en altura 0 bloquean
+        return WALL_KEY_L0_ONLY;
+    }
+    return CellMerger::NO_KEY;
+}
+
+b2Polygon MapLoader::make_rect_box(const CellRect& rect) const {
+    // El rectangulo va de la fila rect.row a rect.row + rect.rows - 1 de la matriz,
+    // que en el mundo (Y invertida) es de height - rect.row - rect.rows a height - rect.row
+    const float half_w = static_cast<float>(rect.cols) * CELL_HALF;
+    const float half_h = static_cast<float>(rect.rows) * CELL_HALF;
+    const b2Vec2 center{static_cast<float>(rect.col) + half_w,
+                        static_cast<float>(height - rect.row) - half_h};
+    return b2MakeOffsetBox(half_w, half_h, center, b2Rot_identity);
+}
+
+void MapLoader::create_wall_shape(b2BodyId body, const CellRect& rect, uint32_t category_wall,
+                                  uint32_t category_car) const {
+    b2Polygon box = make_rect_box(rect);
     b2ShapeDef sdef = b2DefaultShapeDef();
 
     sdef.enableHitEvents = true;
@@ -217,58 +85,88 @@ void MapLoader::create_wall(uint32_t category_wall, uint32_t category_car, const
 
     sdef.material.friction = 1.2f;
     sdef.material.restitution = 0.0f;
-    b2CreatePolygonShape(groundId, &sdef, &box);
+    b2CreatePolygonShape(body, &sdef, &box);
 }
 
 void MapLoader::create_static_colliders(const b2WorldId& world) const {
+    // Antes se creaba un body (con su shape) por celda de pared, mas los bordes repetidos.
+    // Ahora agrupamos las celdas en rectangulos y colgamos todas las shapes de un solo body.
+    std::vector<int> keys(static_cast<std::size_t>(width) * height);
     for (int y = 0; y < height; ++y) {
         for (int x = 0; x < width; ++x) {
-            if (grid[y][x] == CELL_WALL) {  // Si es pared
-                create_wall(BOTH_WALLS, BOTH_CARS, world, x, y);
-            } else if (grid[y][x] == CELL_WALL_L1_ONLY) {
-                // Se pueden transitar en altura 0, pero en 1 bloquean
-                create_wall(WALL_L1, CAR_L1, world, x, y);
-            } else if (grid[y][x] == CELL_WALL_L0_ONLY) {
-                // dejan el paso en altura 1 pero en altura 0 bloquean
-                create_wall(WALL_L0, CAR_L0, world, x, y);
-            }
+            keys[static_cast<std::size_t>(y) * width + x] = wall_key_of(x, y);
+        }
+    }
+
+    const std::vector<CellRect> rects = CellMerger::merge(keys, width, height);
+
+    b2BodyDef groundBodyDef = b2DefaultBodyDef();  // static por defecto, en el origen
+    b2BodyId groundId = b2CreateBody(world, &groundBodyDef);
+
+    for (const auto& rect: rects) {
+        switch (rect.key) {
+            case WALL_KEY_BOTH:
+                create_wall_shape(groundId, rect, BOTH_WALLS, BOTH_CARS);
+                break;
+            case WALL_KEY_L1_ONLY:
+                create_wall_shape(groundId, rect, WALL_L1, CAR_L1);
+                break;
+            case WALL_KEY_L0_ONLY:
+                create_wall_shape(groundId, rect, WALL_L0, CAR_L0);
+                break;
         }
     }
+}
 
-    // Por las dudas, agrego paredes a mano en todos los bordes
-    // Fila de arriba y de abajo
-    for (int x = 0; x < width; ++x) {
-        create_wall(BOTH_WALLS, BOTH_CARS, world, x, 0);
-        create_wall(BOTH_WALLS, BOTH_CARS, world, x, height - 1);
+std::vector<CellRect> MapLoader::merge_cells(const std::vector<Cell>& cells) {
+    if (cells.empty()) {
+        return {};
     }
 
-    // Columna izquierda y derecha
-    for (int y = 0; y < height; ++y) {
-        create_wall(BOTH_WALLS, BOTH_CARS, world, 0, y);
-        create_wall(BOTH_WALLS, BOTH_CARS, world, width - 1, y);
+    // Trabajamos sobre la caja que encierra a las celdas, no sobre todo el mapa
+    int min_col = cells[0].col, max_col = cells[0].col;
+    int min_row = cells[0].row, max_row = cells[0].row;
+    for (const auto& c: cells) {
+        min_col = std::min(min_col, c.col);
+        max_col = std::max(max_col, c.col);
+        min_row = std::min(min_row, c.row);
+        max_row = std::max(max_row, c.row);
+    }
+
+    const int w = max_col - min_col + 1;
+    const int h = max_row - min_row + 1;
+    std::vector<int> keys(static_cast<std::size_t>(w) * h, CellMerger::NO_KEY);
+    for (const auto& c: cells) {
+        keys[static_cast<std::size_t>(c.row - min_row) * w + (c.col - min_col)] = 0;
+    }
+
+    std::vector<CellRect> rects = CellMerger::merge(keys, w, h);
+    for (auto& r: rects) {
+        r.col += min_col;
+        r.row += min_row;
     }
+    return rects;
 }
 
 void MapLoader::create_checkpoint_sensors(const b2WorldId& world) {
-    for (const auto& cp: checkpoints) {
-
-        // insertamos y obtenemos referencia estable al int dentro de la lista
-        auto& storedOrder = orden.emplace_back(cp.order);
+    for (const auto& cp: asset->get_checkpoints()) {
 
+        // insertamos y obtenemos referencia estable al sensor dentro de la lista
+        CheckpointSensor& sensor = sensors.emplace_back(cp.order, cp.goal);
         for (const auto& cell: cp.cells) {
-            const int x = cell.col;
-            const int y = cell.row;
+            sensor.add_cell(cell.col, cell.row);
+        }
 
-            b2BodyDef def = b2DefaultBodyDef();  // static por defecto
-            def.position = b2Vec2{static_cast<float>(x) + CELL_HALF,
-                                  static_cast<float>(height - 1 - y) + CELL_HALF};
+        b2BodyDef def = b2DefaultBodyDef();  // static por defecto, en el origen
 
-            // guardamos el 'order' en el body userData para reconocerlo desde los contactos
-            def.userData = &storedOrder;
+        // guardamos el sensor en el body userData para reconocerlo desde los eventos
+        def.userData = &sensor;
 
-            b2BodyId body = b2CreateBody(world, &def);
+        b2BodyId body = b2CreateBody(world, &def);
 
-            b2Polygon box = b2MakeBox(CELL_HALF, CELL_HALF);
+        // Una sola shape por rectangulo de celdas (normalmente el checkpoint entero es uno)
+        for (const auto& rect: merge_cells(cp.cells)) {
+            b2Polygon box = make_rect_box(rect);
             b2ShapeDef sdef = b2DefaultShapeDef();
             sdef.isSensor = true;
             sdef.enableSensorEvents = true;
@@ -279,61 +177,54 @@ void MapLoader::create_checkpoint_sensors(const b2WorldId& world) {
             sdef.material.friction = 0.0f;
             sdef.material.restitution = 0.0f;
 
-            b2ShapeId shapeId = b2CreatePolygonShape(body, &sdef, &box);
-
-            sensors.push_back(CheckpointSensor(shapeId, &storedOrder, x, y, cp.goal));
+            b2CreatePolygonShape(body, &sdef, &box);
         }
     }
 }
 
 // Creamos los sensores que te elevan y bajan de un puente
+// Las celdas se agrupan en rectangulos, y hay un solo body para las subidas y otro para las bajadas
 void MapLoader::create_bridge_sensors(const b2WorldId& world) {
+    std::vector<int> keys(static_cast<std::size_t>(width) * height, CellMerger::NO_KEY);
     for (int y = 0; y < height; ++y) {
         for (int x = 0; x < width; ++x) {
-            if (grid[y][x] != CELL_BRIDGE_UP && grid[y][x] != CELL_BRIDGE_DOWN &&
-                grid[y][x] != CELL_BRIDGE_UP_AND_POLE && grid[y][x] != CELL_BRIDGE_DOWN_AND_POLE &&
-                grid[y][x] != CELL_BRIDGE_UP_AND_GOAL && grid[y][x] != CELL_BRIDGE_DOWN_AND_GOAL &&
-                grid[y][x] != CELL_BRIDGE_UP_AND_CHECKPOINT &&
-                grid[y][x] != CELL_BRIDGE_DOWN_AND_CHECKPOINT)
-                continue;
-
-            // Puntero estable porque es lista
-            bool is_up = (grid[y][x] == CELL_BRIDGE_UP || grid[y][x] == CELL_BRIDGE_UP_AND_POLE ||
-                          grid[y][x] == CELL_BRIDGE_UP_AND_GOAL ||
-                          grid[y][x] == CELL_BRIDGE_UP_AND_CHECKPOINT);
-            bridge_target_z_.push_back(is_up ? 1 : 0);
-            int* targetZ = &bridge_target_z_.back();
+            if (asset->get_terrain().has(x, y, TERRAIN_BRIDGE_UP)) {
+                keys[static_cast<std::size_t>(y) * width + x] = 1;
+            } else if (asset->get_terrain().has(x, y, TERRAIN_BRIDGE_DOWN)) {
+                keys[static_cast<std::size_t>(y) * width + x] = 0;
+            }
+        }
+    }
 
-            b2BodyDef def = b2DefaultBodyDef();
-            def.position = b2Vec2{static_cast<float>(x) + CELL_HALF,
-                                  static_cast<float>(height - 1 - y) + CELL_HALF};
+    // La clave de cada rectangulo es justamente el nivel z al que te lleva
+    b2BodyId bodies[2] = {b2_nullBodyId, b2_nullBodyId};
 
+    for (const auto& rect: CellMerger::merge(keys, width, height)) {
+        b2BodyId& body = bodies[rect.key];
+        if (B2_IS_NULL(body)) {
+            // Puntero estable porque es lista
             // En el userData del sensor, guardamos si te sube o baja de nivel
-            def.userData = targetZ;
-
-            b2BodyId body = b2CreateBody(world, &def);
-            b2Polygon box = b2MakeBox(CELL_HALF, CELL_HALF);
-            b2ShapeDef sdef = b2DefaultShapeDef();
-            sdef.isSensor = true;
-            sdef.enableSensorEvents = true;
-            sdef.filter.categoryBits = SENSOR;
-            sdef.filter.maskBits = CAR_L0 | CAR_L1 | NPC_L0 | NPC_L1;
-            sdef.material.friction = 0.0f;
-            sdef.material.restitution = 0.0f;
-            b2ShapeId shapeId = b2CreatePolygonShape(body, &sdef, &box);
-
-            bridge_sensors.emplace_back(shapeId);
+            b2BodyDef def = b2DefaultBodyDef();
+            def.userData = &bridge_target_z_.emplace_back(rect.key);
+            body = b2CreateBody(world, &def);
         }
+
+        b2Polygon box = make_rect_box(rect);
+        b2ShapeDef sdef = b2DefaultShapeDef();
+        sdef.isSensor = true;
+        sdef.enableSensorEvents = true;
+        sdef.filter.categoryBits = SENSOR_BRIDGE;
+        sdef.filter.maskBits = CAR_L0 | CAR_L1 | NPC_L0 | NPC_L1;
+        sdef.material.friction = 0.0f;
+        sdef.material.restitution = 0.0f;
+        b2CreatePolygonShape(body, &sdef, &box);
     }
 }
 
 Spawn MapLoader::get_spawn_for_index(std::size_t idx) { return pole.get_spawn_for_index(idx); }
 
-const std::vector<Cell>& MapLoader::get_slow_cells() const { return slow_cells; }
-
-const std::vector<b2ShapeId>& MapLoader::get_bridge_sensors() const { return bridge_sensors; }
-
 MapId MapLoader::get_map_id() {
+    const std::string& base_map = asset->get_base_map();
     if (base_map == "ViceCity.png") {
         return MapId::ViceCity;
     } else if (base_map == "LibertyCity.png") {
@@ -347,18 +238,6 @@ MapId MapLoader::get_map_id() {
 
 PoleCoordsAndDirec MapLoader::get_pole_position() { return pole.get_pole_position(); }
 
-bool MapLoader::is_driveable_cell(int col, int row) const {
-    if (row < 0 || row >= height || col < 0 || col >= width)
-        return false;
-    int v = grid[row][col];
-
-    return (v == CELL_ROAD || v == CELL_POLE || v == CELL_GOAL || v == CELL_BRIDGE_UP ||
-            v == CELL_BRIDGE_DOWN || v == CELL_BRIDGE_DOWN_AND_POLE ||
-            v == CELL_BRIDGE_UP_AND_POLE || v == CELL_BRIDGE_UP_AND_GOAL ||
-            v == CELL_BRIDGE_DOWN_AND_GOAL || v == CELL_BRIDGE_UP_AND_CHECKPOINT ||
-            v == CELL_BRIDGE_DOWN_AND_CHECKPOINT || v == CELL_WALL_L1_ONLY);
-}
-
 std::vector<Spawn> MapLoader::filter_spawns_by_distance(const std::vector<NpcSpawnDef>& defs,
                                                         float min_dist_to_pole) const {
     std::vector<Spawn> result;
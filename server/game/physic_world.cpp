@@ -1,5 +1,11 @@
 #include "physic_world.h"
 
+#include <mutex>
+
+// b2CreateWorld/b2DestroyWorld tocan el arreglo global de mundos de Box2D y no son thread-safe.
+// Cada partida tiene su gameloop y la proxima carrera se arma en otro hilo, asi que los serializamos
+static std::mutex box2d_worlds_mutex;
+
 PhysicWorld::PhysicWorld(const std::string& path): map(path) {
     const auto& cfg = Config::instance();
 
@@ -10,6 +16,7 @@ PhysicWorld::PhysicWorld(const std::string& path): map(path) {
     b2WorldDef worldDef = b2DefaultWorldDef();
     worldDef.gravity = b2Vec2{0.0f, 0.0f};
     worldDef.hitEventThreshold = hitThreshold;
+    std::lock_guard<std::mutex> lock(box2d_worlds_mutex);
     worldId = b2CreateWorld(&worldDef);
 }
 
@@ -26,8 +33,6 @@ void PhysicWorld::init_world() {
 
 Spawn PhysicWorld::get_spawn_for_index(std::size_t idx) { return map.get_spawn_for_index(idx); }
 
-const std::vector<Cell>& PhysicWorld::get_slow_cells() const { return map.get_slow_cells(); }
-
 void PhysicWorld::handle_contacts() {
 
     b2ContactEvents ev = b2World_GetContactEvents(worldId);
@@ -73,70 +78,37 @@ void PhysicWorld::handle_contacts() {
     handle_bridge_contacts();
 }
 
-void PhysicWorld::handle_contact_in_sensor_bridge_i(std::unordered_set<Car*>& processed,
-                                                    const int* targetZ, b2ShapeId& visitorId) {
-    if (b2Shape_IsValid(visitorId) == false) {
-        return;
+void PhysicWorld::handle_bridge_contacts() {
+    b2SensorEvents ev = b2World_GetSensorEvents(worldId);
+
+    for (int i = 0; i < ev.beginCount; ++i) {
+        handle_bridge_begin_touch(ev.beginEvents[i]);
     }
+}
 
-    // saco el body físico del que está tocando
-    b2BodyId visitorBody = b2Shape_GetBody(visitorId);
+void PhysicWorld::handle_bridge_begin_touch(const b2SensorBeginTouchEvent& ev) {
+    if (!b2Shape_IsValid(ev.sensorShapeId) || !b2Shape_IsValid(ev.visitorShapeId)) {
+        return;
+    }
 
-    // leo el userData del body
-    void* raw = b2Body_GetUserData(visitorBody);
-    if (!raw) {
+    // Los checkpoints tambien generan eventos, nos quedamos con los puentes
+    if ((b2Shape_GetFilter(ev.sensorShapeId).categoryBits & SENSOR_BRIDGE) == 0) {
         return;
     }
 
-    if ((b2Shape_GetFilter(visitorId).categoryBits & (CAR_L0 | CAR_L1)) == 0) {
+    if ((b2Shape_GetFilter(ev.visitorShapeId).categoryBits & (CAR_L0 | CAR_L1)) == 0) {
         return;  // no es un auto
     }
 
-    Car* car = static_cast<Car*>(raw);
-
-    // Si ya lo procesamos en este frame, no lo tocamos de nuevo
-    if (processed.count(car)) {
+    // Recuperar el targetZ desde el userData del cuerpo del sensor
+    // EL mismo, nos dice si te sube o baja de nivel z
+    const int* targetZ = static_cast<int*>(b2Body_GetUserData(b2Shape_GetBody(ev.sensorShapeId)));
+    Car* car = static_cast<Car*>(b2Body_GetUserData(b2Shape_GetBody(ev.visitorShapeId)));
+    if (!targetZ || !car) {
         return;
     }
 
     car->set_layer(*targetZ);
-    processed.insert(car);
-}
-
-void PhysicWorld::handle_bridge_contacts() {
-    const auto& bridge = map.get_bridge_sensors();
-
-    // Autos procesados en este frame
-    std::unordered_set<Car*> processed;
-
-    for (b2ShapeId sensorShapeId: bridge) {
-
-        if (!b2Shape_IsValid(sensorShapeId)) {
-            std::cerr << "sensorShapeId invalido, lo salteo" << std::endl;
-            continue;
-        }
-
-        int capacity = b2Shape_GetSensorCapacity(sensorShapeId);
-        std::vector<b2ShapeId> overlaps;
-        overlaps.resize(capacity);
-        if (capacity == 0) {
-            continue;
-        }
-
-        int count = b2Shape_GetSensorOverlaps(sensorShapeId, overlaps.data(), capacity);
-        overlaps.resize(count);
-
-        // Recuperar el targetZ desde el userData del cuerpo del sensor
-        // EL mismo, nos dice si te sube o baja de nivel z
-        b2BodyId sensorBody = b2Shape_GetBody(sensorShapeId);
-        const int* targetZ = static_cast<int*>(b2Body_GetUserData(sensorBody));
-        if (!targetZ)
-            continue;
-
-        for (int i = 0; i < count; ++i) {
-            handle_contact_in_sensor_bridge_i(processed, targetZ, overlaps[i]);
-        }
-    }
 }
 
 MapId PhysicWorld::get_map_id() { return map.get_map_id(); }
@@ -144,14 +116,7 @@ MapId PhysicWorld::get_map_id() { return map.get_map_id(); }
 PoleCoordsAndDirec PhysicWorld::get_pole_position() { return map.get_pole_position(); }
 
 bool PhysicWorld::is_driveable_world_pos(float x, float y) const {
-    int col = static_cast<int>(x);
-    int row = map.getHeightInMeters() - 1 - static_cast<int>(y);
-
-    if (col < 0 || row < 0 || col >= map.getWidthInMeters() || row >= map.getHeightInMeters()) {
-        return false;
-    }
-
-    return map.is_driveable_cell(col, row);
+    return map.get_terrain().has_at_world(x, y, TERRAIN_DRIVEABLE);
 }
 
 std::vector<Spawn> PhysicWorld::get_npc_spawns_filtered(float min_dist_to_pole) const {
@@ -164,5 +129,6 @@ std::vector<Spawn> PhysicWorld::get_npc_park_spawns_filtered(float min_dist_to_p
 
 PhysicWorld::~PhysicWorld() {
     // Destruyo el mundo de Box2D
+    std::lock_guard<std::mutex> lock(box2d_worlds_mutex);
     b2DestroyWorld(worldId);
 }
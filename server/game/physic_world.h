@@ -2,7 +2,6 @@
 #define PHYSIC_WORLD_H
 
 #include <string>
-#include <unordered_set>
 #include <vector>
 
 #include <box2d/box2d.h>
@@ -26,10 +25,10 @@ private:
 
     MapLoader map;
 
+    // Solo mira los autos que entraron a una subida o bajada en el ultimo step
     void handle_bridge_contacts();
 
-    void handle_contact_in_sensor_bridge_i(std::unordered_set<Car*>& processed, const int* targetZ,
-                                           b2ShapeId& visitorId);
+    void handle_bridge_begin_touch(const b2SensorBeginTouchEvent& ev);
 
 public:
     // Se crea el mundo fisico con su respectiva configuracion
@@ -47,9 +46,11 @@ public:
 
     int getHeightInMeters() const { return map.getHeightInMeters(); }
 
-    const std::vector<CheckpointSensor>& get_sensors() const { return map.get_sensors(); }
+    int getWidthInMeters() const { return map.getWidthInMeters(); }
 
-    const std::vector<Cell>& get_slow_cells() const;
+    const std::list<CheckpointSensor>& get_sensors() const { return map.get_sensors(); }
+
+    const TerrainGrid& get_terrain() const { return map.get_terrain(); }
 
     void handle_contacts();
 
@@ -5,6 +5,7 @@
 
 #include "../../common/resource_paths.h"
 #include "../config.h"
+#include "../conection/op_codes.h"
 
 RaceContext::RaceContext(const std::string& map_path, ClientRegistryMonitor& registry):
         map_path(map_path),
@@ -71,10 +72,10 @@ void RaceContext::handle_race_and_contacts(double race_with_countdown_actual) {
 }
 
 void RaceContext::send_snapshot(double& snapshot_acumulate, float snapshot_interval,
-                                double race_with_countdown) {
+                                double race_with_countdown, TickProfiler& profiler) {
     snapshot_builder.send_snapshot(snapshot_acumulate, snapshot_interval, world_state.get_cars(),
                                    world_state.get_race_progress(), race_with_countdown,
-                                   world_state.get_npc_cars());
+                                   world_state.get_npc_cars(), profiler);
 }
 
 void RaceContext::send_pre_game_snapshot(const int remaining, const double race_total_time,
@@ -155,6 +156,18 @@ void RaceContext::receive_command_move(const CommandReceiver& cmd, double race_w
     }
 }
 
+void RaceContext::receive_input_state(const CommandReceiver& cmd) {
+    if (!world_state.client_have_car(cmd.client_id)) {
+        return;
+    }
+    teclas_presionadas keys;
+    keys.w = cmd.param & INPUT_STATE_W;
+    keys.a = cmd.param & INPUT_STATE_A;
+    keys.s = cmd.param & INPUT_STATE_S;
+    keys.d = cmd.param & INPUT_STATE_D;
+    world_state.set_keys(cmd.sequence, keys, cmd.client_id);
+}
+
 MapId RaceContext::get_map_id() { return physics.get_map_id(); }
 
 void RaceContext::set_race_finish(int id_player, double time_finish) {
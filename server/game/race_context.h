@@ -44,7 +44,7 @@ public:
 
     // Manda snapshot al cliente
     void send_snapshot(double& snapshot_acumulate, float snapshot_interval,
-                       double race_with_countdown);
+                       double race_with_countdown, TickProfiler& profiler);
 
     void send_pre_game_snapshot(const int remaining, const double race_total_time,
                                 const double race_duration);
@@ -65,6 +65,9 @@ public:
 
     void receive_command_move(const CommandReceiver& cmd, double race_with_countdown);
 
+    // Estado completo de las teclas de movimiento (CommandReceiverType::InputState)
+    void receive_input_state(const CommandReceiver& cmd);
+
     bool all_players_finished_or_dead() const;
 
     MapId get_map_id();
@@ -0,0 +1,34 @@
+#include "race_preparer.h"
+
+#include <chrono>
+#include <utility>
+
+RacePreparer::RacePreparer(std::string map_path, ClientRegistryMonitor& registry,
+                           std::map<int, uint16_t> player_models):
+        map_path(std::move(map_path)),
+        registry(registry),
+        player_models(std::move(player_models)) {}
+
+void RacePreparer::run() {
+    const auto t0 = std::chrono::steady_clock::now();
+    try {
+        race = std::make_unique<RaceContext>(map_path, registry);
+        for (const auto& [client_id, model]: player_models) {
+            race->spawn_car_for_player(client_id, model);
+        }
+    } catch (...) {
+        // Se relanza en el hilo del gameloop cuando retire la carrera
+        error = std::current_exception();
+    }
+    preparation_ms =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0)
+                    .count();
+}
+
+std::unique_ptr<RaceContext> RacePreparer::take() {
+    join();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return std::move(race);
+}
@@ -0,0 +1,49 @@
+#ifndef RACE_PREPARER_H
+#define RACE_PREPARER_H
+
+#include <exception>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "../../common/thread.h"
+#include "../conection/client_registry.h"
+
+#include "race_context.h"
+
+// Arma la proxima carrera (mapa, cuerpos de Box2D, NPCs y autos de los jugadores) en su propio
+// hilo, mientras el gameloop sigue mostrando resultados y mejoras. El gameloop la retira con take()
+class RacePreparer: public Thread {
+private:
+    std::string map_path;
+    ClientRegistryMonitor& registry;
+
+    // Modelo de auto de cada jugador (client_id -> modelo)
+    std::map<int, uint16_t> player_models;
+
+    std::unique_ptr<RaceContext> race;
+    std::exception_ptr error;
+
+    // Cuanto tardo en armarse la carrera
+    double preparation_ms = 0.0;
+
+public:
+    RacePreparer(std::string map_path, ClientRegistryMonitor& registry,
+                 std::map<int, uint16_t> player_models);
+
+    void run() override;
+
+    // Espera a que termine (si todavia no termino) y devuelve la carrera.
+    // Si fallo al armarla, relanza la excepcion
+    std::unique_ptr<RaceContext> take();
+
+    double get_preparation_ms() const { return preparation_ms; }
+
+    const std::string& get_map_path() const { return map_path; }
+
+    ~RacePreparer() override = default;
+    RacePreparer(const RacePreparer&) = delete;
+    RacePreparer& operator=(const RacePreparer&) = delete;
+};
+
+#endif  // RACE_PREPARER_H
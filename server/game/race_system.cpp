@@ -6,82 +6,53 @@ RaceSystem::RaceSystem(PhysicWorld& physics, WorldState& world_state):
         physics(physics), world_state(world_state) {}
 
 void RaceSystem::handle_checkpoint_contacts(double race_with_countdown_actual) {
-    // Iteramos todos los sensores de checkpoint del mapa
-    const auto& sens = physics.get_sensors();
-
-    for (const auto& s: sens) {
-        b2ShapeId sensorShapeId = s.get_shapeId();
-        int checkpointOrder = *(s.get_orderPtr());
-
-        int capacity = b2Shape_GetSensorCapacity(sensorShapeId);
-        std::vector<b2ShapeId> overlaps;
-        overlaps.resize(capacity);
-        if (capacity == 0) {
-            continue;
-        }
-
-        int count = b2Shape_GetSensorOverlaps(sensorShapeId, overlaps.data(), capacity);
-        overlaps.resize(count);
+    // Box2D nos da solo los sensores que empezaron a tocar algo en este step
+    b2SensorEvents ev = b2World_GetSensorEvents(physics.getWorld());
 
-        for (int i = 0; i < count; ++i) {
-            handle_contact_in_checkpoint_i(i, race_with_countdown_actual, overlaps, s,
-                                           checkpointOrder);
-        }
+    for (int i = 0; i < ev.beginCount; ++i) {
+        handle_checkpoint_begin_touch(ev.beginEvents[i], race_with_countdown_actual);
     }
 }
 
-void RaceSystem::handle_contact_in_checkpoint_i(int i, double race_with_countdown_actual,
-                                                std::vector<b2ShapeId>& overlaps,
-                                                const CheckpointSensor& s, int checkpointOrder) {
-
-    b2ShapeId visitorId = overlaps[i];
-
-    if (b2Shape_IsValid(visitorId) == false) {
+void RaceSystem::handle_checkpoint_begin_touch(const b2SensorBeginTouchEvent& ev,
+                                               double race_with_countdown_actual) {
+    if (!b2Shape_IsValid(ev.sensorShapeId) || !b2Shape_IsValid(ev.visitorShapeId)) {
         return;
     }
 
-    // saco el body físico del que está tocando
-    b2BodyId visitorBody = b2Shape_GetBody(visitorId);
-
-    // leo el userData del body
-    // Los bodies de los checkpoints tienen userData = int* (storedOrder),
-    // los autos tienen userData = Car*
-    void* raw = b2Body_GetUserData(visitorBody);
-    if (!raw || raw == s.get_orderPtr()) {
+    // Los sensores de los puentes tambien generan eventos, nos quedamos con los checkpoints
+    if ((b2Shape_GetFilter(ev.sensorShapeId).categoryBits & SENSOR) == 0) {
         return;
     }
 
-    Car* car = reinterpret_cast<Car*>(raw);
+    if ((b2Shape_GetFilter(ev.visitorShapeId).categoryBits & (CAR_L0 | CAR_L1)) == 0) {
+        return;  // no es un auto de jugador
+    }
 
-    if (car->is_npc()) {
+    // Los bodies de los checkpoints tienen userData = CheckpointSensor*,
+    // los autos tienen userData = Car*
+    const auto* s = static_cast<const CheckpointSensor*>(
+            b2Body_GetUserData(b2Shape_GetBody(ev.sensorShapeId)));
+    Car* car = static_cast<Car*>(b2Body_GetUserData(b2Shape_GetBody(ev.visitorShapeId)));
+    if (!s || !car || car->is_npc()) {
         return;
     }
 
-    // necesitamos saber quien es el client_id que tiene este Car*
-    int ownerClientId = world_state.get_owner_id(car);
+    // El auto ya sabe de que cliente es
+    int ownerClientId = car->get_owner_id();
     if (ownerClientId == -1) {
         return;
     }
 
     RaceProgress& prog = world_state.get_progress_of(ownerClientId);
 
-    if (checkpointOrder == prog.next_order) {
-        bool goal = s.is_goal();
-
-        if (goal) {
+    if (s->get_order() == prog.next_order) {
+        if (s->is_goal()) {
             world_state.set_race_finish(ownerClientId, race_with_countdown_actual);
-
-            auto& cars = world_state.get_cars();
-            auto itCar = cars.find(ownerClientId);
-            if (itCar != cars.end()) {
-                Car& ownerCar = itCar->second;
-                ownerCar.mark_finished();
-                ownerCar.set_ghost(true);
-            }
-            prog.next_order++;
-        } else {
-            prog.next_order++;
+            car->mark_finished();
+            car->set_ghost(true);
         }
+        prog.next_order++;
     }
 }
 
@@ -13,13 +13,13 @@ private:
     PhysicWorld& physics;
     WorldState& world_state;
 
-    void handle_contact_in_checkpoint_i(int i, double race_with_countdown_actual,
-                                        std::vector<b2ShapeId>& overlaps, const CheckpointSensor& s,
-                                        int checkpointOrder);
+    void handle_checkpoint_begin_touch(const b2SensorBeginTouchEvent& ev,
+                                       double race_with_countdown_actual);
 
 public:
     RaceSystem(PhysicWorld& physics, WorldState& world_state);
 
+    // Procesa los autos que entraron a un checkpoint en el ultimo step
     void handle_checkpoint_contacts(double race_with_countdown_actual);
     bool all_players_finished_or_dead() const;
 
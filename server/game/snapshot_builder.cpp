@@ -2,42 +2,88 @@
 
 #include <algorithm>
 #include <list>
+#include <utility>
+
+#include "../config.h"
 
 SnapshotBuilder::SnapshotBuilder(ClientRegistryMonitor& registry, PhysicWorld& physics):
-        physics(physics), registry(registry) {}
+        physics(physics),
+        registry(registry),
+        interest(Config::instance().aoi_near_radius_px(), Config::instance().aoi_far_radius_px(),
+                 Config::instance().aoi_far_update_interval()) {}
 
 void SnapshotBuilder::send_snapshot(double& snapshot_acumulate, const float snapshot_interval,
                                     const std::map<int, Car>& cars,
                                     std::map<int, RaceProgress>& race_progress,
-                                    double race_with_countdown, const std::list<Car>& npc_cars) {
+                                    double race_with_countdown, const std::list<Car>& npc_cars,
+                                    TickProfiler& profiler) {
 
     if (cars.empty()) {
         snapshot_acumulate -= snapshot_interval;
         return;
     }
 
-    GameSnapshotData data;
+    // Con el filtrado por cercania cada cliente con auto recibe su propia snapshot; los que no
+    // tienen auto o ven todo comparten la completa (full_ids)
+    std::vector<std::pair<int, std::shared_ptr<GameSnapshotEvent>>> views;
+    std::vector<int> full_ids;
+    std::shared_ptr<GameSnapshotEvent> ev;
+    {
+        TickProfiler::Scope measure(profiler, TickPhase::BuildSnapshot);
+        GameSnapshotData data;
+
+        if (race_with_countdown <= 0) {
+            data.time_seconds_remained = 0;
+        } else {
+            data.time_seconds_remained = static_cast<uint32_t>(race_with_countdown);
+        }
+        data.map_width_px = static_cast<uint32_t>(physics.getWidthInMeters() * PPM);
+        data.map_height_px = static_cast<uint32_t>(physics.getHeightInMeters() * PPM);
+        data.checkpoints = get_checkpoint_table();
 
-    if (race_with_countdown <= 0) {
-        data.time_seconds_remained = 0;
-    } else {
-        data.time_seconds_remained = static_cast<uint32_t>(race_with_countdown);
-    }
+        data.players.reserve(cars.size());
 
-    data.players.reserve(cars.size());
+        for (const auto& [player_id, car]: cars) {
+            add_car_to_snapshot(car, player_id, race_progress, data);
+        }
 
-    for (const auto& [player_id, car]: cars) {
-        add_car_to_snapshot(car, player_id, race_progress, data);
-    }
+        for (const Car& npc: npc_cars) {
+            add_npc_to_snapshot(npc, data);
+        }
 
-    for (const Car& npc: npc_cars) {
-        add_npc_to_snapshot(npc, data);
+        if (!data.players.empty() && !interest.enabled()) {
+            ev = std::make_shared<GameSnapshotEvent>(std::move(data));
+        } else if (!data.players.empty()) {
+            const std::vector<int> ids = registry.get_ids();
+            interest.begin_snapshot(data);
+            views.reserve(ids.size());
+            GameSnapshotData view;
+            for (int id: ids) {
+                if (interest.build_view(id, data, view)) {
+                    views.emplace_back(id, std::make_shared<GameSnapshotEvent>(std::move(view)));
+                } else {
+                    full_ids.push_back(id);
+                }
+            }
+            interest.retain(ids);
+            if (!full_ids.empty()) {
+                ev = std::make_shared<GameSnapshotEvent>(std::move(data));
+            }
+        }
     }
 
-
-    if (!data.players.empty()) {
-        auto ev = std::make_shared<GameSnapshotEvent>(std::move(data));
-        registry.broadcast(ev);
+    {
+        TickProfiler::Scope measure(profiler, TickPhase::Broadcast);
+        if (ev && views.empty()) {
+            registry.broadcast(ev);
+        } else if (ev) {
+            for (int id: full_ids) {
+                registry.send_to(id, ev);
+            }
+        }
+        for (const auto& [id, view]: views) {
+            registry.send_to(id, view);
+        }
     }
 
     snapshot_acumulate -= snapshot_interval;
@@ -101,47 +147,53 @@ void SnapshotBuilder::add_car_to_snapshot(const Car& car, const int& player_id,
     ps.z = static_cast<uint8_t>(car.get_level());
     ps.angle = static_cast<uint32_t>(angle_between_0_and_360(angle_deg));
 
-    // Iteramos todos los sensores de checkpoint del mapa
-    const auto& sens = physics.get_sensors();
-
-    int max_order = 0;
-    if (!sens.empty()) {
-        auto it = std::max_element(sens.begin(), sens.end(), [](const auto& a, const auto& b) {
-            return *a.get_orderPtr() < *b.get_orderPtr();
-        });
-        max_order = *it->get_orderPtr();
-    }
-
-    RaceProgress rp = race_progress[player_id];
-    int next_checkpoint = rp.next_order;
+    // Solo el orden: las celdas estan en la tabla de checkpoints que ya tiene el snapshot
+    ps.next_order = static_cast<uint16_t>(race_progress[player_id].next_order);
 
-    int next_next_checkpoint = -1;
-    ps.there_is_second_checkpoint = 0;
+    snapshot.players.push_back(ps);
+}
 
-    if (next_checkpoint < max_order) {
-        next_next_checkpoint = next_checkpoint + 1;
+const std::shared_ptr<const CheckpointTable>& SnapshotBuilder::get_checkpoint_table() {
+    if (checkpoints) {
+        return checkpoints;
     }
 
-    for (const auto& s: sens) {
-        if (next_checkpoint == *s.get_orderPtr()) {
+    // Una sola vez por carrera: agrupamos los sensores por orden (puede haber varios sensores
+    // con el mismo orden) y armamos el indice orden -> checkpoint
+    auto table = std::make_shared<CheckpointTable>();
+    for (const auto& s: physics.get_sensors()) {
+        const int order = s.get_order();
+        if (order < 0) {
+            continue;
+        }
+        if (static_cast<std::size_t>(order) >= table->index_by_order.size()) {
+            table->index_by_order.resize(static_cast<std::size_t>(order) + 1, -1);
+        }
+        if (table->index_by_order[order] < 0) {
+            table->index_by_order[order] = static_cast<int>(table->checkpoints.size());
+            table->checkpoints.push_back(CheckpointInfo{order, 0x00, {}});
+        }
 
-            ps.next_checkpoint.push_back(
-                    Coord{.x_px = static_cast<uint32_t>(s.get_position_in_px_X()),
-                          .y_px = static_cast<uint32_t>(s.get_position_in_px_Y())});
-            if (s.is_goal()) {
-                ps.goal = 0x01;
-            }
-        } else if (next_next_checkpoint != -1 && next_next_checkpoint == *s.get_orderPtr()) {
-            ps.there_is_second_checkpoint = 1;
-            ps.next_next_checkpoint.push_back(
-                    Coord{.x_px = static_cast<uint32_t>(s.get_position_in_px_X()),
-                          .y_px = static_cast<uint32_t>(s.get_position_in_px_Y())});
-            if (s.is_goal()) {
-                ps.next_next_goal = 0x01;
-            }
+        CheckpointInfo& cp = table->checkpoints[table->index_by_order[order]];
+        for (const auto& c: s.get_cells_px()) {
+            cp.cells.push_back(Coord{.x_px = static_cast<uint32_t>(c.x_px),
+                                     .y_px = static_cast<uint32_t>(c.y_px)});
         }
+        if (s.is_goal()) {
+            cp.goal = 0x01;
+        }
+        table->max_order = std::max(table->max_order, order);
     }
-    snapshot.players.push_back(ps);
+
+    // Ordenados por orden; hay que rehacer el indice despues de ordenar
+    std::sort(table->checkpoints.begin(), table->checkpoints.end(),
+              [](const CheckpointInfo& a, const CheckpointInfo& b) { return a.order < b.order; });
+    for (std::size_t i = 0; i < table->checkpoints.size(); ++i) {
+        table->index_by_order[table->checkpoints[i].order] = static_cast<int>(i);
+    }
+
+    checkpoints = std::move(table);
+    return checkpoints;
 }
 
 float SnapshotBuilder::angle_between_0_and_360(float angle) {
@@ -160,6 +212,7 @@ void SnapshotBuilder::send_pre_game_snapshot(const int remaining, const double r
     data.pole = pole_position;
     data.race_total_time_seconds = static_cast<uint32_t>(race_total_time);
     data.race_move_enabled_time_seconds = static_cast<uint32_t>(race_duration);
+    data.checkpoints = get_checkpoint_table();
 
     auto ev = std::make_shared<PreGameSnapshotEvent>(std::move(data));
     registry.broadcast(ev);
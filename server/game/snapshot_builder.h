@@ -11,8 +11,10 @@
 #include "../event.h"
 
 #include "car.h"
+#include "interest_manager.h"
 #include "physic_world.h"
 #include "race_progress.h"
+#include "tick_profiler.h"
 
 class SnapshotBuilder {
 
@@ -21,6 +23,14 @@ private:
 
     ClientRegistryMonitor& registry;
 
+    // Que NPCs y autos van en la snapshot de cada cliente
+    InterestManager interest;
+
+    // Checkpoints de la carrera, se arma la primera vez que se pide
+    std::shared_ptr<const CheckpointTable> checkpoints;
+
+    const std::shared_ptr<const CheckpointTable>& get_checkpoint_table();
+
     // Maximo siempre 3 slots de podio
     static constexpr uint8_t MAX_PODIUM_SLOTS = 3;
 
@@ -41,7 +51,8 @@ public:
 
     void send_snapshot(double& snapshot_acumulate, const float snapshot_interval,
                        const std::map<int, Car>& cars, std::map<int, RaceProgress>& race_progress,
-                       double race_with_countdown, const std::list<Car>& npc_cars);
+                       double race_with_countdown, const std::list<Car>& npc_cars,
+                       TickProfiler& profiler);
 
     void send_pre_game_snapshot(const int remaining, const double race_total_time,
                                 const double race_duration, MapId map_id,
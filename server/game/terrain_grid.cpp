@@ -0,0 +1,22 @@
+#include "terrain_grid.h"
+
+#include <stdexcept>
+#include <utility>
+
+TerrainGrid::TerrainGrid(int width, int height, std::vector<uint8_t>&& cells):
+        width(width), height(height) {
+    if (width <= 0 || height <= 0 || cells.size() != static_cast<std::size_t>(width) * height) {
+        throw std::runtime_error("TerrainGrid: la grilla no coincide con las dimensiones");
+    }
+    auto owned = std::make_shared<const std::vector<uint8_t>>(std::move(cells));
+    this->cells = owned->data();
+    storage = std::move(owned);
+}
+
+TerrainGrid::TerrainGrid(int width, int height, const uint8_t* cells,
+                         std::shared_ptr<const void> owner):
+        width(width), height(height), storage(std::move(owner)), cells(cells) {
+    if (width <= 0 || height <= 0 || !this->cells) {
+        throw std::runtime_error("TerrainGrid: grilla vacía");
+    }
+}
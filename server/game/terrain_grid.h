@@ -0,0 +1,107 @@
+#ifndef TERRAIN_GRID_H
+#define TERRAIN_GRID_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../../common/map_file.h"
+
+// Atributos de una celda. Una celda puede tener varios (ej: subida de puente + pole)
+enum TerrainAttribute : uint8_t {
+    TERRAIN_NONE = 0,
+    TERRAIN_DRIVEABLE = 1 << 0,  // Calle por donde pueden andar los NPCs
+    TERRAIN_SLOW = 1 << 1,       // Pasto, vereda, etc. Se anda mas lento
+    TERRAIN_WALL_L0 = 1 << 2,    // Bloquea en altura 0
+    TERRAIN_WALL_L1 = 1 << 3,    // Bloquea en altura 1
+    TERRAIN_BRIDGE_UP = 1 << 4,
+    TERRAIN_BRIDGE_DOWN = 1 << 5,
+    TERRAIN_POLE = 1 << 6,
+    TERRAIN_GOAL = 1 << 7
+};
+
+// Tabla codigo de celda -> atributos. Se arma en tiempo de compilacion
+constexpr std::array<uint8_t, 256> make_terrain_attribute_table() {
+    std::array<uint8_t, 256> t{};  // Los codigos desconocidos no tienen atributos
+
+    t[CELL_WALL] = TERRAIN_WALL_L0 | TERRAIN_WALL_L1;
+    t[CELL_ROAD] = TERRAIN_DRIVEABLE;
+    t[CELL_POLE] = TERRAIN_DRIVEABLE | TERRAIN_POLE;
+    t[CELL_GOAL] = TERRAIN_DRIVEABLE | TERRAIN_GOAL;
+    t[CELL_CHECKPOINT] = TERRAIN_NONE;
+    t[CELL_SLOW] = TERRAIN_SLOW;
+    // Se pueden transitar en altura 0, pero en 1 bloquean
+    t[CELL_WALL_L1_ONLY] = TERRAIN_DRIVEABLE | TERRAIN_WALL_L1;
+    // dejan el paso en altura 1 pero en altura 0 bloquean
+    t[CELL_WALL_L0_ONLY] = TERRAIN_WALL_L0;
+    t[CELL_BRIDGE_UP] = TERRAIN_DRIVEABLE | TERRAIN_BRIDGE_UP;
+    t[CELL_BRIDGE_DOWN] = TERRAIN_DRIVEABLE | TERRAIN_BRIDGE_DOWN;
+    t[CELL_BRIDGE_UP_AND_POLE] = TERRAIN_DRIVEABLE | TERRAIN_BRIDGE_UP | TERRAIN_POLE;
+    t[CELL_BRIDGE_DOWN_AND_POLE] = TERRAIN_DRIVEABLE | TERRAIN_BRIDGE_DOWN | TERRAIN_POLE;
+    t[CELL_BRIDGE_UP_AND_GOAL] = TERRAIN_DRIVEABLE | TERRAIN_BRIDGE_UP | TERRAIN_GOAL;
+    t[CELL_BRIDGE_DOWN_AND_GOAL] = TERRAIN_DRIVEABLE | TERRAIN_BRIDGE_DOWN | TERRAIN_GOAL;
+    t[CELL_BRIDGE_UP_AND_CHECKPOINT] = TERRAIN_DRIVEABLE | TERRAIN_BRIDGE_UP;
+    t[CELL_BRIDGE_DOWN_AND_CHECKPOINT] = TERRAIN_DRIVEABLE | TERRAIN_BRIDGE_DOWN;
+    return t;
+}
+
+inline constexpr std::array<uint8_t, 256> TERRAIN_ATTRIBUTES = make_terrain_attribute_table();
+
+/*
+Mapa: 290 x 292 celdas
+Cada celda: 16×16 px
+Física box2D: 1 celda = 1 metro
+*/
+
+// Grilla del mapa, inmutable una vez creada. Guarda un byte (el codigo de celda) por celda,
+// fila por fila, y responde los atributos de cualquier celda en O(1) con la tabla de arriba.
+// Los bytes pueden ser propios o vivir en un .n4smap mapeado en memoria (sin copiarlos)
+class TerrainGrid {
+private:
+    int width = 0;
+    int height = 0;
+
+    // Duenio de la memoria de la grilla (un vector propio o el archivo mapeado)
+    std::shared_ptr<const void> storage;
+
+    // codigo de cada celda, cells[row * width + col]
+    const uint8_t* cells = nullptr;
+
+public:
+    TerrainGrid() = default;
+
+    // Se queda con la grilla ya empaquetada (un byte por celda, fila por fila)
+    TerrainGrid(int width, int height, std::vector<uint8_t>&& cells);
+
+    // Usa la grilla que vive en otra memoria (ej: un archivo mapeado), que owner mantiene viva
+    TerrainGrid(int width, int height, const uint8_t* cells, std::shared_ptr<const void> owner);
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+
+    bool in_bounds(int col, int row) const {
+        return col >= 0 && row >= 0 && col < width && row < height;
+    }
+
+    uint8_t code_at(int col, int row) const {
+        return cells[static_cast<std::size_t>(row) * width + col];
+    }
+
+    // Fuera del mapa no hay atributos
+    uint8_t attributes_at(int col, int row) const {
+        return in_bounds(col, row) ? TERRAIN_ATTRIBUTES[code_at(col, row)] :
+                                     static_cast<uint8_t>(TERRAIN_NONE);
+    }
+
+    bool has(int col, int row, uint8_t attribute) const {
+        return (attributes_at(col, row) & attribute) != 0;
+    }
+
+    // Igual que has() pero con una posicion del mundo en metros (Y invertida respecto de la matriz)
+    bool has_at_world(float x, float y, uint8_t attribute) const {
+        return has(static_cast<int>(x), height - 1 - static_cast<int>(y), attribute);
+    }
+};
+
+#endif  // TERRAIN_GRID_H
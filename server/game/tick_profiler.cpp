@@ -0,0 +1,142 @@
+#include "tick_profiler.h"
+
+#include <algorithm>
+#include <bit>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+static constexpr std::array<const char*, static_cast<std::size_t>(TickPhase::Count)>
+        PHASE_NAMES = {"receive_commands", "update_npcs",    "apply_player_inputs",
+                       "step_physics",     "race_contacts",  "build_snapshot",
+                       "broadcast",        "tick"};
+
+// Entre dos dumps por ticks pasados de presupuesto esperamos al menos esto
+static constexpr auto OVERRUN_DUMP_COOLDOWN = std::chrono::seconds(1);
+
+static double ns_to_ms(int64_t ns) { return static_cast<double>(ns) / 1e6; }
+
+std::size_t PhaseHistogram::bucket_of(int64_t ns) {
+    if (ns < SUB_BUCKETS) {
+        return ns <= 0 ? 0 : static_cast<std::size_t>(ns);
+    }
+    const auto v = static_cast<uint64_t>(ns);
+    const int shift = static_cast<int>(std::bit_width(v)) - 1 - SUB_BUCKET_BITS;
+    const auto sub = static_cast<std::size_t>((v >> shift) & (SUB_BUCKETS - 1));
+    return std::min(BUCKETS - 1, static_cast<std::size_t>(shift + 1) * SUB_BUCKETS + sub);
+}
+
+int64_t PhaseHistogram::upper_bound_of(std::size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return static_cast<int64_t>(bucket);
+    }
+    const int shift = static_cast<int>(bucket / SUB_BUCKETS) - 1;
+    const auto sub = static_cast<int64_t>(bucket % SUB_BUCKETS);
+    const int64_t lower = (SUB_BUCKETS + sub) << shift;
+    return lower + (int64_t{1} << shift) - 1;
+}
+
+void PhaseHistogram::record(int64_t ns) {
+    buckets[bucket_of(ns)]++;
+    count++;
+    max_ns = std::max(max_ns, ns);
+}
+
+int64_t PhaseHistogram::percentile(double p) const {
+    if (count == 0) {
+        return 0;
+    }
+    const auto target = static_cast<uint64_t>(p * static_cast<double>(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= target) {
+            // La cota del bucket nunca puede pasarse del maximo real
+            return std::min(upper_bound_of(i), max_ns);
+        }
+    }
+    return max_ns;
+}
+
+void PhaseHistogram::reset() {
+    buckets.fill(0);
+    count = 0;
+    max_ns = 0;
+}
+
+TickProfiler::TickProfiler(std::string name, TickClock::duration budget,
+                           TickClock::duration dump_interval):
+        name(std::move(name)),
+        budget(budget),
+        dump_interval(dump_interval),
+        window_start(TickClock::now()),
+        last_overrun_dump(window_start - OVERRUN_DUMP_COOLDOWN) {}
+
+void TickProfiler::end_tick(TickClock::duration tick_elapsed) {
+    current_tick_ns[static_cast<std::size_t>(TickPhase::Tick)] =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(tick_elapsed).count();
+
+    for (std::size_t i = 0; i < PHASES; ++i) {
+        // Las fases que no corrieron en este tick (p. ej. fisica fuera de carrera) no cuentan
+        if (current_tick_ns[i] > 0) {
+            histograms[i].record(current_tick_ns[i]);
+        }
+    }
+
+    const auto now = TickClock::now();
+    if (tick_elapsed > budget) {
+        overruns++;
+        if (now - last_overrun_dump >= OVERRUN_DUMP_COOLDOWN) {
+            last_overrun_dump = now;
+            dump("tick pasado de presupuesto", now);
+        }
+    }
+
+    current_tick_ns.fill(0);
+
+    if (dump_interval > TickClock::duration::zero() && now - window_start >= dump_interval) {
+        dump("periodico", now);
+        for (auto& h: histograms) {
+            h.reset();
+        }
+        window_start = now;
+    }
+}
+
+void TickProfiler::record_race_preparation(double preparation_ms, double stall_ms) {
+    race_preparation.record(static_cast<int64_t>(preparation_ms * 1e6));
+    race_stall.record(static_cast<int64_t>(stall_ms * 1e6));
+}
+
+void TickProfiler::dump(const char* reason, const TickClock::time_point& now) {
+    const double window_s = std::chrono::duration<double>(now - window_start).count();
+    const int64_t budget_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(budget).count();
+
+    // Se arma entero y se imprime de una, asi no se mezcla con lo que imprimen otras partidas
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << "TickProfiler[" << name << "] " << reason << ": "
+        << histograms[static_cast<std::size_t>(TickPhase::Tick)].get_count() << " ticks en "
+        << window_s << " s, " << overruns << " pasados de " << ns_to_ms(budget_ns) << " ms\n";
+
+    for (std::size_t i = 0; i < PHASES; ++i) {
+        const PhaseHistogram& h = histograms[i];
+        out << "  " << std::left << std::setw(20) << PHASE_NAMES[i] << std::right
+            << " p50=" << ns_to_ms(h.percentile(0.50)) << " p99=" << ns_to_ms(h.percentile(0.99))
+            << " max=" << ns_to_ms(h.get_max_ns()) << " ms";
+        if (current_tick_ns[i] > 0) {
+            // Lo que tardo en el tick que disparo el dump
+            out << " (ultimo=" << ns_to_ms(current_tick_ns[i]) << " ms)";
+        }
+        out << "\n";
+    }
+    if (race_preparation.get_count() > 0) {
+        out << "  " << std::left << std::setw(20) << "race_preparation" << std::right
+            << " p50=" << ns_to_ms(race_preparation.percentile(0.50))
+            << " max=" << ns_to_ms(race_preparation.get_max_ns())
+            << " ms, espera del tick max=" << ns_to_ms(race_stall.get_max_ns()) << " ms ("
+            << race_preparation.get_count() << " carreras)\n";
+    }
+    std::cout << out.str() << std::flush;
+}
@@ -0,0 +1,111 @@
+#ifndef TICK_PROFILER_H
+#define TICK_PROFILER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "tick_scheduler.h"
+
+// Fases de un tick del gameloop que se miden por separado
+enum class TickPhase : std::size_t {
+    ReceiveCommands = 0,
+    UpdateNpcs,
+    ApplyInputs,
+    StepPhysics,
+    RaceAndContacts,
+    BuildSnapshot,
+    Broadcast,
+    Tick,  // el tick entero
+    Count
+};
+
+// Histograma log-lineal de duraciones: 8 buckets por potencia de 2, o sea ~12% de error
+// en los percentiles. Tamaño fijo y sin allocs, registrar es una cuenta de bits y un ++
+class PhaseHistogram {
+private:
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr std::size_t BUCKETS = 64 * SUB_BUCKETS;
+
+    std::array<uint32_t, BUCKETS> buckets{};
+    uint64_t count = 0;
+    int64_t max_ns = 0;
+
+    static std::size_t bucket_of(int64_t ns);
+    static int64_t upper_bound_of(std::size_t bucket);
+
+public:
+    void record(int64_t ns);
+
+    // Cota superior del percentil p (0..1), en nanosegundos
+    int64_t percentile(double p) const;
+
+    int64_t get_max_ns() const { return max_ns; }
+    uint64_t get_count() const { return count; }
+
+    void reset();
+};
+
+// Profiler por partida. Acumula cuanto tarda cada fase dentro del tick y al cerrarlo lo vuelca
+// en los histogramas de la ventana actual. Cada dump_interval imprime p50/p99/max y arranca
+// una ventana nueva; si un tick se pasa del presupuesto imprime enseguida (con tope de uno por
+// segundo para no inundar el log)
+class TickProfiler {
+private:
+    static constexpr std::size_t PHASES = static_cast<std::size_t>(TickPhase::Count);
+
+    std::string name;
+    TickClock::duration budget;
+    TickClock::duration dump_interval;
+
+    std::array<PhaseHistogram, PHASES> histograms;
+    std::array<int64_t, PHASES> current_tick_ns{};
+
+    TickClock::time_point window_start;
+    TickClock::time_point last_overrun_dump;
+    uint64_t overruns = 0;
+
+    // Preparacion de cada carrera en segundo plano y cuanto la tuvo que esperar el tick. Hay
+    // una por carrera, asi que no se reinician con cada ventana
+    PhaseHistogram race_preparation;
+    PhaseHistogram race_stall;
+
+    void dump(const char* reason, const TickClock::time_point& now);
+
+public:
+    // dump_interval cero desactiva el dump periodico
+    TickProfiler(std::string name, TickClock::duration budget, TickClock::duration dump_interval);
+
+    // Mide el tiempo hasta que se destruye el Scope y lo suma a la fase
+    class Scope {
+    private:
+        TickProfiler& profiler;
+        TickPhase phase;
+        TickClock::time_point t0;
+
+    public:
+        Scope(TickProfiler& profiler, TickPhase phase):
+                profiler(profiler), phase(phase), t0(TickClock::now()) {}
+        ~Scope() { profiler.add(phase, TickClock::now() - t0); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    void add(TickPhase phase, TickClock::duration elapsed) {
+        current_tick_ns[static_cast<std::size_t>(phase)] +=
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }
+
+    // Cierra el tick: pasa lo acumulado a los histogramas y decide si hay que imprimir
+    void end_tick(TickClock::duration tick_elapsed);
+
+    // Una carrera nueva entro en juego: cuanto tardo en armarse y cuanto la espero el tick
+    void record_race_preparation(double preparation_ms, double stall_ms);
+
+    uint64_t get_overruns() const { return overruns; }
+};
+
+#endif  // TICK_PROFILER_H
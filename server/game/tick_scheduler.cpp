@@ -0,0 +1,245 @@
+#include "tick_scheduler.h"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+
+// Atraso a partir del cual un tick cuenta como tarde
+static constexpr auto LATE_TOLERANCE = std::chrono::milliseconds(1);
+
+void TickTask::on_scheduled() {
+    _keep_running = true;
+    _is_alive = true;
+}
+
+void TickTask::on_unscheduled() {
+    std::lock_guard<std::mutex> lock(m);
+    _is_alive = false;
+    finished.notify_all();
+}
+
+void TickTask::record_lateness(TickClock::duration lateness) {
+    if (lateness > LATE_TOLERANCE) {
+        late_ticks.fetch_add(1, std::memory_order_relaxed);
+    }
+    const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(lateness).count();
+    if (ns > max_lateness_ns.load(std::memory_order_relaxed)) {
+        max_lateness_ns.store(ns, std::memory_order_relaxed);
+    }
+}
+
+void TickTask::join() {
+    std::unique_lock<std::mutex> lock(m);
+    finished.wait(lock, [this]() { return !_is_alive; });
+}
+
+TickWorker::TickWorker(TickScheduler& scheduler, std::size_t index):
+        scheduler(scheduler), index(index) {}
+
+void TickWorker::update_next_deadline() {
+    next_deadline = ticks.empty() ? NO_DEADLINE : to_ns(ticks.top().deadline);
+}
+
+void TickWorker::push(const ScheduledTick& scheduled) {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        ticks.push(scheduled);
+        update_next_deadline();
+        wakeup.notify_one();
+    }
+    // Si esta ocupado (le llego una partida nueva mientras corre otra) puede que no llegue
+    if (busy) {
+        wake_idle_peer(to_ns(scheduled.deadline));
+    }
+}
+
+void TickWorker::wake_idle_peer(int64_t deadline) {
+    const std::size_t n = scheduler.workers.size();
+    for (std::size_t i = 1; i < n; ++i) {
+        TickWorker& peer = *scheduler.workers[(index + i) % n];
+        if (peer.sleeping_until > deadline) {
+            // Con su m tomado: o ya esta en wait y lo despertamos, o todavia no calculo hasta
+            // cuando dormir y va a ver que estamos ocupados
+            std::lock_guard<std::mutex> lock(peer.m);
+            peer.wakeup.notify_one();
+            return;
+        }
+    }
+}
+
+int64_t TickWorker::earliest_deadline_to_watch() const {
+    int64_t until = next_deadline;
+    for (const auto& w: scheduler.workers) {
+        if (w.get() != this && w->busy) {
+            until = std::min(until, w->next_deadline.load());
+        }
+    }
+    return until;
+}
+
+std::size_t TickWorker::size() {
+    std::lock_guard<std::mutex> lock(m);
+    return ticks.size();
+}
+
+bool TickWorker::pop_due(TickClock::time_point now, ScheduledTick& out) {
+    std::lock_guard<std::mutex> lock(m);
+    if (ticks.empty() || ticks.top().deadline > now) {
+        return false;
+    }
+    out = ticks.top();
+    ticks.pop();
+    update_next_deadline();
+    return true;
+}
+
+bool TickWorker::try_steal_due(TickClock::time_point now, ScheduledTick& out) {
+    const std::size_t n = scheduler.workers.size();
+    for (std::size_t i = 1; i < n; ++i) {
+        TickWorker& victim = *scheduler.workers[(index + i) % n];
+
+        // Si el otro tiene el lock tomado no lo esperamos, probamos con el siguiente
+        std::unique_lock<std::mutex> lock(victim.m, std::try_to_lock);
+        if (!lock.owns_lock() || victim.ticks.empty() || victim.ticks.top().deadline > now) {
+            continue;
+        }
+        out = victim.ticks.top();
+        victim.ticks.pop();
+        victim.update_next_deadline();
+        return true;
+    }
+    return false;
+}
+
+void TickWorker::run_tick(ScheduledTick& scheduled) {
+    const auto frame_start = TickClock::now();
+    scheduled.task->record_lateness(frame_start - scheduled.deadline + scheduled.skipped);
+
+    bool again = false;
+    try {
+        again = scheduled.task->tick();
+    } catch (const std::exception& e) {
+        std::cerr << "TickWorker: excepcion en tick: " << e.what() << "\n";
+    } catch (...) {
+        std::cerr << "TickWorker: excepcion desconocida en tick\n";
+    }
+
+    if (!again) {
+        // Ultimo acceso a la tarea: despues de esto el dueño puede destruirla
+        scheduled.task->on_unscheduled();
+        return;
+    }
+
+    // Deadlines absolutos: el proximo frame vence un periodo despues del deadline anterior
+    // (no de cuando arranco este), asi el error no se acumula. Si nos atrasamos mas de un
+    // periodo corremos uno solo de inmediato (el deadline perdido mas reciente) en vez de una
+    // rafaga de ticks seguidos; el gameloop recupera el tiempo con sus acumuladores
+    const auto period = scheduled.task->tick_period();
+    scheduled.deadline += period;
+    scheduled.skipped = TickClock::duration::zero();
+    const auto now = TickClock::now();
+    if (scheduled.deadline < now && period.count() > 0) {
+        scheduled.skipped = ((now - scheduled.deadline) / period) * period;
+        scheduled.deadline += scheduled.skipped;
+    }
+    push(scheduled);
+}
+
+void TickWorker::run() {
+    while (should_keep_running()) {
+        const auto now = TickClock::now();
+
+        ScheduledTick scheduled{};
+        if (pop_due(now, scheduled) || try_steal_due(now, scheduled)) {
+            busy = true;
+            // Lo que nos quede en cola puede vencer mientras corremos este
+            const int64_t queued = next_deadline;
+            if (queued != NO_DEADLINE) {
+                wake_idle_peer(queued);
+            }
+            run_tick(scheduled);
+            busy = false;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m);
+        if (!should_keep_running()) {
+            break;
+        }
+        // Primero nos anotamos como dormidos (sin limite) y despues miramos quien esta ocupado:
+        // un worker que se ocupe entre medio ve la marca y nos despierta
+        sleeping_until = NO_DEADLINE;
+        const int64_t until = earliest_deadline_to_watch();
+        sleeping_until = until;
+        if (until == NO_DEADLINE) {
+            wakeup.wait(lock);
+        } else {
+            // Espera con deadline absoluto sobre el reloj monotono (pthread_cond_clockwait),
+            // igual que clock_nanosleep(TIMER_ABSTIME) pero despertable cuando llega un tick
+            // nuevo o stop()
+            wakeup.wait_until(lock, TickClock::time_point(std::chrono::nanoseconds(until)));
+        }
+        sleeping_until = 0;
+    }
+
+    // Soltamos lo que haya quedado para que nadie se quede trabado en join()
+    std::lock_guard<std::mutex> lock(m);
+    while (!ticks.empty()) {
+        ticks.top().task->on_unscheduled();
+        ticks.pop();
+    }
+}
+
+void TickWorker::stop() {
+    Thread::stop();
+    std::lock_guard<std::mutex> lock(m);
+    wakeup.notify_all();
+}
+
+TickScheduler::TickScheduler(std::size_t workers_count) {
+    if (workers_count == 0) {
+        workers_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Primero se crean todos y despues se arrancan: los workers se miran entre si para robar
+    workers.reserve(workers_count);
+    for (std::size_t i = 0; i < workers_count; ++i) {
+        workers.push_back(std::make_unique<TickWorker>(*this, i));
+    }
+    for (auto& w: workers) {
+        w->start();
+    }
+    std::cout << "TickScheduler: " << workers.size() << " workers\n";
+}
+
+void TickScheduler::schedule(TickTask& task) {
+    // Worker menos cargado, arrancando en uno distinto cada vez para repartir los empates
+    const std::size_t n = workers.size();
+    const std::size_t first = next_worker++ % n;
+    std::size_t best = first;
+    std::size_t best_size = workers[first]->size();
+    for (std::size_t i = 1; i < n && best_size > 0; ++i) {
+        const std::size_t idx = (first + i) % n;
+        const std::size_t size = workers[idx]->size();
+        if (size < best_size) {
+            best = idx;
+            best_size = size;
+        }
+    }
+
+    task.on_scheduled();
+    workers[best]->push(ScheduledTick{TickClock::now(), &task});
+}
+
+void TickScheduler::stop() {
+    for (auto& w: workers) {
+        w->stop();
+    }
+    for (auto& w: workers) {
+        w->join();
+    }
+    // Asi un segundo stop() (el del destructor) no hace nada
+    workers.clear();
+}
+
+TickScheduler::~TickScheduler() { stop(); }
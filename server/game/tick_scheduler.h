@@ -0,0 +1,174 @@
+#ifndef TICK_SCHEDULER_H
+#define TICK_SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+#include "../../common/thread.h"
+
+using TickClock = std::chrono::steady_clock;
+
+// Algo que se ejecuta de a ticks en el pool compartido del server (hoy, los gameloops).
+// Reemplaza a Thread: en vez de tener un hilo propio que duerme entre frames, el scheduler
+// llama a tick() cada vez que vence su deadline. La interfaz de ciclo de vida es la misma
+// (stop/join/is_alive) para que Game no tenga que cambiar
+class TickTask {
+private:
+    std::atomic<bool> _keep_running{true};
+    std::atomic<bool> _is_alive{false};
+
+    // Metricas de puntualidad (las escribe solo el worker que corre la tarea)
+    std::atomic<uint64_t> late_ticks{0};
+    std::atomic<int64_t> max_lateness_ns{0};
+
+    // Para que join() espere a que el scheduler suelte la tarea
+    std::mutex m;
+    std::condition_variable finished;
+
+    friend class TickScheduler;
+    friend class TickWorker;
+
+    // Lo llama el scheduler al encolarla y cuando la saca para siempre.
+    // Despues de on_unscheduled el scheduler no vuelve a tocar la tarea
+    void on_scheduled();
+    void on_unscheduled();
+    void record_lateness(TickClock::duration lateness);
+
+protected:
+    bool should_keep_running() const { return _keep_running; }
+
+public:
+    TickTask() = default;
+
+    // Corre un frame. Devuelve false si la tarea termino y no hay que volver a llamarla.
+    // Nunca se corre en dos workers a la vez
+    virtual bool tick() = 0;
+
+    // Cada cuanto hay que correr tick()
+    virtual TickClock::duration tick_period() const = 0;
+
+    void stop() { _keep_running = false; }
+
+    // Bloquea hasta que el scheduler haya soltado la tarea
+    void join();
+
+    bool is_alive() const { return _is_alive; }
+
+    // Ticks que arrancaron mas de LATE_TOLERANCE despues de su deadline, y el peor atraso
+    uint64_t get_late_ticks() const { return late_ticks; }
+    TickClock::duration get_max_lateness() const {
+        return std::chrono::nanoseconds(max_lateness_ns.load());
+    }
+
+    virtual ~TickTask() = default;
+    TickTask(const TickTask&) = delete;
+    TickTask& operator=(const TickTask&) = delete;
+};
+
+struct ScheduledTick {
+    TickClock::time_point deadline;
+    TickTask* task;
+    // Deadlines perdidos que se saltearon al reprogramar (para medir bien el atraso)
+    TickClock::duration skipped{0};
+};
+
+// Ordena la cola de prioridad por deadline (el mas proximo arriba)
+struct LaterDeadline {
+    bool operator()(const ScheduledTick& a, const ScheduledTick& b) const {
+        return a.deadline > b.deadline;
+    }
+};
+
+class TickScheduler;
+
+// Cada worker tiene su propia cola ordenada por deadline. Si no tiene nada vencido,
+// intenta robarle a otro worker un tick ya vencido (el otro esta ocupado corriendo algo).
+//
+// Un worker sin nada que hacer no sondea: duerme hasta el proximo deadline propio o de algun
+// worker ocupado (que quizas no llegue a correrlo), y si no hay ninguno hasta que lo despierten.
+// Un worker que arranca un tick teniendo otros en cola despierta a un par dormido que no
+// pensaba despertarse a tiempo para el proximo
+class TickWorker: public Thread {
+private:
+    // "Nunca", para next_deadline y sleeping_until
+    static constexpr int64_t NO_DEADLINE = INT64_MAX;
+
+    TickScheduler& scheduler;
+    std::size_t index;
+
+    std::mutex m;
+    std::condition_variable wakeup;
+    std::priority_queue<ScheduledTick, std::vector<ScheduledTick>, LaterDeadline> ticks;
+
+    // Lo que los otros workers miran sin tomar m (en ns de TickClock)
+    // Deadline del primero de la cola, NO_DEADLINE si esta vacia. Se escribe con m tomado
+    std::atomic<int64_t> next_deadline{NO_DEADLINE};
+    // Hasta cuando duerme este worker (0 = esta despierto, no hace falta avisarle)
+    std::atomic<int64_t> sleeping_until{0};
+    // Esta corriendo un tick: lo que tenga en cola puede vencer sin que lo atienda
+    std::atomic<bool> busy{false};
+
+    friend class TickScheduler;
+
+    static int64_t to_ns(TickClock::time_point t) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch())
+                .count();
+    }
+
+    // Con m tomado, despues de tocar la cola
+    void update_next_deadline();
+
+    // Saca el proximo tick si ya vencio
+    bool pop_due(TickClock::time_point now, ScheduledTick& out);
+    bool try_steal_due(TickClock::time_point now, ScheduledTick& out);
+    void run_tick(ScheduledTick& scheduled);
+
+    // Estando ocupado: despierta a un worker que duerme mas alla de deadline
+    void wake_idle_peer(int64_t deadline);
+    // Hasta cuando puede dormir: su proximo deadline o el de algun worker ocupado
+    int64_t earliest_deadline_to_watch() const;
+
+public:
+    TickWorker(TickScheduler& scheduler, std::size_t index);
+
+    void push(const ScheduledTick& scheduled);
+    std::size_t size();
+
+    void run() override;
+    void stop() override;
+};
+
+// Pool fijo de workers que corre los ticks de todas las partidas del server
+class TickScheduler {
+private:
+    // std::unique_ptr porque Thread no se puede mover
+    std::vector<std::unique_ptr<TickWorker>> workers;
+    std::atomic<std::size_t> next_worker{0};
+
+    friend class TickWorker;
+
+public:
+    // workers == 0 usa un worker por core
+    explicit TickScheduler(std::size_t workers);
+
+    // Agrega la tarea al worker menos cargado. Su primer tick se corre de inmediato
+    void schedule(TickTask& task);
+
+    std::size_t worker_count() const { return workers.size(); }
+
+    // Frena y espera a todos los workers. Las tareas que queden se sueltan sin volver a correr
+    void stop();
+
+    ~TickScheduler();
+    TickScheduler(const TickScheduler&) = delete;
+    TickScheduler& operator=(const TickScheduler&) = delete;
+};
+
+#endif  // TICK_SCHEDULER_H
@@ -36,6 +36,16 @@ void WorldState::change_d(bool new_state, const int client_id) {
     keys.d = new_state;
 }
 
+void WorldState::set_keys(uint32_t sequence, const teclas_presionadas& keys,
+                          const int client_id) {
+    auto& current = inputs_for(client_id);
+    if (sequence <= current.sequence) {
+        return;
+    }
+    current = keys;
+    current.sequence = sequence;
+}
+
 std::size_t WorldState::number_of_players() const { return cars.size(); }
 
 void WorldState::add_new_car(Spawn&& spawn, uint16_t new_car_model, int client_id,
@@ -49,6 +59,7 @@ void WorldState::add_new_car(Spawn&& spawn, uint16_t new_car_model, int client_i
     // (*it).second = Car&
     Car& newCar = it->second;
     newCar.set_user_data();
+    newCar.set_owner_id(client_id);
 
     player_movements[client_id] = teclas_presionadas{};
     race_progress[client_id] = RaceProgress{};
@@ -61,7 +72,7 @@ void WorldState::apply_player_inputs() {
             Car& car = car_it->second;
 
             car.apply_input(keys.w, keys.s, keys.a, keys.d,
-                            car.is_on_slow_zone(pw.get_slow_cells(), pw.getHeightInMeters()));
+                            car.is_on_slow_zone(pw.get_terrain()));
         }
     }
 }
@@ -316,12 +327,3 @@ NpcDir WorldState::opposite_of(NpcDir dir) {
     }
     return dir;
 }
-
-int WorldState::get_owner_id(const Car* car) const {
-    for (const auto& [cid, c]: cars) {
-        if (&c == car) {
-            return cid;
-        }
-    }
-    return -1;
-}
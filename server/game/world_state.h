@@ -1,6 +1,7 @@
 #ifndef WORLD_STATE_H
 #define WORLD_STATE_H
 
+#include <cstdint>
 #include <list>
 #include <map>
 #include <vector>
@@ -11,6 +12,8 @@
 
 struct teclas_presionadas {
     bool w = false, a = false, s = false, d = false;
+    // Secuencia del ultimo estado completo que se aplico (0 = ninguno todavia)
+    uint32_t sequence = 0;
 };
 
 class WorldState {
@@ -53,6 +56,10 @@ public:
     void change_s(bool new_state, int client_id);
     void change_d(bool new_state, int client_id);
 
+    // Pisa las cuatro teclas de una, salvo que sequence no sea mas nueva que la ultima
+    // aplicada (el estado llego desordenado o repetido)
+    void set_keys(uint32_t sequence, const teclas_presionadas& keys, int client_id);
+
     std::size_t number_of_players() const;
 
     // Agrega un nuevo jugador y/o auto al juego!
@@ -74,8 +81,6 @@ public:
     void update_npcs();
     const std::list<Car>& get_npc_cars() const { return npc_cars; }
 
-    int get_owner_id(const Car* car) const;
-
     std::map<int, Car>& get_cars() { return cars; }
     const std::map<int, Car>& get_cars() const { return cars; }
 
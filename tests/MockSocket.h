@@ -9,6 +9,8 @@ class MockSocket: public ISocket {
 public:
     MOCK_METHOD(int, sendall, (const void* data, unsigned int sz), (override));
     MOCK_METHOD(int, recvall, (void* data, unsigned int size), (override));
+    MOCK_METHOD(int, recvsome, (void* data, unsigned int size), (override));
+    MOCK_METHOD(int, sendallv, (struct iovec* iov, int iovcnt), (override));
 
     MOCK_METHOD(int, close, (), (override));
 
@@ -3,6 +3,8 @@
 #include <gtest/gtest.h>
 
 #include "../client/ProtocolClient.h"
+#include "../client/SocketReadBuffer.h"
+#include "../common/liberror.h"
 
 #include "MockSocket.h"
 
@@ -385,7 +387,7 @@ TEST(ProtocolClientTest, ReceivePreGameSnapshot) {
 
     EXPECT_EQ(pg.start_line.top_left.coord_x, 100);
     EXPECT_EQ(pg.start_line.top_left.coord_y, 200);
-    EXPECT_EQ(pg.start_line.bottom_right.coord_x, 300);
+    EXPECT_EQ(pg.start_line.bottom_right.coord_x, 300u);
     EXPECT_EQ(pg.start_line.bottom_right.coord_y, 400);
 
     EXPECT_EQ(pg.start_line.direction, Direction::UP);
@@ -512,17 +514,64 @@ TEST(ProtocolClientSendTest, SendKeyMapsCorrectly) {
     EXPECT_CALL(mock, sendall(_, 2)).WillOnce([](const void* buf, unsigned) {
         const uint8_t* b = (uint8_t*)buf;
         EXPECT_EQ(b[0], INPUT_KEY);
-        EXPECT_EQ(b[1], UP_PRESSED);
+        EXPECT_EQ(b[1], COMMAND_GHOST);
         return 2;
     });
 
     ServerEventSender ev;
     ev.type = ServerEventSenderType::SEND_KEY;
-    ev.send_key.key = DirectionKey::UP_PRESSED;
+    ev.send_key.key = DirectionKey::GHOST;
 
     protocol.send_event(ev);
 }
 
+TEST(ProtocolClientSendTest, SendInputState) {
+    MockSocket mock;
+    ProtocolClient protocol(mock);
+
+    EXPECT_CALL(mock, is_stream_send_closed()).WillOnce(Return(false));
+    EXPECT_CALL(mock, sendall(_, 6)).WillOnce([](const void* buf, unsigned) {
+        const uint8_t* b = (uint8_t*)buf;
+        EXPECT_EQ(b[0], SEND_INPUT_STATE);
+        EXPECT_EQ(b[1], 0x00);
+        EXPECT_EQ(b[2], 0x00);
+        EXPECT_EQ(b[3], 0x01);
+        EXPECT_EQ(b[4], 0x02);
+        EXPECT_EQ(b[5], INPUT_STATE_UP | INPUT_STATE_RIGHT);
+        return 6;
+    });
+
+    ServerEventSender ev;
+    ev.type = ServerEventSenderType::SEND_INPUT_STATE;
+    ev.input_state.sequence = 0x0102;
+    ev.input_state.up = true;
+    ev.input_state.right = true;
+
+    protocol.send_event(ev);
+}
+
+TEST(ProtocolClientSendTest, InputSequenceSurvivesANewRace) {
+    MockSocket mock;
+    ProtocolClient protocol(mock);
+
+    // Primera partida: cada carrera arma su InputHandler, que no numera
+    SendInputState state;
+    for (int i = 0; i < 3; ++i) {
+        protocol.number_input_state(state);
+    }
+    EXPECT_EQ(state.sequence, 3u);
+
+    // Segunda partida por la misma conexion (misma sesion UDP en el server): la secuencia
+    // sigue, si no el server descarta los estados hasta pasar el ultimo de la anterior
+    SendInputState next_race;
+    next_race.up = true;
+    protocol.number_input_state(next_race);
+    EXPECT_EQ(next_race.sequence, 4u);
+    EXPECT_EQ(ProtocolClient::encode_udp_input_state(7, 1, next_race),
+              (std::vector<uint8_t>{UDP_INPUT_STATE, 0, 0, 0, 7, 0, 0, 0, 1, 0, 0, 0, 4,
+                                    INPUT_STATE_UP}));
+}
+
 TEST(ProtocolClientSendTest, SendLeaveLobbySendsOpcode) {
     MockSocket mock;
     ProtocolClient protocol(mock);
@@ -548,7 +597,7 @@ TEST(ProtocolClientSendTest, DoesNotSendIfSocketClosed) {
 
     ServerEventSender ev;
     ev.type = ServerEventSenderType::SEND_KEY;
-    ev.send_key.key = DirectionKey::UP_PRESSED;
+    ev.send_key.key = DirectionKey::GHOST;
 
     protocol.send_event(ev);
 }
@@ -720,3 +769,473 @@ TEST(ProtocolClientTest, ReceiveEventSocketClosed) {
 
     EXPECT_TRUE(closed);
 }
+
+TEST(ProtocolClientTest, ReceiveSnapshotDeltaAppliesOverBaseline) {
+    MockSocket mock;
+    ProtocolClient protocol(mock);
+    bool closed = false;
+
+    // Keyframe (seq 5) y despues una delta contra el (seq 6)
+    std::vector<uint8_t> wire;
+    auto u8 = [&](uint8_t v) { wire.push_back(v); };
+    auto u16 = [&](uint16_t v) {
+        u8(static_cast<uint8_t>(v >> 8));
+        u8(static_cast<uint8_t>(v));
+    };
+    auto u32 = [&](uint32_t v) {
+        u16(static_cast<uint16_t>(v >> 16));
+        u16(static_cast<uint16_t>(v));
+    };
+
+    u8(RECEIVE_SNAPSHOT_DELTA);
+    u32(5);
+    u32(0);
+    u32(30);
+    u16(1);
+    u32(42);
+    u16(PLAYER_DELTA_ALL);
+    u8(0);     // ghost
+    u16(100);  // life
+    u16(3);    // model
+    u8(1);     // animation
+    u8(0);     // sound
+    u32(10);   // x
+    u32(20);   // y
+    u8(0);     // z
+    u32(90);   // angle
+    u16(1);    // un checkpoint
+    u32(300);
+    u32(400);
+    u8(0);  // no es llegada
+    u8(0);  // sin secundario
+    u16(1);
+    u8(NPC_DELTA_ALL);
+    u16(7);
+    u8(2);
+    u32(50);
+    u32(60);
+    u8(1);
+    u32(180);
+
+    u8(RECEIVE_SNAPSHOT_DELTA);
+    u32(6);
+    u32(5);
+    u32(29);
+    u16(1);
+    u32(42);
+    u16(PLAYER_DELTA_X | PLAYER_DELTA_ANGLE);
+    u32(15);
+    u32(95);
+    u16(1);
+    u8(NPC_DELTA_Y);
+    u32(65);
+
+    std::size_t pos = 0;
+    EXPECT_CALL(mock, recvall(_, _)).WillRepeatedly([&](void* b, unsigned int size) {
+        memcpy(b, wire.data() + pos, size);
+        pos += size;
+        return static_cast<int>(size);
+    });
+
+    ServerEventReceiver key = protocol.receive_event(closed);
+    ASSERT_EQ(key.type, ServerEventReceiverType::SNAPSHOT);
+    EXPECT_EQ(key.snapshot.sequence, 5u);
+
+    ServerEventReceiver delta = protocol.receive_event(closed);
+    ASSERT_EQ(delta.type, ServerEventReceiverType::SNAPSHOT);
+    EXPECT_EQ(pos, wire.size());
+
+    const Snapshot& s = delta.snapshot;
+    EXPECT_EQ(s.sequence, 6u);
+    EXPECT_EQ(s.actual_time, 29u);
+    ASSERT_EQ(s.players.size(), 1u);
+    EXPECT_EQ(s.players[0].user_id, 42u);
+    EXPECT_EQ(s.players[0].car_life, 100);
+    EXPECT_EQ(s.players[0].car_model, 3);
+    EXPECT_EQ(s.players[0].player_position.coord_x, 15u);
+    EXPECT_EQ(s.players[0].player_position.coord_y, 20u);
+    EXPECT_EQ(s.players[0].rotation, 95u);
+    ASSERT_EQ(s.players[0].next_checkpoint.size(), 1u);
+    EXPECT_EQ(s.players[0].next_checkpoint[0].coord_x, 300u);
+
+    ASSERT_EQ(s.npcs.size(), 1u);
+    EXPECT_EQ(s.npcs[0].model, 7);
+    EXPECT_EQ(s.npcs[0].pos.coord_x, 50u);
+    EXPECT_EQ(s.npcs[0].pos.coord_y, 65u);
+    EXPECT_EQ(s.npcs[0].rotation, 180u);
+}
+
+TEST(ProtocolClientSendTest, SendSnapshotAck) {
+    MockSocket mock;
+    ProtocolClient protocol(mock);
+
+    ServerEventSender ev;
+    ev.type = ServerEventSenderType::SNAPSHOT_ACK;
+    ev.snapshot_ack = 0x01020304;
+
+    EXPECT_CALL(mock, is_stream_send_closed()).WillOnce(Return(false));
+    EXPECT_CALL(mock, sendall(_, 5)).WillOnce([](const void* data, unsigned int) {
+        const auto* b = static_cast<const uint8_t*>(data);
+        EXPECT_EQ(b[0], SEND_SNAPSHOT_ACK);
+        EXPECT_EQ(b[1], 0x01);
+        EXPECT_EQ(b[4], 0x04);
+        return 5;
+    });
+
+    protocol.send_event(ev);
+}
+
+TEST(ProtocolClientSendTest, CommandsAreFramedAfterProtocolVersion) {
+    MockSocket mock;
+    ProtocolClient protocol(mock);
+
+    ServerEventSender version;
+    version.type = ServerEventSenderType::PROTOCOL_VERSION;
+    version.protocol_version = PROTOCOL_VERSION_FRAMED;
+
+    ServerEventSender ack;
+    ack.type = ServerEventSenderType::SNAPSHOT_ACK;
+    ack.snapshot_ack = 9;
+
+    EXPECT_CALL(mock, is_stream_send_closed()).WillRepeatedly(Return(false));
+    {
+        ::testing::InSequence seq;
+        // La version misma va sin frame
+        EXPECT_CALL(mock, sendall(_, 2)).WillOnce([](const void* data, unsigned int) {
+            EXPECT_EQ(static_cast<const uint8_t*>(data)[0], SEND_PROTOCOL_VERSION);
+            return 2;
+        });
+        EXPECT_CALL(mock, sendall(_, 7)).WillOnce([](const void* data, unsigned int) {
+            const auto* b = static_cast<const uint8_t*>(data);
+            EXPECT_EQ(b[0], 0x00);
+            EXPECT_EQ(b[1], 0x05);
+            EXPECT_EQ(b[2], SEND_SNAPSHOT_ACK);
+            EXPECT_EQ(b[6], 9);
+            return 7;
+        });
+    }
+
+    protocol.send_event(version);
+    protocol.send_event(ack);
+}
+
+TEST(ProtocolClientTest, ReceiveSnapshotCompact) {
+    MockSocket mock;
+    ProtocolClient protocol(mock);
+    bool closed = false;
+
+    std::vector<uint8_t> wire;
+    auto u8 = [&](uint8_t v) { wire.push_back(v); };
+    auto u16 = [&](uint16_t v) {
+        u8(static_cast<uint8_t>(v >> 8));
+        u8(static_cast<uint8_t>(v));
+    };
+    auto u32 = [&](uint32_t v) {
+        u16(static_cast<uint16_t>(v >> 16));
+        u16(static_cast<uint16_t>(v));
+    };
+    auto varint = [&](uint32_t v) {
+        while (v >= 0x80) {
+            u8(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        u8(static_cast<uint8_t>(v));
+    };
+
+    // Pre-game con la tabla: el 2 con una celda y el 3 (la meta) con otra
+    u8(RECEIVE_PREGAME_CHECKPOINTS);
+    for (int i = 0; i < 4; i++) {
+        u32(0);
+    }
+    u8(0);
+    u16(1);
+    u8(0);
+    u32(60);
+    u32(3);
+    u16(2);
+    u16(2);
+    u8(0);
+    u16(1);
+    u32(0);
+    u32(1000);
+    u16(3);
+    u8(1);
+    u16(1);
+    u32(4000);
+    u32(0);
+
+    // Keyframe 200: mapa de 4000x2000, un jugador y un npc
+    u8(RECEIVE_SNAPSHOT_COMPACT);
+    varint(200);
+    varint(0);
+    varint(30);
+    varint(4000);
+    varint(2000);
+    u8(COMPACT_HAS_ROSTER);
+    varint(1);
+    varint(1234);
+    varint(1);
+    varint(0);
+    u8(PLAYER_COMPACT_ALL);
+    u8(0x01 | (2 << 1) | (1 << 3));  // ghost, sonido de meta, z = 1
+    varint(100);
+    varint(2);
+    u8(3);
+    u16(16384);
+    u16(65535);
+    u8(64);
+    varint(2);  // next_order
+    varint(1);  // npcs
+    varint(1);
+    varint(0);
+    u8(NPC_COMPACT_ALL);
+    u8(0);
+    varint(5);
+    u8(0);
+    u16(32768);
+    u16(32768);
+    u8(128);
+
+    // Delta 201 contra 200: solo se movio el jugador
+    u8(RECEIVE_SNAPSHOT_COMPACT);
+    varint(201);
+    varint(200);
+    varint(29);
+    varint(4000);
+    varint(2000);
+    u8(0);
+    varint(1);
+    varint(0);
+    u8(PLAYER_COMPACT_POS);
+    u16(49151);
+    u16(65535);
+    varint(1);
+    varint(0);
+
+    std::size_t pos = 0;
+    EXPECT_CALL(mock, recvall(_, _)).WillRepeatedly([&](void* b, unsigned int size) {
+        memcpy(b, wire.data() + pos, size);
+        pos += size;
+        return static_cast<int>(size);
+    });
+
+    ServerEventReceiver pre_game = protocol.receive_event(closed);
+    ASSERT_EQ(pre_game.type, ServerEventReceiverType::PREGAME);
+    EXPECT_EQ(pre_game.pre_snapshot.game_total_time, 60u);
+
+    ServerEventReceiver key = protocol.receive_event(closed);
+    ASSERT_EQ(key.type, ServerEventReceiverType::SNAPSHOT);
+    ASSERT_EQ(key.snapshot.players.size(), 1u);
+
+    const Player& p = key.snapshot.players[0];
+    EXPECT_EQ(p.user_id, 1234u);
+    EXPECT_TRUE(p.is_car_ghost);
+    EXPECT_EQ(p.type_sound, TypeSound::FINISH);
+    EXPECT_EQ(p.car_coord_z, 1);
+    EXPECT_EQ(p.car_life, 100);
+    EXPECT_EQ(p.car_animation, 3);
+    EXPECT_EQ(p.player_position.coord_x, 1000u);
+    EXPECT_EQ(p.player_position.coord_y, 2000u);
+    EXPECT_EQ(p.rotation, 90u);
+    ASSERT_EQ(p.next_checkpoint.size(), 1u);
+    EXPECT_EQ(p.next_checkpoint[0].coord_y, 1000u);
+    EXPECT_FALSE(p.is_checkpoint_finishline);
+    EXPECT_TRUE(p.is_secondary_check);
+    EXPECT_TRUE(p.is_secondary_finishline);
+    ASSERT_EQ(p.secondary_checkpoint.size(), 1u);
+    EXPECT_EQ(p.secondary_checkpoint[0].coord_x, 4000u);
+
+    ServerEventReceiver delta = protocol.receive_event(closed);
+    ASSERT_EQ(delta.type, ServerEventReceiverType::SNAPSHOT);
+    EXPECT_EQ(pos, wire.size());
+    EXPECT_EQ(delta.snapshot.sequence, 201u);
+    ASSERT_EQ(delta.snapshot.players.size(), 1u);
+    EXPECT_EQ(delta.snapshot.players[0].user_id, 1234u);
+    EXPECT_EQ(delta.snapshot.players[0].player_position.coord_x, 3000u);
+    EXPECT_EQ(delta.snapshot.players[0].car_life, 100);
+    ASSERT_EQ(delta.snapshot.npcs.size(), 1u);
+    EXPECT_EQ(delta.snapshot.npcs[0].model, 5);
+    EXPECT_EQ(delta.snapshot.npcs[0].pos.coord_x, 2000u);
+    EXPECT_EQ(delta.snapshot.npcs[0].rotation, 180u);
+}
+
+// Snapshot vieja (0x01) con un jugador con dos celdas de checkpoint y un npc
+static std::vector<uint8_t> legacy_snapshot_wire(uint32_t x) {
+    std::vector<uint8_t> wire;
+    auto u8 = [&](uint8_t v) { wire.push_back(v); };
+    auto u16 = [&](uint16_t v) {
+        u8(static_cast<uint8_t>(v >> 8));
+        u8(static_cast<uint8_t>(v));
+    };
+    auto u32 = [&](uint32_t v) {
+        u16(static_cast<uint16_t>(v >> 16));
+        u16(static_cast<uint16_t>(v));
+    };
+
+    u8(RECEIVE_SNAPSHOT);
+    u32(50);
+    u16(1);
+    u32(7);
+    u8(0);
+    u16(100);
+    u16(1);
+    u8(0);
+    u8(0);
+    u32(x);
+    u32(20);
+    u8(0);
+    u32(90);
+    u16(2);
+    u32(1);
+    u32(2);
+    u32(3);
+    u32(4);
+    u8(0);
+    u8(0);
+    u16(1);
+    u16(4);
+    u8(0);
+    u32(30);
+    u32(40);
+    u8(1);
+    u32(180);
+    return wire;
+}
+
+TEST(ProtocolClientTest, SnapshotDecodedInPlaceReusesMemory) {
+    MockSocket mock;
+    ProtocolClient protocol(mock);
+    bool closed = false;
+
+    std::vector<uint8_t> wire = legacy_snapshot_wire(10);
+    const std::vector<uint8_t> second = legacy_snapshot_wire(11);
+    wire.insert(wire.end(), second.begin(), second.end());
+
+    std::size_t pos = 0;
+    EXPECT_CALL(mock, recvall(_, _)).WillRepeatedly([&](void* b, unsigned int size) {
+        memcpy(b, wire.data() + pos, size);
+        pos += size;
+        return static_cast<int>(size);
+    });
+
+    ServerEventReceiver event;
+    Snapshot slot;
+    protocol.receive_event(closed, event, slot);
+    ASSERT_EQ(event.type, ServerEventReceiverType::SNAPSHOT);
+    ASSERT_EQ(slot.players.size(), 1u);
+    const Player* players = slot.players.data();
+    const Coords* cells = slot.players[0].next_checkpoint.data();
+
+    protocol.receive_event(closed, event, slot);
+    ASSERT_EQ(event.type, ServerEventReceiverType::SNAPSHOT);
+    EXPECT_EQ(pos, wire.size());
+    EXPECT_TRUE(event.snapshot.players.empty());
+    EXPECT_EQ(slot.players[0].player_position.coord_x, 11u);
+    ASSERT_EQ(slot.players[0].next_checkpoint.size(), 2u);
+    EXPECT_EQ(slot.players[0].next_checkpoint[1].coord_y, 4u);
+    EXPECT_EQ(slot.npcs[0].rotation, 180u);
+    // Mismo slot, mismos vectores: la segunda no pidio memoria
+    EXPECT_EQ(slot.players.data(), players);
+    EXPECT_EQ(slot.players[0].next_checkpoint.data(), cells);
+}
+
+TEST(ProtocolClientTest, ReadBufferDecodesSnapshotsFromOneRecv) {
+    MockSocket mock;
+    SocketReadBuffer buffer(mock);
+    ProtocolClient protocol(buffer);
+    bool closed = false;
+
+    std::vector<uint8_t> wire = legacy_snapshot_wire(10);
+    const std::vector<uint8_t> second = legacy_snapshot_wire(11);
+    wire.insert(wire.end(), second.begin(), second.end());
+
+    EXPECT_CALL(mock, recvall(_, _)).Times(0);
+    EXPECT_CALL(mock, recvsome(_, _))
+            .WillOnce([&](void* b, unsigned int size) {
+                EXPECT_GE(size, wire.size());
+                memcpy(b, wire.data(), wire.size());
+                return static_cast<int>(wire.size());
+            })
+            .WillOnce(Return(0));
+
+    ServerEventReceiver first = protocol.receive_event(closed);
+    ASSERT_EQ(first.type, ServerEventReceiverType::SNAPSHOT);
+    EXPECT_EQ(first.snapshot.players[0].player_position.coord_x, 10u);
+
+    ServerEventReceiver next = protocol.receive_event(closed);
+    ASSERT_EQ(next.type, ServerEventReceiverType::SNAPSHOT);
+    EXPECT_EQ(next.snapshot.players[0].player_position.coord_x, 11u);
+
+    protocol.receive_event(closed);
+    EXPECT_TRUE(closed);
+}
+
+TEST(ProtocolClientTest, ReadBufferDecodesDatagramBetweenStreamEvents) {
+    MockSocket mock;
+    SocketReadBuffer buffer(mock);
+    ProtocolClient protocol(buffer);
+    bool closed = false;
+
+    std::vector<uint8_t> wire = legacy_snapshot_wire(10);
+    const std::vector<uint8_t> second = legacy_snapshot_wire(11);
+    wire.insert(wire.end(), second.begin(), second.end());
+
+    EXPECT_CALL(mock, recvsome(_, _)).WillOnce([&](void* b, unsigned int) {
+        memcpy(b, wire.data(), wire.size());
+        return static_cast<int>(wire.size());
+    });
+
+    ServerEventReceiver event = protocol.receive_event(closed);
+    ASSERT_EQ(event.type, ServerEventReceiverType::SNAPSHOT);
+    EXPECT_TRUE(buffer.has_buffered());
+
+    // Un datagrama en el medio se lee entero sin tocar lo que quedo del stream
+    const std::vector<uint8_t> datagram = legacy_snapshot_wire(20);
+    buffer.begin_datagram(datagram.data(), datagram.size());
+    event = protocol.receive_event(closed);
+    buffer.end_datagram();
+    ASSERT_EQ(event.type, ServerEventReceiverType::SNAPSHOT);
+    EXPECT_EQ(event.snapshot.players[0].player_position.coord_x, 20u);
+
+    // Si viene cortado, no se completa con bytes del stream
+    buffer.begin_datagram(datagram.data(), datagram.size() - 1);
+    EXPECT_THROW(protocol.receive_event(closed), LibError);
+    buffer.end_datagram();
+
+    event = protocol.receive_event(closed);
+    ASSERT_EQ(event.type, ServerEventReceiverType::SNAPSHOT);
+    EXPECT_EQ(event.snapshot.players[0].player_position.coord_x, 11u);
+    EXPECT_FALSE(buffer.has_buffered());
+}
+
+TEST(ProtocolClientTest, ReceiveUdpOffer) {
+    MockSocket mock;
+    SocketReadBuffer buffer(mock);
+    ProtocolClient protocol(buffer);
+    bool closed = false;
+
+    const std::vector<uint8_t> wire = {RECEIVE_UDP_OFFER, 0x1F, 0x90, 0xAA, 0xBB, 0xCC, 0xDD};
+    EXPECT_CALL(mock, recvsome(_, _)).WillOnce([&](void* b, unsigned int) {
+        memcpy(b, wire.data(), wire.size());
+        return static_cast<int>(wire.size());
+    });
+
+    ServerEventReceiver event = protocol.receive_event(closed);
+    EXPECT_FALSE(closed);
+    ASSERT_EQ(event.type, ServerEventReceiverType::UDP_OFFER);
+    EXPECT_EQ(event.udp_port, 8080);
+    EXPECT_EQ(event.udp_token, 0xAABBCCDDu);
+}
+
+TEST(ProtocolClientSendTest, UdpDatagrams) {
+    EXPECT_EQ(ProtocolClient::encode_udp_hello(7, 0xDEADBEEF),
+              (std::vector<uint8_t>{UDP_HELLO, 0, 0, 0, 7, 0xDE, 0xAD, 0xBE, 0xEF}));
+
+    SendInputState state;
+    state.sequence = 9;
+    state.left = true;
+    state.down = true;
+    EXPECT_EQ(ProtocolClient::encode_udp_input_state(7, 1, state),
+              (std::vector<uint8_t>{UDP_INPUT_STATE, 0, 0, 0, 7, 0, 0, 0, 1, 0, 0, 0, 9,
+                                    INPUT_STATE_LEFT | INPUT_STATE_DOWN}));
+}
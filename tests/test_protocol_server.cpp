@@ -1,7 +1,12 @@
+#include <chrono>
+#include <thread>
+
 #include <arpa/inet.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "../server/conection/connection_buffers.h"
+#include "../server/conection/outbound_queue.h"
 #include "../server/conection/server_protocol.h"
 #include "../server/event.h"
 
@@ -387,7 +392,7 @@ TEST(ServerProtocolTest, SendLobbySnapshot) {
     });
 
 
-    auto* q = new Queue<std::shared_ptr<IEvent>>();
+    auto* q = new OutboundQueue();
     auto ev = std::make_shared<LobbySnapshotEvent>(std::move(lobby));
     q->push(ev);
     EXPECT_TRUE(protocol.send_event_to_client(mock, *q));
@@ -402,7 +407,7 @@ TEST(ServerProtocolTest, SendJoinError) {
         return 1;
     });
 
-    auto* q = new Queue<std::shared_ptr<IEvent>>();
+    auto* q = new OutboundQueue();
     auto ev = std::make_shared<JoinErrorEvent>();
     q->push(ev);
 
@@ -418,7 +423,7 @@ TEST(ServerProtocolTest, SendStartLobby) {
         return 1;
     });
 
-    auto* q = new Queue<std::shared_ptr<IEvent>>();
+    auto* q = new OutboundQueue();
     auto ev = std::make_shared<StartLobbyEvent>();
     q->push(ev);
 
@@ -434,7 +439,7 @@ TEST(ServerProtocolTest, SendExitJoin) {
         return 1;
     });
 
-    auto* q = new Queue<std::shared_ptr<IEvent>>();
+    auto* q = new OutboundQueue();
     auto ev = std::make_shared<ExitJoinEvent>();
     q->push(ev);
 
@@ -451,7 +456,7 @@ TEST(ServerProtocolTest, SendPhaseChange) {
         return 1;
     });
 
-    auto* q = new Queue<std::shared_ptr<IEvent>>();
+    auto* q = new OutboundQueue();
     auto ev = std::make_shared<PhaseChangeEvent>();
     q->push(ev);
 
@@ -531,7 +536,7 @@ TEST(ServerProtocolTest, PreGameSnapshot) {
         return expected_size;
     });
 
-    auto* q = new Queue<std::shared_ptr<IEvent>>();
+    auto* q = new OutboundQueue();
     auto ev = std::make_shared<PreGameSnapshotEvent>(std::move(pre_game));
     q->push(ev);
 
@@ -557,11 +562,15 @@ TEST(ServerProtocolTest, SendGameSnapshot) {
     p.y_px = 2000;
     p.z = 1;
     p.angle = 90;
-    p.next_checkpoint = {Coord{3000, 4000}};
-    p.there_is_second_checkpoint = 1;
-    p.next_next_checkpoint = {Coord{5000, 7000}};
-    p.goal = 0;
-    p.next_next_goal = 0;
+    p.next_order = 1;
+
+    // El proximo checkpoint (orden 1) y el siguiente (orden 2) salen de la tabla
+    auto table = std::make_shared<CheckpointTable>();
+    table->checkpoints = {CheckpointInfo{1, 0, {Coord{3000, 4000}}},
+                          CheckpointInfo{2, 0, {Coord{5000, 7000}}}};
+    table->index_by_order = {-1, 0, 1};
+    table->max_order = 2;
+    game.checkpoints = table;
 
     game.players.clear();
     game.players.push_back(p);
@@ -735,7 +744,7 @@ TEST(ServerProtocolTest, SendGameSnapshot) {
         return expected_size;
     });
 
-    auto* q = new Queue<std::shared_ptr<IEvent>>();
+    auto* q = new OutboundQueue();
     auto ev = std::make_shared<GameSnapshotEvent>(std::move(game));
     q->push(ev);
 
@@ -841,7 +850,7 @@ TEST(ServerProtocolTest, SendRaceResults) {
         return expected_size;
     });
 
-    auto* q = new Queue<std::shared_ptr<IEvent>>();
+    auto* q = new OutboundQueue();
     auto ev = std::make_shared<RaceResultsEvent>(std::move(rr));
     q->push(ev);
 
@@ -1022,7 +1031,7 @@ TEST(ServerProtocolTest, SendRaceResultsLast) {
         return expected_size;
     });
 
-    auto* q = new Queue<std::shared_ptr<IEvent>>();
+    auto* q = new OutboundQueue();
     auto ev = std::make_shared<RaceResultsLastEvent>(std::move(rr));
     q->push(ev);
 
@@ -1105,9 +1114,665 @@ TEST(ServerProtocolTest, SendRaceResultsLastOnlyOnePlayer) {
         return expected_size;
     });
 
-    auto* q = new Queue<std::shared_ptr<IEvent>>();
+    auto* q = new OutboundQueue();
     auto ev = std::make_shared<RaceResultsLastEvent>(std::move(rr));
     q->push(ev);
 
     EXPECT_TRUE(protocol.send_event_to_client(mock, *q));
 }
+
+TEST(ServerProtocolTest, SnapshotEncodedOnceForAllClients) {
+    GameSnapshotData game;
+    game.time_seconds_remained = 7;
+
+    PlayerSnapshot p;
+    p.id = 1;
+    p.car_life = 100;
+    p.model = 3;
+    p.animation = 0;
+    p.sound_code = 0;
+    p.x_px = 10;
+    p.y_px = 20;
+    p.z = 0;
+    p.angle = 45;
+    game.players.push_back(p);
+
+    const std::vector<uint8_t> expected = ServerProtocol::encode_snapshot_game(game);
+
+    auto ev = std::make_shared<GameSnapshotEvent>(std::move(game));
+
+    // Dos clientes, cada uno con su protocolo: los dos mandan exactamente el buffer del evento
+    const WireBuffer& wire = ev->get_wire();
+    ASSERT_EQ(*wire, expected);
+
+    for (int client = 0; client < 2; ++client) {
+        MockSocket mock;
+        ServerProtocol protocol;
+
+        EXPECT_CALL(mock, sendall(_, expected.size()))
+                .WillOnce([&](const void* data, unsigned int size) {
+                    EXPECT_EQ(data, wire->data());
+                    return static_cast<int>(size);
+                });
+
+        OutboundQueue q;
+        q.push(ev);
+        EXPECT_TRUE(protocol.send_event_to_client(mock, q));
+    }
+}
+
+TEST(ServerProtocolTest, ConstantEventsSharePreEncodedBuffer) {
+    PhaseChangeEvent a;
+    PhaseChangeEvent b;
+    StartLobbyEvent start;
+
+    EXPECT_EQ(a.get_wire(), b.get_wire());
+    ASSERT_EQ(a.get_wire()->size(), 1u);
+    EXPECT_EQ((*a.get_wire())[0], EVENT_PHASE_CHANGE);
+    EXPECT_EQ((*start.get_wire())[0], EVENT_START_LOBBY);
+}
+
+TEST(ServerProtocolTest, SnapshotDeltaOnlySendsChangedFields) {
+    PlayerSnapshot p;
+    p.id = 9;
+    p.car_life = 100;
+    p.model = 2;
+    p.x_px = 10;
+    p.y_px = 20;
+    p.angle = 90;
+
+    NpcSnapshot npc;
+    npc.model = 4;
+    npc.x_px = 50;
+    npc.y_px = 60;
+
+    GameSnapshotData first;
+    first.time_seconds_remained = 30;
+    first.players.push_back(p);
+    first.npcs.push_back(npc);
+
+    // Segunda snapshot: el jugador solo se movio en x y giro, el npc quedo igual
+    GameSnapshotData second = first;
+    second.time_seconds_remained = 29;
+    second.players[0].x_px = 15;
+    second.players[0].angle = 95;
+
+    auto ev1 = std::make_shared<GameSnapshotEvent>(std::move(first));
+    auto ev2 = std::make_shared<GameSnapshotEvent>(std::move(second));
+
+    MockSocket mock;
+    ServerProtocol protocol;
+    protocol.ack_snapshot(0);
+
+    std::vector<std::vector<uint8_t>> sent;
+    EXPECT_CALL(mock, sendall(_, _))
+            .Times(2)
+            .WillRepeatedly([&](const void* data, unsigned int size) {
+                const auto* b = static_cast<const uint8_t*>(data);
+                sent.emplace_back(b, b + size);
+                return static_cast<int>(size);
+            });
+
+    OutboundQueue q;
+    q.push(ev1);
+    EXPECT_TRUE(protocol.send_event_to_client(mock, q));
+
+    protocol.ack_snapshot(ev1->sequence);
+    q.push(ev2);
+    EXPECT_TRUE(protocol.send_event_to_client(mock, q));
+
+    ASSERT_EQ(sent.size(), 2u);
+
+    // El primero es un keyframe (baseline 0) con todos los campos
+    EXPECT_EQ(sent[0], ServerProtocol::encode_snapshot_delta(ev1->data, ev1->sequence, nullptr, 0));
+    EXPECT_EQ(sent[0][0], EVENT_SEND_SNAPSHOT_DELTA);
+
+    std::vector<uint8_t> expected;
+    OperationsBytes::add_one_byte(EVENT_SEND_SNAPSHOT_DELTA, expected);
+    OperationsBytes::add_four_bytes(ev2->sequence, expected);
+    OperationsBytes::add_four_bytes(ev1->sequence, expected);
+    OperationsBytes::add_four_bytes(29, expected);
+    OperationsBytes::add_two_bytes(1, expected);
+    OperationsBytes::add_four_bytes(9, expected);
+    OperationsBytes::add_two_bytes(PLAYER_DELTA_X | PLAYER_DELTA_ANGLE, expected);
+    OperationsBytes::add_four_bytes(15, expected);
+    OperationsBytes::add_four_bytes(95, expected);
+    OperationsBytes::add_two_bytes(1, expected);
+    OperationsBytes::add_one_byte(0, expected);  // npc sin cambios
+
+    EXPECT_EQ(sent[1], expected);
+    EXPECT_LT(sent[1].size(), ev2->get_wire()->size());
+}
+
+TEST(ServerProtocolTest, CompactSnapshotQuantizesAndPacks) {
+    GameSnapshotData game;
+    game.time_seconds_remained = 30;
+    game.map_width_px = 4000;
+    game.map_height_px = 2000;
+
+    PlayerSnapshot p;
+    p.id = 1234;
+    p.ghost = 1;
+    p.car_life = 100;
+    p.model = 2;
+    p.animation = 0;
+    p.sound_code = 2;
+    p.x_px = 1000;
+    p.y_px = 2000;
+    p.z = 1;
+    p.angle = 90;
+    p.next_order = 3;
+    game.players.push_back(p);
+
+    GameSnapshotData moved = game;
+    moved.players[0].x_px = 3000;
+
+    const auto key = ServerProtocol::encode_snapshot_compact(game, 200, nullptr, 0);
+
+    std::vector<uint8_t> expected;
+    OperationsBytes::add_one_byte(EVENT_SEND_SNAPSHOT_COMPACT, expected);
+    OperationsBytes::add_varint(200, expected);
+    OperationsBytes::add_varint(0, expected);
+    OperationsBytes::add_varint(30, expected);
+    OperationsBytes::add_varint(4000, expected);
+    OperationsBytes::add_varint(2000, expected);
+    OperationsBytes::add_one_byte(COMPACT_HAS_ROSTER, expected);
+    OperationsBytes::add_varint(1, expected);
+    OperationsBytes::add_varint(1234, expected);
+    OperationsBytes::add_varint(1, expected);  // un jugador con cambios
+    OperationsBytes::add_varint(0, expected);  // indice 0
+    OperationsBytes::add_one_byte(PLAYER_COMPACT_ALL, expected);
+    OperationsBytes::add_one_byte(0x01 | (2 << 1) | (1 << 3), expected);  // ghost, meta, z
+    OperationsBytes::add_varint(100, expected);
+    OperationsBytes::add_varint(2, expected);
+    OperationsBytes::add_one_byte(0, expected);
+    OperationsBytes::add_two_bytes(16384, expected);  // 1000 / 4000
+    OperationsBytes::add_two_bytes(65535, expected);  // 2000 / 2000
+    OperationsBytes::add_one_byte(64, expected);      // 90 grados
+    OperationsBytes::add_varint(3, expected);         // proximo checkpoint
+    OperationsBytes::add_varint(0, expected);         // npcs
+    OperationsBytes::add_varint(0, expected);
+
+    EXPECT_EQ(key, expected);
+    EXPECT_LT(key.size(), ServerProtocol::encode_snapshot_game(game).size());
+
+    // Delta: sin roster (no cambio) y solo la posicion del jugador
+    const auto delta = ServerProtocol::encode_snapshot_compact(moved, 201, &game, 200);
+    std::vector<uint8_t> expected_delta;
+    OperationsBytes::add_one_byte(EVENT_SEND_SNAPSHOT_COMPACT, expected_delta);
+    OperationsBytes::add_varint(201, expected_delta);
+    OperationsBytes::add_varint(200, expected_delta);
+    OperationsBytes::add_varint(30, expected_delta);
+    OperationsBytes::add_varint(4000, expected_delta);
+    OperationsBytes::add_varint(2000, expected_delta);
+    OperationsBytes::add_one_byte(0, expected_delta);
+    OperationsBytes::add_varint(1, expected_delta);
+    OperationsBytes::add_varint(0, expected_delta);
+    OperationsBytes::add_one_byte(PLAYER_COMPACT_POS, expected_delta);
+    OperationsBytes::add_two_bytes(49151, expected_delta);  // 3000 / 4000
+    OperationsBytes::add_two_bytes(65535, expected_delta);
+    OperationsBytes::add_varint(0, expected_delta);
+    OperationsBytes::add_varint(0, expected_delta);
+
+    EXPECT_EQ(delta, expected_delta);
+}
+
+TEST(ServerProtocolTest, NegotiatedVersionSelectsCompactSnapshots) {
+    GameSnapshotData game;
+    game.map_width_px = 100;
+    game.map_height_px = 100;
+    PlayerSnapshot p{};
+    p.id = 1;
+    game.players.push_back(p);
+    auto ev = std::make_shared<GameSnapshotEvent>(std::move(game));
+
+    MockSocket mock;
+    ServerProtocol protocol;
+    // Un cliente de una version futura habla la mas nueva del server
+    protocol.set_protocol_version(9);
+
+    EXPECT_CALL(mock, sendall(_, _)).WillOnce([](const void* data, unsigned int size) {
+        EXPECT_EQ(static_cast<const uint8_t*>(data)[0], EVENT_SEND_SNAPSHOT_COMPACT);
+        return static_cast<int>(size);
+    });
+
+    OutboundQueue q;
+    q.push(ev);
+    EXPECT_TRUE(protocol.send_event_to_client(mock, q));
+}
+
+TEST(ServerProtocolTest, QueuedEventsAreFlushedInOneWrite) {
+    MockSocket mock;
+    ServerProtocol protocol;
+
+    // Todo lo encolado sale en un solo sendallv, en orden, sin pasar por sendall
+    std::vector<uint8_t> sent;
+    EXPECT_CALL(mock, sendall(_, _)).Times(0);
+    EXPECT_CALL(mock, sendallv(_, 3)).WillOnce([&](struct iovec* iov, int iovcnt) {
+        for (int i = 0; i < iovcnt; ++i) {
+            const auto* b = static_cast<const uint8_t*>(iov[i].iov_base);
+            sent.insert(sent.end(), b, b + iov[i].iov_len);
+        }
+        return static_cast<int>(sent.size());
+    });
+
+    OutboundQueue q;
+    q.push(std::make_shared<StartLobbyEvent>());
+    q.push(std::make_shared<PhaseChangeEvent>());
+    q.push(std::make_shared<ExitJoinEvent>());
+    EXPECT_TRUE(protocol.send_event_to_client(mock, q));
+    EXPECT_EQ(protocol.get_events_sent(), 3u);
+
+    std::vector<uint8_t> expected = {EVENT_START_LOBBY, EVENT_PHASE_CHANGE, EVENT_EXIT_JOIN};
+    EXPECT_EQ(sent, expected);
+}
+
+TEST(OutboundQueueTest, NewSnapshotReplacesUnsentOne) {
+    OutboundQueue q;
+    auto old_snap = std::make_shared<GameSnapshotEvent>(GameSnapshotData{});
+    auto new_snap = std::make_shared<GameSnapshotEvent>(GameSnapshotData{});
+    auto start = std::make_shared<StartLobbyEvent>();
+
+    q.push(start);
+    q.push(old_snap);
+    q.push(new_snap);
+
+    // El control sale primero y de las snapshots solo queda la ultima
+    EXPECT_EQ(q.pop(), start);
+    EXPECT_EQ(q.pop(), new_snap);
+    std::shared_ptr<IEvent> ev;
+    EXPECT_FALSE(q.try_pop(ev));
+}
+
+TEST(OutboundQueueTest, ReplacedSnapshotKeepsOneShotFields) {
+    OutboundQueue q;
+
+    PlayerSnapshot crashed{};
+    crashed.id = 1;
+    crashed.animation = 3;
+    crashed.sound_code = 2;
+    NpcSnapshot npc_crashed{};
+    npc_crashed.model = 4;
+    npc_crashed.animation = 1;
+    npc_crashed.x_px = 100;
+    GameSnapshotData old_data;
+    old_data.players.push_back(crashed);
+    old_data.npcs.push_back(npc_crashed);
+
+    PlayerSnapshot quiet = crashed;
+    quiet.animation = 0;
+    quiet.sound_code = 1;
+    quiet.x_px = 50;
+    NpcSnapshot npc_quiet = npc_crashed;
+    npc_quiet.animation = 0;
+    npc_quiet.x_px = 104;
+    GameSnapshotData new_data;
+    new_data.players.push_back(quiet);
+    new_data.npcs.push_back(npc_quiet);
+
+    auto new_snap = std::make_shared<GameSnapshotEvent>(new_data);
+    q.push(std::make_shared<GameSnapshotEvent>(old_data));
+    q.push(new_snap);
+
+    // Sale la posicion nueva con el choque y el sonido de la que se piso; la compartida no se
+    // toca
+    auto sent = std::dynamic_pointer_cast<GameSnapshotEvent>(q.pop());
+    ASSERT_TRUE(sent);
+    EXPECT_NE(sent, new_snap);
+    EXPECT_EQ(sent->data.players[0].x_px, 50u);
+    EXPECT_EQ(sent->data.players[0].animation, 3);
+    EXPECT_EQ(sent->data.players[0].sound_code, 2);
+    EXPECT_EQ(sent->data.npcs[0].x_px, 104u);
+    EXPECT_EQ(sent->data.npcs[0].animation, 1);
+    EXPECT_EQ(new_snap->data.players[0].animation, 0);
+}
+
+TEST(OutboundQueueTest, ControlEventKeepsPendingSnapshotBeforeIt) {
+    OutboundQueue q;
+    auto snap = std::make_shared<GameSnapshotEvent>(GameSnapshotData{});
+    auto phase = std::make_shared<PhaseChangeEvent>();
+    auto next_snap = std::make_shared<GameSnapshotEvent>(GameSnapshotData{});
+
+    q.push(snap);
+    q.push(phase);
+    q.push(next_snap);
+
+    EXPECT_EQ(q.pop(), snap);
+    EXPECT_EQ(q.pop(), phase);
+    EXPECT_EQ(q.pop(), next_snap);
+}
+
+TEST(OutboundQueueTest, OverflowClosesQueueAndDropsPending) {
+    // Dos eventos de 1 byte entran, el tercero pasa el tope
+    OutboundQueue q(2);
+    q.push(std::make_shared<StartLobbyEvent>());
+    q.push(std::make_shared<ExitJoinEvent>());
+    EXPECT_FALSE(q.is_overflowed());
+
+    q.push(std::make_shared<JoinErrorEvent>());
+    EXPECT_TRUE(q.is_overflowed());
+    EXPECT_THROW(q.pop(), ClosedQueue);
+    EXPECT_THROW(q.push(std::make_shared<StartLobbyEvent>()), ClosedQueue);
+}
+
+TEST(OutboundQueueTest, ClientThatStopsReadingOverflowsByLag) {
+    OutboundQueue q(0, std::chrono::milliseconds(1));
+    q.push(std::make_shared<GameSnapshotEvent>(GameSnapshotData{}));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    // Nadie saco nada en todo ese tiempo
+    q.push(std::make_shared<GameSnapshotEvent>(GameSnapshotData{}));
+    EXPECT_TRUE(q.is_overflowed());
+}
+
+TEST(ServerProtocolTest, PreGameCarriesCheckpointTableForCompactClients) {
+    auto table = std::make_shared<CheckpointTable>();
+    table->checkpoints = {CheckpointInfo{1, 0, {Coord{10, 20}, Coord{30, 40}}},
+                          CheckpointInfo{2, 1, {Coord{50, 60}}}};
+    table->index_by_order = {-1, 0, 1};
+    table->max_order = 2;
+
+    PreGameSnapshotData pre;
+    pre.remaining_races = 2;
+    pre.pole = PoleCoordsAndDirec{Coord{1, 2}, Coord{3, 4}, 1};
+    pre.race_total_time_seconds = 100;
+    pre.race_move_enabled_time_seconds = 90;
+    pre.checkpoints = table;
+
+    auto ev = std::make_shared<PreGameSnapshotEvent>(pre);
+
+    std::vector<uint8_t> expected = ServerProtocol::encode_pre_game_snapshot(pre);
+    expected[0] = EVENT_PRE_GAME_CHECKPOINTS;
+    OperationsBytes::add_two_bytes(2, expected);
+    OperationsBytes::add_two_bytes(1, expected);
+    OperationsBytes::add_one_byte(0, expected);
+    OperationsBytes::add_two_bytes(2, expected);
+    OperationsBytes::add_four_bytes(10, expected);
+    OperationsBytes::add_four_bytes(20, expected);
+    OperationsBytes::add_four_bytes(30, expected);
+    OperationsBytes::add_four_bytes(40, expected);
+    OperationsBytes::add_two_bytes(2, expected);
+    OperationsBytes::add_one_byte(1, expected);
+    OperationsBytes::add_two_bytes(1, expected);
+    OperationsBytes::add_four_bytes(50, expected);
+    OperationsBytes::add_four_bytes(60, expected);
+
+    // Cliente viejo: la pre-game de siempre. Cliente compacto: con la tabla
+    for (uint8_t version: {PROTOCOL_VERSION_LEGACY, PROTOCOL_VERSION_COMPACT}) {
+        MockSocket mock;
+        ServerProtocol protocol;
+        protocol.set_protocol_version(version);
+
+        const std::vector<uint8_t> want = (version == PROTOCOL_VERSION_LEGACY) ?
+                                                  ServerProtocol::encode_pre_game_snapshot(pre) :
+                                                  expected;
+        EXPECT_CALL(mock, sendall(_, want.size()))
+                .WillOnce([&](const void* data, unsigned int size) {
+                    const auto* b = static_cast<const uint8_t*>(data);
+                    EXPECT_EQ(std::vector<uint8_t>(b, b + size), want);
+                    return static_cast<int>(size);
+                });
+
+        OutboundQueue q;
+        q.push(ev);
+        EXPECT_TRUE(protocol.send_event_to_client(mock, q));
+    }
+}
+
+TEST(ServerProtocolTest, FramedCommandsAreParsedFromOneRecv) {
+    MockSocket mock;
+    ServerProtocol protocol;
+    protocol.set_protocol_version(PROTOCOL_VERSION_FRAMED);
+
+    // Move, create lobby con dos mapas, ack y un move con un byte de mas (se ignora)
+    const std::vector<uint8_t> wire = {
+            0x00, 0x02, INPUT_KEY, 0x03,
+            0x00, 0x0E, CREATE_LOBBY, 0x02, 0x00, 0x02, 'y', 'o', 0x00, 0x02,
+            0x00, 0x01, 'a', 0x00, 0x01, 'b',
+            0x00, 0x05, CMD_SNAPSHOT_ACK, 0x00, 0x00, 0x01, 0x2C,
+            0x00, 0x03, INPUT_KEY, 0x01, 0xFF,
+    };
+
+    EXPECT_CALL(mock, recvall(_, _)).Times(0);
+    EXPECT_CALL(mock, recvsome(_, _))
+            .WillOnce([&](void* b, unsigned int size) {
+                EXPECT_GE(size, wire.size());
+                memcpy(b, wire.data(), wire.size());
+                return static_cast<int>(wire.size());
+            })
+            .WillOnce(Return(0));
+
+    ASSERT_EQ(protocol.get_type_of_command(mock), CommandReceiverType::Move);
+    EXPECT_EQ(protocol.get_command_move(mock, 1).param, 0x03);
+
+    ASSERT_EQ(protocol.get_type_of_command(mock), CommandReceiverType::CreateLobby);
+    auto lobby = protocol.get_command_create_lobby(mock, 1);
+    EXPECT_EQ(lobby.name, "yo");
+    ASSERT_EQ(lobby.maps.size(), 2u);
+    EXPECT_EQ(lobby.maps[1], "b");
+
+    ASSERT_EQ(protocol.get_type_of_command(mock), CommandReceiverType::SnapshotAck);
+    EXPECT_EQ(protocol.get_snapshot_ack(mock), 300u);
+
+    ASSERT_EQ(protocol.get_type_of_command(mock), CommandReceiverType::Move);
+    EXPECT_EQ(protocol.get_command_move(mock, 1).param, 0x01);
+
+    EXPECT_EQ(protocol.get_type_of_command(mock), CommandReceiverType::DefiniteDisconect);
+}
+
+TEST(ServerProtocolTest, FramedCommandSplitAcrossRecvs) {
+    MockSocket mock;
+    ServerProtocol protocol;
+    protocol.set_protocol_version(PROTOCOL_VERSION_FRAMED);
+
+    const std::vector<uint8_t> wire = {0x00, 0x05, CMD_SNAPSHOT_ACK, 0x00, 0x00, 0x00, 0x07};
+    std::size_t pos = 0;
+    // El kernel entrega de a tres bytes
+    EXPECT_CALL(mock, recvsome(_, _)).WillRepeatedly([&](void* b, unsigned int size) {
+        const std::size_t n = std::min<std::size_t>({3, size, wire.size() - pos});
+        memcpy(b, wire.data() + pos, n);
+        pos += n;
+        return static_cast<int>(n);
+    });
+
+    ASSERT_EQ(protocol.get_type_of_command(mock), CommandReceiverType::SnapshotAck);
+    EXPECT_EQ(protocol.get_snapshot_ack(mock), 7u);
+}
+
+TEST(ServerProtocolTest, FramedCommandFieldPastEndThrows) {
+    MockSocket mock;
+    ServerProtocol protocol;
+    protocol.set_protocol_version(PROTOCOL_VERSION_FRAMED);
+
+    // El ack dice tener 4 bytes pero el frame trae 2
+    const std::vector<uint8_t> wire = {0x00, 0x03, CMD_SNAPSHOT_ACK, 0x00, 0x01};
+    EXPECT_CALL(mock, recvsome(_, _)).WillOnce([&](void* b, unsigned int) {
+        memcpy(b, wire.data(), wire.size());
+        return static_cast<int>(wire.size());
+    });
+
+    ASSERT_EQ(protocol.get_type_of_command(mock), CommandReceiverType::SnapshotAck);
+    EXPECT_THROW(protocol.get_snapshot_ack(mock), FrameError);
+}
+
+TEST(ServerProtocolTest, SnapshotGoesByDatagramWhenTheSinkTakesIt) {
+    GameSnapshotData game;
+    game.map_width_px = 100;
+    game.map_height_px = 100;
+    auto first = std::make_shared<GameSnapshotEvent>(game);
+    auto second = std::make_shared<GameSnapshotEvent>(game);
+
+    MockSocket mock;
+    ServerProtocol protocol;
+    protocol.set_protocol_version(PROTOCOL_VERSION_UDP);
+
+    // El primero no entra en un datagrama y sale por TCP; el segundo va por UDP
+    std::vector<WireBuffer> datagrams;
+    bool take = false;
+    protocol.set_datagram_sink([&](const WireBuffer& wire) {
+        if (take) {
+            datagrams.push_back(wire);
+        }
+        return take;
+    });
+
+    EXPECT_CALL(mock, sendall(_, _)).WillOnce([](const void* data, unsigned int size) {
+        EXPECT_EQ(static_cast<const uint8_t*>(data)[0], EVENT_SEND_SNAPSHOT_COMPACT);
+        return static_cast<int>(size);
+    });
+    EXPECT_TRUE(protocol.send_snapshot_event(mock, first));
+
+    take = true;
+    EXPECT_TRUE(protocol.send_snapshot_event(mock, second));
+    ASSERT_EQ(datagrams.size(), 1u);
+    EXPECT_EQ((*datagrams[0])[0], EVENT_SEND_SNAPSHOT_COMPACT);
+}
+
+TEST(ServerProtocolTest, UdpOfferAndReady) {
+    const std::vector<uint8_t> offer = ServerProtocol::encode_udp_offer(8080, 0xAABBCCDD);
+    EXPECT_EQ(offer, (std::vector<uint8_t>{EVENT_UDP_OFFER, 0x1F, 0x90, 0xAA, 0xBB, 0xCC, 0xDD}));
+
+    MockSocket mock;
+    ServerProtocol protocol;
+    EXPECT_CALL(mock, recvall(_, 1)).WillOnce([](void* b, unsigned int) {
+        reinterpret_cast<uint8_t*>(b)[0] = CMD_UDP_READY;
+        return 1;
+    });
+    EXPECT_EQ(protocol.get_type_of_command(mock), CommandReceiverType::UdpReady);
+}
+
+TEST(ServerProtocolTest, DecodeUdpDatagrams) {
+    CommandReceiverUdp cmd;
+
+    const std::vector<uint8_t> hello = {UDP_HELLO, 0, 0, 0, 7, 0xDE, 0xAD, 0xBE, 0xEF};
+    ASSERT_TRUE(ServerProtocol::decode_udp_datagram(hello.data(), hello.size(), cmd));
+    EXPECT_EQ(cmd.op, UDP_HELLO);
+    EXPECT_EQ(cmd.client_id, 7);
+    EXPECT_EQ(cmd.token, 0xDEADBEEFu);
+
+    const std::vector<uint8_t> input = {UDP_INPUT, 0, 0, 0, 7, 0, 0, 0, 1, 2,
+                                        0,         0, 0, 4, 0x00, 0, 0, 0, 5, 0x04};
+    ASSERT_TRUE(ServerProtocol::decode_udp_datagram(input.data(), input.size(), cmd));
+    EXPECT_EQ(cmd.op, UDP_INPUT);
+    EXPECT_EQ(cmd.token, 1u);
+    ASSERT_EQ(cmd.inputs.size(), 2u);
+    EXPECT_EQ(cmd.inputs[0].sequence, 4u);
+    EXPECT_EQ(cmd.inputs[0].key, 0x00);
+    EXPECT_EQ(cmd.inputs[1].sequence, 5u);
+    EXPECT_EQ(cmd.inputs[1].key, 0x04);
+
+    // Cortado, opcode ajeno o mas inputs de los que puede traer: se ignora
+    EXPECT_FALSE(ServerProtocol::decode_udp_datagram(input.data(), input.size() - 1, cmd));
+    const std::vector<uint8_t> other = {0x99, 0, 0, 0, 7, 0, 0, 0, 1};
+    EXPECT_FALSE(ServerProtocol::decode_udp_datagram(other.data(), other.size(), cmd));
+    std::vector<uint8_t> too_many = {UDP_INPUT, 0, 0, 0, 7, 0, 0, 0, 1, UDP_MAX_INPUTS + 1};
+    too_many.resize(too_many.size() + (UDP_MAX_INPUTS + 1) * 5);
+    EXPECT_FALSE(ServerProtocol::decode_udp_datagram(too_many.data(), too_many.size(), cmd));
+}
+
+TEST(ServerProtocolTest, DecodeUdpInputState) {
+    CommandReceiverUdp cmd;
+
+    // Los bits de mas (no son teclas) se descartan
+    const uint8_t keys = INPUT_STATE_W | INPUT_STATE_D | 0x80;
+    const std::vector<uint8_t> state = {UDP_INPUT_STATE, 0, 0, 0, 7, 0, 0, 0, 1, 0, 0, 1, 2, keys};
+    ASSERT_TRUE(ServerProtocol::decode_udp_datagram(state.data(), state.size(), cmd));
+    EXPECT_EQ(cmd.op, UDP_INPUT_STATE);
+    EXPECT_EQ(cmd.client_id, 7);
+    EXPECT_EQ(cmd.token, 1u);
+    EXPECT_EQ(cmd.state.sequence, 0x0102u);
+    EXPECT_EQ(cmd.state.key, INPUT_STATE_W | INPUT_STATE_D);
+    EXPECT_TRUE(cmd.inputs.empty());
+
+    EXPECT_FALSE(ServerProtocol::decode_udp_datagram(state.data(), state.size() - 1, cmd));
+}
+
+static void append(InputBuffer& in, const std::vector<uint8_t>& bytes, std::size_t from,
+                   std::size_t to) {
+    memcpy(in.write_area(to - from), bytes.data() + from, to - from);
+    in.commit_write(to - from);
+}
+
+TEST(InputBufferTest, LegacyCommandCutInHalfIsRetriedWhole) {
+    InputBuffer in;
+    ServerProtocol protocol;
+
+    const std::vector<uint8_t> wire = {CREATE_LOBBY, 0x05, 0x00, 0x03, 'A', 'n', 'a',
+                                       0x00, 0x01,   0x00, 0x04, 'c',  'i', 't', 'y'};
+    // Llega hasta la mitad del nombre
+    append(in, wire, 0, 6);
+
+    in.begin_command();
+    ASSERT_EQ(protocol.get_type_of_command(in), CommandReceiverType::CreateLobby);
+    EXPECT_THROW(protocol.get_command_create_lobby(in, 1), NeedMoreInput);
+    in.rollback();
+    EXPECT_EQ(in.pending(), 6u);
+
+    append(in, wire, 6, wire.size());
+    in.begin_command();
+    ASSERT_EQ(protocol.get_type_of_command(in), CommandReceiverType::CreateLobby);
+    auto cmd = protocol.get_command_create_lobby(in, 1);
+    EXPECT_EQ(cmd.model_car, 5);
+    EXPECT_EQ(cmd.name, "Ana");
+    ASSERT_EQ(cmd.maps.size(), 1u);
+    EXPECT_EQ(cmd.maps[0], "city");
+    EXPECT_EQ(in.pending(), 0u);
+
+    // Sin nada mas pendiente, se espera al proximo comando
+    in.begin_command();
+    EXPECT_THROW(protocol.get_type_of_command(in), NeedMoreInput);
+}
+
+TEST(InputBufferTest, FramedCommandsOnlyHandOutWholeFrames) {
+    InputBuffer in;
+    ServerProtocol protocol;
+    protocol.set_protocol_version(PROTOCOL_VERSION_FRAMED);
+    in.set_framed(true);
+
+    const std::vector<uint8_t> wire = {0x00, 0x05, CMD_SNAPSHOT_ACK, 0x00, 0x00, 0x00, 0x07,
+                                       0x00, 0x02, INPUT_KEY,        0x03};
+    // El ack entero y la mitad del move
+    append(in, wire, 0, 9);
+
+    in.begin_command();
+    ASSERT_EQ(protocol.get_type_of_command(in), CommandReceiverType::SnapshotAck);
+    EXPECT_EQ(protocol.get_snapshot_ack(in), 7u);
+
+    in.begin_command();
+    EXPECT_THROW(protocol.get_type_of_command(in), NeedMoreInput);
+    in.rollback();
+
+    append(in, wire, 9, wire.size());
+    in.begin_command();
+    ASSERT_EQ(protocol.get_type_of_command(in), CommandReceiverType::Move);
+    EXPECT_EQ(protocol.get_command_move(in, 1).param, 0x03);
+    EXPECT_EQ(in.pending(), 0u);
+}
+
+TEST(InputBufferTest, FramedInputState) {
+    InputBuffer in;
+    ServerProtocol protocol;
+    protocol.set_protocol_version(PROTOCOL_VERSION_INPUT_STATE);
+    in.set_framed(true);
+
+    const std::vector<uint8_t> wire = {0x00, 0x06, CMD_INPUT_STATE, 0x00, 0x00, 0x00, 0x2A,
+                                       INPUT_STATE_A | INPUT_STATE_S};
+    append(in, wire, 0, wire.size());
+
+    in.begin_command();
+    ASSERT_EQ(protocol.get_type_of_command(in), CommandReceiverType::InputState);
+    auto cmd = protocol.get_command_input_state(in, 3);
+    EXPECT_EQ(cmd.client_id, 3);
+    EXPECT_EQ(cmd.type, CommandReceiverType::InputState);
+    EXPECT_EQ(cmd.sequence, 42u);
+    EXPECT_EQ(cmd.param, INPUT_STATE_A | INPUT_STATE_S);
+    EXPECT_EQ(in.pending(), 0u);
+}
+
+TEST(InputBufferTest, ClosedConnectionEndsTheCommandStream) {
+    InputBuffer in;
+    ServerProtocol protocol;
+
+    in.set_eof();
+    EXPECT_EQ(protocol.get_type_of_command(in), CommandReceiverType::DefiniteDisconect);
+}
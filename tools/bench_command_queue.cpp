@@ -0,0 +1,116 @@
+// Microbenchmark de la cola de comandos del gameloop: Queue (mutex + condvar) contra
+// MpscQueue (ring lock-free). N receivers pushean comandos a la vez y despues el consumidor
+// los saca en una tanda, como hace el gameloop en cada tick.
+//
+// Uso: taller_bench_command_queue [productores] [comandos por productor]
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../common/mpsc_queue.h"
+#include "../common/queue.h"
+#include "../server/command.h"
+
+using BenchClock = std::chrono::steady_clock;
+
+static CommandReceiver make_command(int producer, int i) {
+    CommandReceiver cmd;
+    cmd.client_id = producer;
+    cmd.type = CommandReceiverType::Move;
+    cmd.param = static_cast<uint8_t>(i);
+    // Un nombre que no entra en el SSO, para que copiar cueste lo que cuesta con un NewCar
+    cmd.name = "jugador_con_nombre_largo_" + std::to_string(producer);
+    return cmd;
+}
+
+struct BenchResult {
+    double push_seconds;
+    double drain_seconds;
+};
+
+// Primero los productores pushean todos a la vez (lo que pagan los receivers, con contencion)
+// y despues el consumidor saca todo de una, como el gameloop al principio de un tick
+template <typename Push, typename DrainAll>
+static BenchResult run(int producers, int per_producer, Push push, DrainAll drain_all) {
+    const long total = static_cast<long>(producers) * per_producer;
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    threads.reserve(producers);
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (int i = 0; i < per_producer; ++i) {
+                push(make_command(p, i));
+            }
+        });
+    }
+
+    const auto start = BenchClock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& t: threads) t.join();
+    const auto pushed = BenchClock::now();
+
+    const long received = drain_all();
+    const auto drained = BenchClock::now();
+    if (received != total) {
+        std::cerr << "Se perdieron comandos: " << received << " de " << total << "\n";
+    }
+
+    return {std::chrono::duration<double>(pushed - start).count(),
+            std::chrono::duration<double>(drained - pushed).count()};
+}
+
+static void report(const std::string& name, long total, const BenchResult& r) {
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed
+              << std::setprecision(1) << "push " << std::setw(8)
+              << (r.push_seconds * 1e9 / total) << " ns/cmd   drain " << std::setw(8)
+              << (r.drain_seconds * 1e9 / total) << " ns/cmd\n";
+}
+
+int main(int argc, char* argv[]) {
+    const int producers = argc > 1 ? std::atoi(argv[1]) : 8;
+    const int per_producer = argc > 2 ? std::atoi(argv[2]) : 200000;
+    const long total = static_cast<long>(producers) * per_producer;
+    if (producers <= 0 || per_producer <= 0) {
+        std::cerr << "Uso: " << argv[0] << " [productores] [comandos por productor]\n";
+        return 1;
+    }
+
+    std::cout << producers << " productores, " << total << " comandos\n";
+
+    {
+        Queue<CommandReceiver> q;
+        BenchResult r = run(
+                producers, per_producer, [&](CommandReceiver&& cmd) { q.push(cmd); },
+                [&]() {
+                    long n = 0;
+                    CommandReceiver cmd;
+                    while (q.try_pop(cmd)) {
+                        ++n;
+                    }
+                    return n;
+                });
+        report("Queue", total, r);
+    }
+
+    {
+        // Con lugar para todo: aca se mide el costo de encolar, no el de esperar a que se libere
+        MpscQueue<CommandReceiver> q(static_cast<std::size_t>(total));
+        BenchResult r = run(
+                producers, per_producer,
+                [&](CommandReceiver&& cmd) { q.push(std::move(cmd)); },
+                [&]() { return static_cast<long>(q.drain([](CommandReceiver&) {})); });
+        report("MpscQueue", total, r);
+    }
+
+    return 0;
+}
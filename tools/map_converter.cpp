@@ -0,0 +1,60 @@
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "../common/map_file.h"
+#include "../common/resource_paths.h"
+
+// Convierte un mapa .json del editor al formato binario .n4smap (queda al lado del json)
+static bool convert(const std::string& json_path) {
+    try {
+        std::ifstream file(json_path);
+        if (!file) {
+            std::cerr << "No se puede abrir el archivo " << json_path << "\n";
+            return false;
+        }
+        nlohmann::json j;
+        file >> j;
+
+        const std::string binary_path = MapFile::binary_path_for(json_path);
+        MapFile::write(binary_path, MapFile::from_json(j));
+
+        // Lo volvemos a abrir para validar header y checksum
+        MappedMapFile check(binary_path);
+        std::cout << json_path << " -> " << binary_path << "\n";
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << json_path << ": " << e.what() << "\n";
+        return false;
+    }
+}
+
+// ./taller_map_converter [mapa.json ...]
+// Sin argumentos convierte todos los mapas jugables del usuario
+int main(int argc, char* argv[]) {
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        paths.emplace_back(argv[i]);
+    }
+
+    if (paths.empty()) {
+        ResourcePaths::init();
+        for (const auto& entry: std::filesystem::directory_iterator(ResourcePaths::userMaps())) {
+            if (entry.is_regular_file() && entry.path().extension() == ".json") {
+                paths.push_back(entry.path().string());
+            }
+        }
+    }
+
+    bool ok = true;
+    for (const auto& path: paths) {
+        ok = convert(path) && ok;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}